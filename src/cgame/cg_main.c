@@ -1964,6 +1964,9 @@ void CG_Init( int serverMessageNum, int serverCommandSequence, int clientNum )
 
   CG_InitConsoleCommands( );
 
+  // the "csm" handler is registered, let the server batch configstrings
+  trap_Cvar_Set( "cl_csm", "1" );
+
   String_Init( );
 
   CG_AssetCache( );
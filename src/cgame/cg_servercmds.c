@@ -301,20 +301,13 @@ static void CG_AnnounceHumanStageTransistion( stage_t from, stage_t to )
 
 /*
 ================
-CG_ConfigStringModified
+CG_ConfigStringChanged
 
 ================
 */
-static void CG_ConfigStringModified( void )
+static void CG_ConfigStringChanged( int num )
 {
   const char  *str;
-  int         num;
-
-  num = atoi( CG_Argv( 1 ) );
-
-  // get the gamestate from the client system, which will have the
-  // new configstring already integrated
-  trap_GetGameState( &cgs.gameState );
 
   // look up the individual string that was modified
   str = CG_ConfigString( num );
@@ -426,6 +419,43 @@ static void CG_ConfigStringModified( void )
   }
 }
 
+/*
+================
+CG_ConfigStringModified
+
+================
+*/
+static void CG_ConfigStringModified( void )
+{
+  // get the gamestate from the client system, which will have the
+  // new configstring already integrated
+  trap_GetGameState( &cgs.gameState );
+
+  CG_ConfigStringChanged( atoi( CG_Argv( 1 ) ) );
+}
+
+/*
+================
+CG_ConfigStringsModified
+
+A batch of configstring changes, "csm <num> <string> <num> <string> ..."
+================
+*/
+static void CG_ConfigStringsModified( void )
+{
+  int nums[ MAX_STRING_TOKENS / 2 ];
+  int i, count = 0;
+
+  // the handlers may tokenize other commands, read the indexes first
+  for( i = 1; i + 1 < trap_Argc( ) && count < (int)ARRAY_LEN( nums ); i += 2 )
+    nums[ count++ ] = atoi( CG_Argv( i ) );
+
+  trap_GetGameState( &cgs.gameState );
+
+  for( i = 0; i < count; i++ )
+    CG_ConfigStringChanged( nums[ i ] );
+}
+
 
 /*
 ===============
@@ -1394,6 +1424,7 @@ static consoleCommand_t svcommands[ ] =
   { "cmds", CG_GameCmds_f },
   { "cp", CG_CenterPrint_f },
   { "cs", CG_ConfigStringModified },
+  { "csm", CG_ConfigStringsModified },
   { "map_restart", CG_MapRestart },
   { "poisoncloud", CG_PoisonCloud_f },
   { "print", CG_Print_f },
@@ -183,17 +183,14 @@ void CL_AddCgameCommand( const char *cmdName ) {
 
 /*
 =====================
-CL_ConfigstringModified
+CL_SetConfigstring
 =====================
 */
-void CL_ConfigstringModified( void )
+static void CL_SetConfigstring( int idx, const char *s )
 {
-	int idx = atoi( Cmd_Argv(1) );
 	if ( idx < 0 || idx >= MAX_CONFIGSTRINGS )
 		Com_Error( ERR_DROP, "CL_ConfigstringModified: bad index %i", idx );
 
-	// get everything after "cs <num>"
-	const char* s = Cmd_ArgsFrom(2);
 	const char* old = cl.gameState.stringData + cl.gameState.stringOffsets[ idx ];
 	if ( !strcmp(old, s) )
 		return;
@@ -234,6 +231,17 @@ void CL_ConfigstringModified( void )
 	}
 }
 
+/*
+=====================
+CL_ConfigstringModified
+=====================
+*/
+void CL_ConfigstringModified( void )
+{
+	// get everything after "cs <num>"
+	CL_SetConfigstring( atoi( Cmd_Argv(1) ), Cmd_ArgsFrom(2) );
+}
+
 
 /*
 ===================
@@ -323,6 +331,19 @@ rescan:
 		return true;
 	}
 
+	if ( !strcmp( cmd, "csm" ) )
+    {
+		// several "cs" in one command, pairs of index and string
+		for ( int i = 1; i + 1 < argc; i += 2 )
+        {
+			// CL_SetConfigstring may have done another Cmd_TokenizeString()
+			Cmd_TokenizeString( s );
+			CL_SetConfigstring( atoi( Cmd_Argv(i) ), Cmd_Argv(i + 1) );
+		}
+		Cmd_TokenizeString( s );
+		return true;
+	}
+
 	if ( !strcmp( cmd, "map_restart" ) )
     {
 		// clear notify lines and outgoing commands before passing
@@ -386,6 +407,9 @@ void CL_ShutdownCGame( void ) {
 	VM_Call( cls.cgame, CG_SHUTDOWN );
 	VM_Free( cls.cgame );
 	cls.cgame = NULL;
+
+	// the next cgame may not understand "csm"
+	Cvar_Set( "cl_csm", "0" );
 }
 
 static int	FloatAsInt( float f ) {
@@ -795,6 +819,9 @@ void CL_InitCGame( void ) {
 			interpret = VMI_COMPILED;
 	}
 
+	// only a cgame that handles "csm" turns batching back on
+	Cvar_Set( "cl_csm", "0" );
+
 	cls.cgame = VM_Create( "cgame", CL_CgameSystemCalls, interpret );
 	if ( !cls.cgame ) {
 		Com_Error( ERR_DROP, "VM_Create on cgame failed" );
@@ -925,7 +952,8 @@ void CL_AdjustTimeDelta( void ) {
 		return;
 	}
 
-	newDelta = cl.snap.serverTime - cls.realtime;
+	// measure from when the snapshot arrived, not from when this frame got to it
+	newDelta = cl.snap.serverTime - ( cls.realtime - cl.snap.receiveDelay );
 	deltaDelta = abs( newDelta - cl.serverTimeDelta );
 
 	if ( deltaDelta > RESET_TIME ) {
@@ -977,7 +1005,7 @@ void CL_FirstSnapshot( void ) {
 	clc.state = CA_ACTIVE;
 
 	// set the timedelta so we are exactly on this first frame
-	cl.serverTimeDelta = cl.snap.serverTime - cls.realtime;
+	cl.serverTimeDelta = cl.snap.serverTime - ( cls.realtime - cl.snap.receiveDelay );
 	cl.oldServerTime = cl.snap.serverTime;
 
 	clc.timeDemoBaseTime = cl.snap.serverTime;
@@ -829,6 +829,13 @@ static void CL_Record_f(void)
     MSG_WriteByte(&buf, svc_gamestate);
     MSG_WriteLong(&buf, clc.serverCommandSequence);
 
+    // the recorded snapshots use the profiled field tables
+    if (clc.netFields)
+    {
+        MSG_WriteByte(&buf, svc_netfields);
+        MSG_WriteLong(&buf, MSG_NetFieldsChecksum());
+    }
+
     // configstrings
     for (i = 0; i < MAX_CONFIGSTRINGS; i++)
     {
@@ -852,7 +859,7 @@ static void CL_Record_f(void)
             continue;
         }
         MSG_WriteByte(&buf, svc_baseline);
-        MSG_WriteDeltaEntity(clc.netchan.alternateProtocol, &buf, &nullstate, ent, true);
+        MSG_WriteDeltaEntity(CL_DeltaProtocol(), &buf, &nullstate, ent, true);
     }
 
     MSG_WriteByte(&buf, svc_EOF);
@@ -3980,14 +3987,16 @@ static void CL_ConnectionlessPacket(netadr_t from, msg_t *msg)
 =================
 CL_PacketEvent
 
-A packet has arrived from the main event loop
+A packet has arrived from the main event loop, delay msec ago when it
+was picked up early by the net_recvThread receive thread
 =================
 */
-void CL_PacketEvent(netadr_t from, msg_t *msg)
+void CL_PacketEvent(netadr_t from, msg_t *msg, int delay)
 {
     int headerBytes;
 
     clc.lastPacketTime = cls.realtime;
+    clc.packetDelay = delay * com_timescale->value;
 
     if (msg->cursize >= 4 && *(int *)msg->data == -1)
     {
@@ -4764,6 +4773,10 @@ static void CL_InitRef(void)
     ri.FS_ListFiles = FS_ListFiles;
     ri.FS_FileIsInPAK = FS_FileIsInPAK;
     ri.FS_FileExists = FS_FileExists;
+    ri.FS_PakFileChecksum = FS_PakFileChecksum;
+    ri.FS_MapHomeFile = FS_MapHomeFile;
+    ri.FS_UnmapHomeFile = FS_UnmapHomeFile;
+    ri.FS_PruneHomeDir = FS_PruneHomeDir;
     ri.Cvar_Get = Cvar_Get;
     ri.Cvar_Set = Cvar_Set;
     ri.Cvar_SetValue = Cvar_SetValue;
@@ -4979,6 +4992,17 @@ void CL_Init(void)
     cl_voipProtocol = Cvar_Get("cl_voipProtocol", cl_voip->integer ? "opus" : "", CVAR_USERINFO | CVAR_ROM);
 #endif
 
+    // tells the server it may batch configstring updates into "csm",
+    // set by a cgame that knows the command once it is loaded
+    Cvar_Get("cl_csm", "0", CVAR_USERINFO);
+    // and may deflate the configstrings of the gamestate
+    Cvar_Get("cl_zgamestate", "1", CVAR_USERINFO);
+    // and may delta with the profiled field tables if it has the same ones
+    if (Cvar_Get("cl_profiledFields", "0", CVAR_ARCHIVE | CVAR_LATCH)->integer)
+    {
+        Cvar_Get("cl_netFields", va("%08x", MSG_NetFieldsChecksum()), CVAR_USERINFO | CVAR_ROM);
+    }
+
     // cgame might not be initialized before menu is used
     Cvar_Get("cg_viewsize", "100", CVAR_ARCHIVE);
     // Make sure cg_stereoSeparation is zero as that variable is deprecated and should not be used anymore.
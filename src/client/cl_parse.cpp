@@ -25,6 +25,8 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 
 #include "client.h"
 
+#include "zlib.h"
+
 const char *svc_strings[256] = {
 	"svc_bad",
 	"svc_nop",
@@ -37,6 +39,8 @@ const char *svc_strings[256] = {
 	"svc_EOF",
 	"svc_voipSpeex",
 	"svc_voipOpus",
+	"svc_zconfigstrings",
+	"svc_netfields",
 };
 
 void SHOWNET( msg_t *msg, const char *s) {
@@ -76,7 +80,7 @@ static void CL_DeltaEntity(msg_t *msg, clSnapshot_t *frame, int newnum, entitySt
 	}
     else
     {
-		MSG_ReadDeltaEntity( clc.netchan.alternateProtocol, msg, old, state, newnum );
+		MSG_ReadDeltaEntity( CL_DeltaProtocol(), msg, old, state, newnum );
 	}
 
 	if ( state->number == (MAX_GENTITIES-1) )
@@ -234,6 +238,7 @@ void CL_ParseSnapshot( msg_t *msg ) {
 	cl_paused->modified = false;
 
 	newSnap.messageNum = clc.serverMessageSequence;
+	newSnap.receiveDelay = clc.packetDelay;
 
 	deltaNum = MSG_ReadByte( msg );
 	if ( !deltaNum ) {
@@ -288,9 +293,9 @@ void CL_ParseSnapshot( msg_t *msg ) {
 		}
 	} else {
 		if ( old ) {
-			MSG_ReadDeltaPlayerstate( msg, &old->ps, &newSnap.ps );
+			MSG_ReadDeltaPlayerstate( CL_DeltaProtocol(), msg, &old->ps, &newSnap.ps );
 		} else {
-			MSG_ReadDeltaPlayerstate( msg, NULL, &newSnap.ps );
+			MSG_ReadDeltaPlayerstate( CL_DeltaProtocol(), msg, NULL, &newSnap.ps );
 		}
 	}
 
@@ -460,6 +465,99 @@ static void CL_ParseServerInfo(void)
 		sizeof(clc.sv_dlURL));
 }
 
+/*
+==================
+CL_GamestateAddString
+==================
+*/
+static void CL_GamestateAddString( int i, const char *s ) {
+	int len;
+
+	if ( i < 0 || i >= MAX_CONFIGSTRINGS ) {
+		Com_Error( ERR_DROP, "configstring > MAX_CONFIGSTRINGS" );
+	}
+
+	len = strlen( s );
+	if ( len + 1 + cl.gameState.dataCount > MAX_GAMESTATE_CHARS ) {
+		Com_Error( ERR_DROP, "MAX_GAMESTATE_CHARS exceeded" );
+	}
+
+	// append it to the gameState string buffer
+	cl.gameState.stringOffsets[ i ] = cl.gameState.dataCount;
+	::memcpy( cl.gameState.stringData + cl.gameState.dataCount, s, len + 1 );
+	cl.gameState.dataCount += len + 1;
+}
+
+/*
+==================
+CL_ParseZConfigstrings
+
+All the gamestate configstrings in one deflate stream, see SV_ZConfigstrings
+==================
+*/
+static void CL_ParseZConfigstrings( msg_t *msg ) {
+	static byte	deflated[MAX_MSGLEN];
+	static byte	raw[MAX_MSGLEN];
+	z_stream	zs;
+	int			rawLength, length, pos, ret;
+
+	rawLength = MSG_ReadLong( msg );
+	length = MSG_ReadLong( msg );
+	if ( rawLength <= 0 || rawLength > (int)sizeof( raw ) || length <= 0 || length > (int)sizeof( deflated ) ) {
+		Com_Error( ERR_DROP, "CL_ParseZConfigstrings: bad size" );
+	}
+	MSG_ReadData( msg, deflated, length );
+
+	::memset( &zs, 0, sizeof( zs ) );
+	if ( inflateInit2( &zs, -MAX_WBITS ) != Z_OK ) {
+		Com_Error( ERR_DROP, "CL_ParseZConfigstrings: inflateInit2 failed" );
+	}
+	zs.next_in = deflated;
+	zs.avail_in = length;
+	zs.next_out = raw;
+	zs.avail_out = rawLength;
+	ret = inflate( &zs, Z_FINISH );
+	inflateEnd( &zs );
+
+	if ( ret != Z_STREAM_END || (int)zs.total_out != rawLength ) {
+		Com_Error( ERR_DROP, "CL_ParseZConfigstrings: corrupt configstrings" );
+	}
+
+	for ( pos = 0; pos < rawLength; ) {
+		int i;
+		const byte *end;
+
+		if ( pos + 2 >= rawLength ) {
+			Com_Error( ERR_DROP, "CL_ParseZConfigstrings: truncated configstring" );
+		}
+		i = raw[ pos ] | ( raw[ pos + 1 ] << 8 );
+		pos += 2;
+
+		end = (const byte *)memchr( raw + pos, 0, rawLength - pos );
+		if ( !end ) {
+			Com_Error( ERR_DROP, "CL_ParseZConfigstrings: truncated configstring" );
+		}
+
+		CL_GamestateAddString( i, (const char *)raw + pos );
+		pos = end - raw + 1;
+	}
+}
+
+/*
+==================
+CL_DeltaProtocol
+
+The alternateProtocol for the entity and playerstate deltas
+==================
+*/
+int CL_DeltaProtocol( void ) {
+	if ( clc.netFields ) {
+		return MSG_PROFILED_FIELDS;
+	}
+
+	return clc.netchan.alternateProtocol;
+}
+
 /*
 ==================
 CL_ParseGamestate
@@ -482,6 +580,9 @@ void CL_ParseGamestate( msg_t *msg ) {
 	// a gamestate always marks a server command sequence
 	clc.serverCommandSequence = MSG_ReadLong( msg );
 
+	// svc_netfields comes first if the server agreed on the profiled tables
+	clc.netFields = false;
+
 	// parse all the configstrings and baselines
 	cl.gameState.dataCount = 1;	// leave a 0 at the beginning for uninitialized configstrings
 	while ( 1 ) {
@@ -492,23 +593,16 @@ void CL_ParseGamestate( msg_t *msg ) {
 		}
 		
 		if ( cmd == svc_configstring ) {
-			int		len;
-
 			i = MSG_ReadShort( msg );
-			if ( i < 0 || i >= MAX_CONFIGSTRINGS ) {
-				Com_Error( ERR_DROP, "configstring > MAX_CONFIGSTRINGS" );
-			}
 			s = MSG_ReadBigString( msg );
-			len = strlen( s );
-
-			if ( len + 1 + cl.gameState.dataCount > MAX_GAMESTATE_CHARS ) {
-				Com_Error( ERR_DROP, "MAX_GAMESTATE_CHARS exceeded" );
+			CL_GamestateAddString( i, s );
+		} else if ( cmd == svc_zconfigstrings ) {
+			CL_ParseZConfigstrings( msg );
+		} else if ( cmd == svc_netfields ) {
+			if ( MSG_ReadLong( msg ) != MSG_NetFieldsChecksum() ) {
+				Com_Error( ERR_DROP, "CL_ParseGamestate: the server has different profiled field tables" );
 			}
-
-			// append it to the gameState string buffer
-			cl.gameState.stringOffsets[ i ] = cl.gameState.dataCount;
-			::memcpy( cl.gameState.stringData + cl.gameState.dataCount, s, len + 1 );
-			cl.gameState.dataCount += len + 1;
+			clc.netFields = true;
 		} else if ( cmd == svc_baseline ) {
 			newnum = MSG_ReadBits( msg, GENTITYNUM_BITS );
 			if ( newnum < 0 || newnum >= MAX_GENTITIES ) {
@@ -516,7 +610,7 @@ void CL_ParseGamestate( msg_t *msg ) {
 			}
 			::memset(&nullstate, 0, sizeof(nullstate));
 			es = &cl.entityBaselines[ newnum ];
-			MSG_ReadDeltaEntity( clc.netchan.alternateProtocol, msg, &nullstate, es, newnum );
+			MSG_ReadDeltaEntity( CL_DeltaProtocol(), msg, &nullstate, es, newnum );
 		} else {
 			Com_Error( ERR_DROP, "CL_ParseGamestate: bad command byte" );
 		}
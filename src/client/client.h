@@ -127,6 +127,7 @@ struct clSnapshot_t {
     int messageNum;  // copied from netchan->incoming_sequence
     int deltaNum;  // messageNum the delta is from
     int ping;  // time from when cmdNum-1 was sent to time packet was reeceived
+    int receiveDelay;  // msec between the packet arriving and being parsed
     byte areamask[MAX_MAP_AREA_BYTES];  // portalarea visibility bits
 
     int cmdNum;  // the next cmdNum the server is expecting
@@ -237,6 +238,7 @@ struct clientConnection_t {
     int clientNum;
     int lastPacketSentTime;  // for retransmits during connection
     int lastPacketTime;  // for timeouts
+    int packetDelay;  // msec the packet being parsed waited after arriving
 
     char servername[MAX_OSPATH];  // name of server from original connect (used by reconnect)
     netadr_t serverAddress;
@@ -248,6 +250,7 @@ struct clientConnection_t {
     char challenge2[33];
     bool sendSignature;
     int checksumFeed;  // from the server for checksum calculations
+    bool netFields;  // svc_netfields, the deltas use the profiled field tables
 
     // these are our reliable messages that go to the server
     int reliableSequence;
@@ -604,6 +607,7 @@ void CL_Voip_f(void);
 
 void CL_SystemInfoChanged(void);
 void CL_ParseServerMessage(msg_t *msg);
+int CL_DeltaProtocol(void);
 
 //====================================================================
 
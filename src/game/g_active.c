@@ -284,8 +284,8 @@ void ClientImpacts( gentity_t *ent, pmove_t *pm )
     // if our movement is blocked by another player's real position,
     // don't use the unlagged position for them because they are
     // blocking or server-side Pmove() from reaching it
-    if( other->client && other->client->unlaggedCalc.used )
-      other->client->unlaggedCalc.used = qfalse;
+    if( other->client )
+      G_UnlaggedCalcDiscard( other );
 
     // tyrant impact attacks
     if( ent->client->ps.weapon == WP_ALEVEL4 )
@@ -300,7 +300,10 @@ void ClientImpacts( gentity_t *ent, pmove_t *pm )
 
     // touch triggers
     if( other->touch )
+    {
+      G_WakeEntity( other );
       other->touch( other, ent, &trace );
+    }
   }
 }
 
@@ -378,7 +381,10 @@ void  G_TouchTriggers( gentity_t *ent )
     memset( &trace, 0, sizeof( trace ) );
 
     if( hit->touch )
+    {
+      G_WakeEntity( hit );
       hit->touch( hit, ent, &trace );
+    }
   }
 }
 
@@ -939,12 +945,15 @@ void SendPendingPredictableEvents( playerState_t *ps )
   }
 }
 
+#define UNLAGGED_BIT( n ) ( 1 << ( ( n ) & 31 ) )
+#define UNLAGGED_USED( frame, n ) ( ( frame )->used[ ( n ) >> 5 ] & UNLAGGED_BIT( n ) )
+
 /*
 ==============
  G_UnlaggedStore
 
- Called on every server frame.  Stores position data for the client at that
- into client->unlaggedHist[] and the time into level.unlaggedTimes[].
+ Called on every server frame.  Stores position data for all clients at that
+ time into level.unlaggedHist[] and the time into level.unlaggedTimes[].
  This data is used by G_UnlaggedCalc()
 ==============
 */
@@ -952,7 +961,7 @@ void G_UnlaggedStore( void )
 {
   int i = 0;
   gentity_t *ent;
-  unlagged_t *save;
+  unlaggedFrame_t *save;
 
   if( !g_unlagged.integer )
     return;
@@ -962,19 +971,20 @@ void G_UnlaggedStore( void )
 
   level.unlaggedTimes[ level.unlaggedIndex ] = level.time;
 
+  save = &level.unlaggedHist[ level.unlaggedIndex ];
+  memset( save->used, 0, sizeof( save->used ) );
+
   for( i = 0; i < level.maxclients; i++ )
   {
     ent = &g_entities[ i ];
-    save = &ent->client->unlaggedHist[ level.unlaggedIndex ];
-    save->used = qfalse;
     if( !ent->r.linked || !( ent->r.contents & CONTENTS_BODY ) )
       continue;
     if( ent->client->pers.connected != CON_CONNECTED )
       continue;
-    VectorCopy( ent->r.mins, save->mins );
-    VectorCopy( ent->r.maxs, save->maxs );
-    VectorCopy( ent->s.pos.trBase, save->origin );
-    save->used = qtrue;
+    VectorCopy( ent->r.mins, save->mins[ i ] );
+    VectorCopy( ent->r.maxs, save->maxs[ i ] );
+    VectorCopy( ent->s.pos.trBase, save->origin[ i ] );
+    save->used[ i >> 5 ] |= UNLAGGED_BIT( i );
   }
 }
 
@@ -989,17 +999,67 @@ void G_UnlaggedStore( void )
 void G_UnlaggedClear( gentity_t *ent )
 {
   int i;
+  int num = ent - g_entities;
 
   for( i = 0; i < MAX_UNLAGGED_MARKERS; i++ )
-    ent->client->unlaggedHist[ i ].used = qfalse;
+    level.unlaggedHist[ i ].used[ num >> 5 ] &= ~UNLAGGED_BIT( num );
+
+  G_UnlaggedCalcDiscard( ent );
+}
+
+/*
+==============
+ G_UnlaggedCalcOrigin
+
+ Gets where G_UnlaggedCalc() put ent, qfalse if it wasn't moved
+==============
+*/
+qboolean G_UnlaggedCalcOrigin( gentity_t *ent, vec3_t origin )
+{
+  int num = ent - g_entities;
+
+  if( !UNLAGGED_USED( &level.unlaggedCalc, num ) )
+    return qfalse;
+
+  VectorCopy( level.unlaggedCalc.origin[ num ], origin );
+  return qtrue;
+}
+
+/*
+==============
+ G_UnlaggedCalcDiscard
+
+ Stops G_UnlaggedOn() from moving ent until the next G_UnlaggedCalc()
+==============
+*/
+void G_UnlaggedCalcDiscard( gentity_t *ent )
+{
+  int num = ent - g_entities;
+
+  level.unlaggedCalc.used[ num >> 5 ] &= ~UNLAGGED_BIT( num );
+}
+
+/*
+==============
+ G_UnlaggedLerp
+
+ out = from + frac * ( to - from ) over count floats
+==============
+*/
+static void G_UnlaggedLerp( float frac, const float *from, const float *to, float *out, int count )
+{
+  int i;
+
+  for( i = 0; i < count; i++ )
+    out[ i ] = from[ i ] + frac * ( to[ i ] - from[ i ] );
 }
 
 /*
 ==============
  G_UnlaggedCalc
 
- Loops through all active clients and calculates their predicted position
- for time then stores it in client->unlaggedCalc
+ Calculates the positions of all active clients at time and stores them
+ in level.unlaggedCalc
 ==============
 */
 void G_UnlaggedCalc( int time, gentity_t *rewindEnt )
@@ -1010,16 +1070,13 @@ void G_UnlaggedCalc( int time, gentity_t *rewindEnt )
   int stopIndex;
   int frameMsec;
   float lerp;
+  unlaggedFrame_t *start, *stop, *calc = &level.unlaggedCalc;
 
   if( !g_unlagged.integer )
     return;
 
   // clear any calculated values from a previous run
-  for( i = 0; i < level.maxclients; i++ )
-  {
-    ent = &g_entities[ i ];
-    ent->client->unlaggedCalc.used = qfalse;
-  }
+  memset( calc->used, 0, sizeof( calc->used ) );
 
   // client is on the current frame, no need for unlagged
   if( level.unlaggedTimes[ level.unlaggedIndex ] <= time )
@@ -1047,33 +1104,27 @@ void G_UnlaggedCalc( int time, gentity_t *rewindEnt )
     lerp = ( float )( time - level.unlaggedTimes[ startIndex ] ) / ( float )frameMsec;
   }
 
+  start = &level.unlaggedHist[ startIndex ];
+  stop = &level.unlaggedHist[ stopIndex ];
+
+  // only clients that were there at both markers are moved
+  for( i = 0; i < MAX_CLIENTS / 32; i++ )
+    calc->used[ i ] = start->used[ i ] & stop->used[ i ];
+
   for( i = 0; i < level.maxclients; i++ )
   {
     ent = &g_entities[ i ];
-    if( ent == rewindEnt )
-      continue;
-    if( !ent->r.linked || !( ent->r.contents & CONTENTS_BODY ) )
-      continue;
-    if( ent->client->pers.connected != CON_CONNECTED )
-      continue;
-    if( !ent->client->unlaggedHist[ startIndex ].used )
-      continue;
-    if( !ent->client->unlaggedHist[ stopIndex ].used )
+    if( !UNLAGGED_USED( calc, i ) )
       continue;
-
-    // between two unlagged markers
-    VectorLerp2( lerp, ent->client->unlaggedHist[ startIndex ].mins,
-      ent->client->unlaggedHist[ stopIndex ].mins,
-      ent->client->unlaggedCalc.mins );
-    VectorLerp2( lerp, ent->client->unlaggedHist[ startIndex ].maxs,
-      ent->client->unlaggedHist[ stopIndex ].maxs,
-      ent->client->unlaggedCalc.maxs );
-    VectorLerp2( lerp, ent->client->unlaggedHist[ startIndex ].origin,
-      ent->client->unlaggedHist[ stopIndex ].origin,
-      ent->client->unlaggedCalc.origin );
-
-    ent->client->unlaggedCalc.used = qtrue;
+    if( ent == rewindEnt || !ent->r.linked || !( ent->r.contents & CONTENTS_BODY ) ||
+        ent->client->pers.connected != CON_CONNECTED )
+      calc->used[ i >> 5 ] &= ~UNLAGGED_BIT( i );
   }
+
+  // between two unlagged markers
+  G_UnlaggedLerp( lerp, start->origin[ 0 ], stop->origin[ 0 ], calc->origin[ 0 ], level.maxclients * 3 );
+  G_UnlaggedLerp( lerp, start->mins[ 0 ], stop->mins[ 0 ], calc->mins[ 0 ], level.maxclients * 3 );
+  G_UnlaggedLerp( lerp, start->maxs[ 0 ], stop->maxs[ 0 ], calc->maxs[ 0 ], level.maxclients * 3 );
 }
 
 /*
@@ -1106,23 +1157,39 @@ void G_UnlaggedOff( void )
 
 /*
 ==============
- G_UnlaggedOn
+ G_UnlaggedRadius
 
- Called after G_UnlaggedCalc() to apply the calculated values to all active
- clients.  Once finished tracing, G_UnlaggedOff() must be called to restore
- the clients' position data
-
- As an optimization, all clients that have an unlagged position that is
- not touchable at "range" from "muzzle" will be ignored.  This is required
- to prevent a huge amount of trap_LinkEntity() calls per user cmd.
+ Radius of a sphere around origin holding the whole hitbox
 ==============
 */
+static float G_UnlaggedRadius( const vec3_t mins, const vec3_t maxs )
+{
+  vec3_t extent;
+  int    i;
 
-void G_UnlaggedOn( gentity_t *attacker, vec3_t muzzle, float range )
+  for( i = 0; i < 3; i++ )
+    extent[ i ] = MAX( fabs( mins[ i ] ), fabs( maxs[ i ] ) );
+
+  return VectorLength( extent );
+}
+
+/*
+==============
+ G_UnlaggedRewind
+
+ Moves the clients G_UnlaggedCalc() placed somewhere else to that place.
+ With an end, only the clients whose rewound hitbox can be reached by
+ a trace from start to end, radius wide, are moved. Without one, those
+ within radius of start are
+==============
+*/
+static void G_UnlaggedRewind( gentity_t *attacker, vec3_t start, vec3_t end, float radius )
 {
   int i = 0;
   gentity_t *ent;
-  unlagged_t *calc;
+  unlaggedFrame_t *calc = &level.unlaggedCalc;
+  vec3_t dir, delta;
+  float length = 0.0f;
 
   if( !g_unlagged.integer )
     return;
@@ -1130,26 +1197,44 @@ void G_UnlaggedOn( gentity_t *attacker, vec3_t muzzle, float range )
   if( !attacker->client->pers.useUnlagged )
     return;
 
+  if( start && end )
+  {
+    VectorSubtract( end, start, dir );
+    length = VectorNormalize( dir );
+  }
+
   for( i = 0; i < level.maxclients; i++ )
   {
     ent = &g_entities[ i ];
-    calc = &ent->client->unlaggedCalc;
 
-    if( !calc->used )
+    if( !UNLAGGED_USED( calc, i ) )
       continue;
     if( ent->client->unlaggedBackup.used )
       continue;
     if( !ent->r.linked || !( ent->r.contents & CONTENTS_BODY ) )
       continue;
-    if( VectorCompare( ent->r.currentOrigin, calc->origin ) )
+    if( VectorCompare( ent->r.currentOrigin, calc->origin[ i ] ) )
       continue;
-    if( muzzle )
+    if( start )
     {
-      float r1 = Distance( calc->origin, calc->maxs );
-      float r2 = Distance( calc->origin, calc->mins );
-      float maxRadius = ( r1 > r2 ) ? r1 : r2;
+      float reach = radius + G_UnlaggedRadius( calc->mins[ i ], calc->maxs[ i ] );
+
+      VectorSubtract( calc->origin[ i ], start, delta );
+
+      if( end )
+      {
+        // distance from the trace's line segment
+        float along = DotProduct( delta, dir );
+
+        if( along < 0.0f )
+          along = 0.0f;
+        else if( along > length )
+          along = length;
 
-      if( Distance( muzzle, calc->origin ) > range + maxRadius )
+        VectorMA( delta, -along, dir, delta );
+      }
+
+      if( VectorLengthSquared( delta ) > reach * reach )
         continue;
     }
 
@@ -1160,12 +1245,45 @@ void G_UnlaggedOn( gentity_t *attacker, vec3_t muzzle, float range )
     ent->client->unlaggedBackup.used = qtrue;
 
     // move the client to the calculated unlagged position
-    VectorCopy( calc->mins, ent->r.mins );
-    VectorCopy( calc->maxs, ent->r.maxs );
-    VectorCopy( calc->origin, ent->r.currentOrigin );
+    VectorCopy( calc->mins[ i ], ent->r.mins );
+    VectorCopy( calc->maxs[ i ], ent->r.maxs );
+    VectorCopy( calc->origin[ i ], ent->r.currentOrigin );
     trap_LinkEntity( ent );
   }
 }
+
+/*
+==============
+ G_UnlaggedOn
+
+ Called after G_UnlaggedCalc() to apply the calculated values to all active
+ clients.  Once finished tracing, G_UnlaggedOff() must be called to restore
+ the clients' position data
+
+ As an optimization, all clients that have an unlagged position that is
+ not touchable at "range" from "muzzle" will be ignored.  This is required
+ to prevent a huge amount of trap_LinkEntity() calls per user cmd.
+==============
+*/
+void G_UnlaggedOn( gentity_t *attacker, vec3_t muzzle, float range )
+{
+  G_UnlaggedRewind( attacker, muzzle, NULL, range );
+}
+
+/*
+==============
+ G_UnlaggedOnTrace
+
+ G_UnlaggedOn() for a single trace from start to end, radius being the
+ size of whatever is traced.  Only the clients it can hit are moved, so
+ long range hitscan weapons don't relink everyone on the map
+==============
+*/
+void G_UnlaggedOnTrace( gentity_t *attacker, vec3_t start, vec3_t end, float radius )
+{
+  G_UnlaggedRewind( attacker, start, end, radius );
+}
+
 /*
 ==============
  G_UnlaggedDetectCollisions
@@ -1190,10 +1308,7 @@ void G_UnlaggedOn( gentity_t *attacker, vec3_t muzzle, float range )
 */
 static void G_UnlaggedDetectCollisions( gentity_t *ent )
 {
-  unlagged_t *calc;
   trace_t tr;
-  float r1, r2;
-  float range;
 
   if( !g_unlagged.integer )
     return;
@@ -1201,26 +1316,18 @@ static void G_UnlaggedDetectCollisions( gentity_t *ent )
   if( !ent->client->pers.useUnlagged )
     return;
 
-  calc = &ent->client->unlaggedCalc;
-
   // if the client isn't moving, this is not necessary
   if( VectorCompare( ent->client->oldOrigin, ent->client->ps.origin ) )
     return;
 
-  range = Distance( ent->client->oldOrigin, ent->client->ps.origin );
-
-  // increase the range by the player's largest possible radius since it's
-  // the players bounding box that collides, not their origin
-  r1 = Distance( calc->origin, calc->mins );
-  r2 = Distance( calc->origin, calc->maxs );
-  range += ( r1 > r2 ) ? r1 : r2;
-
-  G_UnlaggedOn( ent, ent->client->oldOrigin, range );
+  // the player's bounding box is what collides, not their origin
+  G_UnlaggedOnTrace( ent, ent->client->oldOrigin, ent->client->ps.origin,
+    G_UnlaggedRadius( ent->r.mins, ent->r.maxs ) );
 
   trap_Trace(&tr, ent->client->oldOrigin, ent->r.mins, ent->r.maxs,
     ent->client->ps.origin, ent->s.number,  MASK_PLAYERSOLID );
   if( tr.entityNum >= 0 && tr.entityNum < MAX_CLIENTS )
-    g_entities[ tr.entityNum ].client->unlaggedCalc.used = qfalse;
+    G_UnlaggedCalcDiscard( &g_entities[ tr.entityNum ] );
 
   G_UnlaggedOff( );
 }
@@ -1688,7 +1795,10 @@ void ClientThink_real( gentity_t *ent )
     traceEnt = &g_entities[ trace.entityNum ];
 
     if( traceEnt && traceEnt->buildableTeam == client->ps.stats[ STAT_TEAM ] && traceEnt->use )
+    {
+      G_WakeEntity( traceEnt );
       traceEnt->use( traceEnt, ent, ent ); //other and activator are the same in this context
+    }
     else
     {
       //no entity in front of player - do a small area search
@@ -1703,6 +1813,7 @@ void ClientThink_real( gentity_t *ent )
 
         if( traceEnt && traceEnt->buildableTeam == client->ps.stats[ STAT_TEAM ] && traceEnt->use )
         {
+          G_WakeEntity( traceEnt );
           traceEnt->use( traceEnt, ent, ent ); //other and activator are the same in this context
           break;
         }
@@ -246,6 +246,212 @@ g_admin_admin_t *g_admin_admins = NULL;
 g_admin_ban_t *g_admin_bans = NULL;
 g_admin_command_t *g_admin_commands = NULL;
 
+/*
+================
+Admin and ban indexes
+
+Admins and bans are hashed by guid, and bans are also kept in a binary
+trie of their address prefixes per address family. The trie is path
+compressed, so a node only exists where a ban sits or two prefixes part,
+and a client's address walks a single path from the root past every ban
+that covers it. Chains are unordered, lookups that care about list order
+compare ids. Expired bans leave the indexes when a lookup finds them,
+adjustban puts them back if they are extended
+================
+*/
+typedef struct g_admin_banNode
+{
+  struct g_admin_banNode *parent;
+  struct g_admin_banNode *child[ 2 ];
+  byte addr[ ADDRLEN ]; // bits past len are zero
+  int len;
+  g_admin_ban_t *bans;  // linked by addrNext
+}
+g_admin_banNode_t;
+
+static g_admin_admin_t *g_admin_adminGuids[ ADMIN_GUID_BUCKETS ];
+static g_admin_ban_t *g_admin_banGuids[ ADMIN_GUID_BUCKETS ];
+static g_admin_ban_t *g_admin_banNoGuid; // only guidless clients look here
+static g_admin_banNode_t *g_admin_banTrie[ 2 ]; // IPv4, IPv6
+
+static g_admin_ban_t **admin_ban_guidchain( const char *guid )
+{
+  if( !*guid )
+    return &g_admin_banNoGuid;
+  return &g_admin_banGuids[ G_GuidHash( guid, ADMIN_GUID_BUCKETS ) ];
+}
+
+static int admin_addr_bit( const byte *addr, int bit )
+{
+  return ( addr[ bit >> 3 ] >> ( 7 - ( bit & 7 ) ) ) & 1;
+}
+
+// the number of leading bits G_AddressCompare looks at
+static int admin_addr_prefix( const addr_t *ip )
+{
+  int max = ip->type == IPv6 ? 128 : 32;
+
+  if( ip->mask < 1 || ip->mask > max )
+    return max;
+  return ip->mask;
+}
+
+static int admin_addr_common( const byte *a, const byte *b, int max )
+{
+  int i = 0;
+
+  while( i < max )
+  {
+    if( !( i & 7 ) && max - i >= 8 && a[ i >> 3 ] == b[ i >> 3 ] )
+      i += 8;
+    else if( admin_addr_bit( a, i ) == admin_addr_bit( b, i ) )
+      i++;
+    else
+      break;
+  }
+
+  return i;
+}
+
+static g_admin_banNode_t *admin_trie_alloc( const byte *addr, int len,
+  g_admin_banNode_t *parent )
+{
+  g_admin_banNode_t *n = BG_Alloc( sizeof( g_admin_banNode_t ) );
+  int i;
+
+  for( i = 0; i < len; i++ )
+  {
+    if( admin_addr_bit( addr, i ) )
+      n->addr[ i >> 3 ] |= 0x80 >> ( i & 7 );
+  }
+  n->len = len;
+  n->parent = parent;
+
+  return n;
+}
+
+static g_admin_banNode_t *admin_trie_insert( g_admin_banNode_t **root,
+  const byte *addr, int len )
+{
+  g_admin_banNode_t **link = root, *parent = NULL, *n, *split;
+  int common;
+
+  while( ( n = *link ) )
+  {
+    common = admin_addr_common( n->addr, addr, MIN( n->len, len ) );
+    if( common < n->len )
+    {
+      // the prefixes part here, or the new one is shorter
+      split = admin_trie_alloc( addr, common, parent );
+      split->child[ admin_addr_bit( n->addr, common ) ] = n;
+      n->parent = split;
+      *link = split;
+      if( common == len )
+        return split;
+
+      n = admin_trie_alloc( addr, len, split );
+      split->child[ admin_addr_bit( addr, common ) ] = n;
+      return n;
+    }
+
+    if( n->len == len )
+      return n;
+
+    parent = n;
+    link = &n->child[ admin_addr_bit( addr, n->len ) ];
+  }
+
+  return *link = admin_trie_alloc( addr, len, parent );
+}
+
+// drop nodes that no longer hold a ban or join two branches
+static void admin_trie_prune( g_admin_banNode_t **root, g_admin_banNode_t *n )
+{
+  g_admin_banNode_t **link, *child, *parent;
+
+  while( n && !n->bans && !( n->child[ 0 ] && n->child[ 1 ] ) )
+  {
+    parent = n->parent;
+    child = n->child[ 0 ] ? n->child[ 0 ] : n->child[ 1 ];
+    if( parent )
+      link = &parent->child[ admin_addr_bit( n->addr, parent->len ) ];
+    else
+      link = root;
+
+    *link = child;
+    if( child )
+      child->parent = parent;
+    BG_Free( n );
+    n = parent;
+  }
+}
+
+static void admin_trie_free( g_admin_banNode_t *n )
+{
+  if( !n )
+    return;
+
+  admin_trie_free( n->child[ 0 ] );
+  admin_trie_free( n->child[ 1 ] );
+  BG_Free( n );
+}
+
+static void admin_ban_index( g_admin_ban_t *b )
+{
+  g_admin_ban_t **chain;
+
+  if( b->indexed )
+    return;
+
+  chain = admin_ban_guidchain( b->guid );
+  b->guidNext = *chain;
+  *chain = b;
+
+  if( b->ip.type == IPv4 || b->ip.type == IPv6 )
+  {
+    b->node = admin_trie_insert( &g_admin_banTrie[ b->ip.type ], b->ip.addr,
+      admin_addr_prefix( &b->ip ) );
+    b->addrNext = b->node->bans;
+    b->node->bans = b;
+  }
+
+  b->indexed = qtrue;
+}
+
+static void admin_ban_unindex( g_admin_ban_t *b )
+{
+  g_admin_ban_t **link;
+
+  if( !b->indexed )
+    return;
+
+  for( link = admin_ban_guidchain( b->guid ); *link != b;
+       link = &(*link)->guidNext );
+  *link = b->guidNext;
+
+  if( b->node )
+  {
+    for( link = &b->node->bans; *link != b; link = &(*link)->addrNext );
+    *link = b->addrNext;
+    admin_trie_prune( &g_admin_banTrie[ b->ip.type ], b->node );
+  }
+
+  b->guidNext = b->addrNext = NULL;
+  b->node = NULL;
+  b->indexed = qfalse;
+}
+
+static void admin_admin_index( g_admin_admin_t *a )
+{
+  g_admin_admin_t **link;
+
+  // append, the first admin in g_admin_admins order wins a duplicate guid
+  for( link = &g_admin_adminGuids[ G_GuidHash( a->guid, ADMIN_GUID_BUCKETS ) ];
+       *link; link = &(*link)->guidNext );
+  *link = a;
+  a->guidNext = NULL;
+}
+
 void G_admin_register_cmds( void )
 {
   int i;
@@ -337,7 +543,8 @@ g_admin_admin_t *G_admin_admin( const char *guid )
 {
   g_admin_admin_t *admin;
 
-  for( admin = g_admin_admins; admin; admin = admin->next )
+  for( admin = g_admin_adminGuids[ G_GuidHash( guid, ADMIN_GUID_BUCKETS ) ];
+       admin; admin = admin->guidNext )
   {
     if( !Q_stricmp( admin->guid, guid ) )
       return admin;
@@ -492,37 +699,98 @@ static qboolean admin_higher( gentity_t *admin, gentity_t *victim )
     victim->client->pers.admin );
 }
 
-static void admin_writeconfig_string( char *s, fileHandle_t f )
+/*
+================
+admin.dat persistence
+
+admin.dat is only written whole when the configuration is read, between
+maps. Admin commands queue their changes as records in the same format,
+and G_admin_flush appends the queue to a journal next to admin.dat at
+most once a second, from the end of the frame. readconfig replays the
+journal over admin.dat and compacts the two back into a plain admin.dat.
+In the journal an [admin] replaces the admin with the same guid, and a
+[ban] replaces the ban with the same guid, address and "made" time or is
+a new one. Ban numbers are not used, compacting renumbers them and the
+journal may outlive that if the server stops in between
+================
+*/
+#define ADMIN_RECORD_SIZE       2048
+#define ADMIN_JOURNAL_SIZE      16384
+#define ADMIN_JOURNAL_INTERVAL  1000
+
+static char admin_journal[ ADMIN_JOURNAL_SIZE ];
+static int  admin_journalLength;
+static int  admin_journalFlushTime;
+
+static const char *admin_journal_name( void )
+{
+  return va( "%s.journal", g_admin.string );
+}
+
+static void admin_record_string( char *rec, int size, const char *key,
+  const char *s )
+{
+  Q_strcat( rec, size, va( "%-8s= %s\n", key, s ) );
+}
+
+static void admin_record_int( char *rec, int size, const char *key, int v )
 {
-  if( s[ 0 ] )
-    trap_FS_Write( s, strlen( s ), f );
-  trap_FS_Write( "\n", 1, f );
+  Q_strcat( rec, size, va( "%-8s= %d\n", key, v ) );
 }
 
-static void admin_writeconfig_int( int v, fileHandle_t f )
+static void admin_level_record( g_admin_level_t *l, char *rec, int size )
 {
-  char buf[ 32 ];
+  Q_strncpyz( rec, "[level]\n", size );
+  admin_record_int( rec, size, "level", l->level );
+  admin_record_string( rec, size, "name", l->name );
+  admin_record_string( rec, size, "flags", l->flags );
+  Q_strcat( rec, size, "\n" );
+}
 
-  Com_sprintf( buf, sizeof( buf ), "%d\n", v );
-  trap_FS_Write( buf, strlen( buf ), f );
+static void admin_admin_record( g_admin_admin_t *a, char *rec, int size )
+{
+  Q_strncpyz( rec, "[admin]\n", size );
+  admin_record_string( rec, size, "name", a->name );
+  admin_record_string( rec, size, "guid", a->guid );
+  admin_record_int( rec, size, "level", a->level );
+  admin_record_string( rec, size, "flags", a->flags );
+  Q_strcat( rec, size, "\n" );
 }
 
-static void admin_writeconfig( void )
+static void admin_ban_record( g_admin_ban_t *b, char *rec,
+  int size )
+{
+  Q_strncpyz( rec, "[ban]\n", size );
+  admin_record_string( rec, size, "name", b->name );
+  admin_record_string( rec, size, "guid", b->guid );
+  admin_record_string( rec, size, "ip", b->ip.str );
+  admin_record_string( rec, size, "reason", b->reason );
+  admin_record_string( rec, size, "made", b->made );
+  admin_record_int( rec, size, "expires", b->expires );
+  admin_record_string( rec, size, "banner", b->banner );
+  Q_strcat( rec, size, "\n" );
+}
+
+static void admin_command_record( g_admin_command_t *c, char *rec, int size )
+{
+  Q_strncpyz( rec, "[command]\n", size );
+  admin_record_string( rec, size, "command", c->command );
+  admin_record_string( rec, size, "exec", c->exec );
+  admin_record_string( rec, size, "desc", c->desc );
+  admin_record_string( rec, size, "flag", c->flag );
+  Q_strcat( rec, size, "\n" );
+}
+
+// rewrites admin.dat from memory and empties the journal
+static void admin_writeconfig( int t )
 {
   fileHandle_t f;
-  int t;
   g_admin_admin_t *a;
   g_admin_level_t *l;
   g_admin_ban_t *b;
   g_admin_command_t *c;
+  char rec[ ADMIN_RECORD_SIZE ];
 
-  if( !g_admin.string[ 0 ] )
-  {
-    G_Printf( S_COLOR_YELLOW "WARNING: g_admin is not set. "
-      " configuration will not be saved to a file.\n" );
-    return;
-  }
-  t = trap_RealTime( NULL );
   if( trap_FS_FOpenFile( g_admin.string, &f, FS_WRITE ) < 0 )
   {
     G_Printf( "admin_writeconfig: could not open g_admin file \"%s\"\n",
@@ -531,14 +799,8 @@ static void admin_writeconfig( void )
   }
   for( l = g_admin_levels; l; l = l->next )
   {
-    trap_FS_Write( "[level]\n", 8, f );
-    trap_FS_Write( "level   = ", 10, f );
-    admin_writeconfig_int( l->level, f );
-    trap_FS_Write( "name    = ", 10, f );
-    admin_writeconfig_string( l->name, f );
-    trap_FS_Write( "flags   = ", 10, f );
-    admin_writeconfig_string( l->flags, f );
-    trap_FS_Write( "\n", 1, f );
+    admin_level_record( l, rec, sizeof( rec ) );
+    trap_FS_Write( rec, strlen( rec ), f );
   }
   for( a = g_admin_admins; a; a = a->next )
   {
@@ -546,16 +808,8 @@ static void admin_writeconfig( void )
     if( a->level == 0 )
       continue;
 
-    trap_FS_Write( "[admin]\n", 8, f );
-    trap_FS_Write( "name    = ", 10, f );
-    admin_writeconfig_string( a->name, f );
-    trap_FS_Write( "guid    = ", 10, f );
-    admin_writeconfig_string( a->guid, f );
-    trap_FS_Write( "level   = ", 10, f );
-    admin_writeconfig_int( a->level, f );
-    trap_FS_Write( "flags   = ", 10, f );
-    admin_writeconfig_string( a->flags, f );
-    trap_FS_Write( "\n", 1, f );
+    admin_admin_record( a, rec, sizeof( rec ) );
+    trap_FS_Write( rec, strlen( rec ), f );
   }
   for( b = g_admin_bans; b; b = b->next )
   {
@@ -564,79 +818,275 @@ static void admin_writeconfig( void )
     if( b->expires != 0 && b->expires <= t )
       continue;
 
-    trap_FS_Write( "[ban]\n", 6, f );
-    trap_FS_Write( "name    = ", 10, f );
-    admin_writeconfig_string( b->name, f );
-    trap_FS_Write( "guid    = ", 10, f );
-    admin_writeconfig_string( b->guid, f );
-    trap_FS_Write( "ip      = ", 10, f );
-    admin_writeconfig_string( b->ip.str, f );
-    trap_FS_Write( "reason  = ", 10, f );
-    admin_writeconfig_string( b->reason, f );
-    trap_FS_Write( "made    = ", 10, f );
-    admin_writeconfig_string( b->made, f );
-    trap_FS_Write( "expires = ", 10, f );
-    admin_writeconfig_int( b->expires, f );
-    trap_FS_Write( "banner  = ", 10, f );
-    admin_writeconfig_string( b->banner, f );
-    trap_FS_Write( "\n", 1, f );
+    admin_ban_record( b, rec, sizeof( rec ) );
+    trap_FS_Write( rec, strlen( rec ), f );
   }
   for( c = g_admin_commands; c; c = c->next )
   {
-    trap_FS_Write( "[command]\n", 10, f );
-    trap_FS_Write( "command = ", 10, f );
-    admin_writeconfig_string( c->command, f );
-    trap_FS_Write( "exec    = ", 10, f );
-    admin_writeconfig_string( c->exec, f );
-    trap_FS_Write( "desc    = ", 10, f );
-    admin_writeconfig_string( c->desc, f );
-    trap_FS_Write( "flag    = ", 10, f );
-    admin_writeconfig_string( c->flag, f );
-    trap_FS_Write( "\n", 1, f );
+    admin_command_record( c, rec, sizeof( rec ) );
+    trap_FS_Write( rec, strlen( rec ), f );
   }
   trap_FS_FCloseFile( f );
+
+  admin_journalLength = 0;
+  if( trap_FS_FOpenFile( admin_journal_name( ), &f, FS_WRITE ) >= 0 )
+    trap_FS_FCloseFile( f );
+}
+
+/*
+================
+G_admin_flush
+
+Appends the queued changes to the journal, at most once every
+ADMIN_JOURNAL_INTERVAL unless forced
+================
+*/
+void G_admin_flush( qboolean force )
+{
+  fileHandle_t f;
+
+  if( !admin_journalLength )
+    return;
+
+  if( !force && level.time < admin_journalFlushTime )
+    return;
+  admin_journalFlushTime = level.time + ADMIN_JOURNAL_INTERVAL;
+
+  if( trap_FS_FOpenFile( admin_journal_name( ), &f, FS_APPEND ) < 0 )
+  {
+    G_Printf( "admin_flush: could not open journal \"%s\"\n",
+              admin_journal_name( ) );
+  }
+  else
+  {
+    trap_FS_Write( admin_journal, admin_journalLength, f );
+    trap_FS_FCloseFile( f );
+  }
+  admin_journalLength = 0;
 }
 
-static void admin_readconfig_string( char **cnf, char *s, int size )
+static void admin_journal_write( const char *rec )
 {
-  char *t;
+  int len = strlen( rec );
 
-  //COM_MatchToken(cnf, "=");
-  s[ 0 ] = '\0';
-  t = COM_ParseExt( cnf, qfalse );
-  if( strcmp( t, "=" ) )
+  if( !g_admin.string[ 0 ] )
   {
-    COM_ParseWarning( "expected '=' before \"%s\"", t );
-    Q_strncpyz( s, t, size );
+    G_Printf( S_COLOR_YELLOW "WARNING: g_admin is not set. "
+      " configuration will not be saved to a file.\n" );
+    return;
   }
+
+  if( admin_journalLength + len > sizeof( admin_journal ) )
+    G_admin_flush( qtrue );
+
+  memcpy( admin_journal + admin_journalLength, rec, len );
+  admin_journalLength += len;
+}
+
+static void admin_journal_admin( g_admin_admin_t *a )
+{
+  char rec[ ADMIN_RECORD_SIZE ];
+
+  admin_admin_record( a, rec, sizeof( rec ) );
+  admin_journal_write( rec );
+}
+
+static void admin_journal_ban( g_admin_ban_t *b )
+{
+  char rec[ ADMIN_RECORD_SIZE ];
+
+  admin_ban_record( b, rec, sizeof( rec ) );
+  admin_journal_write( rec );
+}
+
+/*
+================
+admin_readconfig_line
+
+Takes the next "key = value" or "[section]" line apart in place. The
+value is split into words the way COM_Parse did it, so it is the words
+joined by single spaces with quotes dropped and // starting a comment
+================
+*/
+static qboolean admin_readconfig_line( char **data, int *line, int *keyLine,
+  char **key, char **value, qboolean *equals )
+{
+  char *p = *data, *end, *out;
+  qboolean eol;
+
+  // blank lines and comments
   while( 1 )
   {
-    t = COM_ParseExt( cnf, qfalse );
-    if( !*t )
+    while( *p && (byte)*p <= ' ' )
+    {
+      if( *p == '\n' )
+        ( *line )++;
+      p++;
+    }
+
+    if( p[ 0 ] == '/' && p[ 1 ] == '/' )
+    {
+      while( *p && *p != '\n' )
+        p++;
+    }
+    else if( p[ 0 ] == '/' && p[ 1 ] == '*' )
+    {
+      for( p += 2; *p && !( p[ 0 ] == '*' && p[ 1 ] == '/' ); p++ )
+      {
+        if( *p == '\n' )
+          ( *line )++;
+      }
+      if( *p )
+        p += 2;
+    }
+    else
       break;
-    if( strlen( t ) + strlen( s ) >= size )
+  }
+
+  if( !*p )
+  {
+    *data = p;
+    return qfalse;
+  }
+
+  *keyLine = *line;
+  *key = p;
+  while( (byte)*p > ' ' )
+    p++;
+  end = p;
+  eol = ( !*p || *p == '\n' );
+  if( *p == '\n' )
+    ( *line )++;
+  if( *p )
+    p++;
+  *end = '\0';
+
+  *equals = qfalse;
+  if( eol )
+  {
+    *value = "";
+    *data = p;
+    return qtrue;
+  }
+
+  while( *p && *p != '\n' && (byte)*p <= ' ' )
+    p++;
+  if( p[ 0 ] == '=' && (byte)p[ 1 ] <= ' ' )
+  {
+    *equals = qtrue;
+    p++;
+  }
+
+  // the words are copied down over the spaces between them
+  *value = out = p;
+  while( 1 )
+  {
+    while( *p && *p != '\n' && (byte)*p <= ' ' )
+      p++;
+    if( !*p || *p == '\n' || ( p[ 0 ] == '/' && p[ 1 ] == '/' ) )
       break;
-    if( *s )
-      Q_strcat( s, size, " " );
-    Q_strcat( s, size, t );
+
+    if( out > *value )
+      *out++ = ' ';
+
+    if( *p == '"' )
+    {
+      for( p++; *p && *p != '"' && *p != '\n'; )
+        *out++ = *p++;
+      if( *p == '"' )
+        p++;
+    }
+    else
+    {
+      while( (byte)*p > ' ' )
+        *out++ = *p++;
+    }
+  }
+
+  while( *p && *p != '\n' )
+    p++;
+  if( *p == '\n' )
+  {
+    ( *line )++;
+    p++;
   }
+  *out = '\0';
+
+  *data = p;
+  return qtrue;
 }
 
-static void admin_readconfig_int( char **cnf, int *v )
+// a journal [admin] replaces the one with the same guid
+static void admin_journal_replay_admin( g_admin_admin_t *rec,
+  g_admin_admin_t **tail, int *count )
 {
-  char *t;
+  g_admin_admin_t *a;
+
+  for( a = g_admin_admins; a; a = a->next )
+  {
+    if( !Q_stricmp( a->guid, rec->guid ) )
+      break;
+  }
 
-  //COM_MatchToken(cnf, "=");
-  t = COM_ParseExt( cnf, qfalse );
-  if( !strcmp( t, "=" ) )
+  if( !a )
   {
-    t = COM_ParseExt( cnf, qfalse );
+    a = BG_Alloc( sizeof( g_admin_admin_t ) );
+    if( *tail )
+      ( *tail )->next = a;
+    else
+      g_admin_admins = a;
+    *tail = a;
+    ( *count )++;
   }
-  else
+
+  a->level = rec->level;
+  Q_strncpyz( a->guid, rec->guid, sizeof( a->guid ) );
+  Q_strncpyz( a->name, rec->name, sizeof( a->name ) );
+  Q_strncpyz( a->flags, rec->flags, sizeof( a->flags ) );
+}
+
+// the parts of a ban adjustban leaves alone, the address without its netmask
+static qboolean admin_same_ban( g_admin_ban_t *a, g_admin_ban_t *b )
+{
+  const char *p = a->ip.str, *q = b->ip.str;
+
+  if( Q_stricmp( a->guid, b->guid ) || strcmp( a->made, b->made ) )
+    return qfalse;
+
+  for( ; *p && *p != '/' && *p == *q; p++, q++ );
+  return ( !*p || *p == '/' ) && ( !*q || *q == '/' );
+}
+
+// a journal [ban] replaces the same ban, or is the next one
+static void admin_journal_replay_ban( g_admin_ban_t *rec, g_admin_ban_t **tail,
+  int *count )
+{
+  g_admin_ban_t *b;
+
+  for( b = g_admin_bans; b; b = b->next )
   {
-    COM_ParseWarning( "expected '=' before \"%s\"", t );
+    if( admin_same_ban( b, rec ) )
+      break;
   }
-  *v = atoi( t );
+
+  if( !b )
+  {
+    b = BG_Alloc( sizeof( g_admin_ban_t ) );
+    if( *tail )
+      ( *tail )->next = b;
+    else
+      g_admin_bans = b;
+    *tail = b;
+    b->id = ++( *count );
+  }
+
+  Q_strncpyz( b->name, rec->name, sizeof( b->name ) );
+  Q_strncpyz( b->guid, rec->guid, sizeof( b->guid ) );
+  memcpy( &b->ip, &rec->ip, sizeof( b->ip ) );
+  Q_strncpyz( b->reason, rec->reason, sizeof( b->reason ) );
+  Q_strncpyz( b->made, rec->made, sizeof( b->made ) );
+  b->expires = rec->expires;
+  Q_strncpyz( b->banner, rec->banner, sizeof( b->banner ) );
 }
 
 // if we can't parse any levels from readconfig, set up default
@@ -904,17 +1354,12 @@ static void G_admin_ban_message(
 
   if( areason && ent )
   {
-    // we just want the ban number
-    int n = 1;
-    g_admin_ban_t *b = g_admin_bans;
-    for( ; b && b != ban; b = b->next, n++ )
-      ;
     Com_sprintf( areason, alen,
       S_COLOR_YELLOW "Banned player %s" S_COLOR_YELLOW
       " tried to connect from %s (ban #%d)",
       ent->client->pers.netname[ 0 ] ? ent->client->pers.netname : ban->name,
       ent->client->pers.ip.str,
-      n );
+      ban->id );
   }
 }
 
@@ -925,26 +1370,73 @@ static qboolean G_admin_ban_matches( g_admin_ban_t *ban, gentity_t *ent )
            G_AddressCompare( &ban->ip, &ent->client->pers.ip ) );
 }
 
+/*
+================
+G_admin_match_ban
+
+The first unexpired ban in g_admin_bans that matches, found through the
+guid hash and the path of the client's address through the ban trie
+================
+*/
+#define MAX_EXPIRED_BANS 16
 static g_admin_ban_t *G_admin_match_ban( gentity_t *ent )
 {
-  int t;
-  g_admin_ban_t *ban;
+  int t, i, numExpired = 0;
+  g_admin_ban_t *ban, *match = NULL;
+  g_admin_ban_t *expired[ MAX_EXPIRED_BANS ];
+  g_admin_banNode_t *n;
+  const addr_t *ip = &ent->client->pers.ip;
 
   t = trap_RealTime( NULL );
   if( ent->client->pers.localClient )
     return NULL;
 
-  for( ban = g_admin_bans; ban; ban = ban->next )
+  for( ban = *admin_ban_guidchain( ent->client->pers.guid ); ban;
+       ban = ban->guidNext )
   {
+    if( Q_stricmp( ban->guid, ent->client->pers.guid ) )
+      continue;
+
     // 0 is for perm ban
     if( ban->expires != 0 && ban->expires <= t )
-      continue;
+    {
+      if( numExpired < MAX_EXPIRED_BANS )
+        expired[ numExpired++ ] = ban;
+    }
+    else if( !match || ban->id < match->id )
+      match = ban;
+  }
 
-    if( G_admin_ban_matches( ban, ent ) )
-      return ban;
+  if( ( ip->type == IPv4 || ip->type == IPv6 ) &&
+      !G_admin_permission( ent, ADMF_IMMUNITY ) )
+  {
+    for( n = g_admin_banTrie[ ip->type ]; n; )
+    {
+      if( admin_addr_common( n->addr, ip->addr, n->len ) < n->len )
+        break;
+
+      for( ban = n->bans; ban; ban = ban->addrNext )
+      {
+        if( ban->expires != 0 && ban->expires <= t )
+        {
+          if( numExpired < MAX_EXPIRED_BANS )
+            expired[ numExpired++ ] = ban;
+        }
+        else if( !match || ban->id < match->id )
+          match = ban;
+      }
+
+      if( n->len == ( ip->type == IPv6 ? 128 : 32 ) )
+        break;
+      n = n->child[ admin_addr_bit( ip->addr, n->len ) ];
+    }
   }
 
-  return NULL;
+  // unindexing can free trie nodes, so it waits until the walk is over
+  for( i = 0; i < numExpired; i++ )
+    admin_ban_unindex( expired[ i ] );
+
+  return match;
 }
 
 qboolean G_admin_ban_check( gentity_t *ent, char *reason, int rlen )
@@ -1071,20 +1563,134 @@ static int cmplevel( const void *a, const void *b )
   return ((g_admin_level_t *)b)->level - ((g_admin_level_t *)a)->level;
 }
 
+static qboolean admin_readconfig_level( g_admin_level_t *l, const char *key,
+  const char *value )
+{
+  int len;
+
+  if( !Q_stricmp( key, "level" ) )
+    l->level = atoi( value );
+  else if( !Q_stricmp( key, "name" ) )
+  {
+    Q_strncpyz( l->name, value, sizeof( l->name ) );
+    // max printable name length for formatting
+    len = Q_PrintStrlen( l->name );
+    if( len > admin_level_maxname )
+      admin_level_maxname = len;
+  }
+  else if( !Q_stricmp( key, "flags" ) )
+    Q_strncpyz( l->flags, value, sizeof( l->flags ) );
+  else
+    return qfalse;
+  return qtrue;
+}
+
+static qboolean admin_readconfig_admin( g_admin_admin_t *a, const char *key,
+  const char *value )
+{
+  if( !Q_stricmp( key, "name" ) )
+    Q_strncpyz( a->name, value, sizeof( a->name ) );
+  else if( !Q_stricmp( key, "guid" ) )
+    Q_strncpyz( a->guid, value, sizeof( a->guid ) );
+  else if( !Q_stricmp( key, "level" ) )
+    a->level = atoi( value );
+  else if( !Q_stricmp( key, "flags" ) )
+    Q_strncpyz( a->flags, value, sizeof( a->flags ) );
+  else
+    return qfalse;
+  return qtrue;
+}
+
+static qboolean admin_readconfig_ban( g_admin_ban_t *b,
+  const char *key, const char *value )
+{
+  if( !Q_stricmp( key, "name" ) )
+    Q_strncpyz( b->name, value, sizeof( b->name ) );
+  else if( !Q_stricmp( key, "guid" ) )
+    Q_strncpyz( b->guid, value, sizeof( b->guid ) );
+  else if( !Q_stricmp( key, "ip" ) )
+    G_AddressParse( value, &b->ip );
+  else if( !Q_stricmp( key, "reason" ) )
+    Q_strncpyz( b->reason, value, sizeof( b->reason ) );
+  else if( !Q_stricmp( key, "made" ) )
+    Q_strncpyz( b->made, value, sizeof( b->made ) );
+  else if( !Q_stricmp( key, "expires" ) )
+    b->expires = atoi( value );
+  else if( !Q_stricmp( key, "banner" ) )
+    Q_strncpyz( b->banner, value, sizeof( b->banner ) );
+  else
+    return qfalse;
+  return qtrue;
+}
+
+static qboolean admin_readconfig_command( g_admin_command_t *c,
+  const char *key, const char *value )
+{
+  if( !Q_stricmp( key, "command" ) )
+    Q_strncpyz( c->command, value, sizeof( c->command ) );
+  else if( !Q_stricmp( key, "exec" ) )
+    Q_strncpyz( c->exec, value, sizeof( c->exec ) );
+  else if( !Q_stricmp( key, "desc" ) )
+    Q_strncpyz( c->desc, value, sizeof( c->desc ) );
+  else if( !Q_stricmp( key, "flag" ) )
+    Q_strncpyz( c->flag, value, sizeof( c->flag ) );
+  else
+    return qfalse;
+  return qtrue;
+}
+
+static int admin_readconfig_file( const char *name, char **cnf, int offset )
+{
+  fileHandle_t f;
+  int len;
+
+  len = trap_FS_FOpenFile( name, &f, FS_READ );
+  if( len < 0 )
+    return len;
+
+  if( *cnf )
+  {
+    char *grown = BG_Alloc( offset + len + 1 );
+
+    memcpy( grown, *cnf, offset );
+    BG_Free( *cnf );
+    *cnf = grown;
+  }
+  else
+    *cnf = BG_Alloc( offset + len + 1 );
+
+  trap_FS_Read( *cnf + offset, len, f );
+  ( *cnf )[ offset + len ] = '\0';
+  trap_FS_FCloseFile( f );
+  return len;
+}
+
+typedef enum
+{
+  ADMIN_SECTION_NONE,
+  ADMIN_SECTION_LEVEL,
+  ADMIN_SECTION_ADMIN,
+  ADMIN_SECTION_BAN,
+  ADMIN_SECTION_COMMAND
+} adminSection_t;
+
 qboolean G_admin_readconfig( gentity_t *ent )
 {
   g_admin_level_t *l = NULL;
-  g_admin_admin_t *a = NULL;
-  g_admin_ban_t *b = NULL;
+  g_admin_admin_t *a = NULL, journalAdmin;
+  g_admin_ban_t *b = NULL, *prev, *next, journalBan;
   g_admin_command_t *c = NULL;
-  int lc = 0, ac = 0, bc = 0, cc = 0;
-  fileHandle_t f;
-  int len;
-  char *cnf, *cnf2;
-  char *t;
-  qboolean level_open, admin_open, ban_open, command_open;
-  int i;
-  char ip[ 44 ];
+  int lc = 0, ac = 0, bc = 0, cc = 0, jc = 0;
+  int len, jlen, pass, line, keyLine;
+  char *cnf = NULL, *p, *key, *value;
+  char file[ MAX_QPATH ];
+  adminSection_t section;
+  qboolean equals, known;
+  int i, now;
+
+  // anything still queued belongs in the journal we are about to replay
+  G_admin_flush( qtrue );
+  admin_journalFlushTime = 0;
 
   G_admin_cleanup();
 
@@ -1095,184 +1701,150 @@ qboolean G_admin_readconfig( gentity_t *ent )
     return qfalse;
   }
 
-  len = trap_FS_FOpenFile( g_admin.string, &f, FS_READ );
-  if( len < 0 )
+  len = admin_readconfig_file( g_admin.string, &cnf, 0 );
+  jlen = admin_readconfig_file( admin_journal_name( ), &cnf,
+                                MAX( len, 0 ) + 1 );
+  if( len < 0 && jlen < 0 )
   {
     G_Printf( "^3readconfig: ^7could not open admin config file %s\n",
             g_admin.string );
     admin_default_levels();
     return qfalse;
   }
-  cnf = BG_Alloc( len + 1 );
-  cnf2 = cnf;
-  trap_FS_Read( cnf, len, f );
-  *( cnf + len ) = '\0';
-  trap_FS_FCloseFile( f );
+  if( len < 0 )
+  {
+    len = 0;
+    cnf[ 0 ] = '\0';
+  }
+  if( jlen < 0 )
+    jlen = 0;
 
   admin_level_maxname = 0;
 
-  level_open = admin_open = ban_open = command_open = qfalse;
-  COM_BeginParseSession( g_admin.string );
-  while( 1 )
+  for( pass = 0; pass < 2; pass++ )
   {
-    t = COM_Parse( &cnf );
-    if( !*t )
-      break;
-
-    if( !Q_stricmp( t, "[level]" ) )
+    if( pass == 0 )
     {
-      if( l )
-        l = l->next = BG_Alloc( sizeof( g_admin_level_t ) );
-      else
-        l = g_admin_levels = BG_Alloc( sizeof( g_admin_level_t ) );
-      level_open = qtrue;
-      admin_open = ban_open = command_open = qfalse;
-      lc++;
+      p = cnf;
+      Q_strncpyz( file, g_admin.string, sizeof( file ) );
     }
-    else if( !Q_stricmp( t, "[admin]" ) )
-    {
-      if( a )
-        a = a->next = BG_Alloc( sizeof( g_admin_admin_t ) );
-      else
-        a = g_admin_admins = BG_Alloc( sizeof( g_admin_admin_t ) );
-      admin_open = qtrue;
-      level_open = ban_open = command_open = qfalse;
-      ac++;
-    }
-    else if( !Q_stricmp( t, "[ban]" ) )
-    {
-      if( b )
-        b = b->next = BG_Alloc( sizeof( g_admin_ban_t ) );
-      else
-        b = g_admin_bans = BG_Alloc( sizeof( g_admin_ban_t ) );
-      ban_open = qtrue;
-      level_open = admin_open = command_open = qfalse;
-      bc++;
-    }
-    else if( !Q_stricmp( t, "[command]" ) )
-    {
-      if( c )
-        c = c->next = BG_Alloc( sizeof( g_admin_command_t ) );
-      else
-        c = g_admin_commands = BG_Alloc( sizeof( g_admin_command_t ) );
-      command_open = qtrue;
-      level_open = admin_open = ban_open = qfalse;
-      cc++;
-    }
-    else if( level_open )
+    else
     {
-      if( !Q_stricmp( t, "level" ) )
-      {
-        admin_readconfig_int( &cnf, &l->level );
-      }
-      else if( !Q_stricmp( t, "name" ) )
-      {
-        admin_readconfig_string( &cnf, l->name, sizeof( l->name ) );
-        // max printable name length for formatting
-        len = Q_PrintStrlen( l->name );
-        if( len > admin_level_maxname )
-          admin_level_maxname = len;
-      }
-      else if( !Q_stricmp( t, "flags" ) )
-      {
-        admin_readconfig_string( &cnf, l->flags, sizeof( l->flags ) );
-      }
-      else
-      {
-        COM_ParseError( "[level] unrecognized token \"%s\"", t );
-      }
+      if( !jlen )
+        break;
+      p = cnf + len + 1;
+      Q_strncpyz( file, admin_journal_name( ), sizeof( file ) );
     }
-    else if( admin_open )
-    {
-      if( !Q_stricmp( t, "name" ) )
-      {
-        admin_readconfig_string( &cnf, a->name, sizeof( a->name ) );
-      }
-      else if( !Q_stricmp( t, "guid" ) )
-      {
-        admin_readconfig_string( &cnf, a->guid, sizeof( a->guid ) );
-      }
-      else if( !Q_stricmp( t, "level" ) )
-      {
-        admin_readconfig_int( &cnf, &a->level );
-      }
-      else if( !Q_stricmp( t, "flags" ) )
-      {
-        admin_readconfig_string( &cnf, a->flags, sizeof( a->flags ) );
-      }
-      else
-      {
-        COM_ParseError( "[admin] unrecognized token \"%s\"", t );
-      }
 
-    }
-    else if( ban_open )
+    line = 1;
+    section = ADMIN_SECTION_NONE;
+    while( 1 )
     {
-      if( !Q_stricmp( t, "name" ) )
-      {
-        admin_readconfig_string( &cnf, b->name, sizeof( b->name ) );
-      }
-      else if( !Q_stricmp( t, "guid" ) )
-      {
-        admin_readconfig_string( &cnf, b->guid, sizeof( b->guid ) );
-      }
-      else if( !Q_stricmp( t, "ip" ) )
-      {
-        admin_readconfig_string( &cnf, ip, sizeof( ip ) );
-        G_AddressParse( ip, &b->ip );
-      }
-      else if( !Q_stricmp( t, "reason" ) )
-      {
-        admin_readconfig_string( &cnf, b->reason, sizeof( b->reason ) );
-      }
-      else if( !Q_stricmp( t, "made" ) )
-      {
-        admin_readconfig_string( &cnf, b->made, sizeof( b->made ) );
-      }
-      else if( !Q_stricmp( t, "expires" ) )
-      {
-        admin_readconfig_int( &cnf, &b->expires );
-      }
-      else if( !Q_stricmp( t, "banner" ) )
+      known = admin_readconfig_line( &p, &line, &keyLine, &key, &value,
+                                     &equals );
+
+      // a journal record is applied once all of it has been read
+      if( pass == 1 && ( !known || key[ 0 ] == '[' ) )
       {
-        admin_readconfig_string( &cnf, b->banner, sizeof( b->banner ) );
+        if( section == ADMIN_SECTION_ADMIN )
+          admin_journal_replay_admin( &journalAdmin, &a, &ac );
+        else if( section == ADMIN_SECTION_BAN )
+          admin_journal_replay_ban( &journalBan, &b, &bc );
       }
-      else
+      if( !known )
+        break;
+
+      if( !Q_stricmp( key, "[level]" ) && pass == 0 )
       {
-        COM_ParseError( "[ban] unrecognized token \"%s\"", t );
+        if( l )
+          l = l->next = BG_Alloc( sizeof( g_admin_level_t ) );
+        else
+          l = g_admin_levels = BG_Alloc( sizeof( g_admin_level_t ) );
+        section = ADMIN_SECTION_LEVEL;
+        lc++;
       }
-    }
-    else if( command_open )
-    {
-      if( !Q_stricmp( t, "command" ) )
+      else if( !Q_stricmp( key, "[admin]" ) )
       {
-        admin_readconfig_string( &cnf, c->command, sizeof( c->command ) );
+        if( pass == 1 )
+        {
+          memset( &journalAdmin, 0, sizeof( journalAdmin ) );
+          jc++;
+        }
+        else
+        {
+          if( a )
+            a = a->next = BG_Alloc( sizeof( g_admin_admin_t ) );
+          else
+            a = g_admin_admins = BG_Alloc( sizeof( g_admin_admin_t ) );
+          ac++;
+        }
+        section = ADMIN_SECTION_ADMIN;
       }
-      else if( !Q_stricmp( t, "exec" ) )
+      else if( !Q_stricmp( key, "[ban]" ) )
       {
-        admin_readconfig_string( &cnf, c->exec, sizeof( c->exec ) );
+        if( pass == 1 )
+        {
+          memset( &journalBan, 0, sizeof( journalBan ) );
+          jc++;
+        }
+        else
+        {
+          if( b )
+            b = b->next = BG_Alloc( sizeof( g_admin_ban_t ) );
+          else
+            b = g_admin_bans = BG_Alloc( sizeof( g_admin_ban_t ) );
+          b->id = ++bc;
+        }
+        section = ADMIN_SECTION_BAN;
       }
-      else if( !Q_stricmp( t, "desc" ) )
+      else if( !Q_stricmp( key, "[command]" ) && pass == 0 )
       {
-        admin_readconfig_string( &cnf, c->desc, sizeof( c->desc ) );
+        if( c )
+          c = c->next = BG_Alloc( sizeof( g_admin_command_t ) );
+        else
+          c = g_admin_commands = BG_Alloc( sizeof( g_admin_command_t ) );
+        section = ADMIN_SECTION_COMMAND;
+        cc++;
       }
-      else if( !Q_stricmp( t, "flag" ) )
+      else if( key[ 0 ] == '[' )
       {
-        admin_readconfig_string( &cnf, c->flag, sizeof( c->flag ) );
+        G_Printf( "ERROR: %s, line %d: unexpected section \"%s\"\n",
+                  file, keyLine, key );
+        section = ADMIN_SECTION_NONE;
       }
       else
       {
-        COM_ParseError( "[command] unrecognized token \"%s\"", t );
+        if( section != ADMIN_SECTION_NONE && !equals )
+          G_Printf( "WARNING: %s, line %d: expected '=' after \"%s\"\n",
+                    file, keyLine, key );
+
+        switch( section )
+        {
+          case ADMIN_SECTION_LEVEL:
+            known = admin_readconfig_level( l, key, value );
+            break;
+          case ADMIN_SECTION_ADMIN:
+            known = admin_readconfig_admin( pass ? &journalAdmin : a,
+                                            key, value );
+            break;
+          case ADMIN_SECTION_BAN:
+            known = admin_readconfig_ban( pass ? &journalBan : b, key, value );
+            break;
+          case ADMIN_SECTION_COMMAND:
+            known = admin_readconfig_command( c, key, value );
+            break;
+          default:
+            known = qfalse;
+            break;
+        }
+        if( !known )
+          G_Printf( "ERROR: %s, line %d: unrecognized token \"%s\"\n",
+                    file, keyLine, key );
       }
     }
-    else
-    {
-      COM_ParseError( "unexpected token \"%s\"", t );
-    }
   }
-  BG_Free( cnf2 );
-  ADMP( va( "^3readconfig: ^7loaded %d levels, %d admins, %d bans, %d commands\n",
-          lc, ac, bc, cc ) );
+  BG_Free( cnf );
+
   if( lc == 0 )
     admin_default_levels();
   else
@@ -1281,6 +1853,48 @@ qboolean G_admin_readconfig( gentity_t *ent )
     llsort( (struct llist **)&g_admin_admins, cmplevel );
   }
 
+  now = trap_RealTime( NULL );
+
+  // fold the journal into admin.dat, then drop what it no longer holds so
+  // that ban numbers match the file
+  if( jc )
+  {
+    admin_writeconfig( now );
+
+    bc = 0;
+    for( prev = NULL, b = g_admin_bans; b; b = next )
+    {
+      next = b->next;
+      if( b->expires != 0 && b->expires <= now )
+      {
+        if( prev )
+          prev->next = next;
+        else
+          g_admin_bans = next;
+        BG_Free( b );
+        continue;
+      }
+      b->id = ++bc;
+      prev = b;
+    }
+  }
+
+  if( jc )
+    ADMP( va( "^3readconfig: ^7loaded %d levels, %d admins, %d bans, "
+      "%d commands, %d journal records\n", lc, ac, bc, cc, jc ) );
+  else
+    ADMP( va( "^3readconfig: ^7loaded %d levels, %d admins, %d bans, "
+      "%d commands\n", lc, ac, bc, cc ) );
+
+  for( a = g_admin_admins; a; a = a->next )
+    admin_admin_index( a );
+
+  for( b = g_admin_bans; b; b = b->next )
+  {
+    if( b->expires == 0 || b->expires > now )
+      admin_ban_index( b );
+  }
+
   // restore admin mapping
   for( i = 0; i < level.maxclients; i++ )
   {
@@ -1453,6 +2067,7 @@ qboolean G_admin_setlevel( gentity_t *ent )
       a = g_admin_admins = BG_Alloc( sizeof( g_admin_admin_t ) );
     vic->client->pers.admin = a;
     Q_strncpyz( a->guid, vic->client->pers.guid, sizeof( a->guid ) );
+    admin_admin_index( a );
   }
 
   a->level = l->level;
@@ -1466,7 +2081,7 @@ qboolean G_admin_setlevel( gentity_t *ent )
     "print \"^3setlevel: ^7%s^7 was given level %d admin rights by %s\n\"",
     a->name, a->level, ( ent ) ? ent->client->pers.netname : "console" ) );
 
-  admin_writeconfig();
+  admin_journal_admin( a );
   if( vic )
   {
     G_admin_authlog( vic );
@@ -1494,16 +2109,25 @@ static void admin_create_ban( gentity_t *ent,
   for( b = g_admin_bans; b; b = b->next )
   {
     if( !b->next )
+    {
+      i = b->id;
       break;
+    }
   }
 
   if( b )
   {
     if( !b->next )
+    {
       b = b->next = BG_Alloc( sizeof( g_admin_ban_t ) );
+      b->id = i + 1;
+    }
   }
   else
+  {
     b = g_admin_bans = BG_Alloc( sizeof( g_admin_ban_t ) );
+    b->id = 1;
+  }
 
   Q_strncpyz( b->name, netname, sizeof( b->name ) );
   Q_strncpyz( b->guid, guid, sizeof( b->guid ) );
@@ -1530,6 +2154,9 @@ static void admin_create_ban( gentity_t *ent,
   else
     Q_strncpyz( b->reason, reason, sizeof( b->reason ) );
 
+  admin_ban_index( b );
+  admin_journal_ban( b );
+
   G_admin_ban_message( NULL, b, disconnect, sizeof( disconnect ), NULL, 0 );
 
   for( i = 0; i < level.maxclients; i++ )
@@ -1665,7 +2292,6 @@ qboolean G_admin_kick( gentity_t *ent )
     &vic->client->pers.ip,
     MAX( 1, G_admin_parse_time( g_adminTempBan.string ) ),
     ( *reason ) ? reason : "kicked by admin" );
-  admin_writeconfig();
 
   return qtrue;
 }
@@ -1881,8 +2507,6 @@ qboolean G_admin_ban( gentity_t *ent )
 
   if( !g_admin.string[ 0 ] )
     ADMP( "^3ban: ^7WARNING g_admin not set, not saving ban to a file\n" );
-  else
-    admin_writeconfig();
 
   return qtrue;
 }
@@ -1929,7 +2553,8 @@ qboolean G_admin_unban( gentity_t *ent )
           ban->name,
           ( ent ) ? ent->client->pers.netname : "console" ) );
   ban->expires = time;
-  admin_writeconfig();
+  admin_ban_unindex( ban );
+  admin_journal_ban( ban );
   return qtrue;
 }
 
@@ -2059,6 +2684,10 @@ qboolean G_admin_adjustban( gentity_t *ent )
       Com_sprintf( p, sizeof( ban->ip.str ) - ( p - ban->ip.str ), "/%d", mask );
     ban->ip.mask = mask;
   }
+  // the prefix or the expiry may have changed
+  admin_ban_unindex( ban );
+  if( ban->expires == 0 || ban->expires > time )
+    admin_ban_index( ban );
   reason = ConcatArgs( 3 + skiparg );
   if( *reason )
     Q_strncpyz( ban->reason, reason, sizeof( ban->reason ) );
@@ -2080,7 +2709,7 @@ qboolean G_admin_adjustban( gentity_t *ent )
     reason ) );
   if( ent )
     Q_strncpyz( ban->banner, ent->client->pers.netname, sizeof( ban->banner ) );
-  admin_writeconfig();
+  admin_journal_ban( ban );
   return qtrue;
 }
 
@@ -2335,6 +2964,7 @@ qboolean G_admin_listlayouts( gentity_t *ent )
   char *s;
   char layout[ MAX_QPATH ] = { "" };
   size_t i = 0;
+  layoutInfo_t info;
 
   if( trap_Argc( ) == 2 )
     trap_Argv( 1, map, sizeof( map ) );
@@ -2349,7 +2979,11 @@ qboolean G_admin_listlayouts( gentity_t *ent )
   {
     if( *s == ' ' )
     {
-      ADMBP( va ( " %s\n", layout ) );
+      if( G_LayoutInfo( map, layout, &info ) )
+        ADMBP( va( " %-24s %d alien, %d human buildables\n", layout,
+          info.counts[ TEAM_ALIENS ], info.counts[ TEAM_HUMANS ] ) );
+      else
+        ADMBP( va ( " %s\n", layout ) );
       layout[ 0 ] = '\0';
       i = 0;
     }
@@ -3138,15 +3772,7 @@ namelog_t *G_NamelogFromString( gentity_t *ent, char *s )
         return level.clients[ i ].pers.namelog;
     }
     else if( i >= MAX_CLIENTS )
-    {
-      for( p = level.namelogs; p; p = p->next )
-      {
-        if( p->id == i )
-          break;
-      }
-      if( p )
-        return p;
-    }
+      return G_namelog_find( i );
 
     return NULL;
   }
@@ -3578,6 +4204,12 @@ void G_admin_cleanup( void )
     BG_Free( b );
   }
   g_admin_bans = NULL;
+  memset( g_admin_adminGuids, 0, sizeof( g_admin_adminGuids ) );
+  memset( g_admin_banGuids, 0, sizeof( g_admin_banGuids ) );
+  g_admin_banNoGuid = NULL;
+  admin_trie_free( g_admin_banTrie[ IPv4 ] );
+  admin_trie_free( g_admin_banTrie[ IPv6 ] );
+  g_admin_banTrie[ IPv4 ] = g_admin_banTrie[ IPv6 ] = NULL;
   for( c = g_admin_commands; c; c = n )
   {
     n = c->next;
@@ -71,6 +71,9 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 #define MAX_ADMIN_LISTITEMS 20
 #define MAX_ADMIN_SHOWBANS 10
 
+// admins and bans are also hashed by guid, bans by address in a trie
+#define ADMIN_GUID_BUCKETS 1024
+
 typedef struct
 {
   char *keyword;
@@ -94,10 +97,11 @@ g_admin_level_t;
 typedef struct g_admin_admin
 {
   struct g_admin_admin *next;
-  int level;
+  int level; // where g_admin_level_t has it, for cmplevel
   char guid[ 33 ];
   char name[ MAX_COLORFUL_NAME_LENGTH ];
   char flags[ MAX_ADMIN_FLAGS ];
+  struct g_admin_admin *guidNext;
 }
 g_admin_admin_t;
 
@@ -121,6 +125,11 @@ typedef struct
 typedef struct g_admin_ban
 {
   struct g_admin_ban *next;
+  struct g_admin_ban *guidNext;
+  struct g_admin_ban *addrNext;
+  struct g_admin_banNode *node; // where addrNext is linked, NULL if unindexed
+  qboolean indexed;
+  int id; // ban#, the position in g_admin_bans
   char name[ MAX_COLORFUL_NAME_LENGTH ];
   char guid[ 33 ];
   addr_t ip;
@@ -149,6 +158,7 @@ void G_admin_cmdlist( gentity_t *ent );
 qboolean G_admin_ban_check( gentity_t *ent, char *reason, int rlen );
 qboolean G_admin_cmd_check( gentity_t *ent );
 qboolean G_admin_readconfig( gentity_t *ent );
+void G_admin_flush( qboolean force );
 qboolean G_admin_permission( gentity_t *ent, const char *flag );
 qboolean G_admin_name_check( gentity_t *ent, char *name, char *err, int len );
 g_admin_admin_t *G_admin_admin( const char *guid );
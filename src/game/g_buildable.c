@@ -112,153 +112,461 @@ gentity_t *G_CheckSpawnPoint( int spawnNum, const vec3_t origin,
   return NULL;
 }
 
-#define POWER_REFRESH_TIME  2000
+/*
+================
+G_BuildableGridBucket
+
+Cells are hashed into a fixed number of buckets, so a bucket can hold
+buildables from several cells and walkers check buildableCell
+================
+*/
+static int G_BuildableGridBucket( int x, int y )
+{
+  return ( x * 73 + y * 151 ) & ( BUILDABLE_GRID_BUCKETS - 1 );
+}
+
+static int G_BuildableGridCoord( float v )
+{
+  return ( (int)v + BUILDABLE_GRID_OFFSET ) >> BUILDABLE_GRID_SHIFT;
+}
+
+static void G_LinkBuildableCell( gentity_t *ent )
+{
+  gentity_t **bucket;
+
+  ent->buildableCell[ 0 ] = G_BuildableGridCoord( ent->r.currentOrigin[ 0 ] );
+  ent->buildableCell[ 1 ] = G_BuildableGridCoord( ent->r.currentOrigin[ 1 ] );
+
+  bucket = &level.buildableGrid[ G_BuildableGridBucket( ent->buildableCell[ 0 ],
+                                                        ent->buildableCell[ 1 ] ) ];
+  ent->nextCellBuildable = *bucket;
+  *bucket = ent;
+}
+
+static void G_UnlinkBuildableCell( gentity_t *ent )
+{
+  gentity_t **link;
+
+  link = &level.buildableGrid[ G_BuildableGridBucket( ent->buildableCell[ 0 ],
+                                                      ent->buildableCell[ 1 ] ) ];
+  for( ; *link; link = &(*link)->nextCellBuildable )
+  {
+    if( *link == ent )
+    {
+      *link = ent->nextCellBuildable;
+      break;
+    }
+  }
+
+  ent->nextCellBuildable = NULL;
+}
 
 /*
 ================
-G_FindPower
+G_RegisterBuildable
 
-attempt to find power for self, return qtrue if successful
+Buildables are kept in a list per type and in a grid of their positions,
+so the searches for a type or for what is near a point don't have to
+walk all of g_entities. Entries stay until G_FreeEntity, so walkers still
+check eType for buildables that have turned into explosion events
 ================
 */
-qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
+void G_RegisterBuildable( gentity_t *ent )
 {
-  int       i, j;
-  gentity_t *ent, *ent2;
-  gentity_t *closestPower = NULL;
-  int       distance = 0;
-  int       minDistance = REPEATER_BASESIZE + 1;
-  vec3_t    temp_v;
+  gentity_t **link;
 
-  if( self->buildableTeam != TEAM_HUMANS )
-    return qfalse;
+  if( ent->buildableRegistered )
+    G_UnregisterBuildable( ent );
 
-  // Reactor is always powered
-  if( self->s.modelindex == BA_H_REACTOR )
+  // keep the lists in entity number order, like the old scans
+  for( link = &level.buildables[ ent->s.modelindex ]; *link && *link < ent;
+       link = &(*link)->nextBuildable );
+  ent->nextBuildable = *link;
+  *link = ent;
+
+  G_LinkBuildableCell( ent );
+  ent->buildableRegistered = qtrue;
+
+  // the team is known now
+  G_UpdatePowerLoad( ent );
+}
+
+/*
+================
+G_UnregisterBuildable
+================
+*/
+void G_UnregisterBuildable( gentity_t *ent )
+{
+  gentity_t **link;
+
+  if( !ent->buildableRegistered )
+    return;
+
+  for( link = &level.buildables[ ent->s.modelindex ]; *link; link = &(*link)->nextBuildable )
   {
-    self->parentNode = self;
+    if( *link == ent )
+    {
+      *link = ent->nextBuildable;
+      break;
+    }
+  }
 
-    return qtrue;
+  ent->nextBuildable = NULL;
+  G_UnlinkBuildableCell( ent );
+  ent->buildableRegistered = qfalse;
+}
+
+/*
+================
+G_UpdateBuildableCell
+
+Moves a buildable to the right grid cell after it has moved
+================
+*/
+void G_UpdateBuildableCell( gentity_t *ent )
+{
+  if( !ent->buildableRegistered )
+    return;
+
+  if( ent->buildableCell[ 0 ] == G_BuildableGridCoord( ent->r.currentOrigin[ 0 ] ) &&
+      ent->buildableCell[ 1 ] == G_BuildableGridCoord( ent->r.currentOrigin[ 1 ] ) )
+    return;
+
+  G_UnlinkBuildableCell( ent );
+  G_LinkBuildableCell( ent );
+}
+
+/*
+================
+G_BuildablesInRange
+
+Fills list with the buildables of a type, or of any type for BA_NONE,
+whose origin is within range of origin and returns how many it found
+================
+*/
+int G_BuildablesInRange( const vec3_t origin, float range, buildable_t buildable,
+                         gentity_t **list, int maxList )
+{
+  int       x, y, mins[ 2 ], maxs[ 2 ];
+  int       num = 0;
+  float     rangeSquared = range * range;
+  qboolean  wholeGrid;
+  gentity_t *ent;
+
+  mins[ 0 ] = G_BuildableGridCoord( origin[ 0 ] - range );
+  mins[ 1 ] = G_BuildableGridCoord( origin[ 1 ] - range );
+  maxs[ 0 ] = G_BuildableGridCoord( origin[ 0 ] + range );
+  maxs[ 1 ] = G_BuildableGridCoord( origin[ 1 ] + range );
+
+  // once the area covers more cells than there are buckets it's cheaper to
+  // go over each bucket once
+  wholeGrid = ( maxs[ 0 ] - mins[ 0 ] + 1 ) * ( maxs[ 1 ] - mins[ 1 ] + 1 ) >= BUILDABLE_GRID_BUCKETS;
+  if( wholeGrid )
+  {
+    mins[ 0 ] = mins[ 1 ] = 0;
+    maxs[ 0 ] = 0;
+    maxs[ 1 ] = BUILDABLE_GRID_BUCKETS - 1;
   }
 
-  // Handle repeaters
-  if( self->s.modelindex == BA_H_REPEATER )
+  for( x = mins[ 0 ]; x <= maxs[ 0 ]; x++ )
   {
-    self->parentNode = G_Reactor( );
+    for( y = mins[ 1 ]; y <= maxs[ 1 ]; y++ )
+    {
+      ent = level.buildableGrid[ wholeGrid ? y : G_BuildableGridBucket( x, y ) ];
 
-    return self->parentNode != NULL;
+      for( ; ent; ent = ent->nextCellBuildable )
+      {
+        if( !wholeGrid && ( ent->buildableCell[ 0 ] != x || ent->buildableCell[ 1 ] != y ) )
+          continue;
+
+        if( ent->s.eType != ET_BUILDABLE )
+          continue;
+
+        if( buildable != BA_NONE && ent->s.modelindex != buildable )
+          continue;
+
+        if( DistanceSquared( origin, ent->r.currentOrigin ) > rangeSquared )
+          continue;
+
+        if( num < maxList )
+          list[ num++ ] = ent;
+      }
+    }
+  }
+
+  return num;
+}
+
+#define POWER_REFRESH_TIME  2000
+
+/*
+================
+G_BuildPointsUsed
+================
+*/
+static int *G_BuildPointsUsed( int pool )
+{
+  if( pool == BP_POOL_ALIENS )
+    return &level.alienBuildPointsUsed;
+  if( pool == BP_POOL_HUMANS )
+    return &level.humanBuildPointsUsed;
+
+  return &level.repeaterBuildPointsUsed[ pool ];
+}
+
+/*
+================
+G_SetPowerLoad
+================
+*/
+static void G_SetPowerLoad( gentity_t *ent, int node, int load, int pool, int charge )
+{
+  if( ent->powerLoad )
+    level.powerLoad[ ent->powerLoadNode ] -= ent->powerLoad;
+  if( ent->buildPointCharge )
+    *G_BuildPointsUsed( ent->buildPointPool ) -= ent->buildPointCharge;
+
+  ent->powerLoad = load;
+  ent->powerLoadNode = node;
+  ent->buildPointCharge = charge;
+  ent->buildPointPool = pool;
+
+  if( load )
+    level.powerLoad[ node ] += load;
+  if( charge )
+    *G_BuildPointsUsed( pool ) += charge;
+}
+
+/*
+================
+G_UpdatePowerLoad
+
+level.powerLoad holds, for every entity slot, the build points of the
+buildables that have it as their parentNode, so the power checks don't
+have to rescan the whole base. Alongside it the build points the live
+buildables take are kept per team and per repeater for
+G_CalculateBuildPoints. Each entity remembers what it added so it can
+take it back again when its parentNode changes, it dies or it is freed
+================
+*/
+void G_UpdatePowerLoad( gentity_t *ent )
+{
+  int load = 0;
+  int node = 0;
+  int charge = 0;
+  int pool = BP_POOL_HUMANS;
+
+  if( ent->s.eType == ET_BUILDABLE && ent->parentNode )
+  {
+    node = ent->parentNode - g_entities;
+    load = BG_Buildable( ent->s.modelindex )->buildPoints;
   }
 
-  // Iterate through entities
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  if( ent->s.eType == ET_BUILDABLE && !( ent->s.eFlags & EF_DEAD ) )
   {
-    if( ent->s.eType != ET_BUILDABLE )
-      continue;
+    buildable_t buildable = ent->s.modelindex;
+    gentity_t   *power = ent->parentNode;
 
-    // If entity is a power item calculate the distance to it
-    if( ( ent->s.modelindex == BA_H_REACTOR || ent->s.modelindex == BA_H_REPEATER ) &&
-        ( searchUnspawned || ent->spawned ) && ent->powered && ent->health > 0 )
+    if( ent->buildableTeam == TEAM_ALIENS )
     {
-      VectorSubtract( self->r.currentOrigin, ent->r.currentOrigin, temp_v );
-      distance = VectorLength( temp_v );
-
-      // Always prefer a reactor if there is one in range
-      if( ent->s.modelindex == BA_H_REACTOR && distance <= REACTOR_BASESIZE )
+      pool = BP_POOL_ALIENS;
+      charge = BG_Buildable( buildable )->buildPoints;
+    }
+    else if( ent->buildableTeam == TEAM_HUMANS && buildable != BA_H_REACTOR )
+    {
+      // repeaters are paid for from the main pool wherever they are
+      if( buildable == BA_H_REPEATER ||
+          ( power && power->s.modelindex == BA_H_REACTOR ) )
+        charge = BG_Buildable( buildable )->buildPoints;
+      else if( power && power->s.modelindex == BA_H_REPEATER )
       {
-        // Only power as much BP as the reactor can hold
-        if( self->s.modelindex != BA_NONE )
-        {
-          int buildPoints = g_humanBuildPoints.integer;
+        pool = power - g_entities;
+        charge = BG_Buildable( buildable )->buildPoints;
+      }
+    }
+  }
 
-          // Scan the buildables in the reactor zone
-          for( j = MAX_CLIENTS, ent2 = g_entities + j; j < level.num_entities; j++, ent2++ )
-          {
-            if( ent2->s.eType != ET_BUILDABLE )
-              continue;
+  G_SetPowerLoad( ent, node, load, pool, charge );
+}
 
-            if( ent2 == self )
-              continue;
+/*
+================
+G_ClearPowerLoad
 
-            if( ent2->parentNode == ent )
-            {
-              buildPoints -= BG_Buildable( ent2->s.modelindex )->buildPoints;
-            }
-          }
+Takes back everything an entity added, before it is freed
+================
+*/
+void G_ClearPowerLoad( gentity_t *ent )
+{
+  G_SetPowerLoad( ent, 0, 0, BP_POOL_HUMANS, 0 );
+}
+
+/*
+================
+G_SetParentNode
 
-          buildPoints -= level.humanBuildPointQueue;
+Every parentNode change of a real entity goes through here, dummies built
+on the stack just set the field
+================
+*/
+void G_SetParentNode( gentity_t *ent, gentity_t *parent )
+{
+  ent->parentNode = parent;
 
-          buildPoints -= BG_Buildable( self->s.modelindex )->buildPoints;
+  if( ent >= g_entities && ent < g_entities + MAX_GENTITIES )
+    G_UpdatePowerLoad( ent );
+}
 
-          if( buildPoints >= 0 )
-          {
-            self->parentNode = ent;
-            return qtrue;
-          }
-          else
+/*
+================
+G_PowerNodeLoad
+
+Build points already drawn from a power node by everything but self
+================
+*/
+static int G_PowerNodeLoad( gentity_t *node, gentity_t *self )
+{
+  int load = level.powerLoad[ node - g_entities ];
+
+  if( self->powerLoad && self->powerLoadNode == node - g_entities )
+    load -= self->powerLoad;
+
+  return load;
+}
+
+/*
+================
+G_ClosestPower
+
+The reactor or repeater that would power self, NULL if there is none
+================
+*/
+static gentity_t *G_ClosestPower( gentity_t *self, qboolean searchUnspawned )
+{
+  static const buildable_t powerTypes[ ] = { BA_H_REACTOR, BA_H_REPEATER };
+  int       i;
+  gentity_t *ent;
+  gentity_t *closestPower = NULL;
+  int       distance = 0;
+  int       minDistance = REPEATER_BASESIZE + 1;
+  vec3_t    temp_v;
+
+  // Iterate through the reactor and the repeaters
+  for( i = 0; i < (int)ARRAY_LEN( powerTypes ); i++ )
+  {
+    for( ent = level.buildables[ powerTypes[ i ] ]; ent; ent = ent->nextBuildable )
+    {
+      if( ent->s.eType != ET_BUILDABLE )
+        continue;
+
+      // If entity is a power item calculate the distance to it
+      if( ( searchUnspawned || ent->spawned ) && ent->powered && ent->health > 0 )
+      {
+        VectorSubtract( self->r.currentOrigin, ent->r.currentOrigin, temp_v );
+        distance = VectorLength( temp_v );
+
+        // Always prefer a reactor if there is one in range
+        if( ent->s.modelindex == BA_H_REACTOR && distance <= REACTOR_BASESIZE )
+        {
+          // Only power as much BP as the reactor can hold
+          if( self->s.modelindex != BA_NONE )
           {
-            // a buildable can still be built if it shares BP from two zones
+            int buildPoints = g_humanBuildPoints.integer;
+
+            // The buildables in the reactor zone
+            buildPoints -= G_PowerNodeLoad( ent, self );
 
-            // TODO: handle combined power zones here
+            buildPoints -= level.humanBuildPointQueue;
+
+            buildPoints -= BG_Buildable( self->s.modelindex )->buildPoints;
+
+            if( buildPoints >= 0 )
+              return ent;
+            else
+            {
+              // a buildable can still be built if it shares BP from two zones
+
+              // TODO: handle combined power zones here
+            }
           }
-        }
 
-        // Dummy buildables don't need to look for zones
-        else
-        {
-          self->parentNode = ent;
-          return qtrue;
+          // Dummy buildables don't need to look for zones
+          else
+            return ent;
         }
-      }
-      else if( distance < minDistance )
-      {
-        // It's a repeater, so check that enough BP will be available to power
-        // the buildable but only if self is a real buildable
-
-        if( self->s.modelindex != BA_NONE )
+        else if( distance < minDistance )
         {
-          int buildPoints = g_humanRepeaterBuildPoints.integer;
+          // It's a repeater, so check that enough BP will be available to power
+          // the buildable but only if self is a real buildable
 
-          // Scan the buildables in the repeater zone
-          for( j = MAX_CLIENTS, ent2 = g_entities + j; j < level.num_entities; j++, ent2++ )
+          if( self->s.modelindex != BA_NONE )
           {
-            if( ent2->s.eType != ET_BUILDABLE )
-              continue;
+            int buildPoints = g_humanRepeaterBuildPoints.integer;
 
-            if( ent2 == self )
-              continue;
+            // The buildables in the repeater zone
+            buildPoints -= G_PowerNodeLoad( ent, self );
 
-            if( ent2->parentNode == ent )
-              buildPoints -= BG_Buildable( ent2->s.modelindex )->buildPoints;
-          }
+            if( ent->usesBuildPointZone && level.buildPointZones[ ent->buildPointZone ].active )
+              buildPoints -= level.buildPointZones[ ent->buildPointZone ].queuedBuildPoints;
 
-          if( ent->usesBuildPointZone && level.buildPointZones[ ent->buildPointZone ].active )
-            buildPoints -= level.buildPointZones[ ent->buildPointZone ].queuedBuildPoints;
+            buildPoints -= BG_Buildable( self->s.modelindex )->buildPoints;
 
-          buildPoints -= BG_Buildable( self->s.modelindex )->buildPoints;
+            if( buildPoints >= 0 )
+            {
+              closestPower = ent;
+              minDistance = distance;
+            }
+            else
+            {
+              // a buildable can still be built if it shares BP from two zones
 
-          if( buildPoints >= 0 )
-          {
-            closestPower = ent;
-            minDistance = distance;
+              // TODO: handle combined power zones here
+            }
           }
           else
           {
-            // a buildable can still be built if it shares BP from two zones
-
-            // TODO: handle combined power zones here
+            // Dummy buildables don't need to look for zones
+            closestPower = ent;
+            minDistance = distance;
           }
         }
-        else
-        {
-          // Dummy buildables don't need to look for zones
-          closestPower = ent;
-          minDistance = distance;
-        }
       }
     }
   }
 
-  self->parentNode = closestPower;
+  return closestPower;
+}
+
+/*
+================
+G_FindPower
+
+attempt to find power for self, return qtrue if successful
+================
+*/
+qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
+{
+  if( self->buildableTeam != TEAM_HUMANS )
+    return qfalse;
+
+  // Reactor is always powered
+  if( self->s.modelindex == BA_H_REACTOR )
+  {
+    G_SetParentNode( self, self );
+
+    return qtrue;
+  }
+
+  // Handle repeaters
+  if( self->s.modelindex == BA_H_REPEATER )
+  {
+    G_SetParentNode( self, G_Reactor( ) );
+
+    return self->parentNode != NULL;
+  }
+
+  G_SetParentNode( self, G_ClosestPower( self, searchUnspawned ) );
   return self->parentNode != NULL;
 }
 
@@ -266,8 +574,7 @@ qboolean G_FindPower( gentity_t *self, qboolean searchUnspawned )
 ================
 G_PowerEntityForPoint
 
-Simple wrapper to G_FindPower to find the entity providing
-power for the specified point
+Find the entity providing power for the specified point
 ================
 */
 gentity_t *G_PowerEntityForPoint( const vec3_t origin )
@@ -279,10 +586,7 @@ gentity_t *G_PowerEntityForPoint( const vec3_t origin )
   dummy.s.modelindex = BA_NONE;
   VectorCopy( origin, dummy.r.currentOrigin );
 
-  if( G_FindPower( &dummy, qfalse ) )
-    return dummy.parentNode;
-  else
-    return NULL;
+  return G_ClosestPower( &dummy, qfalse );
 }
 
 /*
@@ -367,6 +671,7 @@ Get the number of marked build points from a position
 int G_GetMarkedBuildPoints( const vec3_t pos, team_t team )
 {
   gentity_t *ent;
+  gentity_t *power = NULL;
   int       i;
   int sum = 0;
 
@@ -376,28 +681,37 @@ int G_GetMarkedBuildPoints( const vec3_t pos, team_t team )
   if( !g_markDeconstruct.integer )
     return 0;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  if( team == TEAM_HUMANS )
+    power = G_PowerEntityForPoint( pos );
+
+  for( i = BA_NONE + 1; i < BA_NUM_BUILDABLES; i++ )
   {
-    if( ent->s.eType != ET_BUILDABLE )
+    if( BG_Buildable( i )->team != team )
       continue;
 
-    if( team == TEAM_HUMANS &&
-        ent->s.modelindex != BA_H_REACTOR &&
-        ent->s.modelindex != BA_H_REPEATER &&
-        ent->parentNode != G_PowerEntityForPoint( pos ) )
-      continue;
+    for( ent = level.buildables[ i ]; ent; ent = ent->nextBuildable )
+    {
+      if( ent->s.eType != ET_BUILDABLE )
+        continue;
 
-    if( !ent->inuse )
-      continue;
+      if( team == TEAM_HUMANS &&
+          ent->s.modelindex != BA_H_REACTOR &&
+          ent->s.modelindex != BA_H_REPEATER &&
+          ent->parentNode != power )
+        continue;
 
-    if( ent->health <= 0 )
-      continue;
+      if( !ent->inuse )
+        continue;
 
-    if( ent->buildableTeam != team )
-      continue;
+      if( ent->health <= 0 )
+        continue;
 
-    if( ent->deconstruct )
-      sum += BG_Buildable( ent->s.modelindex )->buildPoints;
+      if( ent->buildableTeam != team )
+        continue;
+
+      if( ent->deconstruct )
+        sum += BG_Buildable( ent->s.modelindex )->buildPoints;
+    }
   }
 
   return sum;
@@ -416,15 +730,17 @@ providers will find themselves.
 */
 gentity_t *G_InPowerZone( gentity_t *self )
 {
-  int         i;
+  gentity_t   *list[ MAX_GENTITIES ];
+  int         i, num;
   gentity_t   *ent;
   int         distance;
   vec3_t      temp_v;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  num = G_BuildablesInRange( self->r.currentOrigin, MAX( REACTOR_BASESIZE, REPEATER_BASESIZE ) + 1.0f,
+                             BA_NONE, list, MAX_GENTITIES );
+  for( i = 0; i < num; i++ )
   {
-    if( ent->s.eType != ET_BUILDABLE )
-      continue;
+    ent = list[ i ];
 
     if( ent == self )
       continue;
@@ -461,7 +777,8 @@ attempt to find a controlling DCC for self, return number found
 */
 int G_FindDCC( gentity_t *self )
 {
-  int       i;
+  gentity_t *list[ MAX_GENTITIES ];
+  int       i, num;
   gentity_t *ent;
   int       distance = 0;
   vec3_t    temp_v;
@@ -470,11 +787,11 @@ int G_FindDCC( gentity_t *self )
   if( self->buildableTeam != TEAM_HUMANS )
     return 0;
 
-  //iterate through entities
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  //iterate through the dccs in range
+  num = G_BuildablesInRange( self->r.currentOrigin, DC_RANGE + 1.0f, BA_H_DCC, list, MAX_GENTITIES );
+  for( i = 0; i < num; i++ )
   {
-    if( ent->s.eType != ET_BUILDABLE )
-      continue;
+    ent = list[ i ];
 
     //if entity is a dcc calculate the distance to it
     if( ent->s.modelindex == BA_H_DCC && ent->spawned )
@@ -500,17 +817,13 @@ See if any powered DCC exists
 */
 qboolean G_IsDCCBuilt( void )
 {
-  int       i;
   gentity_t *ent;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  for( ent = level.buildables[ BA_H_DCC ]; ent; ent = ent->nextBuildable )
   {
     if( ent->s.eType != ET_BUILDABLE )
       continue;
 
-    if( ent->s.modelindex != BA_H_DCC )
-      continue;
-
     if( !ent->spawned )
       continue;
 
@@ -576,7 +889,8 @@ attempt to find creep for self, return qtrue if successful
 */
 qboolean G_FindCreep( gentity_t *self )
 {
-  int       i;
+  gentity_t *list[ MAX_GENTITIES ];
+  int       i, num;
   gentity_t *ent;
   gentity_t *closestSpawn = NULL;
   int       distance = 0;
@@ -591,10 +905,12 @@ qboolean G_FindCreep( gentity_t *self )
   if( self->client || self->parentNode == NULL || !self->parentNode->inuse ||
       self->parentNode->health <= 0 )
   {
-    for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+    // anything further away than CREEP_BASESIZE can't be the answer
+    num = G_BuildablesInRange( self->r.currentOrigin, CREEP_BASESIZE + 1.0f, BA_NONE,
+                               list, MAX_GENTITIES );
+    for( i = 0; i < num; i++ )
     {
-      if( ent->s.eType != ET_BUILDABLE )
-        continue;
+      ent = list[ i ];
 
       if( ( ent->s.modelindex == BA_A_SPAWN ||
             ent->s.modelindex == BA_A_OVERMIND ) &&
@@ -613,7 +929,7 @@ qboolean G_FindCreep( gentity_t *self )
     if( minDistance <= CREEP_BASESIZE )
     {
       if( !self->client )
-        self->parentNode = closestSpawn;
+        G_SetParentNode( self, closestSpawn );
       return qtrue;
     }
     else
@@ -715,6 +1031,7 @@ void AGeneric_CreepRecede( gentity_t *self )
   if( !( self->s.eFlags & EF_DEAD ) )
   {
     self->s.eFlags |= EF_DEAD;
+    G_UpdatePowerLoad( self );
     G_QueueBuildPoints( self );
 
     G_RewardAttackers( self );
@@ -1281,13 +1598,13 @@ void AHive_Think( gentity_t *self )
   if( self->spawned && !self->active && self->powered )
   {
     int i, num, entityList[ MAX_GENTITIES ];
-    vec3_t mins, maxs,
-           range = { HIVE_SENSE_RANGE, HIVE_SENSE_RANGE, HIVE_SENSE_RANGE };
-
-    VectorAdd( self->r.currentOrigin, range, maxs );
-    VectorSubtract( self->r.currentOrigin, range, mins );
+    vec3_t tip_origin;
 
-    num = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+    // AHive_CheckTarget measures the range from the tip
+    VectorMA( self->s.pos.trBase, self->r.maxs[ 2 ], self->s.origin2,
+              tip_origin );
+    num = trap_EntitiesInRadius( tip_origin, HIVE_SENSE_RANGE, 0,
+                                 entityList, MAX_GENTITIES );
 
     if( num == 0 )
       return;
@@ -1464,14 +1781,18 @@ Used by ATrapper_Think to locate enemy gentities
 void ATrapper_FindEnemy( gentity_t *ent, int range )
 {
   gentity_t *target;
-  int       i;
+  int       entityList[ MAX_GENTITIES ];
+  int       i, num;
   int       start;
 
-  // iterate through entities
-  start = rand( ) / ( RAND_MAX / level.num_entities + 1 );
-  for( i = start; i < level.num_entities + start; i++ )
+  // iterate through the entities in range
+  num = trap_EntitiesInRadius( ent->r.currentOrigin, range, 0,
+                               entityList, MAX_GENTITIES );
+
+  start = rand( ) / ( RAND_MAX / MAX( num, 1 ) + 1 );
+  for( i = start; i < num + start; i++ )
   {
-    target = g_entities + ( i % level.num_entities );
+    target = g_entities + entityList[ i % num ];
     //if target is not valid keep searching
     if( !ATrapper_CheckTarget( ent, target, range ) )
       continue;
@@ -1630,6 +1951,7 @@ void HSpawn_Blast( gentity_t *self )
   G_RewardAttackers( self );
   // turn into an explosion
   self->s.eType = ET_EVENTS + EV_HUMAN_BUILDABLE_EXPLOSION;
+  G_UpdatePowerLoad( self );
   self->freeAfterEvent = qtrue;
   G_AddEvent( self, EV_HUMAN_BUILDABLE_EXPLOSION, DirToByte( dir ) );
 }
@@ -2259,19 +2581,15 @@ Used by HMGTurret_Think to locate enemy gentities
 void HMGTurret_FindEnemy( gentity_t *self )
 {
   int       entityList[ MAX_GENTITIES ];
-  vec3_t    range;
-  vec3_t    mins, maxs;
   int       i, num;
   gentity_t *target;
   int       start;
 
   self->enemy = NULL;
 
-  // Look for targets in a box around the turret
-  VectorSet( range, MGTURRET_RANGE, MGTURRET_RANGE, MGTURRET_RANGE );
-  VectorAdd( self->r.currentOrigin, range, maxs );
-  VectorSubtract( self->r.currentOrigin, range, mins );
-  num = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+  // Look for targets the turret's line trace can reach
+  num = trap_EntitiesInRadius( self->r.currentOrigin, MGTURRET_RANGE,
+                               CONTENTS_BODY, entityList, MAX_GENTITIES );
 
   if( num == 0 )
     return;
@@ -2680,7 +2998,10 @@ void G_BuildableTouchTriggers( gentity_t *ent )
     memset( &trace, 0, sizeof( trace ) );
 
     if( hit->touch )
+    {
+      G_WakeEntity( hit );
       hit->touch( hit, ent, &trace );
+    }
   }
 }
 
@@ -2772,7 +3093,10 @@ void G_BuildableThink( gentity_t *ent, int msec )
 
   // Fall back on normal physics routines
   if( msec != 0 )
+  {
     G_Physics( ent, msec );
+    G_UpdateBuildableCell( ent );
+  }
 }
 
 
@@ -2785,22 +3109,23 @@ Check whether a point is within some range of a type of buildable
 */
 qboolean G_BuildableRange( vec3_t origin, float r, buildable_t buildable )
 {
-  int       entityList[ MAX_GENTITIES ];
   vec3_t    range;
   vec3_t    mins, maxs;
-  int       i, num;
   gentity_t *ent;
 
   VectorSet( range, r, r, r );
   VectorAdd( origin, range, maxs );
   VectorSubtract( origin, range, mins );
 
-  num = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
-  for( i = 0; i < num; i++ )
+  // the same box test trap_EntitiesInBox does, over just this type
+  for( ent = level.buildables[ buildable ]; ent; ent = ent->nextBuildable )
   {
-    ent = &g_entities[ entityList[ i ] ];
+    if( ent->s.eType != ET_BUILDABLE || !ent->r.linked )
+      continue;
 
-    if( ent->s.eType != ET_BUILDABLE )
+    if( ent->r.absmin[ 0 ] > maxs[ 0 ] || ent->r.absmin[ 1 ] > maxs[ 1 ] ||
+        ent->r.absmin[ 2 ] > maxs[ 2 ] || ent->r.absmax[ 0 ] < mins[ 0 ] ||
+        ent->r.absmax[ 1 ] < mins[ 1 ] || ent->r.absmax[ 2 ] < mins[ 2 ] )
       continue;
 
     if( ent->buildableTeam == TEAM_HUMANS && !ent->powered )
@@ -2822,16 +3147,14 @@ Finds a buildable of the specified type
 */
 static gentity_t *G_FindBuildable( buildable_t buildable )
 {
-  int       i;
   gentity_t *ent;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i;
-       i < level.num_entities; i++, ent++ )
+  for( ent = level.buildables[ buildable ]; ent; ent = ent->nextBuildable )
   {
     if( ent->s.eType != ET_BUILDABLE )
       continue;
 
-    if( ent->s.modelindex == buildable && !( ent->s.eFlags & EF_DEAD ) )
+    if( !( ent->s.eFlags & EF_DEAD ) )
       return ent;
   }
 
@@ -2975,15 +3298,18 @@ void G_ClearDeconMarks( void )
   int       i;
   gentity_t *ent;
 
-  for( i = MAX_CLIENTS, ent = g_entities + i ; i < level.num_entities ; i++, ent++ )
+  for( i = BA_NONE + 1; i < BA_NUM_BUILDABLES; i++ )
   {
-    if( !ent->inuse )
-      continue;
+    for( ent = level.buildables[ i ]; ent; ent = ent->nextBuildable )
+    {
+      if( !ent->inuse )
+        continue;
 
-    if( ent->s.eType != ET_BUILDABLE )
-      continue;
+      if( ent->s.eType != ET_BUILDABLE )
+        continue;
 
-    ent->deconstruct = qfalse;
+      ent->deconstruct = qfalse;
+    }
   }
 }
 
@@ -3054,6 +3380,90 @@ void G_FreeMarkedBuildables( gentity_t *deconner, char *readable, int rsize,
   }
 }
 
+/*
+===============
+G_BuildableRadius
+
+Radius of the sphere around a buildable's bounding box
+===============
+*/
+static float G_BuildableRadius( buildable_t buildable )
+{
+  vec3_t  mins, maxs, extent;
+  int     i;
+
+  BG_BuildableBoundingBox( buildable, mins, maxs );
+
+  for( i = 0; i < 3; i++ )
+    extent[ i ] = MAX( fabs( mins[ i ] ), fabs( maxs[ i ] ) );
+
+  return VectorLength( extent );
+}
+
+/*
+===============
+G_CollisionRange
+
+How far away another buildable can be and still intersect buildable
+===============
+*/
+static float G_CollisionRange( buildable_t buildable )
+{
+  float maxRadius = 0.0f;
+  int   i;
+
+  for( i = BA_NONE + 1; i < BA_NUM_BUILDABLES; i++ )
+    maxRadius = MAX( maxRadius, G_BuildableRadius( i ) );
+
+  return G_BuildableRadius( buildable ) + maxRadius + 1.0f;
+}
+
+static int G_CompareEntities( const void *a, const void *b )
+{
+  return *(gentity_t **)a - *(gentity_t **)b;
+}
+
+/*
+===============
+G_ReplacementCandidates
+
+The buildables G_SufficientBPAvailable has to look at, which are those of
+the team anywhere and those of any team that might collide, in entity
+number order as the removal list depends on it
+===============
+*/
+static int G_ReplacementCandidates( buildable_t buildable, vec3_t origin, team_t team,
+                                    gentity_t **list )
+{
+  int       i, j, num = 0, numNear;
+  gentity_t *ent;
+
+  for( i = BA_NONE + 1; i < BA_NUM_BUILDABLES; i++ )
+  {
+    if( BG_Buildable( i )->team != team )
+      continue;
+
+    for( ent = level.buildables[ i ]; ent; ent = ent->nextBuildable )
+    {
+      if( ent->s.eType == ET_BUILDABLE )
+        list[ num++ ] = ent;
+    }
+  }
+
+  numNear = G_BuildablesInRange( origin, G_CollisionRange( buildable ), BA_NONE,
+                                 list + num, MAX_GENTITIES - num );
+  for( i = j = num; i < num + numNear; i++ )
+  {
+    if( list[ i ]->buildableTeam != team )
+      list[ j++ ] = list[ i ];
+  }
+  num = j;
+
+  qsort( list, num, sizeof( list[ 0 ] ), G_CompareEntities );
+
+  return num;
+}
+
 /*
 ===============
 G_SufficientBPAvailable
@@ -3065,11 +3475,13 @@ and list the buildables that must be destroyed if this is the case
 static itemBuildError_t G_SufficientBPAvailable( buildable_t     buildable,
                                                  vec3_t          origin )
 {
-  int               i;
+  static gentity_t  *candidates[ MAX_GENTITIES ];
+  int               i, numCandidates;
   int               numBuildables = 0;
   int               numRequired = 0;
   int               pointsYielded = 0;
   gentity_t         *ent;
+  gentity_t         *power = NULL;
   team_t            team = BG_Buildable( buildable )->team;
   int               buildPoints = BG_Buildable( buildable )->buildPoints;
   int               remainingBP, remainingSpawns;
@@ -3118,10 +3530,11 @@ static itemBuildError_t G_SufficientBPAvailable( buildable_t     buildable,
       return bpError;
 
     // Check for buildable<->buildable collisions
-    for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+    numCandidates = G_BuildablesInRange( origin, G_CollisionRange( buildable ), BA_NONE,
+                                         candidates, MAX_GENTITIES );
+    for( i = 0; i < numCandidates; i++ )
     {
-      if( ent->s.eType != ET_BUILDABLE )
-        continue;
+      ent = candidates[ i ];
 
       if( G_BuildablesIntersect( buildable, origin, ent->s.modelindex, ent->r.currentOrigin ) )
         return IBE_NOROOM;
@@ -3133,11 +3546,14 @@ static itemBuildError_t G_SufficientBPAvailable( buildable_t     buildable,
   // Set buildPoints to the number extra that are required
   buildPoints -= remainingBP;
 
+  if( team == TEAM_HUMANS )
+    power = G_PowerEntityForPoint( origin );
+
   // Build a list of buildable entities
-  for( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+  numCandidates = G_ReplacementCandidates( buildable, origin, team, candidates );
+  for( i = 0; i < numCandidates; i++ )
   {
-    if( ent->s.eType != ET_BUILDABLE )
-      continue;
+    ent = candidates[ i ];
 
     collision = G_BuildablesIntersect( buildable, origin, ent->s.modelindex, ent->r.currentOrigin );
 
@@ -3172,7 +3588,7 @@ static itemBuildError_t G_SufficientBPAvailable( buildable_t     buildable,
     if( team == TEAM_HUMANS &&
         buildable != BA_H_REACTOR &&
         buildable != BA_H_REPEATER &&
-        ent->parentNode != G_PowerEntityForPoint( origin ) )
+        ent->parentNode != power )
       continue;
 
     if( !ent->inuse )
@@ -3191,7 +3607,7 @@ static itemBuildError_t G_SufficientBPAvailable( buildable_t     buildable,
 
     // Don't allow a power source to be replaced by a dependant
     if( team == TEAM_HUMANS &&
-        G_PowerEntityForPoint( origin ) == ent &&
+        power == ent &&
         buildable != BA_H_REPEATER &&
         buildable != core )
       continue;
@@ -3581,6 +3997,7 @@ static gentity_t *G_Build( gentity_t *builder, buildable_t buildable,
   built->killedBy = ENTITYNUM_NONE;
   built->classname = BG_Buildable( buildable )->entityName;
   built->s.modelindex = buildable;
+  G_UpdatePowerLoad( built );
   built->buildableTeam = built->s.modelindex2 = BG_Buildable( buildable )->team;
   BG_BuildableBoundingBox( buildable, built->r.mins, built->r.maxs );
 
@@ -3716,6 +4133,7 @@ static gentity_t *G_Build( gentity_t *builder, buildable_t buildable,
     built->builtBy = NULL;
 
   G_SetOrigin( built, origin );
+  G_RegisterBuildable( built );
 
   // set turret angles
   VectorCopy( builder->s.angles2, built->s.angles2 );
@@ -3871,10 +4289,12 @@ qboolean G_BuildIfValid( gentity_t *ent, buildable_t buildable )
 G_FinishSpawningBuildable
 
 Traces down to find where an item should rest, instead of letting them
-free fall from their spawn points
+free fall from their spawn points. A resting item was saved where it came
+to rest on the world and is left there
 ================
 */
-static gentity_t *G_FinishSpawningBuildable( gentity_t *ent, qboolean force )
+static gentity_t *G_FinishSpawningBuildable( gentity_t *ent, qboolean force,
+  qboolean resting )
 {
   trace_t     tr;
   vec3_t      normal, dest;
@@ -3896,9 +4316,15 @@ static gentity_t *G_FinishSpawningBuildable( gentity_t *ent, qboolean force )
   built->health = BG_Buildable( buildable )->health;
   built->s.eFlags |= EF_B_SPAWNED;
 
-  // drop towards normal surface
-  VectorScale( built->s.origin2, -4096.0f, dest );
-  VectorAdd( dest, built->r.currentOrigin, dest );
+  // a resting item only checks that its own spot is free, the others are
+  // dropped towards their normal surface
+  if( resting )
+    VectorCopy( built->r.currentOrigin, dest );
+  else
+  {
+    VectorScale( built->s.origin2, -4096.0f, dest );
+    VectorAdd( dest, built->r.currentOrigin, dest );
+  }
 
   trap_Trace( &tr, built->r.currentOrigin, built->r.mins, built->r.maxs, dest, built->s.number, built->clipmask );
 
@@ -3911,14 +4337,21 @@ static gentity_t *G_FinishSpawningBuildable( gentity_t *ent, qboolean force )
     return NULL;
   }
 
-  //point items in the correct direction
-  VectorCopy( tr.plane.normal, built->s.origin2 );
+  if( resting )
+    built->s.groundEntityNum = ENTITYNUM_WORLD;
+  else
+  {
+    //point items in the correct direction
+    VectorCopy( tr.plane.normal, built->s.origin2 );
 
-  // allow to ride movers
-  built->s.groundEntityNum = tr.entityNum;
+    // allow to ride movers
+    built->s.groundEntityNum = tr.entityNum;
+  }
 
   G_SetOrigin( built, tr.endpos );
 
+  G_UpdateBuildableCell( built );
+
   trap_LinkEntity( built );
   return built;
 }
@@ -3932,7 +4365,20 @@ Complete spawning a buildable using its placeholder
 */
 static void G_SpawnBuildableThink( gentity_t *ent )
 {
-  G_FinishSpawningBuildable( ent, qfalse );
+  G_FinishSpawningBuildable( ent, qfalse, qfalse );
+  G_BuildableThink( ent, 0 );
+}
+
+/*
+============
+G_SpawnRestingBuildableThink
+
+Complete spawning a buildable from a layout saved on this map
+============
+*/
+static void G_SpawnRestingBuildableThink( gentity_t *ent )
+{
+  G_FinishSpawningBuildable( ent, qfalse, qtrue );
   G_BuildableThink( ent, 0 );
 }
 
@@ -4027,20 +4473,198 @@ void G_ParseCSVBuildablePlusList( const char *string, int *buildables, int build
   buildables[ i ] = BA_NONE;
 }
 
+/*
+============
+Binary layouts
+
+A layout file holds either text, one "name origin angles origin2 angles2"
+line per item, or a binary snapshot that starts with LAYOUT_MAGIC. The
+binary header carries the item counts so listings only read the header,
+and the checksum of the map the layout was saved on. On that map each
+saved buildable is where it came to rest, so it is spawned in place
+instead of being dropped to the floor again.
+
+Items are stored by buildable_t number, so LAYOUT_VERSION has to change
+along with the buildable list
+============
+*/
+#define LAYOUT_MAGIC        "TLAY"
+#define LAYOUT_VERSION      1
+#define LAYOUT_HEADER_SIZE  32
+#define LAYOUT_RECORD_SIZE  52
+
+// header flags
+#define LAYOUT_RESTING      0x0001
+
+// record flags
+#define LAYOUT_ON_WORLD     0x01
+
+// item types after the buildables are the intermission views of each team,
+// matching the bAllowed indexes of a filtered layout
+#define LAYOUT_IVO          BA_NUM_BUILDABLES
+#define LAYOUT_NUM_TYPES    ( BA_NUM_BUILDABLES + NUM_TEAMS )
+
+static char *layoutIvoNames[ NUM_TEAMS ] =
+{
+  "ivo_spectator",
+  "ivo_alien",
+  "ivo_human"
+};
+
+static char *layoutIvoClassnames[ NUM_TEAMS ] =
+{
+  "info_player_intermission",
+  "info_alien_intermission",
+  "info_human_intermission"
+};
+
+static void G_LayoutPutInt( byte *p, int v )
+{
+  p[ 0 ] = v & 0xFF;
+  p[ 1 ] = ( v >> 8 ) & 0xFF;
+  p[ 2 ] = ( v >> 16 ) & 0xFF;
+  p[ 3 ] = ( v >> 24 ) & 0xFF;
+}
+
+static int G_LayoutGetInt( const byte *p )
+{
+  return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) | ( p[ 3 ] << 24 );
+}
+
+static void G_LayoutPutVec( byte *p, const vec3_t v )
+{
+  floatint_t fi;
+  int i;
+
+  for( i = 0; i < 3; i++ )
+  {
+    fi.f = v[ i ];
+    G_LayoutPutInt( p + i * 4, fi.i );
+  }
+}
+
+static void G_LayoutGetVec( const byte *p, vec3_t v )
+{
+  floatint_t fi;
+  int i;
+
+  for( i = 0; i < 3; i++ )
+  {
+    fi.i = G_LayoutGetInt( p + i * 4 );
+    v[ i ] = fi.f;
+  }
+}
+
+/*
+============
+G_LayoutReadHeader
+
+Returns qfalse if buf does not start with a binary layout header
+============
+*/
+static qboolean G_LayoutReadHeader( const byte *buf, int len,
+  layoutInfo_t *info )
+{
+  int i;
+
+  memset( info, 0, sizeof( *info ) );
+  if( len < LAYOUT_HEADER_SIZE )
+    return qfalse;
+  for( i = 0; i < 4; i++ )
+  {
+    if( buf[ i ] != LAYOUT_MAGIC[ i ] )
+      return qfalse;
+  }
+
+  info->version = G_LayoutGetInt( buf + 4 );
+  info->flags = G_LayoutGetInt( buf + 8 );
+  info->count = G_LayoutGetInt( buf + 12 );
+  info->mapChecksum = G_LayoutGetInt( buf + 16 );
+  for( i = 0; i < NUM_TEAMS; i++ )
+    info->counts[ i ] = G_LayoutGetInt( buf + 20 + i * 4 );
+  return qtrue;
+}
+
+/*
+============
+G_LayoutInfo
+
+Reads the header of a binary layout
+============
+*/
+qboolean G_LayoutInfo( const char *map, const char *layout,
+  layoutInfo_t *info )
+{
+  byte header[ LAYOUT_HEADER_SIZE ];
+  fileHandle_t f;
+  int len;
+
+  memset( info, 0, sizeof( *info ) );
+  len = trap_FS_FOpenFile( va( "layouts/%s/%s.dat", map, layout ), &f,
+    FS_READ );
+  if( len < 0 )
+    return qfalse;
+  if( len < LAYOUT_HEADER_SIZE )
+  {
+    trap_FS_FCloseFile( f );
+    return qfalse;
+  }
+  trap_FS_Read( header, sizeof( header ), f );
+  trap_FS_FCloseFile( f );
+  return G_LayoutReadHeader( header, len, info );
+}
+
+/*
+============
+G_LayoutItemType
+
+The layout item type of ent, or -1 if ent does not belong in the layout
+============
+*/
+static int G_LayoutItemType( gentity_t *ent, qboolean *bAllowed )
+{
+  int type, i;
+
+  if( ent->s.eType == ET_BUILDABLE )
+    type = ent->s.modelindex;
+  else if( ent->count == 1 && ent->classname )
+  {
+    for( i = 0; i < NUM_TEAMS; i++ )
+    {
+      if( !strcmp( ent->classname, layoutIvoClassnames[ i ] ) )
+        break;
+    }
+    if( i == NUM_TEAMS )
+      return -1;
+    type = LAYOUT_IVO + i;
+  }
+  else
+    return -1;
+
+  if( !bAllowed[ BA_NONE ] && !bAllowed[ type ] )
+    return -1;
+  return type;
+}
+
 /*
 ============
 G_LayoutSave
+
+Saves the current base as a binary layout, or as text for editing
 ============
 */
-void G_LayoutSave( char *lstr )
+void G_LayoutSave( char *lstr, qboolean text )
 {
   char *lstrPipePtr;
   qboolean bAllowed[ BA_NUM_BUILDABLES + NUM_TEAMS ];
   char map[ MAX_QPATH ];
   char fileName[ MAX_OSPATH ];
+  byte header[ LAYOUT_HEADER_SIZE ];
+  byte record[ LAYOUT_RECORD_SIZE ];
+  int counts[ NUM_TEAMS ];
   fileHandle_t f;
   int len;
-  int i;
+  int i, type, count;
   gentity_t *ent;
   const char *s;
 
@@ -4074,55 +4698,76 @@ void G_LayoutSave( char *lstr )
     return;
   }
 
-  G_Printf( "layoutsave: saving layout to %s\n", fileName );
+  G_Printf( "layoutsave: saving %s layout to %s\n",
+    text ? "text" : "binary", fileName );
 
-  for( i = MAX_CLIENTS; i < level.num_entities; i++ )
+  if( !text )
   {
-    const char *name;
-
-    ent = &level.gentities[ i ];
-    if( ent->s.eType == ET_BUILDABLE )
-    {
-      if( !bAllowed[ BA_NONE ] && !bAllowed[ ent->s.modelindex ] )
-        continue;
-      name = BG_Buildable( ent->s.modelindex )->name;
-    }
-    else if( ent->count == 1 && !strcmp( ent->classname, "info_player_intermission" ) )
-    {
-      if( !bAllowed[ BA_NONE ] && !bAllowed[ BA_NUM_BUILDABLES + TEAM_NONE ] )
-        continue;
-      name = "ivo_spectator";
-    }
-    else if( ent->count == 1 && !strcmp( ent->classname, "info_alien_intermission" ) )
+    count = 0;
+    memset( counts, 0, sizeof( counts ) );
+    for( i = MAX_CLIENTS; i < level.num_entities; i++ )
     {
-      if( !bAllowed[ BA_NONE ] && !bAllowed[ BA_NUM_BUILDABLES + TEAM_ALIENS ] )
+      type = G_LayoutItemType( &level.gentities[ i ], bAllowed );
+      if( type < 0 )
         continue;
-      name = "ivo_alien";
+      count++;
+      if( type >= LAYOUT_IVO )
+        counts[ TEAM_NONE ]++;
+      else
+        counts[ BG_Buildable( type )->team ]++;
     }
-    else if( ent->count == 1 && !strcmp( ent->classname, "info_human_intermission" ) )
+
+    memset( header, 0, sizeof( header ) );
+    for( i = 0; i < 4; i++ )
+      header[ i ] = LAYOUT_MAGIC[ i ];
+    G_LayoutPutInt( header + 4, LAYOUT_VERSION );
+    G_LayoutPutInt( header + 8, LAYOUT_RESTING );
+    G_LayoutPutInt( header + 12, count );
+    G_LayoutPutInt( header + 16,
+      trap_Cvar_VariableIntegerValue( "sv_mapChecksum" ) );
+    for( i = 0; i < NUM_TEAMS; i++ )
+      G_LayoutPutInt( header + 20 + i * 4, counts[ i ] );
+    trap_FS_Write( header, sizeof( header ), f );
+  }
+
+  for( i = MAX_CLIENTS; i < level.num_entities; i++ )
+  {
+    ent = &level.gentities[ i ];
+    type = G_LayoutItemType( ent, bAllowed );
+    if( type < 0 )
+      continue;
+
+    if( text )
     {
-      if( !bAllowed[ BA_NONE ] && !bAllowed[ BA_NUM_BUILDABLES + TEAM_HUMANS ] )
-        continue;
-      name = "ivo_human";
-    }
-    else
+      s = va( "%s %f %f %f %f %f %f %f %f %f %f %f %f\n",
+        type >= LAYOUT_IVO ? layoutIvoNames[ type - LAYOUT_IVO ] :
+          BG_Buildable( type )->name,
+        ent->r.currentOrigin[ 0 ],
+        ent->r.currentOrigin[ 1 ],
+        ent->r.currentOrigin[ 2 ],
+        ent->r.currentAngles[ 0 ],
+        ent->r.currentAngles[ 1 ],
+        ent->r.currentAngles[ 2 ],
+        ent->s.origin2[ 0 ],
+        ent->s.origin2[ 1 ],
+        ent->s.origin2[ 2 ],
+        ent->s.angles2[ 0 ],
+        ent->s.angles2[ 1 ],
+        ent->s.angles2[ 2 ] );
+      trap_FS_Write( s, strlen( s ), f );
       continue;
+    }
 
-    s = va( "%s %f %f %f %f %f %f %f %f %f %f %f %f\n",
-      name,
-      ent->r.currentOrigin[ 0 ],
-      ent->r.currentOrigin[ 1 ],
-      ent->r.currentOrigin[ 2 ],
-      ent->r.currentAngles[ 0 ],
-      ent->r.currentAngles[ 1 ],
-      ent->r.currentAngles[ 2 ],
-      ent->s.origin2[ 0 ],
-      ent->s.origin2[ 1 ],
-      ent->s.origin2[ 2 ],
-      ent->s.angles2[ 0 ],
-      ent->s.angles2[ 1 ],
-      ent->s.angles2[ 2 ] );
-    trap_FS_Write( s, strlen( s ), f );
+    record[ 0 ] = type & 0xFF;
+    record[ 1 ] = ( type >> 8 ) & 0xFF;
+    record[ 2 ] = ( ent->s.eType == ET_BUILDABLE &&
+      ent->s.groundEntityNum == ENTITYNUM_WORLD ) ? LAYOUT_ON_WORLD : 0;
+    record[ 3 ] = 0;
+    G_LayoutPutVec( record + 4, ent->r.currentOrigin );
+    G_LayoutPutVec( record + 16, ent->r.currentAngles );
+    G_LayoutPutVec( record + 28, ent->s.origin2 );
+    G_LayoutPutVec( record + 40, ent->s.angles2 );
+    trap_FS_Write( record, sizeof( record ), f );
   }
   trap_FS_FCloseFile( f );
 }
@@ -4260,7 +4905,7 @@ G_LayoutBuildItem
 ============
 */
 static void G_LayoutBuildItem( buildable_t buildable, vec3_t origin,
-  vec3_t angles, vec3_t origin2, vec3_t angles2 )
+  vec3_t angles, vec3_t origin2, vec3_t angles2, qboolean resting )
 {
   gentity_t *builder;
 
@@ -4271,6 +4916,8 @@ static void G_LayoutBuildItem( buildable_t buildable, vec3_t origin,
   VectorCopy( origin2, builder->s.origin2 );
   VectorCopy( angles2, builder->s.angles2 );
   G_SpawnBuildable( builder, buildable );
+  if( resting )
+    builder->think = G_SpawnRestingBuildableThink;
 }
 
 static void G_SpawnIntermissionViewOverride( char *cn, vec3_t origin, vec3_t angles )
@@ -4287,6 +4934,129 @@ static void G_SpawnIntermissionViewOverride( char *cn, vec3_t origin, vec3_t ang
   VectorCopy( angles, spot->r.currentAngles );
 }
 
+/*
+============
+G_LayoutPlaceItem
+============
+*/
+static void G_LayoutPlaceItem( int type, qboolean *bAllowed, vec3_t origin,
+  vec3_t angles, vec3_t origin2, vec3_t angles2, qboolean resting )
+{
+  if( !bAllowed[ BA_NONE ] && !bAllowed[ type ] )
+    return;
+
+  if( type >= LAYOUT_IVO )
+    G_SpawnIntermissionViewOverride( layoutIvoClassnames[ type - LAYOUT_IVO ],
+      origin, angles );
+  else
+    G_LayoutBuildItem( type, origin, angles, origin2, angles2, resting );
+}
+
+/*
+============
+G_LayoutLoadBinary
+============
+*/
+static void G_LayoutLoadBinary( const char *fileName, const byte *layout,
+  int len, qboolean *bAllowed )
+{
+  layoutInfo_t info;
+  const byte *record;
+  vec3_t origin, angles, origin2, angles2;
+  qboolean resting;
+  int i, type;
+
+  G_LayoutReadHeader( layout, len, &info );
+  if( info.version != LAYOUT_VERSION )
+  {
+    G_Printf( S_COLOR_RED "ERROR: %s is layout version %d, expected %d\n",
+      fileName, info.version, LAYOUT_VERSION );
+    return;
+  }
+  if( info.count < 0 ||
+      info.count > ( len - LAYOUT_HEADER_SIZE ) / LAYOUT_RECORD_SIZE )
+  {
+    G_Printf( S_COLOR_RED "ERROR: %s is truncated\n", fileName );
+    return;
+  }
+
+  // positions saved on another map, or another version of it, still have
+  // to find the floor
+  resting = ( info.flags & LAYOUT_RESTING ) &&
+    info.mapChecksum == trap_Cvar_VariableIntegerValue( "sv_mapChecksum" );
+
+  record = layout + LAYOUT_HEADER_SIZE;
+  for( i = 0; i < info.count; i++, record += LAYOUT_RECORD_SIZE )
+  {
+    type = record[ 0 ] | ( record[ 1 ] << 8 );
+    if( type <= BA_NONE || type >= LAYOUT_NUM_TYPES )
+    {
+      G_Printf( S_COLOR_YELLOW "WARNING: bad item type (%d) in layout."
+        " skipping\n", type );
+      continue;
+    }
+
+    G_LayoutGetVec( record + 4, origin );
+    G_LayoutGetVec( record + 16, angles );
+    G_LayoutGetVec( record + 28, origin2 );
+    G_LayoutGetVec( record + 40, angles2 );
+    G_LayoutPlaceItem( type, bAllowed, origin, angles, origin2, angles2,
+      resting && ( record[ 2 ] & LAYOUT_ON_WORLD ) );
+  }
+}
+
+/*
+============
+G_LayoutLoadText
+============
+*/
+static void G_LayoutLoadText( char *layout, qboolean *bAllowed )
+{
+  char buildName[ MAX_TOKEN_CHARS + 1 ];
+  vec3_t origin = { 0.0f, 0.0f, 0.0f };
+  vec3_t angles = { 0.0f, 0.0f, 0.0f };
+  vec3_t origin2 = { 0.0f, 0.0f, 0.0f };
+  vec3_t angles2 = { 0.0f, 0.0f, 0.0f };
+  char *line, *end;
+  int type;
+
+  for( line = layout; *line; line = end )
+  {
+    // only complete lines count, as before
+    end = strchr( line, '\n' );
+    if( !end )
+      break;
+    *end++ = '\0';
+
+    // the name is read straight from the line, at most MAX_TOKEN_CHARS
+    // characters of it
+    buildName[ 0 ] = '\0';
+    sscanf( line, "%" XSTRING( MAX_TOKEN_CHARS ) "s %f %f %f %f %f %f %f %f %f %f %f %f",
+      buildName,
+      &origin[ 0 ], &origin[ 1 ], &origin[ 2 ],
+      &angles[ 0 ], &angles[ 1 ], &angles[ 2 ],
+      &origin2[ 0 ], &origin2[ 1 ], &origin2[ 2 ],
+      &angles2[ 0 ], &angles2[ 1 ], &angles2[ 2 ] );
+
+    for( type = 0; type < NUM_TEAMS; type++ )
+    {
+      if( !Q_stricmp( buildName, layoutIvoNames[ type ] ) )
+        break;
+    }
+    if( type < NUM_TEAMS )
+      type += LAYOUT_IVO;
+    else
+      type = BG_BuildableByName( buildName )->number;
+
+    if( type <= BA_NONE || type >= LAYOUT_NUM_TYPES )
+      G_Printf( S_COLOR_YELLOW "WARNING: bad buildable name (%s) in layout."
+        " skipping\n", buildName );
+    else
+      G_LayoutPlaceItem( type, bAllowed, origin, angles, origin2, angles2,
+        qfalse );
+  }
+}
+
 /*
 ============
 G_LayoutLoad
@@ -4298,15 +5068,10 @@ void G_LayoutLoad( char *lstr )
   qboolean bAllowed[ BA_NUM_BUILDABLES + NUM_TEAMS ];
   fileHandle_t f;
   int len;
-  char *layout, *layoutHead;
+  char *layout;
   char map[ MAX_QPATH ];
-  char buildName[ MAX_TOKEN_CHARS ];
-  int buildable;
-  vec3_t origin = { 0.0f, 0.0f, 0.0f };
-  vec3_t angles = { 0.0f, 0.0f, 0.0f };
-  vec3_t origin2 = { 0.0f, 0.0f, 0.0f };
-  vec3_t angles2 = { 0.0f, 0.0f, 0.0f };
-  char line[ MAX_STRING_CHARS ];
+  char fileName[ MAX_OSPATH ];
+  layoutInfo_t info;
   int i;
 
   if( !lstr[ 0 ] || !Q_stricmp( lstr, "*BUILTIN*" ) )
@@ -4332,66 +5097,23 @@ void G_LayoutLoad( char *lstr )
     bAllowed[ BA_NONE ] = qtrue; // allow all
 
   trap_Cvar_VariableStringBuffer( "mapname", map, sizeof( map ) );
-  len = trap_FS_FOpenFile( va( "layouts/%s/%s.dat", map, lstr ),
-    &f, FS_READ );
+  Com_sprintf( fileName, sizeof( fileName ), "layouts/%s/%s.dat", map, lstr );
+  len = trap_FS_FOpenFile( fileName, &f, FS_READ );
   if( len < 0 )
   {
     G_Printf( "ERROR: layout %s could not be opened\n", lstr );
     return;
   }
-  layoutHead = layout = BG_Alloc( len + 1 );
+  layout = BG_Alloc( len + 1 );
   trap_FS_Read( layout, len, f );
   layout[ len ] = '\0';
   trap_FS_FCloseFile( f );
-  i = 0;
-  while( *layout )
-  {
-    if( i >= sizeof( line ) - 1 )
-    {
-      G_Printf( S_COLOR_RED "ERROR: line overflow in %s before \"%s\"\n",
-       va( "layouts/%s/%s.dat", map, lstr ), line );
-      break;
-    }
-    line[ i++ ] = *layout;
-    line[ i ] = '\0';
-    if( *layout == '\n' )
-    {
-      i = 0;
-      sscanf( line, "%s %f %f %f %f %f %f %f %f %f %f %f %f\n",
-        buildName,
-        &origin[ 0 ], &origin[ 1 ], &origin[ 2 ],
-        &angles[ 0 ], &angles[ 1 ], &angles[ 2 ],
-        &origin2[ 0 ], &origin2[ 1 ], &origin2[ 2 ],
-        &angles2[ 0 ], &angles2[ 1 ], &angles2[ 2 ] );
-
-      buildable = BG_BuildableByName( buildName )->number;
-      if( !Q_stricmp( buildName, "ivo_spectator" ) )
-      {
-        if( bAllowed[ BA_NONE ] || bAllowed[ BA_NUM_BUILDABLES + TEAM_NONE ] )
-          G_SpawnIntermissionViewOverride( "info_player_intermission", origin, angles );
-      }
-      else if( !Q_stricmp( buildName, "ivo_alien" ) )
-      {
-        if( bAllowed[ BA_NONE ] || bAllowed[ BA_NUM_BUILDABLES + TEAM_ALIENS ] )
-          G_SpawnIntermissionViewOverride( "info_alien_intermission", origin, angles );
-      }
-      else if( !Q_stricmp( buildName, "ivo_human" ) )
-      {
-        if( bAllowed[ BA_NONE ] || bAllowed[ BA_NUM_BUILDABLES + TEAM_HUMANS ] )
-          G_SpawnIntermissionViewOverride( "info_human_intermission", origin, angles );
-      }
-      else if( buildable <= BA_NONE || buildable >= BA_NUM_BUILDABLES )
-        G_Printf( S_COLOR_YELLOW "WARNING: bad buildable name (%s) in layout."
-          " skipping\n", buildName );
-      else
-      {
-        if( bAllowed[ BA_NONE ] || bAllowed[ buildable ] )
-          G_LayoutBuildItem( buildable, origin, angles, origin2, angles2 );
-      }
-    }
-    layout++;
-  }
-  BG_Free( layoutHead );
+
+  if( G_LayoutReadHeader( (byte *)layout, len, &info ) )
+    G_LayoutLoadBinary( fileName, (byte *)layout, len, bAllowed );
+  else
+    G_LayoutLoadText( layout, bAllowed );
+  BG_Free( layout );
 
   if( lstrPlusPtr )
   {
@@ -4501,7 +5223,7 @@ void G_BuildLogRevertThink( gentity_t *ent )
     }
   }
 
-  built = G_FinishSpawningBuildable( ent, qtrue );
+  built = G_FinishSpawningBuildable( ent, qtrue, qfalse );
   built->buildTime = built->s.time = 0;
   G_KillBox( built );
 
@@ -4603,89 +5325,143 @@ void G_BuildLogRevert( int id )
   }
 }
 
+/*
+================
+G_RangeMarkerTypes
+
+Bits of the buildable types whose range markers a client is shown
+================
+*/
+static int G_RangeMarkerTypes( gclient_t *client )
+{
+  int     types = 0;
+  int     i;
+  team_t  team;
+
+  if( client->pers.connected != CON_CONNECTED )
+    return 0;
+
+  team = client->pers.teamSelection;
+  if( team == TEAM_NONE )
+    types = ~0;
+  else if( BG_InventoryContainsWeapon( WP_HBUILD, client->ps.stats ) ||
+           client->ps.weapon == WP_ABUILD || client->ps.weapon == WP_ABUILD2 )
+  {
+    for( i = BA_NONE + 1; i < BA_NUM_BUILDABLES; i++ )
+    {
+      if( BG_Buildable( i )->team == team )
+        types |= 1 << i;
+    }
+  }
+
+  return types & client->pers.buildableRangeMarkerMask;
+}
+
+static qboolean G_TrajectoriesEqual( const trajectory_t *a, const trajectory_t *b )
+{
+  return a->trType == b->trType && a->trTime == b->trTime &&
+         a->trDuration == b->trDuration &&
+         VectorCompare( a->trBase, b->trBase ) && VectorCompare( a->trDelta, b->trDelta );
+}
+
 /*
 ================
 G_UpdateBuildableRangeMarkers
+
+The clients that see the markers of each buildable type are kept as 64 bit
+masks, which are only rebuilt when a client's team, build weapon or
+cg_buildableRangeMarkerMask changes. Markers are relinked only when their
+position or mask changes
 ================
 */
 void G_UpdateBuildableRangeMarkers( void )
 {
   // is the entity 64-bit client-masking extension available?
   qboolean maskingExtension = ( trap_Cvar_VariableIntegerValue( "sv_gppExtension" ) >= 1 );
-
+  qboolean changed = qfalse;
+  qboolean hidden = qfalse;
   gentity_t *e;
-  for( e = &g_entities[ MAX_CLIENTS ]; e < &g_entities[ level.num_entities ]; ++e )
+  int i, types;
+
+  for( i = 0; i < level.maxclients; ++i )
   {
-    buildable_t bType;
-    team_t bTeam;
-    int i;
+    types = G_RangeMarkerTypes( &level.clients[ i ] );
 
-    if( e->s.eType != ET_BUILDABLE || !e->rangeMarker )
-      continue;
+    if( i >= 32 && !maskingExtension && level.clients[ i ].pers.connected == CON_CONNECTED )
+      hidden = qtrue;
 
-    bType = e->s.modelindex;
-    bTeam = BG_Buildable( bType )->team;
+    if( types != level.rangeMarkerTypes[ i ] )
+    {
+      level.rangeMarkerTypes[ i ] = types;
+      changed = qtrue;
+    }
+  }
 
-    e->rangeMarker->s.pos = e->s.pos;
-    if( bType == BA_A_HIVE || bType == BA_H_TESLAGEN )
-      VectorMA( e->s.pos.trBase, e->r.maxs[ 2 ], e->s.origin2, e->rangeMarker->s.pos.trBase );
-    else if( bType == BA_A_TRAPPER || bType == BA_H_MGTURRET )
-      vectoangles( e->s.origin2, e->rangeMarker->s.apos.trBase );
+  if( hidden )
+  {
+    // resort to not sending range markers at all
+    if( !trap_Cvar_VariableIntegerValue( "g_rangeMarkerWarningGiven" ) )
+    {
+      trap_SendServerCommand( -1, "print \"" S_COLOR_YELLOW "WARNING: There is no "
+        "support for entity 64-bit client-masking on this server. Please update "
+        "your server executable. Until then, range markers will not be displayed "
+        "while there are clients with client numbers above 31 in the game.\n\"" );
+      trap_Cvar_Set( "g_rangeMarkerWarningGiven", "1" );
+    }
+  }
 
-    e->rangeMarker->r.singleClient = 0;
-    e->rangeMarker->r.hack.generic1 = 0;
+  if( changed )
+  {
+    int bType;
 
-    // remove any previously added NOCLIENT flags from the hack below
-    e->rangeMarker->r.svFlags &= ~SVF_NOCLIENT;
+    memset( level.rangeMarkerClients, 0, sizeof( level.rangeMarkerClients ) );
 
     for( i = 0; i < level.maxclients; ++i )
     {
-      gclient_t *client;
-      team_t team;
-      qboolean weaponDisplays, wantsToSee;
-
-      client = &level.clients[ i ];
-      if( client->pers.connected != CON_CONNECTED )
-        continue;
-
-      if( i >= 32 && !maskingExtension )
+      for( bType = BA_NONE + 1; bType < BA_NUM_BUILDABLES; bType++ )
       {
-        // resort to not sending range markers at all
-        if( !trap_Cvar_VariableIntegerValue( "g_rangeMarkerWarningGiven" ) )
-        {
-          trap_SendServerCommand( -1, "print \"" S_COLOR_YELLOW "WARNING: There is no "
-            "support for entity 64-bit client-masking on this server. Please update "
-            "your server executable. Until then, range markers will not be displayed "
-            "while there are clients with client numbers above 31 in the game.\n\"" );
-          trap_Cvar_Set( "g_rangeMarkerWarningGiven", "1" );
-        }
+        if( level.rangeMarkerTypes[ i ] & ( 1 << bType ) )
+          level.rangeMarkerClients[ bType ][ i >> 5 ] |= 1 << ( i & 31 );
+      }
+    }
+  }
 
-        for( e = &g_entities[ MAX_CLIENTS ]; e < &g_entities[ level.num_entities ]; ++e )
-        {
-          if( e->s.eType == ET_BUILDABLE && e->rangeMarker )
-            e->rangeMarker->r.svFlags |= SVF_NOCLIENT;
-        }
+  for( i = BA_NONE + 1; i < BA_NUM_BUILDABLES; i++ )
+  {
+    for( e = level.buildables[ i ]; e; e = e->nextBuildable )
+    {
+      gentity_t *rm = e->rangeMarker;
+      trajectory_t pos, apos;
+      int svFlags;
 
-        return;
-      }
+      if( e->s.eType != ET_BUILDABLE || !rm )
+        continue;
 
-      team = client->pers.teamSelection;
-      if( team != TEAM_NONE )
-      {
-        weaponDisplays = ( BG_InventoryContainsWeapon( WP_HBUILD, client->ps.stats ) ||
-          client->ps.weapon == WP_ABUILD || client->ps.weapon == WP_ABUILD2 );
-      }
-      wantsToSee = !!( client->pers.buildableRangeMarkerMask & ( 1 << bType ) );
+      pos = e->s.pos;
+      apos = rm->s.apos;
+      if( i == BA_A_HIVE || i == BA_H_TESLAGEN )
+        VectorMA( e->s.pos.trBase, e->r.maxs[ 2 ], e->s.origin2, pos.trBase );
+      else if( i == BA_A_TRAPPER || i == BA_H_MGTURRET )
+        vectoangles( e->s.origin2, apos.trBase );
+
+      svFlags = rm->r.svFlags & ~SVF_NOCLIENT;
+      if( hidden )
+        svFlags |= SVF_NOCLIENT;
+
+      if( rm->r.linked && rm->r.svFlags == svFlags &&
+          rm->r.singleClient == level.rangeMarkerClients[ i ][ 0 ] &&
+          rm->r.hack.generic1 == level.rangeMarkerClients[ i ][ 1 ] &&
+          G_TrajectoriesEqual( &rm->s.pos, &pos ) &&
+          G_TrajectoriesEqual( &rm->s.apos, &apos ) )
+        continue;
 
-      if( ( team == TEAM_NONE || ( team == bTeam && weaponDisplays ) ) && wantsToSee )
-      {
-        if( i >= 32 )
-          e->rangeMarker->r.hack.generic1 |= 1 << ( i - 32 );
-        else
-          e->rangeMarker->r.singleClient |= 1 << i;
-      }
-    }
+      rm->s.pos = pos;
+      rm->s.apos = apos;
+      rm->r.svFlags = svFlags;
+      rm->r.singleClient = level.rangeMarkerClients[ i ][ 0 ];
+      rm->r.hack.generic1 = level.rangeMarkerClients[ i ][ 1 ];
 
-    trap_LinkEntity( e->rangeMarker );
+      trap_LinkEntity( rm );
+    }
   }
 }
@@ -242,14 +242,16 @@ int G_ClientNumbersFromString(
 
 /*
 ==================
-ScoreboardMessage
+G_ScoreboardRows
 
+The score rows as seen by a member of team, built once a frame and
+dropped whenever the ranks are recalculated
 ==================
 */
-void ScoreboardMessage( gentity_t *ent )
+static const char *G_ScoreboardRows( team_t team )
 {
   char      entry[ 1024 ];
-  char      string[ 1400 ];
+  char      *string = level.scoreboardRows[ team ];
   int       stringlength;
   int       i, j;
   gclient_t *cl;
@@ -257,7 +259,9 @@ void ScoreboardMessage( gentity_t *ent )
   weapon_t  weapon = WP_NONE;
   upgrade_t upgrade = UP_NONE;
 
-  // send the latest information on all clients
+  if( level.scoreboardTime[ team ] == level.time + 1 )
+    return string;
+
   string[ 0 ] = 0;
   stringlength = 0;
 
@@ -275,8 +279,7 @@ void ScoreboardMessage( gentity_t *ent )
       ping = cl->ps.ping < 999 ? cl->ps.ping : 999;
 
     if( cl->sess.spectatorState == SPECTATOR_NOT &&
-        ( ent->client->pers.teamSelection == TEAM_NONE ||
-          cl->pers.teamSelection == ent->client->pers.teamSelection ) )
+        ( team == TEAM_NONE || cl->pers.teamSelection == team ) )
     {
       weapon = cl->ps.weapon;
 
@@ -305,15 +308,29 @@ void ScoreboardMessage( gentity_t *ent )
 
     j = strlen( entry );
 
-    if( stringlength + j >= sizeof( string ) )
+    if( stringlength + j >= sizeof( level.scoreboardRows[ 0 ] ) )
       break;
 
     strcpy( string + stringlength, entry );
     stringlength += j;
   }
 
+  level.scoreboardTime[ team ] = level.time + 1;
+  return string;
+}
+
+/*
+==================
+ScoreboardMessage
+
+==================
+*/
+void ScoreboardMessage( gentity_t *ent )
+{
+  // send the latest information on all clients
   trap_SendServerCommand( ent-g_entities, va( "scores %i %i%s",
-    level.alienKills, level.humanKills, string ) );
+    level.alienKills, level.humanKills,
+    G_ScoreboardRows( ent->client->pers.teamSelection ) ) );
 }
 
 
@@ -886,10 +903,138 @@ void Cmd_Team_f( gentity_t *ent )
 /*
 ==================
 G_CensorString
+
+The censors are compiled into an Aho-Corasick automaton over the
+lowercased letters and digits of the text, the only characters they are
+compared with, so a string is censored in one pass whatever the number
+of censors. Where several censors start at the same character the one
+listed first in the file wins, and the text resumes after it
 ==================
 */
+#define MAX_CENSORS       ( sizeof( censors ) / 3 )
+#define MAX_CENSOR_NODES  ( sizeof( censors ) )
+
+typedef struct
+{
+  short child;    // first child
+  short sibling;  // next child of the same parent
+  short fail;     // longest proper suffix that is also in the trie
+  short dict;     // longest proper suffix that ends a censor, -1 if none
+  short censor;   // first censor ending here, -1 if none
+  char  c;
+} censorNode_t;
+
 static char censors[ 20000 ];
 static int numcensors;
+static const char *censorReplacements[ MAX_CENSORS ];
+static int censorLengths[ MAX_CENSORS ];
+static censorNode_t censorNodes[ MAX_CENSOR_NODES ];
+static int numCensorNodes;
+
+static int G_CensorChild( int node, char c )
+{
+  int n;
+
+  for( n = censorNodes[ node ].child; n >= 0; n = censorNodes[ n ].sibling )
+  {
+    if( censorNodes[ n ].c == c )
+      return n;
+  }
+  return -1;
+}
+
+static int G_CensorNext( int node, char c )
+{
+  int n;
+
+  while( ( n = G_CensorChild( node, c ) ) < 0 && node )
+    node = censorNodes[ node ].fail;
+  return n < 0 ? 0 : n;
+}
+
+static int G_CensorNewNode( char c )
+{
+  censorNode_t *node = &censorNodes[ numCensorNodes ];
+
+  node->child = node->sibling = -1;
+  node->fail = 0;
+  node->dict = node->censor = -1;
+  node->c = c;
+  return numCensorNodes++;
+}
+
+/*
+==================
+G_CensorCompile
+
+Builds the automaton from the censors parsed so far
+==================
+*/
+static void G_CensorCompile( void )
+{
+  static short queue[ MAX_CENSOR_NODES ];
+  const char *m;
+  int i, node, next, f, head, tail;
+
+  numCensorNodes = 0;
+  G_CensorNewNode( '\0' );
+
+  for( i = 0, m = censors; i < numcensors; i++ )
+  {
+    censorLengths[ i ] = strlen( m );
+    for( node = 0; *m; m++ )
+    {
+      // only letters and digits are compared, so this can never match
+      if( !isalnum( *m ) )
+        break;
+
+      next = G_CensorChild( node, *m );
+      if( next < 0 )
+      {
+        if( numCensorNodes == MAX_CENSOR_NODES )
+          break;
+        next = G_CensorNewNode( *m );
+        censorNodes[ next ].sibling = censorNodes[ node ].child;
+        censorNodes[ node ].child = next;
+      }
+      node = next;
+    }
+    if( !*m && censorNodes[ node ].censor < 0 )
+      censorNodes[ node ].censor = i;
+
+    while( *m )
+      m++;
+    m++;
+    censorReplacements[ i ] = m;
+    while( *m )
+      m++;
+    m++;
+  }
+
+  // fail and dictionary links, breadth first so parents come first
+  head = tail = 0;
+  for( next = censorNodes[ 0 ].child; next >= 0;
+       next = censorNodes[ next ].sibling )
+    queue[ tail++ ] = next;
+  while( head < tail )
+  {
+    node = queue[ head++ ];
+    for( next = censorNodes[ node ].child; next >= 0;
+         next = censorNodes[ next ].sibling )
+    {
+      f = censorNodes[ node ].fail;
+      while( G_CensorChild( f, censorNodes[ next ].c ) < 0 && f )
+        f = censorNodes[ f ].fail;
+      f = G_CensorChild( f, censorNodes[ next ].c );
+      censorNodes[ next ].fail = f < 0 ? 0 : f;
+
+      f = censorNodes[ next ].fail;
+      censorNodes[ next ].dict = censorNodes[ f ].censor >= 0 ? f :
+        censorNodes[ f ].dict;
+      queue[ tail++ ] = next;
+    }
+  }
+}
 
 void G_LoadCensors( void )
 {
@@ -925,7 +1070,9 @@ void G_LoadCensors( void )
   term = censors;
 
   text_p = text;
-  while( 1 )
+  // the shortest entry, a one letter censor with an empty replacement,
+  // takes 3 bytes of censors[], so the tables hold as many entries as it can
+  while( numcensors < MAX_CENSORS )
   {
     token = COM_Parse( &text_p );
     if( !*token || sizeof( censors ) - ( term - censors ) < 4 )
@@ -940,13 +1087,17 @@ void G_LoadCensors( void )
     term += strlen( term ) + 1;
     numcensors++;
   }
+  G_CensorCompile( );
   G_Printf( "Parsed %d string replacements\n", numcensors );
 }
 
 void G_CensorString( char *out, const char *in, int len, gentity_t *ent )
 {
-  const char *s, *m;
-  int  i;
+  short chars[ MAX_STRING_CHARS ];  // offset in in of each compared char
+  short index[ MAX_STRING_CHARS ];  // and the other way around
+  short starts[ MAX_STRING_CHARS ]; // censor starting at each offset
+  const char *base = in, *s, *m;
+  int  i, n, k, node, mapped;
 
   if( !numcensors || G_admin_permission( ent, ADMF_NOCENSORFLOOD) )
   {
@@ -954,6 +1105,51 @@ void G_CensorString( char *out, const char *in, int len, gentity_t *ent )
     return;
   }
 
+  // pick out the characters censors are compared with, skipping the
+  // same ones the text is copied past below
+  n = 0;
+  for( s = in; *s && s - in < MAX_STRING_CHARS - 1; )
+  {
+    if( Q_IsColorString( s ) )
+    {
+      s += Q_ColorStringLength( s );
+      continue;
+    }
+    else if( Q_IsColorEscapeEscape( s ) )
+      s++;
+
+    if( !isalnum( *s ) )
+    {
+      s++;
+      continue;
+    }
+    if( s - in >= MAX_STRING_CHARS - 1 )
+      break;
+    chars[ n++ ] = s - in;
+    s++;
+  }
+  mapped = MIN( s - in, MAX_STRING_CHARS - 1 );
+  for( k = 0; k < mapped; k++ )
+    index[ k ] = starts[ k ] = -1;
+  for( k = 0; k < n; k++ )
+    index[ chars[ k ] ] = k;
+
+  // every censor that matches anywhere, keeping the first listed one
+  // for each starting character
+  for( k = 0, node = 0; k < n; k++ )
+  {
+    node = G_CensorNext( node, tolower( in[ chars[ k ] ] ) );
+    for( i = censorNodes[ node ].censor >= 0 ? node : censorNodes[ node ].dict;
+         i >= 0; i = censorNodes[ i ].dict )
+    {
+      int censor = censorNodes[ i ].censor;
+      int start = chars[ k - censorLengths[ censor ] + 1 ];
+
+      if( starts[ start ] < 0 || censor < starts[ start ] )
+        starts[ start ] = censor;
+    }
+  }
+
   len--;
   while( *in )
   {
@@ -988,58 +1184,26 @@ void G_CensorString( char *out, const char *in, int len, gentity_t *ent )
       len--;
       continue;
     }
-    m = censors;
-    for( i = 0; i < numcensors; i++, m++ )
+
+    k = in - base;
+    i = ( k < mapped && index[ k ] >= 0 ) ? starts[ k ] : -1;
+    // match
+    if( i >= 0 )
     {
-      s = in;
-      while( *s && *m )
+      in = base + chars[ index[ k ] + censorLengths[ i ] - 1 ] + 1;
+      m = censorReplacements[ i ];
+      while( *m )
       {
-        if( Q_IsColorString( s ) )
-        {
-          s += Q_ColorStringLength(s);
-          continue;
-        }
-        else if(Q_IsColorEscapeEscape(s)) {
-          s++;
-        }
-
-        if( !isalnum( *s ) )
-        {
-          s++;
-          continue;
-        }
-        if( tolower( *s ) != *m )
+        if( len < 1 )
           break;
-        s++;
-        m++;
-      }
-      // match
-      if( !*m )
-      {
-        in = s;
-        m++;
-        while( *m )
-        {
-          if( len < 1 )
-            break;
-          *out++ = *m++;
-          len--;
-        }
-        break;
-      }
-      else
-      {
-        while( *m )
-          m++;
-        m++;
-        while( *m )
-          m++;
+        *out++ = *m++;
+        len--;
       }
     }
     if( len < 1 )
       break;
     // no match
-    if( i == numcensors )
+    if( i < 0 )
     {
       *out++ = *in++;
       len--;
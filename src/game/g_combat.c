@@ -751,9 +751,7 @@ static float G_CalcDamageModifier( vec3_t point, gentity_t *targ, gentity_t *att
     return GetNonLocDamageModifier( targ, class );
   
   // Get the point location relative to the floor under the target
-  if( g_unlagged.integer && targ->client && targ->client->unlaggedCalc.used )
-    VectorCopy( targ->client->unlaggedCalc.origin, targOrigin );
-  else
+  if( !g_unlagged.integer || !targ->client || !G_UnlaggedCalcOrigin( targ, targOrigin ) )
     VectorCopy( targ->r.currentOrigin, targOrigin );
 
   BG_GetClientNormal( &targ->client->ps, normal );
@@ -1168,11 +1166,15 @@ void G_Damage( gentity_t *targ, gentity_t *inflictor, gentity_t *attacker,
       }
 
       targ->enemy = attacker;
+      G_WakeEntity( targ );
       targ->die( targ, inflictor, attacker, take, mod );
       return;
     }
     else if( targ->pain )
+    {
+      G_WakeEntity( targ );
       targ->pain( targ, attacker, take );
+    }
   }
 }
 
@@ -1234,6 +1236,31 @@ qboolean CanDamage( gentity_t *targ, vec3_t origin )
   return qfalse;
 }
 
+/*
+============
+G_BoundsDistance
+
+Distance from origin to the nearest point of ent's bounding box
+============
+*/
+static float G_BoundsDistance( vec3_t origin, gentity_t *ent )
+{
+  vec3_t v;
+  int    i;
+
+  for( i = 0; i < 3; i++ )
+  {
+    if( origin[ i ] < ent->r.absmin[ i ] )
+      v[ i ] = ent->r.absmin[ i ] - origin[ i ];
+    else if( origin[ i ] > ent->r.absmax[ i ] )
+      v[ i ] = origin[ i ] - ent->r.absmax[ i ];
+    else
+      v[ i ] = 0;
+  }
+
+  return VectorLength( v );
+}
+
 /*
 ============
 G_SelectiveRadiusDamage
@@ -1246,22 +1273,14 @@ qboolean G_SelectiveRadiusDamage( vec3_t origin, gentity_t *attacker, float dama
   gentity_t *ent;
   int       entityList[ MAX_GENTITIES ];
   int       numListedEntities;
-  vec3_t    mins, maxs;
-  vec3_t    v;
   vec3_t    dir;
-  int       i, e;
+  int       e;
   qboolean  hitClient = qfalse;
 
   if( radius < 1 )
     radius = 1;
 
-  for( i = 0; i < 3; i++ )
-  {
-    mins[ i ] = origin[ i ] - radius;
-    maxs[ i ] = origin[ i ] + radius;
-  }
-
-  numListedEntities = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+  numListedEntities = trap_EntitiesInRadius( origin, radius, 0, entityList, MAX_GENTITIES );
 
   for( e = 0; e < numListedEntities; e++ )
   {
@@ -1276,25 +1295,16 @@ qboolean G_SelectiveRadiusDamage( vec3_t origin, gentity_t *attacker, float dama
     if( ent->flags & FL_NOTARGET )
       continue;
 
-    // find the distance from the edge of the bounding box
-    for( i = 0 ; i < 3 ; i++ )
-    {
-      if( origin[ i ] < ent->r.absmin[ i ] )
-        v[ i ] = ent->r.absmin[ i ] - origin[ i ];
-      else if( origin[ i ] > ent->r.absmax[ i ] )
-        v[ i ] = origin[ i ] - ent->r.absmax[ i ];
-      else
-        v[ i ] = 0;
-    }
+    if( !ent->client || ent->client->ps.stats[ STAT_TEAM ] == team )
+      continue;
 
-    dist = VectorLength( v );
+    dist = G_BoundsDistance( origin, ent );
     if( dist >= radius )
       continue;
 
     points = damage * ( 1.0 - dist / radius );
 
-    if( CanDamage( ent, origin ) && ent->client &&
-        ent->client->ps.stats[ STAT_TEAM ] != team )
+    if( CanDamage( ent, origin ) )
     {
       VectorSubtract( ent->r.currentOrigin, origin, dir );
       // push the center of mass higher than the origin so players
@@ -1322,22 +1332,14 @@ qboolean G_RadiusDamage( vec3_t origin, gentity_t *attacker, float damage,
   gentity_t *ent;
   int       entityList[ MAX_GENTITIES ];
   int       numListedEntities;
-  vec3_t    mins, maxs;
-  vec3_t    v;
   vec3_t    dir;
-  int       i, e;
+  int       e;
   qboolean  hitClient = qfalse;
 
   if( radius < 1 )
     radius = 1;
 
-  for( i = 0; i < 3; i++ )
-  {
-    mins[ i ] = origin[ i ] - radius;
-    maxs[ i ] = origin[ i ] + radius;
-  }
-
-  numListedEntities = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+  numListedEntities = trap_EntitiesInRadius( origin, radius, 0, entityList, MAX_GENTITIES );
 
   for( e = 0; e < numListedEntities; e++ )
   {
@@ -1349,18 +1351,7 @@ qboolean G_RadiusDamage( vec3_t origin, gentity_t *attacker, float damage,
     if( !ent->takedamage )
       continue;
 
-    // find the distance from the edge of the bounding box
-    for( i = 0; i < 3; i++ )
-    {
-      if( origin[ i ] < ent->r.absmin[ i ] )
-        v[ i ] = ent->r.absmin[ i ] - origin[ i ];
-      else if( origin[ i ] > ent->r.absmax[ i ] )
-        v[ i ] = origin[ i ] - ent->r.absmax[ i ];
-      else
-        v[ i ] = 0;
-    }
-
-    dist = VectorLength( v );
+    dist = G_BoundsDistance( origin, ent );
     if( dist >= radius )
       continue;
 
@@ -153,6 +153,8 @@ struct gentity_s
   vec3_t            jerk;
 
   int               nextthink;
+  int               wakeTime;       // when a sleeping entity is walked again, see G_SleepEntity
+  int               wakeSlot;       // 1 + position in level.wakeQueue, 0 if not queued
   void              (*think)( gentity_t *self );
   void              (*reached)( gentity_t *self );  // movers call this when hitting endpoint
   void              (*blocked)( gentity_t *self, gentity_t *other );
@@ -197,6 +199,14 @@ struct gentity_s
 
   team_t            buildableTeam;      // buildable item team
   gentity_t         *parentNode;        // for creep and defence/spawn dependencies
+  int               powerLoad;          // build points this adds to level.powerLoad
+  int               powerLoadNode;      // and the slot it adds them to
+  int               buildPointCharge;   // build points this takes from buildPointPool
+  int               buildPointPool;     // BP_POOL_ALIENS, BP_POOL_HUMANS or a repeater's slot
+  qboolean          buildableRegistered;  // in the buildable registry
+  gentity_t         *nextBuildable;     // next buildable of the same type
+  gentity_t         *nextCellBuildable; // next buildable in the same grid bucket
+  int               buildableCell[ 2 ]; // grid cell it is bucketed by
   gentity_t         *rangeMarker;
   qboolean          active;             // for power repeater, but could be useful elsewhere
   qboolean          powered;            // for human buildables
@@ -268,6 +278,7 @@ typedef struct
 // namelog
 #define MAX_NAMELOG_NAMES 5
 #define MAX_NAMELOG_ADDRS 5
+#define NAMELOG_BUCKETS   256 // namelogs are also hashed by guid and by id
 typedef struct namelog_s
 {
   struct namelog_s  *next;
@@ -291,6 +302,9 @@ typedef struct namelog_s
   team_t            team;
 
   int               id;
+
+  struct namelog_s  *guidNext;
+  struct namelog_s  *idNext;
 } namelog_t;
 
 // client data that stays across multiple respawns, but is cleared
@@ -352,6 +366,15 @@ typedef struct unlagged_s {
   qboolean    used;
 } unlagged_t;
 
+// the hitboxes of all clients at one server frame, each field packed
+// by client number so a rewind can lerp every client in a single pass
+typedef struct unlaggedFrame_s {
+  vec3_t      origin[ MAX_CLIENTS ];
+  vec3_t      mins[ MAX_CLIENTS ];
+  vec3_t      maxs[ MAX_CLIENTS ];
+  int         used[ MAX_CLIENTS / 32 ]; // one bit per client
+} unlaggedFrame_t;
+
 #define MAX_TRAMPLE_BUILDABLES_TRACKED 20
 // this structure is cleared on each ClientSpawn(),
 // except for 'client->pers' and 'client->sess'
@@ -431,9 +454,7 @@ struct gclient_s
 
   int                 lastFlameBall;        // s.number of the last flame ball fired
 
-  unlagged_t          unlaggedHist[ MAX_UNLAGGED_MARKERS ];
   unlagged_t          unlaggedBackup;
-  unlagged_t          unlaggedCalc;
   int                 unlaggedTime;
 
   float               voiceEnthusiasm;
@@ -471,6 +492,10 @@ void      G_PrintSpawnQueue( spawnQueue_t *sq );
 #define MAX_DAMAGE_REGION_TEXT    8192
 #define MAX_DAMAGE_REGIONS 16
 
+// where a buildable's build points are taken from, see G_UpdatePowerLoad
+#define BP_POOL_ALIENS  -1
+#define BP_POOL_HUMANS  -2
+
 // build point zone
 typedef struct
 {
@@ -528,12 +553,28 @@ typedef struct
   int          powerValue;
 } buildLog_t;
 
+// header of a binary layout file
+typedef struct
+{
+  int          version;
+  int          flags;
+  int          count;
+  int          mapChecksum;
+  int          counts[ NUM_TEAMS ]; // buildables per team, views for TEAM_NONE
+} layoutInfo_t;
+
 //
 // this structure is cleared as each map is entered
 //
 #define MAX_SPAWN_VARS      64
 #define MAX_SPAWN_VARS_CHARS  4096
 #define MAX_BUILDLOG          128
+
+// the buildable grid hashes cells of BUILDABLE_GRID_SIZE units square
+#define BUILDABLE_GRID_SHIFT    8
+#define BUILDABLE_GRID_SIZE     ( 1 << BUILDABLE_GRID_SHIFT )
+#define BUILDABLE_GRID_OFFSET   ( 128 * 1024 ) // keeps cell coordinates positive
+#define BUILDABLE_GRID_BUCKETS  256
 #define MAX_PLAYER_MODEL      256
 
 typedef struct
@@ -571,6 +612,17 @@ typedef struct
   int               numPlayingClients;            // connected, non-spectators
   int               sortedClients[MAX_CLIENTS];   // sorted by score
 
+  // per-team payloads built once and shared by every recipient
+  int               scoreboardTime[ NUM_TEAMS ];  // level.time + 1 when built, 0 when stale
+  char              scoreboardRows[ NUM_TEAMS ][ 1400 ];
+  int               teamInfoPass;                 // nonzero while CheckTeamStatus sends tinfo
+  int               teamInfoEntryPass[ MAX_CLIENTS ];
+  char              teamInfoEntries[ MAX_CLIENTS ][ 24 ];
+  int               teamInfoSharedPass;
+  team_t            teamInfoSharedTeam;
+  int               teamInfoSharedSince;          // pers.teamInfo of the recipients it fits
+  char              teamInfoShared[ ( MAX_CLIENTS - 1 ) * 16 + 1 ];
+
   int               snd_fry;                      // sound index for standing in lava
 
   int               warmupModificationCount;      // for detecting if g_warmup is changed
@@ -632,6 +684,25 @@ typedef struct
 
   buildPointZone_t  *buildPointZones;
 
+  // power graph, see G_UpdatePowerLoad
+  int               powerLoad[ MAX_GENTITIES ];     // BP of buildables with each slot as parentNode
+  int               alienBuildPointsUsed;           // BP of the live alien buildables
+  int               humanBuildPointsUsed;           // BP of the repeaters and what the reactor powers
+  int               repeaterBuildPointsUsed[ MAX_GENTITIES ]; // BP of what each slot powers as a repeater
+
+  // buildable registry, see G_RegisterBuildable
+  gentity_t         *buildables[ BA_NUM_BUILDABLES ];         // by type, in entity number order
+  gentity_t         *buildableGrid[ BUILDABLE_GRID_BUCKETS ]; // by position
+
+  // range marker visibility, see G_UpdateBuildableRangeMarkers
+  int               rangeMarkerTypes[ MAX_CLIENTS ];              // buildable types each client sees
+  int               rangeMarkerClients[ BA_NUM_BUILDABLES ][ 2 ]; // 64 bit client mask per type
+
+  // entity scheduler, see G_WakeEntity
+  int               awakeEntities[ MAX_GENTITIES / 32 ]; // walked by G_RunFrame every frame
+  int               wakeQueue[ MAX_GENTITIES ];          // sleeping entities, heap on wakeTime
+  int               numWakeQueue;
+
   gentity_t         *markedBuildables[ MAX_GENTITIES ];
   int               numBuildablesForRemoval;
 
@@ -664,6 +735,8 @@ typedef struct
 
   int unlaggedIndex;
   int unlaggedTimes[ MAX_UNLAGGED_MARKERS ];
+  unlaggedFrame_t unlaggedHist[ MAX_UNLAGGED_MARKERS ];
+  unlaggedFrame_t unlaggedCalc;   // where the last G_UnlaggedCalc put everyone
 
   char              layout[ MAX_QPATH ];
 
@@ -680,6 +753,9 @@ typedef struct
   int               playerModelCount;
 
   namelog_t         *namelogs;
+  namelog_t         *lastNamelog;
+  namelog_t         *namelogGuids[ NAMELOG_BUCKETS ];
+  namelog_t         *namelogIds[ NAMELOG_BUCKETS ];
 
   buildLog_t        buildLog[ MAX_BUILDLOG ];
   int               buildId;
@@ -802,8 +878,10 @@ void              G_SetBuildableAnim( gentity_t *ent, buildableAnimNumber_t anim
 void              G_SetIdleBuildableAnim( gentity_t *ent, buildableAnimNumber_t anim );
 void              G_SpawnBuildable(gentity_t *ent, buildable_t buildable);
 void              FinishSpawningBuildable( gentity_t *ent );
-void              G_LayoutSave( char *name );
+void              G_LayoutSave( char *name, qboolean text );
 int               G_LayoutList( const char *map, char *list, int len );
+qboolean          G_LayoutInfo( const char *map, const char *layout,
+                                layoutInfo_t *info );
 void              G_LayoutSelect( void );
 void              G_LayoutLoad( char *lstr );
 void              G_BaseSelfDestruct( team_t team );
@@ -811,6 +889,14 @@ int               G_NextQueueTime( int queuedBP, int totalBP, int queueBaseRate
 void              G_QueueBuildPoints( gentity_t *self );
 int               G_GetBuildPoints( const vec3_t pos, team_t team );
 int               G_GetMarkedBuildPoints( const vec3_t pos, team_t team );
+void              G_RegisterBuildable( gentity_t *ent );
+void              G_UnregisterBuildable( gentity_t *ent );
+void              G_UpdateBuildableCell( gentity_t *ent );
+int               G_BuildablesInRange( const vec3_t origin, float range, buildable_t buildable,
+                                       gentity_t **list, int maxList );
+void              G_UpdatePowerLoad( gentity_t *ent );
+void              G_ClearPowerLoad( gentity_t *ent );
+void              G_SetParentNode( gentity_t *ent, gentity_t *parent );
 qboolean          G_FindPower( gentity_t *self, qboolean searchUnspawned );
 gentity_t         *G_PowerEntityForPoint( const vec3_t origin );
 gentity_t         *G_PowerEntityForEntity( gentity_t *ent );
@@ -829,6 +915,7 @@ void              G_UpdateBuildableRangeMarkers( void );
 //addr_t in g_admin.h for g_admin_ban_t
 qboolean    G_AddressParse( const char *str, addr_t *addr );
 qboolean    G_AddressCompare( const addr_t *a, const addr_t *b );
+int         G_GuidHash( const char *guid, int buckets );
 
 int         G_ParticleSystemIndex( const char *name );
 int         G_ShaderIndex( const char *name );
@@ -840,6 +927,10 @@ gentity_t   *G_PickTarget (char *targetname);
 void        G_UseTargets (gentity_t *ent, gentity_t *activator);
 void        G_SetMovedir ( vec3_t angles, vec3_t movedir);
 
+void        G_WakeEntity( gentity_t *ent );
+void        G_SleepEntity( gentity_t *ent );
+void        G_WakeDueEntities( void );
+qboolean    G_EntityNeedsFrame( gentity_t *ent );
 void        G_InitGentity( gentity_t *e );
 gentity_t   *G_Spawn( void );
 gentity_t   *G_TempEntity( const vec3_t origin, int event );
@@ -1049,6 +1140,9 @@ void G_UnlaggedStore( void );
 void G_UnlaggedClear( gentity_t *ent );
 void G_UnlaggedCalc( int time, gentity_t *skipEnt );
 void G_UnlaggedOn( gentity_t *attacker, vec3_t muzzle, float range );
+void G_UnlaggedOnTrace( gentity_t *attacker, vec3_t start, vec3_t end, float radius );
+qboolean G_UnlaggedCalcOrigin( gentity_t *ent, vec3_t origin );
+void G_UnlaggedCalcDiscard( gentity_t *ent );
 void G_UnlaggedOff( void );
 void ClientThink( int clientNum );
 void ClientEndFrame( gentity_t *ent );
@@ -1088,11 +1182,13 @@ void      G_ShutdownMapRotations( void );
 qboolean  G_MapExists( const char *name );
 qboolean  G_LayoutExists( const char *map, const char *layout );
 void      G_ClearRotationStack( void );
+void      G_SimulateMapRotation( const char *name, int steps, int numClients );
 
 //
 // g_namelog.c
 //
 
+namelog_t *G_namelog_find( int id );
 void G_namelog_connect( gclient_t *client );
 void G_namelog_disconnect( gclient_t *client );
 void G_namelog_restore( gclient_t *client );
@@ -1206,6 +1302,8 @@ extern  vmCvar_t  g_allowTeamOverlay;
 
 extern  vmCvar_t  g_censorship;
 
+extern  vmCvar_t  g_profile;
+
 void      trap_Print( const char *fmt );
 void      trap_Error( const char *fmt ) __attribute__((noreturn));
 int       trap_Milliseconds( void );
@@ -1255,3 +1353,6 @@ void      trap_SnapVector( float *v );
 void      trap_AddCommand( const char *cmdName );
 void      trap_RemoveCommand( const char *cmdName );
 int       trap_FS_GetFilteredFiles( const char *path, const char *extension, const char *filter, char *listbuf, int bufsize );
+void      trap_ProfilePhase( int phase );
+int       trap_EntitiesInRadius( const vec3_t origin, float radius, int contentmask, int *list, int maxcount );
+int       trap_PointCluster( const vec3_t point, int *area );
@@ -145,6 +145,8 @@ vmCvar_t  g_censorship;
 
 vmCvar_t  g_tag;
 
+vmCvar_t  g_profile;
+
 
 // copy cvars that can be set in worldspawn so they can be restored later
 static char cv_gravity[ MAX_CVAR_VALUE_STRING ];
@@ -158,6 +160,7 @@ static cvarTable_t   gameCvarTable[ ] =
 {
   // don't override the cheat state set by the system
   { &g_cheats, "sv_cheats", "", 0, 0, qfalse },
+  { &g_profile, "sv_profile", "0", 0, 0, qfalse },
 
   // noset vars
   { NULL, "gamename", GAME_VERSION , CVAR_SERVERINFO | CVAR_ROM, 0, qfalse  },
@@ -739,6 +742,7 @@ void G_ShutdownGame( int restart )
   // write all the client session data so we can get it back
   G_WriteSessionData( );
 
+  G_admin_flush( qtrue );
   G_admin_cleanup( );
   G_namelog_cleanup( );
   G_UnregisterCommands( );
@@ -1132,7 +1136,7 @@ Recalculate the quantity of building points available to the teams
 void G_CalculateBuildPoints( void )
 {
   int               i;
-  buildable_t       buildable;
+  gentity_t         *ent;
   buildPointZone_t  *zone;
 
   // BP queue updates
@@ -1180,8 +1184,11 @@ void G_CalculateBuildPoints( void )
     level.suddenDeathWarning = TW_IMMINENT;
   }
 
-  level.humanBuildPoints = g_humanBuildPoints.integer - level.humanBuildPointQueue;
-  level.alienBuildPoints = g_alienBuildPoints.integer - level.alienBuildPointQueue;
+  // the live buildables' build points are kept up to date by G_UpdatePowerLoad
+  level.humanBuildPoints = g_humanBuildPoints.integer - level.humanBuildPointQueue -
+                           level.humanBuildPointsUsed;
+  level.alienBuildPoints = g_alienBuildPoints.integer - level.alienBuildPointQueue -
+                           level.alienBuildPointsUsed;
 
   // Reset buildPointZones
   for( i = 0; i < g_humanRepeaterMaxZones.integer; i++ )
@@ -1192,63 +1199,28 @@ void G_CalculateBuildPoints( void )
     zone->totalBuildPoints = g_humanRepeaterBuildPoints.integer;
   }
 
-  // Iterate through entities
-  for( i = MAX_CLIENTS; i < level.num_entities; i++ )
+  // mark the zones of the live repeaters as active and take what they power
+  for( ent = level.buildables[ BA_H_REPEATER ]; ent; ent = ent->nextBuildable )
   {
-    gentity_t         *ent = &g_entities[ i ];
-    buildPointZone_t  *zone;
-    buildable_t       buildable;
-    int               cost;
-
-    if( ent->s.eType != ET_BUILDABLE || ent->s.eFlags & EF_DEAD )
+    if( ent->s.eType != ET_BUILDABLE || ent->s.eFlags & EF_DEAD ||
+        !ent->usesBuildPointZone )
       continue;
 
-    // mark a zone as active
-    if( ent->usesBuildPointZone )
-    {
-      assert( ent->buildPointZone >= 0 && ent->buildPointZone < g_humanRepeaterMaxZones.integer );
+    assert( ent->buildPointZone >= 0 && ent->buildPointZone < g_humanRepeaterMaxZones.integer );
 
-      zone = &level.buildPointZones[ ent->buildPointZone ];
-      zone->active = qtrue;
-    }
-
-    // Subtract the BP from the appropriate pool
-    buildable = ent->s.modelindex;
-    cost = BG_Buildable( buildable )->buildPoints;
-
-    if( ent->buildableTeam == TEAM_ALIENS )
-      level.alienBuildPoints -= cost;
-    if( buildable == BA_H_REPEATER )
-      level.humanBuildPoints -= cost;
-    else if( buildable != BA_H_REACTOR )
-    {
-      gentity_t *power = G_PowerEntityForEntity( ent );
-
-      if( power )
-      {
-        if( power->s.modelindex == BA_H_REACTOR )
-          level.humanBuildPoints -= cost;
-        else if( power->s.modelindex == BA_H_REPEATER && power->usesBuildPointZone )
-          level.buildPointZones[ power->buildPointZone ].totalBuildPoints -= cost;
-      }
-    }
+    zone = &level.buildPointZones[ ent->buildPointZone ];
+    zone->active = qtrue;
+    zone->totalBuildPoints -= level.repeaterBuildPointsUsed[ ent - g_entities ];
   }
 
   // Finally, update repeater zones and their queues
   // note that this has to be done after the used BP is calculated
-  for( i = MAX_CLIENTS; i < level.num_entities; i++ )
+  for( ent = level.buildables[ BA_H_REPEATER ]; ent; ent = ent->nextBuildable )
   {
-    gentity_t *ent = &g_entities[ i ];
-
     if( ent->s.eType != ET_BUILDABLE || ent->s.eFlags & EF_DEAD ||
         ent->buildableTeam != TEAM_HUMANS )
       continue;
 
-    buildable = ent->s.modelindex;
-
-    if( buildable != BA_H_REPEATER )
-      continue;
-
     if( ent->usesBuildPointZone && level.buildPointZones[ ent->buildPointZone ].active )
     {
       zone = &level.buildPointZones[ ent->buildPointZone ];
@@ -1539,6 +1511,7 @@ void CalculateRanks( void )
   level.numHumanClients = 0;
   level.numAlienClientsAlive = 0;
   level.numHumanClientsAlive = 0;
+  memset( level.scoreboardTime, 0, sizeof( level.scoreboardTime ) );
 
   for( i = 0; i < level.maxclients; i++ )
   {
@@ -1913,7 +1886,10 @@ void LogExit( const char *string )
     if( !Q_stricmp( ent->classname, "trigger_win" ) )
     {
       if( level.lastWin == ent->stageTeam )
+      {
+        G_WakeEntity( ent );
         ent->use( ent, ent, ent );
+      }
     }
   }
 }
@@ -2362,6 +2338,25 @@ void G_EvaluateAcceleration( gentity_t *ent, int msec )
   VectorCopy( ent->acceleration, ent->oldAccel );
 }
 
+/*
+================
+G_ProfilePhase
+
+Tells the server profiler which part of G_RunFrame is running, runs of
+entities of the same kind only cost a single syscall
+================
+*/
+static void G_ProfilePhase( gamePhase_t phase )
+{
+  static gamePhase_t current = GAMEPHASE_NONE;
+
+  if( !g_profile.integer || phase == current )
+    return;
+
+  current = phase;
+  trap_ProfilePhase( phase );
+}
+
 /*
 ================
 G_RunFrame
@@ -2425,14 +2420,30 @@ void G_RunFrame( int levelTime )
   level.spawning = qfalse;
 
   //
-  // go through all allocated objects
+  // go through all awake objects
   //
   ent = &g_entities[ 0 ];
+  G_ProfilePhase( GAMEPHASE_ENTITIES );
+  G_WakeDueEntities( );
 
   for( i = 0; i < level.num_entities; i++, ent++ )
   {
+    if( !( level.awakeEntities[ i >> 5 ] & ( 1 << ( i & 31 ) ) ) )
+    {
+      // skip the rest of a word with nobody awake in it
+      if( !( (unsigned)level.awakeEntities[ i >> 5 ] >> ( i & 31 ) ) )
+      {
+        i |= 31;
+        ent = &g_entities[ i ];
+      }
+      continue;
+    }
+
     if( !ent->inuse )
+    {
+      level.awakeEntities[ i >> 5 ] &= ~( 1 << ( i & 31 ) );
       continue;
+    }
 
     // clear events that are too old
     if( level.time - ent->eventTime > EVENT_VALID_MSEC )
@@ -2464,7 +2475,10 @@ void G_RunFrame( int levelTime )
 
     // temporary entities don't think
     if( ent->freeAfterEvent )
+    {
+      G_SleepEntity( ent );
       continue;
+    }
 
     // calculate the acceleration of this entity
     if( ent->evaluateAcceleration )
@@ -2475,45 +2489,56 @@ void G_RunFrame( int levelTime )
 
     if( ent->s.eType == ET_MISSILE )
     {
+      G_ProfilePhase( GAMEPHASE_MISSILES );
       G_RunMissile( ent );
       continue;
     }
 
     if ( ent->s.eType == ET_WEAPON_DROP )
     {
+      G_ProfilePhase( GAMEPHASE_ENTITIES );
       G_RunWeaponDrop( ent );
       continue;
     }
 
     if( ent->s.eType == ET_BUILDABLE )
     {
+      G_ProfilePhase( GAMEPHASE_BUILDABLES );
       G_BuildableThink( ent, msec );
       continue;
     }
 
     if( ent->s.eType == ET_CORPSE || ent->physicsObject )
     {
+      G_ProfilePhase( GAMEPHASE_ENTITIES );
       G_Physics( ent, msec );
       continue;
     }
 
     if( ent->s.eType == ET_MOVER )
     {
+      G_ProfilePhase( GAMEPHASE_ENTITIES );
       G_RunMover( ent );
       continue;
     }
 
     if( i < MAX_CLIENTS )
     {
+      G_ProfilePhase( GAMEPHASE_CLIENTS );
       G_RunClient( ent );
       continue;
     }
 
+    G_ProfilePhase( GAMEPHASE_ENTITIES );
     G_RunThink( ent );
+
+    if( ent->inuse && !G_EntityNeedsFrame( ent ) )
+      G_SleepEntity( ent );
   }
 
   // perform final fixups on the players
   ent = &g_entities[ 0 ];
+  G_ProfilePhase( GAMEPHASE_CLIENTS );
 
   for( i = 0; i < level.maxclients; i++, ent++ )
   {
@@ -2524,10 +2549,13 @@ void G_RunFrame( int levelTime )
   // save position information for all active clients
   G_UnlaggedStore( );
 
+  G_ProfilePhase( GAMEPHASE_OTHER );
   G_CountSpawns( );
   if( !g_doWarmup.integer || level.warmupTime <= level.time )
   {
+    G_ProfilePhase( GAMEPHASE_BUILDPOINTS );
     G_CalculateBuildPoints( );
+    G_ProfilePhase( GAMEPHASE_OTHER );
     G_CalculateStages( );
     G_CalculateStates( );
     G_SpawnClients( TEAM_ALIENS );
@@ -2547,5 +2575,10 @@ void G_RunFrame( int levelTime )
   for( i = 0; i < NUM_TEAMS; i++ )
     G_CheckVote( i );
 
+  G_ProfilePhase( GAMEPHASE_NONE );
+
+  // write queued admin changes once the frame's work is done
+  G_admin_flush( qfalse );
+
   level.frameMsec = trap_Milliseconds();
 }
@@ -98,29 +98,109 @@ typedef struct mapRotation_s
   char    name[ MAX_QPATH ];
 
   node_t  *nodes[ MAX_MAP_ROTATION_MAPS ];
+  int     code[ MAX_MAP_ROTATION_MAPS ];        // first instruction of each node
   int     numNodes;
   int     currentNode;
 } mapRotation_t;
 
+// the node trees are compiled into one flat array of instructions after
+// parsing, with conditions unrolled into tests and every goto, resume and
+// map existence check resolved up front
+typedef enum
+{
+  RI_RANDOM,      // test: passes half of the time
+  RI_NUMCLIENTS,  // test: client count compared to arg2 by conditionOp_t arg
+  RI_LASTWIN,     // test: team arg won the last game
+  RI_MAP,         // change to the map in node, arg is qtrue if it exists
+  RI_LABEL,
+  RI_ROTATION,    // start rotation arg, from its first node if arg2
+  RI_JUMP,        // continue the rotation at node arg
+  RI_UNRESOLVED,  // goto or resume naming nothing that exists
+  RI_RETURN
+} rotationOp_t;
+
+typedef struct rotationInstruction_s
+{
+  rotationOp_t  op;
+  int           arg;
+  int           arg2;
+  node_t        *node;                          // terminal node, for names
+} rotationInstruction_t;
+
 typedef struct mapRotations_s
 {
-  mapRotation_t   rotations[ MAX_MAP_ROTATIONS ];
-  int             numRotations;
+  mapRotation_t         rotations[ MAX_MAP_ROTATIONS ];
+  int                   numRotations;
+
+  rotationInstruction_t *code;
+  int                   numInstructions;
 } mapRotations_t;
 
 static mapRotations_t mapRotations;
 
-static int G_NodeIndexAfter( int currentNode, int rotation );
+#define MAX_ROTATION_STACK      64
+
+// everything a map change reads and writes, loaded from the rotation cvars
+// for a real change or made up by the simulator
+typedef struct rotationState_s
+{
+  int       rotation;
+  int       nodes[ MAX_MAP_ROTATIONS ];
+  int       stack[ MAX_ROTATION_STACK ];        // [ 0 ] is the top
+  int       stackDepth;
+
+  node_t    *map;                               // picked by the last advance
+
+  qboolean  dryRun;
+  int       numClients;
+  team_t    lastWin;
+  int       seed;
+  int       warnings;
+  int       errors;
+} rotationState_t;
+
+/*
+===============
+G_FileIndexed
+
+Look for name plus ext in a list filled by trap_FS_GetFileList
+===============
+*/
+static qboolean G_FileIndexed( const char *list, int count, const char *name, const char *ext )
+{
+  int len = strlen( name );
+  int i;
+
+  for( i = 0; i < count; i++ )
+  {
+    if( !Q_stricmpn( list, name, len ) && !Q_stricmp( list + len, ext ) )
+      return qtrue;
+
+    list += strlen( list ) + 1;
+  }
+
+  return qfalse;
+}
 
 /*
 ===============
 G_MapExists
 
-Check if a map exists
+Check if a map exists. The map directory is listed once and looked up
+after that, only names missing from the list go to the filesystem
 ===============
 */
 qboolean G_MapExists( const char *name )
 {
+  static char mapIndex[ 16384 ];
+  static int  mapIndexCount = -1;
+
+  if( mapIndexCount < 0 )
+    mapIndexCount = trap_FS_GetFileList( "maps", ".bsp", mapIndex, sizeof( mapIndex ) );
+
+  if( G_FileIndexed( mapIndex, mapIndexCount, name, ".bsp" ) )
+    return qtrue;
+
   return trap_FS_FOpenFile( va( "maps/%s.bsp", name ), NULL, FS_READ ) > 0;
 }
 
@@ -128,12 +208,30 @@ qboolean G_MapExists( const char *name )
 ===============
 G_LayoutExists
 
-Check if a layout exists for a map
+Check if a layout exists for a map, listing the layouts of the last map
+asked about the same way G_MapExists lists the maps
 ===============
 */
 qboolean G_LayoutExists( const char *map, const char *layout )
 {
-  return !Q_stricmp( layout, "*BUILTIN*" ) || trap_FS_FOpenFile( va( "layouts/%s/%s.dat", map, layout ), NULL, FS_READ ) > 0;
+  static char layoutIndexMap[ MAX_QPATH ];
+  static char layoutIndex[ 4096 ];
+  static int  layoutIndexCount = -1;
+
+  if( !Q_stricmp( layout, "*BUILTIN*" ) )
+    return qtrue;
+
+  if( layoutIndexCount < 0 || Q_stricmp( layoutIndexMap, map ) )
+  {
+    Q_strncpyz( layoutIndexMap, map, sizeof( layoutIndexMap ) );
+    layoutIndexCount = trap_FS_GetFileList( va( "layouts/%s", map ), ".dat",
+      layoutIndex, sizeof( layoutIndex ) );
+  }
+
+  if( G_FileIndexed( layoutIndex, layoutIndexCount, layout, ".dat" ) )
+    return qtrue;
+
+  return trap_FS_FOpenFile( va( "layouts/%s/%s.dat", map, layout ), NULL, FS_READ ) > 0;
 }
 
 /*
@@ -700,400 +798,493 @@ void G_PrintRotations( void )
     G_Printf( "}\n" );
   }
 
+  size += mapRotations.numInstructions * sizeof( rotationInstruction_t );
+
+  G_Printf( "Compiled to %d instructions\n", mapRotations.numInstructions );
   G_Printf( "Total memory used: %d bytes\n", size );
 }
 
 /*
 ===============
-G_ClearRotationStack
+G_CompileGoto
 
-Clear the rotation stack
+Resolve a goto or resume the way G_RunRotationNode would look it up:
+rotation names first, then labels in the rotation, then the next map
+of that name after the node
 ===============
 */
-void G_ClearRotationStack( void )
+static void G_CompileGoto( rotationInstruction_t *ri, int rotation, int nodeIndex, node_t *node )
 {
-  trap_Cvar_Set( "g_mapRotationStack", "" );
-  trap_Cvar_Update( &g_mapRotationStack );
-}
+  mapRotation_t *mr = &mapRotations.rotations[ rotation ];
+  char          *name = node->u.label.name;
+  int           i, n;
 
-/*
-===============
-G_PushRotationStack
+  ri->node = node;
 
-Push the rotation stack
-===============
-*/
-static void G_PushRotationStack( int rotation )
-{
-  char text[ MAX_CVAR_VALUE_STRING ];
+  for( i = 0; i < mapRotations.numRotations; i++ )
+  {
+    if( !Q_stricmp( mapRotations.rotations[ i ].name, name ) )
+    {
+      ri->op = RI_ROTATION;
+      ri->arg = i;
+      ri->arg2 = ( node->type == NT_GOTO );
+      return;
+    }
+  }
 
-  Com_sprintf( text, sizeof( text ), "%d %s",
-               rotation, g_mapRotationStack.string );
-  trap_Cvar_Set( "g_mapRotationStack", text );
-  trap_Cvar_Update( &g_mapRotationStack );
+  for( i = 0; i < mr->numNodes; i++ )
+  {
+    if( mr->nodes[ i ]->type == NT_LABEL &&
+        !Q_stricmp( mr->nodes[ i ]->u.label.name, name ) )
+    {
+      ri->op = RI_JUMP;
+      ri->arg = ( i + 1 ) % mr->numNodes;
+      return;
+    }
+  }
+
+  for( i = 1; i <= mr->numNodes; i++ )
+  {
+    n = ( nodeIndex + i ) % mr->numNodes;
+
+    if( mr->nodes[ n ]->type == NT_MAP &&
+        !Q_stricmp( mr->nodes[ n ]->u.map.name, name ) )
+    {
+      ri->op = RI_JUMP;
+      ri->arg = n;
+      return;
+    }
+  }
+
+  ri->op = RI_UNRESOLVED;
 }
 
 /*
 ===============
-G_PopRotationStack
+G_CompileMapRotations
 
-Pop the rotation stack
+Flatten the parsed node trees into mapRotations.code
 ===============
 */
-static int G_PopRotationStack( void )
+static void G_CompileMapRotations( void )
 {
-  int   value = -1;
-  char  text[ MAX_CVAR_VALUE_STRING ];
-  char  *text_p, *token;
+  rotationInstruction_t *ri;
+  mapRotation_t         *mr;
+  node_t                *node;
+  condition_t           *condition;
+  char                  *layouts, *token;
+  int                   i, j;
 
-  Q_strncpyz( text, g_mapRotationStack.string, sizeof( text ) );
+  mapRotations.numInstructions = 0;
 
-  text_p = text;
-  token = COM_Parse( &text_p );
+  for( i = 0; i < mapRotations.numRotations; i++ )
+  {
+    mr = &mapRotations.rotations[ i ];
 
-  if( *token )
-    value = atoi( token );
+    for( j = 0; j < mr->numNodes; j++ )
+    {
+      for( node = mr->nodes[ j ]; node->type == NT_CONDITION;
+           node = node->u.condition.target )
+        mapRotations.numInstructions++;
 
-  if( text_p )
-  {
-    while ( *text_p == ' ' )
-      text_p++;
-    trap_Cvar_Set( "g_mapRotationStack", text_p );
-    trap_Cvar_Update( &g_mapRotationStack );
+      mapRotations.numInstructions++;
+    }
   }
-  else
-    G_ClearRotationStack( );
 
-  return value;
+  if( !mapRotations.numInstructions )
+    return;
+
+  mapRotations.code = BG_Alloc( mapRotations.numInstructions *
+                                sizeof( rotationInstruction_t ) );
+  ri = mapRotations.code;
+
+  for( i = 0; i < mapRotations.numRotations; i++ )
+  {
+    mr = &mapRotations.rotations[ i ];
+
+    for( j = 0; j < mr->numNodes; j++ )
+    {
+      mr->code[ j ] = ri - mapRotations.code;
+
+      for( node = mr->nodes[ j ]; node->type == NT_CONDITION;
+           node = node->u.condition.target, ri++ )
+      {
+        condition = &node->u.condition;
+
+        switch( condition->lhs )
+        {
+          case CV_RANDOM:
+            ri->op = RI_RANDOM;
+            break;
+
+          case CV_NUMCLIENTS:
+            ri->op = RI_NUMCLIENTS;
+            ri->arg = condition->op;
+            ri->arg2 = condition->numClients;
+            break;
+
+          default:
+          case CV_LASTWIN:
+            ri->op = RI_LASTWIN;
+            ri->arg = condition->lastWin;
+            break;
+        }
+      }
+
+      ri->node = node;
+
+      switch( node->type )
+      {
+        case NT_MAP:
+          ri->op = RI_MAP;
+          ri->arg = G_MapExists( node->u.map.name );
+
+          // the layouts are picked when the map loads, only warn about them here
+          layouts = node->u.map.layouts;
+
+          while( ri->arg )
+          {
+            token = COM_ParseExt( &layouts, qfalse );
+
+            if( !*token )
+              break;
+
+            if( !strchr( token, '+' ) && !strchr( token, '|' ) &&
+                !G_LayoutExists( node->u.map.name, token ) )
+              G_Printf( S_COLOR_YELLOW "WARNING: layout \"%s\" for rotation map \"%s\" doesn't exist\n",
+                        token, node->u.map.name );
+          }
+          break;
+
+        case NT_GOTO:
+        case NT_RESUME:
+          G_CompileGoto( ri, i, j, node );
+          break;
+
+        case NT_RETURN:
+          ri->op = RI_RETURN;
+          break;
+
+        default:
+        case NT_LABEL:
+          ri->op = RI_LABEL;
+          break;
+      }
+
+      ri++;
+    }
+  }
 }
 
 /*
 ===============
-G_RotationNameByIndex
+G_ClearRotationStack
 
-Returns the name of a rotation by its index
+Clear the rotation stack
 ===============
 */
-static char *G_RotationNameByIndex( int index )
+void G_ClearRotationStack( void )
 {
-  if( index >= 0 && index < mapRotations.numRotations )
-    return mapRotations.rotations[ index ].name;
-  return NULL;
+  trap_Cvar_Set( "g_mapRotationStack", "" );
+  trap_Cvar_Update( &g_mapRotationStack );
 }
 
 /*
 ===============
-G_CurrentNodeIndexArray
+G_LoadRotationState
 
-Fill a static array with the current node of each rotation
+Read the current rotation, node of each rotation and rotation stack
+from their cvars
 ===============
 */
-static int *G_CurrentNodeIndexArray( void )
+static void G_LoadRotationState( rotationState_t *rs )
 {
-  static int  currentNode[ MAX_MAP_ROTATIONS ];
-  int         i = 0;
-  char        text[ MAX_MAP_ROTATIONS * 2 ];
-  char        *text_p, *token;
+  char  text[ MAX_CVAR_VALUE_STRING ];
+  char  *text_p, *token;
+  int   i;
 
-  Q_strncpyz( text, g_mapRotationNodes.string, sizeof( text ) );
+  memset( rs, 0, sizeof( *rs ) );
+  rs->rotation = g_currentMapRotation.integer;
 
+  Q_strncpyz( text, g_mapRotationNodes.string, sizeof( text ) );
   text_p = text;
 
-  while( 1 )
+  for( i = 0; i < MAX_MAP_ROTATIONS; i++ )
   {
     token = COM_Parse( &text_p );
 
     if( !*token )
       break;
 
-    currentNode[ i++ ] = atoi( token );
+    rs->nodes[ i ] = atoi( token );
   }
 
-  return currentNode;
+  Q_strncpyz( text, g_mapRotationStack.string, sizeof( text ) );
+  text_p = text;
+
+  while( rs->stackDepth < MAX_ROTATION_STACK )
+  {
+    token = COM_Parse( &text_p );
+
+    if( !*token )
+      break;
+
+    rs->stack[ rs->stackDepth++ ] = atoi( token );
+  }
 }
 
 /*
 ===============
-G_SetCurrentNodeByIndex
+G_SaveRotationState
 
-Set the current map in some rotation
+Write a rotation state back to the cvars
 ===============
 */
-static void G_SetCurrentNodeByIndex( int currentNode, int rotation )
+static void G_SaveRotationState( rotationState_t *rs )
 {
-  char  text[ MAX_MAP_ROTATIONS * 4 ] = { 0 };
-  int   *p = G_CurrentNodeIndexArray( );
+  char  text[ MAX_CVAR_VALUE_STRING ];
   int   i;
 
-  p[ rotation ] = currentNode;
+  trap_Cvar_Set( "g_currentMapRotation", va( "%d", rs->rotation ) );
+  trap_Cvar_Update( &g_currentMapRotation );
 
+  text[ 0 ] = '\0';
   for( i = 0; i < mapRotations.numRotations; i++ )
-    Q_strcat( text, sizeof( text ), va( "%d ", p[ i ] ) );
+    Q_strcat( text, sizeof( text ), va( "%d ", rs->nodes[ i ] ) );
 
   trap_Cvar_Set( "g_mapRotationNodes", text );
   trap_Cvar_Update( &g_mapRotationNodes );
+
+  text[ 0 ] = '\0';
+  for( i = 0; i < rs->stackDepth; i++ )
+    Q_strcat( text, sizeof( text ), va( i ? " %d" : "%d", rs->stack[ i ] ) );
+
+  trap_Cvar_Set( "g_mapRotationStack", text );
+  trap_Cvar_Update( &g_mapRotationStack );
 }
 
 /*
 ===============
-G_CurrentNodeIndex
+G_RotationMessage
 
-Return the current node index in some rotation
+Print a warning or error from running a rotation, a dry run only counts them
 ===============
 */
-static int G_CurrentNodeIndex( int rotation )
+static void QDECL G_RotationMessage( rotationState_t *rs, qboolean error, const char *fmt, ... )
 {
-  int   *p = G_CurrentNodeIndexArray( );
+  va_list argptr;
+  char    text[ 1024 ];
+
+  if( error )
+    rs->errors++;
+  else
+    rs->warnings++;
+
+  if( rs->dryRun )
+    return;
+
+  va_start( argptr, fmt );
+  Q_vsnprintf( text, sizeof( text ), fmt, argptr );
+  va_end( argptr );
 
-  return p[ rotation ];
+  G_Printf( "%s%s: %s\n", error ? S_COLOR_RED : S_COLOR_YELLOW,
+            error ? "ERROR" : "WARNING", text );
 }
 
 /*
 ===============
-G_NodeByIndex
+G_RotationNameByIndex
 
-Return a node in a rotation by its index
+Returns the name of a rotation by its index
 ===============
 */
-static node_t *G_NodeByIndex( int index, int rotation )
+static char *G_RotationNameByIndex( int index )
 {
-  if( rotation >= 0 && rotation < mapRotations.numRotations &&
-      index >= 0 && index < mapRotations.rotations[ rotation ].numNodes )
-    return mapRotations.rotations[ rotation ].nodes[ index ];
-
+  if( index >= 0 && index < mapRotations.numRotations )
+    return mapRotations.rotations[ index ].name;
   return NULL;
 }
 
 /*
 ===============
-G_IssueMapChange
-
-Send commands to the server to actually change the map
+G_NodeIndexAfter
 ===============
 */
-static void G_IssueMapChange( int index, int rotation )
+static int G_NodeIndexAfter( int currentNode, int rotation )
 {
-  node_t *node = mapRotations.rotations[ rotation ].nodes[ index ];
-  map_t  *map = &node->u.map;
-
-  // allow a manually defined g_nextLayout setting to override the maprotation
-  if( !g_nextLayout.string[ 0 ] && map->layouts[ 0 ] )
-  {
-    trap_Cvar_Set( "g_nextLayout", map->layouts );
-  }
-
-  G_MapConfigs( map->name );
-
-  trap_SendConsoleCommand( EXEC_APPEND, va( "map \"%s\"\n", map->name ) );
+  mapRotation_t *mr = &mapRotations.rotations[ rotation ];
 
-  if( strlen( map->postCommand ) > 0 )
-    trap_SendConsoleCommand( EXEC_APPEND, map->postCommand );
+  return ( currentNode + 1 ) % mr->numNodes;
 }
 
+static void G_AdvanceRotation( rotationState_t *rs, int depth );
+
 /*
 ===============
-G_GotoLabel
+G_StartRotation
 
-Resolve the label of some condition
+Switch a rotation state to rotation
 ===============
 */
-static qboolean G_GotoLabel( int rotation, int nodeIndex, char *name,
-                             qboolean reset_index, int depth )
+static void G_StartRotation( rotationState_t *rs, int rotation, qboolean advance,
+                             qboolean putOnStack, qboolean reset_index, int depth )
 {
-  node_t *node;
-  int    i;
-
-  // Search the rotation names...
-  if( G_StartMapRotation( name, qtrue, qtrue, reset_index, depth ) )
-    return qtrue;
-
-  // ...then try labels in the rotation
-  for( i = 0; i < mapRotations.rotations[ rotation ].numNodes; i++ )
+  if( putOnStack && rs->rotation >= 0 )
   {
-    node = mapRotations.rotations[ rotation ].nodes[ i ];
+    if( rs->stackDepth == MAX_ROTATION_STACK )
+      rs->stackDepth--;
 
-    if( node->type == NT_LABEL && !Q_stricmp( node->u.label.name, name ) )
-    {
-      G_SetCurrentNodeByIndex( G_NodeIndexAfter( i, rotation ), rotation );
-      G_AdvanceMapRotation( depth );
-      return qtrue;
-    }
+    memmove( rs->stack + 1, rs->stack, rs->stackDepth * sizeof( rs->stack[ 0 ] ) );
+    rs->stack[ 0 ] = rs->rotation;
+    rs->stackDepth++;
   }
 
-  // finally check for a map by name
-  for( i = 0; i < mapRotations.rotations[ rotation ].numNodes; i++ )
+  rs->rotation = rotation;
+
+  if( advance )
   {
-    nodeIndex = G_NodeIndexAfter( nodeIndex, rotation );
-    node = mapRotations.rotations[ rotation ].nodes[ nodeIndex ];
+    if( reset_index )
+      rs->nodes[ rotation ] = 0;
 
-    if( node->type == NT_MAP && !Q_stricmp( node->u.map.name, name ) )
-    {
-      G_SetCurrentNodeByIndex( nodeIndex, rotation );
-      G_AdvanceMapRotation( depth );
-      return qtrue;
-    }
+    G_AdvanceRotation( rs, depth );
   }
-
-  return qfalse;
 }
 
 /*
 ===============
-G_EvaluateMapCondition
+G_TestRotationCondition
 
-Evaluate a map condition
+Evaluate one compiled condition
 ===============
 */
-static qboolean G_EvaluateMapCondition( condition_t **condition )
+static qboolean G_TestRotationCondition( rotationState_t *rs, rotationInstruction_t *ri )
 {
-  qboolean    result = qfalse;
-  condition_t *localCondition = *condition;
-
-  switch( localCondition->lhs )
+  switch( ri->op )
   {
-    case CV_RANDOM:
-      result = rand( ) / ( RAND_MAX / 2 + 1 );
-      break;
+    case RI_RANDOM:
+      if( rs->dryRun )
+        return ( Q_rand( &rs->seed ) >> 16 ) & 1;
+      return rand( ) / ( RAND_MAX / 2 + 1 );
 
-    case CV_NUMCLIENTS:
-      switch( localCondition->op )
+    case RI_NUMCLIENTS:
+      switch( ri->arg )
       {
         case CO_LT:
-          result = level.numConnectedClients < localCondition->numClients;
-          break;
+          return rs->numClients < ri->arg2;
 
         case CO_GT:
-          result = level.numConnectedClients > localCondition->numClients;
-          break;
+          return rs->numClients > ri->arg2;
 
         case CO_EQ:
-          result = level.numConnectedClients == localCondition->numClients;
-          break;
+          return rs->numClients == ri->arg2;
       }
       break;
 
-    case CV_LASTWIN:
-      result = level.lastWin == localCondition->lastWin;
-      break;
+    case RI_LASTWIN:
+      return rs->lastWin == ri->arg;
 
     default:
-    case CV_ERR:
-      G_Printf( S_COLOR_RED "ERROR: malformed map switch localCondition\n" );
       break;
   }
 
-  if( localCondition->target->type == NT_CONDITION )
-  {
-    *condition = &localCondition->target->u.condition;
-
-    return result && G_EvaluateMapCondition( condition );
-  }
-
-  return result;
-}
-
-/*
-===============
-G_NodeIndexAfter
-===============
-*/
-static int G_NodeIndexAfter( int currentNode, int rotation )
-{
-  mapRotation_t *mr = &mapRotations.rotations[ rotation ];
-
-  return ( currentNode + 1 ) % mr->numNodes;
+  G_RotationMessage( rs, qtrue, "malformed map switch condition" );
+  return qfalse;
 }
 
 /*
 ===============
-G_StepMapRotation
+G_RunRotationNode
 
-Run one node of a map rotation
+Run one node of a map rotation, returns qtrue if the rotation should go
+on to the next node
 ===============
 */
-qboolean G_StepMapRotation( int rotation, int nodeIndex, int depth )
+static qboolean G_RunRotationNode( rotationState_t *rs, int nodeIndex, int depth )
 {
-  node_t        *node;
-  condition_t   *condition;
-  int           returnRotation;
-  qboolean      step = qtrue;
+  mapRotation_t         *mr = &mapRotations.rotations[ rs->rotation ];
+  rotationInstruction_t *ri = &mapRotations.code[ mr->code[ nodeIndex ] ];
+  int                   rotation = rs->rotation;
+  int                   returnRotation;
 
-  node = G_NodeByIndex( nodeIndex, rotation );
   depth++;
 
   // guard against inifinite loop in conditional code
-  if( depth > 32 && node->type != NT_MAP )
+  if( depth > 32 && ri->op != RI_MAP )
   {
     if( depth > 64 )
     {
-      G_Printf( S_COLOR_RED "ERROR: infinite loop protection stopped at map rotation %s\n",
-              G_RotationNameByIndex( rotation ) );
+      G_RotationMessage( rs, qtrue, "infinite loop protection stopped at map rotation %s",
+                         mr->name );
       return qfalse;
     }
 
-    G_Printf( S_COLOR_YELLOW "WARNING: possible infinite loop in map rotation %s\n",
-              G_RotationNameByIndex( rotation ) );
+    G_RotationMessage( rs, qfalse, "possible infinite loop in map rotation %s",
+                       mr->name );
     return qtrue;
   }
 
-  while( step )
+  // all the tests of a node have to pass to reach its terminal instruction
+  while( ri->op <= RI_LASTWIN )
   {
-    step = qfalse;
-    switch( node->type )
-    {
-      case NT_CONDITION:
-        condition = &node->u.condition;
+    if( !G_TestRotationCondition( rs, ri ) )
+      return qtrue;
 
-        if( G_EvaluateMapCondition( &condition ) )
-        {
-          node = condition->target;
-          step = qtrue;
-          continue;
-        }
-        break;
+    ri++;
+  }
 
-      case NT_RETURN:
-        returnRotation = G_PopRotationStack( );
-        if( returnRotation >= 0 )
-        {
-          G_SetCurrentNodeByIndex(
-            G_NodeIndexAfter( nodeIndex, rotation ), rotation );
-          if( G_StartMapRotation( G_RotationNameByIndex( returnRotation ),
-                                  qtrue, qfalse, qfalse, depth ) )
-          {
-            return qfalse;
-          }
-        }
-        break;
+  switch( ri->op )
+  {
+    case RI_RETURN:
+      returnRotation = -1;
+      if( rs->stackDepth > 0 )
+      {
+        returnRotation = rs->stack[ 0 ];
+        rs->stackDepth--;
+        memmove( rs->stack, rs->stack + 1, rs->stackDepth * sizeof( rs->stack[ 0 ] ) );
+      }
+
+      if( returnRotation >= 0 )
+      {
+        rs->nodes[ rotation ] = G_NodeIndexAfter( nodeIndex, rotation );
 
-      case NT_MAP:
-        if( G_MapExists( node->u.map.name ) )
+        if( returnRotation < mapRotations.numRotations )
         {
-          G_SetCurrentNodeByIndex(
-            G_NodeIndexAfter( nodeIndex, rotation ), rotation );
-          G_IssueMapChange( nodeIndex, rotation );
+          G_StartRotation( rs, returnRotation, qtrue, qfalse, qfalse, depth );
           return qfalse;
         }
+      }
+      break;
 
-        G_Printf( S_COLOR_YELLOW "WARNING: skipped missing map %s in rotation %s\n",
-                  node->u.map.name, G_RotationNameByIndex( rotation ) );
-        break;
+    case RI_MAP:
+      if( ri->arg )
+      {
+        rs->nodes[ rotation ] = G_NodeIndexAfter( nodeIndex, rotation );
+        rs->map = ri->node;
+        return qfalse;
+      }
 
-      case NT_LABEL:
-        break;
+      G_RotationMessage( rs, qfalse, "skipped missing map %s in rotation %s",
+                         ri->node->u.map.name, mr->name );
+      break;
 
-      case NT_GOTO:
-      case NT_RESUME:
-        G_SetCurrentNodeByIndex(
-          G_NodeIndexAfter( nodeIndex, rotation ), rotation );
-        if ( G_GotoLabel( rotation, nodeIndex, node->u.label.name,
-                          ( node->type == NT_GOTO ), depth ) )
-          return qfalse;
+    case RI_ROTATION:
+      rs->nodes[ rotation ] = G_NodeIndexAfter( nodeIndex, rotation );
+      G_StartRotation( rs, ri->arg, qtrue, qtrue, ri->arg2, depth );
+      return qfalse;
 
-        G_Printf( S_COLOR_YELLOW "WARNING: label, map, or rotation %s not found in %s\n",
-                  node->u.label.name, G_RotationNameByIndex( rotation ) );
-        break;
-    }
+    case RI_JUMP:
+      rs->nodes[ rotation ] = ri->arg;
+      G_AdvanceRotation( rs, depth );
+      return qfalse;
+
+    case RI_UNRESOLVED:
+      rs->nodes[ rotation ] = G_NodeIndexAfter( nodeIndex, rotation );
+      G_RotationMessage( rs, qfalse, "label, map, or rotation %s not found in %s",
+                         ri->node->u.label.name, mr->name );
+      break;
+
+    default:
+      break;
   }
 
   return qtrue;
@@ -1101,41 +1292,89 @@ qboolean G_StepMapRotation( int rotation, int nodeIndex, int depth )
 
 /*
 ===============
-G_AdvanceMapRotation
+G_AdvanceRotation
 
-Increment the current map rotation
+Run a rotation state until it picks a map or gives up
 ===============
 */
-void G_AdvanceMapRotation( int depth )
+static void G_AdvanceRotation( rotationState_t *rs, int depth )
 {
-  node_t *node;
-  int    rotation;
-  int    nodeIndex;
+  mapRotation_t *mr;
+  int           nodeIndex;
+
+  if( rs->rotation < 0 || rs->rotation >= MAX_MAP_ROTATIONS )
+    return;
 
-  rotation = g_currentMapRotation.integer;
-  if( rotation < 0 || rotation >= MAX_MAP_ROTATIONS )
+  if( rs->rotation >= mapRotations.numRotations ||
+      !mapRotations.rotations[ rs->rotation ].numNodes )
+  {
+    G_RotationMessage( rs, qtrue, "unexpected end of maprotation '%s'",
+                       G_RotationNameByIndex( rs->rotation ) );
     return;
+  }
 
-  nodeIndex = G_CurrentNodeIndex( rotation );
-  node = G_NodeByIndex( nodeIndex, rotation );
-  if( !node )
+  mr = &mapRotations.rotations[ rs->rotation ];
+  nodeIndex = rs->nodes[ rs->rotation ];
+
+  if( nodeIndex < 0 || nodeIndex >= mr->numNodes )
   {
-    G_Printf( S_COLOR_YELLOW "WARNING: index incorrect for map rotation %s, trying 0\n",
-              G_RotationNameByIndex( rotation) );
+    G_RotationMessage( rs, qfalse, "index incorrect for map rotation %s, trying 0",
+                       mr->name );
     nodeIndex = 0;
-    node = G_NodeByIndex( nodeIndex, rotation );
   }
 
-  while( node && G_StepMapRotation( rotation, nodeIndex, depth ) )
+  while( G_RunRotationNode( rs, nodeIndex, depth ) )
   {
-    nodeIndex = G_NodeIndexAfter( nodeIndex, rotation );
-    node = G_NodeByIndex( nodeIndex, rotation );
+    nodeIndex = G_NodeIndexAfter( nodeIndex, rs->rotation );
     depth++;
   }
+}
+
+/*
+===============
+G_IssueMapChange
+
+Send commands to the server to actually change the map
+===============
+*/
+static void G_IssueMapChange( node_t *node )
+{
+  map_t  *map = &node->u.map;
+
+  // allow a manually defined g_nextLayout setting to override the maprotation
+  if( !g_nextLayout.string[ 0 ] && map->layouts[ 0 ] )
+  {
+    trap_Cvar_Set( "g_nextLayout", map->layouts );
+  }
+
+  G_MapConfigs( map->name );
+
+  trap_SendConsoleCommand( EXEC_APPEND, va( "map \"%s\"\n", map->name ) );
+
+  if( strlen( map->postCommand ) > 0 )
+    trap_SendConsoleCommand( EXEC_APPEND, map->postCommand );
+}
+
+/*
+===============
+G_AdvanceMapRotation
+
+Increment the current map rotation
+===============
+*/
+void G_AdvanceMapRotation( int depth )
+{
+  rotationState_t rs;
+
+  G_LoadRotationState( &rs );
+  rs.numClients = level.numConnectedClients;
+  rs.lastWin = level.lastWin;
 
-  if( !node )
-    G_Printf( S_COLOR_RED "ERROR: unexpected end of maprotation '%s'\n",
-              G_RotationNameByIndex( rotation) );
+  G_AdvanceRotation( &rs, depth );
+  G_SaveRotationState( &rs );
+
+  if( rs.map )
+    G_IssueMapChange( rs.map );
 }
 
 /*
@@ -1148,35 +1387,131 @@ Switch to a new map rotation
 qboolean G_StartMapRotation( char *name, qboolean advance,
                              qboolean putOnStack, qboolean reset_index, int depth )
 {
-  int i;
-  int currentRotation = g_currentMapRotation.integer;
+  rotationState_t rs;
+  int             i;
 
   for( i = 0; i < mapRotations.numRotations; i++ )
   {
     if( !Q_stricmp( mapRotations.rotations[ i ].name, name ) )
-    {
-      if( putOnStack && currentRotation >= 0 )
-        G_PushRotationStack( currentRotation );
+      break;
+  }
 
-      trap_Cvar_Set( "g_currentMapRotation", va( "%d", i ) );
-      trap_Cvar_Update( &g_currentMapRotation );
+  if( i == mapRotations.numRotations )
+    return qfalse;
 
-      if( advance )
-      {
-        if( reset_index )
-          G_SetCurrentNodeByIndex( 0, i );
+  G_LoadRotationState( &rs );
+  rs.numClients = level.numConnectedClients;
+  rs.lastWin = level.lastWin;
 
-        G_AdvanceMapRotation( depth );
-      }
+  G_StartRotation( &rs, i, advance, putOnStack, reset_index, depth );
+  G_SaveRotationState( &rs );
 
+  if( rs.map )
+    G_IssueMapChange( rs.map );
+
+  return qtrue;
+}
+
+/*
+===============
+G_SimulateMapRotation
+
+Run a rotation from its first node for a number of map changes without
+touching the server, counting how often each map comes up. Unless
+numClients is given, the client count and last winner are picked at
+random for every change so the conditions get exercised
+===============
+*/
+void G_SimulateMapRotation( const char *name, int steps, int numClients )
+{
+  mapRotation_t         *mr;
+  rotationInstruction_t *ri;
+  rotationState_t       rs;
+  int                   *picks, *counts;
+  int                   numPicks = 0, stuck = 0;
+  int                   i, j, pick, start, msec;
+
+  for( i = 0; i < mapRotations.numRotations; i++ )
+  {
+    if( !Q_stricmp( mapRotations.rotations[ i ].name, name ) )
       break;
+  }
+
+  if( i == mapRotations.numRotations || !mapRotations.numInstructions )
+  {
+    G_Printf( "simulateMapRotation: invalid map rotation \"%s\"\n", name );
+    return;
+  }
+
+  // every map picked is a terminal instruction
+  picks = BG_Alloc( mapRotations.numInstructions * sizeof( picks[ 0 ] ) );
+  counts = BG_Alloc( mapRotations.numInstructions * sizeof( counts[ 0 ] ) );
+
+  memset( &rs, 0, sizeof( rs ) );
+  rs.dryRun = qtrue;
+  rs.rotation = i;
+  rs.seed = trap_Milliseconds( );
+
+  start = trap_Milliseconds( );
+
+  for( i = 0; i < steps; i++ )
+  {
+    if( numClients >= 0 )
+      rs.numClients = numClients;
+    else
+      rs.numClients = ( ( Q_rand( &rs.seed ) >> 8 ) & 0x7fff ) % ( level.maxclients + 1 );
+
+    rs.lastWin = ( ( Q_rand( &rs.seed ) >> 8 ) & 0x7fff ) % NUM_TEAMS;
+
+    rs.map = NULL;
+    G_AdvanceRotation( &rs, 0 );
+
+    if( !rs.map )
+    {
+      stuck++;
+      continue;
     }
+
+    // the rotation that picked the map has just stepped past it
+    mr = &mapRotations.rotations[ rs.rotation ];
+    pick = rs.rotation * MAX_MAP_ROTATION_MAPS +
+      ( rs.nodes[ rs.rotation ] + mr->numNodes - 1 ) % mr->numNodes;
+
+    for( j = 0; j < numPicks; j++ )
+    {
+      if( picks[ j ] == pick )
+        break;
+    }
+
+    if( j == numPicks )
+    {
+      picks[ numPicks ] = pick;
+      counts[ numPicks++ ] = 0;
+    }
+
+    counts[ j ]++;
   }
 
-  if( i == mapRotations.numRotations )
-    return qfalse;
-  else
-    return qtrue;
+  msec = trap_Milliseconds( ) - start;
+
+  G_Printf( "%d map changes of rotation %s in %d msec\n", steps, name, msec );
+
+  for( j = 0; j < numPicks; j++ )
+  {
+    mr = &mapRotations.rotations[ picks[ j ] / MAX_MAP_ROTATION_MAPS ];
+    pick = picks[ j ] % MAX_MAP_ROTATION_MAPS;
+
+    for( ri = &mapRotations.code[ mr->code[ pick ] ]; ri->op <= RI_LASTWIN; ri++ );
+
+    G_Printf( "  %6d  %s:%d  %s\n", counts[ j ], mr->name, pick,
+              ri->node->u.map.name );
+  }
+
+  G_Printf( "%d changes picked no map, %d warnings, %d errors\n",
+            stuck, rs.warnings, rs.errors );
+
+  BG_Free( counts );
+  BG_Free( picks );
 }
 
 /*
@@ -1220,6 +1555,8 @@ void G_InitMapRotations( void )
   {
     if( !G_ParseMapRotationFile( fileName ) )
       G_Printf( S_COLOR_RED "ERROR: failed to parse %s file\n", fileName );
+
+    G_CompileMapRotations( );
   }
   else
     G_Printf( "%s file not found.\n", fileName );
@@ -1273,4 +1610,7 @@ void G_ShutdownMapRotations( void )
       G_FreeNode( node );
     }
   }
+
+  if( mapRotations.code )
+    BG_Free( mapRotations.code );
 }
@@ -34,13 +34,35 @@ void G_namelog_cleanup( void )
   }
 }
 
+/*
+==================
+G_namelog_find
+
+The namelog with the given id, as shown by /namelog
+==================
+*/
+namelog_t *G_namelog_find( int id )
+{
+  namelog_t *n;
+
+  for( n = level.namelogIds[ id & ( NAMELOG_BUCKETS - 1 ) ]; n; n = n->idNext )
+  {
+    if( n->id == id )
+      return n;
+  }
+
+  return NULL;
+}
+
 void G_namelog_connect( gclient_t *client )
 {
-  namelog_t *n, *p = NULL;
+  namelog_t *n, **link;
   int       i;
   char      *newname;
 
-  for( n = level.namelogs; n; p = n, n = n->next )
+  // guid chains are kept in list order, so this is the first free match
+  link = &level.namelogGuids[ G_GuidHash( client->pers.guid, NAMELOG_BUCKETS ) ];
+  for( n = *link; n; link = &n->guidNext, n = n->guidNext )
   {
     if( n->slot != -1 )
       continue;
@@ -52,16 +74,21 @@ void G_namelog_connect( gclient_t *client )
     n = BG_Alloc( sizeof( namelog_t ) );
     strcpy( n->guid, client->pers.guid );
     n->guidless = client->pers.guidless;
-    if( p )
+    if( level.lastNamelog )
     {
-      p->next = n;
-      n->id = p->id + 1;
+      level.lastNamelog->next = n;
+      n->id = level.lastNamelog->id + 1;
     }
     else
     {
       level.namelogs = n;
       n->id = MAX_CLIENTS;
     }
+    level.lastNamelog = n;
+
+    *link = n;
+    n->idNext = level.namelogIds[ n->id & ( NAMELOG_BUCKETS - 1 ) ];
+    level.namelogIds[ n->id & ( NAMELOG_BUCKETS - 1 ) ] = n;
   }
   client->pers.namelog = n;
   n->slot = client - level.clients;
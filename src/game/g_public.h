@@ -229,9 +229,35 @@ typedef enum {
 
     G_ADDCOMMAND,
     G_REMOVECOMMAND,
-    G_FS_GETFILTEREDFILES
+    G_FS_GETFILTEREDFILES,
+
+    G_PROFILE_PHASE,  // ( int phase );
+    // charges the time since the previous call to the previous phase,
+    // GAMEPHASE_NONE closes the last one
+
+    G_ENTITIES_IN_RADIUS, // ( const vec3_t origin, float radius, int contentmask, int *list, int maxcount );
+    // the entities with bounds closer than radius to origin, nearest first,
+    // a contentmask of 0 accepts any contents
+
+    G_POINT_CLUSTER       // ( const vec3_t point, int *area );
+    // the PVS cluster containing point, area receives its portal area;
+    // two points with the same cluster and area see the same things
 } gameImport_t;
 
+//
+// sub-phases of GAME_RUN_FRAME reported through G_PROFILE_PHASE
+//
+typedef enum {
+    GAMEPHASE_NONE = -1,
+    GAMEPHASE_ENTITIES,  // movers, physics and think functions
+    GAMEPHASE_MISSILES,
+    GAMEPHASE_BUILDABLES,
+    GAMEPHASE_CLIENTS,
+    GAMEPHASE_BUILDPOINTS,  // G_CalculateBuildPoints
+    GAMEPHASE_OTHER,  // stages, spawning, votes and exit rules
+    GAMEPHASE_NUM_PHASES
+} gamePhase_t;
+
 //
 // functions exported by the game subsystem
 //
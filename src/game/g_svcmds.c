@@ -204,7 +204,10 @@ static void Svcmd_ForceTeam_f( void )
 ===================
 Svcmd_LayoutSave_f
 
-layoutsave <name>
+layoutsave <name> [text]
+
+Layouts are saved in the binary format unless text is asked for. Text
+layouts still load, so saving one again after it was loaded imports it
 ===================
 */
 static void Svcmd_LayoutSave_f( void )
@@ -214,10 +217,17 @@ static void Svcmd_LayoutSave_f( void )
   char *s;
   int i = 0;
   qboolean pipeEncountered = qfalse;
+  qboolean text = qfalse;
 
-  if( trap_Argc( ) != 2 )
+  if( trap_Argc( ) == 3 )
+  {
+    trap_Argv( 2, str, sizeof( str ) );
+    text = !Q_stricmp( str, "text" );
+  }
+  if( ( trap_Argc( ) != 2 && trap_Argc( ) != 3 ) ||
+      ( trap_Argc( ) == 3 && !text ) )
   {
-    G_Printf( "usage: layoutsave <name>\n" );
+    G_Printf( "usage: layoutsave <name> [text]\n" );
     return;
   }
   trap_Argv( 1, str, sizeof( str ) );
@@ -244,7 +254,7 @@ static void Svcmd_LayoutSave_f( void )
     return;
   }
 
-  G_LayoutSave( str2 );
+  G_LayoutSave( str2, text );
 }
 
 char  *ConcatArgs( int start );
@@ -555,6 +565,35 @@ static void Svcmd_G_AdvanceMapRotation_f( void )
   G_AdvanceMapRotation( 0 );
 }
 
+static void Svcmd_SimulateMapRotation_f( void )
+{
+  char rotationName[ MAX_QPATH ];
+  char arg[ 16 ];
+  int  steps = 1000, numClients = -1;
+
+  if( trap_Argc( ) < 2 )
+  {
+    G_Printf( "usage: simulateMapRotation <name> [changes] [numClients]\n" );
+    return;
+  }
+
+  trap_Argv( 1, rotationName, sizeof( rotationName ) );
+
+  if( trap_Argc( ) > 2 )
+  {
+    trap_Argv( 2, arg, sizeof( arg ) );
+    steps = atoi( arg );
+  }
+
+  if( trap_Argc( ) > 3 )
+  {
+    trap_Argv( 3, arg, sizeof( arg ) );
+    numClients = atoi( arg );
+  }
+
+  G_SimulateMapRotation( rotationName, steps, numClients );
+}
+
 struct svcmd
 {
   char     *cmd;
@@ -584,6 +623,7 @@ struct svcmd
   { "printqueue", qfalse, Svcmd_PrintQueue_f },
   { "say", qtrue, Svcmd_MessageWrapper },
   { "say_team", qtrue, Svcmd_TeamMessage_f },
+  { "simulateMapRotation", qfalse, Svcmd_SimulateMapRotation_f },
   { "status", qfalse, Svcmd_Status_f },
   { "stopMapRotation", qfalse, G_StopMapRotation },
   { "suddendeath", qfalse, Svcmd_SuddenDeath_f }
@@ -56,6 +56,10 @@ equ trap_AddCommand                   -50
 equ trap_RemoveCommand                -51
 equ trap_FS_GetFilteredFiles           -52
 
+equ trap_ProfilePhase                 -53
+equ trap_EntitiesInRadius             -54
+equ trap_PointCluster                 -55
+
 equ memset                            -101
 equ memcpy                            -102
 equ strncpy                           -103
@@ -297,3 +297,18 @@ int trap_FS_GetFilteredFiles( const char *path, const char *extension, const cha
 {
   return syscall( G_FS_GETFILTEREDFILES, path, extension, filter, listbuf, bufsize );
 }
+
+void trap_ProfilePhase( int phase )
+{
+  syscall( G_PROFILE_PHASE, phase );
+}
+
+int trap_EntitiesInRadius( const vec3_t origin, float radius, int contentmask, int *list, int maxcount )
+{
+  return syscall( G_ENTITIES_IN_RADIUS, origin, PASSFLOAT( radius ), contentmask, list, maxcount );
+}
+
+int trap_PointCluster( const vec3_t point, int *area )
+{
+  return syscall( G_POINT_CLUSTER, point, area );
+}
@@ -252,7 +252,10 @@ void target_relay_use( gentity_t *self, gentity_t *other, gentity_t *activator )
 
     ent = G_PickTarget( self->target );
     if( ent && ent->use )
+    {
+      G_WakeEntity( ent );
       ent->use( ent, self, activator );
+    }
 
     return;
   }
@@ -247,6 +247,59 @@ void G_ChangeTeam( gentity_t *ent, team_t newTeam )
   TeamplayInfoMessage( ent );
 }
 
+/*
+===========
+Team_LocationView
+
+Locations never move, so which of them a player can see depends only on
+the PVS cluster and portal area they stand in. Players sharing a view
+share one bit per location, filled in as the locations are tested and
+thrown away every frame since doors change the area connections
+============
+*/
+typedef struct
+{
+  int cluster;
+  int area;
+  int known[ MAX_LOCATIONS / 32 ];
+  int visible[ MAX_LOCATIONS / 32 ];
+} locationView_t;
+
+static locationView_t locationViews[ MAX_CLIENTS ];
+static int            numLocationViews;
+static int            locationViewTime;
+
+static locationView_t *Team_LocationView( const vec3_t origin )
+{
+  locationView_t  *view;
+  int             cluster, area;
+  int             i;
+
+  if( locationViewTime != level.time + 1 )
+  {
+    locationViewTime = level.time + 1;
+    numLocationViews = 0;
+  }
+
+  cluster = trap_PointCluster( origin, &area );
+
+  for( i = 0; i < numLocationViews; i++ )
+  {
+    view = &locationViews[ i ];
+    if( view->cluster == cluster && view->area == area )
+      return view;
+  }
+
+  if( numLocationViews == MAX_CLIENTS )
+    return NULL;
+
+  view = &locationViews[ numLocationViews++ ];
+  memset( view, 0, sizeof( *view ) );
+  view->cluster = cluster;
+  view->area = area;
+  return view;
+}
+
 /*
 ===========
 Team_GetLocation
@@ -256,11 +309,14 @@ Report a location for the player. Uses placed nearby target_location entities
 */
 gentity_t *Team_GetLocation( gentity_t *ent )
 {
-  gentity_t   *eloc, *best;
-  float       bestlen, len;
+  gentity_t       *eloc, *best;
+  float           bestlen, len;
+  locationView_t  *view;
+  int             n, bit;
 
   best = NULL;
   bestlen = 3.0f * 8192.0f * 8192.0f;
+  view = Team_LocationView( ent->r.currentOrigin );
 
   for( eloc = level.locationHead; eloc; eloc = eloc->nextTrain )
   {
@@ -269,7 +325,23 @@ gentity_t *Team_GetLocation( gentity_t *ent )
     if( len > bestlen )
       continue;
 
-    if( !trap_InPVS( ent->r.currentOrigin, eloc->r.currentOrigin ) )
+    n = eloc->s.generic1;
+
+    if( view && n >= 0 && n < MAX_LOCATIONS )
+    {
+      bit = 1 << ( n & 31 );
+
+      if( !( view->known[ n >> 5 ] & bit ) )
+      {
+        view->known[ n >> 5 ] |= bit;
+        if( trap_InPVS( ent->r.currentOrigin, eloc->r.currentOrigin ) )
+          view->visible[ n >> 5 ] |= bit;
+      }
+
+      if( !( view->visible[ n >> 5 ] & bit ) )
+        continue;
+    }
+    else if( !trap_InPVS( ent->r.currentOrigin, eloc->r.currentOrigin ) )
       continue;
 
     bestlen = len;
@@ -282,6 +354,66 @@ gentity_t *Team_GetLocation( gentity_t *ent )
 
 /*---------------------------------------------------------------------------*/
 
+/*
+==================
+G_TeamInfoEntry
+
+A player's part of the tinfo message, formatted once per CheckTeamStatus
+pass. Outside a pass a player can change between two messages in the same
+frame, so the entry is always rebuilt
+==================
+*/
+static const char *G_TeamInfoEntry( int clientNum )
+{
+  gclient_t *cl = level.clients + clientNum;
+  upgrade_t upgrade = UP_NONE;
+  int       curWeaponClass = WP_NONE; // sends weapon for humans, class for aliens
+
+  if( level.teamInfoPass && level.teamInfoEntryPass[ clientNum ] == level.teamInfoPass )
+    return level.teamInfoEntries[ clientNum ];
+
+  if( cl->sess.spectatorState != SPECTATOR_NOT )
+  {
+    curWeaponClass = WP_NONE;
+    upgrade = UP_NONE;
+  }
+  else if ( cl->pers.teamSelection == TEAM_HUMANS )
+  {
+    curWeaponClass = cl->ps.weapon;
+
+    if( BG_InventoryContainsUpgrade( UP_BATTLESUIT, cl->ps.stats ) )
+      upgrade = UP_BATTLESUIT;
+    else if( BG_InventoryContainsUpgrade( UP_JETPACK, cl->ps.stats ) )
+      upgrade = UP_JETPACK;
+    else if( BG_InventoryContainsUpgrade( UP_BATTPACK, cl->ps.stats ) )
+      upgrade = UP_BATTPACK;
+    else if( BG_InventoryContainsUpgrade( UP_HELMET, cl->ps.stats ) )
+      upgrade = UP_HELMET;
+    else if( BG_InventoryContainsUpgrade( UP_LIGHTARMOUR, cl->ps.stats ) )
+      upgrade = UP_LIGHTARMOUR;
+    else
+      upgrade = UP_NONE;
+  }
+  else if( cl->pers.teamSelection == TEAM_ALIENS )
+  {
+    curWeaponClass = cl->ps.stats[ STAT_CLASS ];
+    upgrade = UP_NONE;
+  }
+
+  // aliens don't have upgrades
+  Com_sprintf( level.teamInfoEntries[ clientNum ],
+    sizeof( level.teamInfoEntries[ clientNum ] ),
+    cl->pers.teamSelection == TEAM_ALIENS ? " %i %i %i %i" : " %i %i %i %i %i",
+    clientNum,
+    cl->pers.location,
+    cl->ps.stats[ STAT_HEALTH ] < 1 ? 0 : cl->ps.stats[ STAT_HEALTH ],
+    curWeaponClass,
+    upgrade );
+
+  level.teamInfoEntryPass[ clientNum ] = level.teamInfoPass;
+  return level.teamInfoEntries[ clientNum ];
+}
+
 /*
 ==================
 TeamplayInfoMessage
@@ -289,19 +421,21 @@ TeamplayInfoMessage
 Format:
   clientNum location health weapon upgrade
 
+During a CheckTeamStatus pass, recipients outside the team they are shown
+(spectators following it) all get the same message when their last update
+was at the same time, so it is built once and reused
 ==================
 */
 void TeamplayInfoMessage( gentity_t *ent )
 {
-  char      entry[ 17 ],
-            string[ ( MAX_CLIENTS - 1 ) * ( sizeof( entry ) - 1 ) + 1 ];
+  char      string[ sizeof( level.teamInfoShared ) ];
   int       i, j;
-  int       team, stringlength;
+  int       stringlength;
+  team_t    team;
+  qboolean  shared;
   gentity_t *player;
   gclient_t *cl;
-  upgrade_t upgrade = UP_NONE;
-  int       curWeaponClass = WP_NONE ; // sends weapon for humans, class for aliens
-  char      *format;
+  const char *entry;
 
   if( !g_allowTeamOverlay.integer )
      return;
@@ -320,69 +454,50 @@ void TeamplayInfoMessage( gentity_t *ent )
   else
     team = ent->client->pers.teamSelection;
 
-  if( team == TEAM_ALIENS )
-    format = " %i %i %i %i"; // aliens don't have upgrades
-  else
-    format = " %i %i %i %i %i";
+  shared = ( level.teamInfoPass && ent->client->pers.teamSelection != team );
 
-  string[ 0 ] = '\0';
-  stringlength = 0;
-
-  for( i = 0; i < level.maxclients; i++)
+  if( shared && level.teamInfoSharedPass == level.teamInfoPass &&
+      level.teamInfoSharedTeam == team &&
+      level.teamInfoSharedSince == ent->client->pers.teamInfo )
+  {
+    Q_strncpyz( string, level.teamInfoShared, sizeof( string ) );
+  }
+  else
   {
-    player = g_entities + i ;
-    cl = player->client;
+    string[ 0 ] = '\0';
+    stringlength = 0;
 
-    if( ent == player || !cl || team != cl->pers.teamSelection ||
-        !player->inuse )
-      continue;
+    for( i = 0; i < level.maxclients; i++)
+    {
+      player = g_entities + i ;
+      cl = player->client;
 
-    // only update if changed since last time
-    if( cl->pers.infoChangeTime <= ent->client->pers.teamInfo )
-      continue;
+      if( ent == player || !cl || team != cl->pers.teamSelection ||
+          !player->inuse )
+        continue;
 
-    if( cl->sess.spectatorState != SPECTATOR_NOT )
-    {
-      curWeaponClass = WP_NONE;
-      upgrade = UP_NONE;
-    }
-    else if ( cl->pers.teamSelection == TEAM_HUMANS )
-    {
-      curWeaponClass = cl->ps.weapon;
-
-      if( BG_InventoryContainsUpgrade( UP_BATTLESUIT, cl->ps.stats ) )
-        upgrade = UP_BATTLESUIT;
-      else if( BG_InventoryContainsUpgrade( UP_JETPACK, cl->ps.stats ) )
-        upgrade = UP_JETPACK;
-      else if( BG_InventoryContainsUpgrade( UP_BATTPACK, cl->ps.stats ) )
-        upgrade = UP_BATTPACK;
-      else if( BG_InventoryContainsUpgrade( UP_HELMET, cl->ps.stats ) )
-        upgrade = UP_HELMET;
-      else if( BG_InventoryContainsUpgrade( UP_LIGHTARMOUR, cl->ps.stats ) )
-        upgrade = UP_LIGHTARMOUR;
-      else
-        upgrade = UP_NONE;
-    }
-    else if( cl->pers.teamSelection == TEAM_ALIENS )
-    {
-      curWeaponClass = cl->ps.stats[ STAT_CLASS ];
-      upgrade = UP_NONE;
-    }
+      // only update if changed since last time
+      if( cl->pers.infoChangeTime <= ent->client->pers.teamInfo )
+        continue;
 
-    Com_sprintf( entry, sizeof( entry ), format, i,
-      cl->pers.location,
-      cl->ps.stats[ STAT_HEALTH ] < 1 ? 0 : cl->ps.stats[ STAT_HEALTH ],
-      curWeaponClass,
-      upgrade );
+      entry = G_TeamInfoEntry( i );
+      j = strlen( entry );
 
-    j = strlen( entry );
+      // this should not happen if entry and string sizes are correct
+      if( stringlength + j >= sizeof( string ) )
+        break;
 
-    // this should not happen if entry and string sizes are correct
-    if( stringlength + j >= sizeof( string ) )
-      break;
+      strcpy( string + stringlength, entry );
+      stringlength += j;
+    }
 
-    strcpy( string + stringlength, entry );
-    stringlength += j;
+    if( shared )
+    {
+      Q_strncpyz( level.teamInfoShared, string, sizeof( level.teamInfoShared ) );
+      level.teamInfoSharedTeam = team;
+      level.teamInfoSharedSince = ent->client->pers.teamInfo;
+      level.teamInfoSharedPass = level.teamInfoPass;
+    }
   }
 
   if( string[ 0 ] )
@@ -429,6 +544,9 @@ void CheckTeamStatus( void )
       }
     }
 
+    // nothing changes while the messages go out, so entries can be shared
+    level.teamInfoPass = level.time;
+
     for( i = 0; i < g_maxclients.integer; i++ )
     {
       ent = g_entities + i;
@@ -438,6 +556,8 @@ void CheckTeamStatus( void )
       if( ent->inuse )
         TeamplayInfoMessage( ent );
     }
+
+    level.teamInfoPass = 0;
   }
 
   // Warn on imbalanced teams
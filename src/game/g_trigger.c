@@ -511,7 +511,10 @@ void G_Checktrigger_stages( team_t team, stage_t stage )
     if( !Q_stricmp( ent->classname, "trigger_stage" ) )
     {
       if( team == ent->stageTeam && stage == ent->stageStage )
+      {
+        G_WakeEntity( ent );
         ent->use( ent, ent, ent );
+      }
     }
   }
 }
@@ -260,7 +260,10 @@ void G_UseTargets( gentity_t *ent, gentity_t *activator )
     else
     {
       if( t->use )
+      {
+        G_WakeEntity( t );
         t->use( t, ent, activator );
+      }
     }
 
     if( !ent->inuse )
@@ -376,12 +379,212 @@ float vectoyaw( const vec3_t vec )
 }
 
 
+/*
+==============================================================================
+
+ENTITY SCHEDULER
+
+G_RunFrame only walks the entities marked awake in level.awakeEntities.
+An entity with nothing to do every frame is put to sleep after it has been
+walked, queued on the time its think or event expiry is due if it has one.
+Anything that can give a sleeping entity something to do sooner (spawning,
+events, use, touch, pain and die) must wake it with G_WakeEntity.
+
+==============================================================================
+*/
+
+#define ENTITY_BIT( n ) ( 1 << ( ( n ) & 31 ) )
+
+/*
+=================
+G_WakeQueueSet
+=================
+*/
+static void G_WakeQueueSet( int slot, int num )
+{
+  level.wakeQueue[ slot ] = num;
+  g_entities[ num ].wakeSlot = slot + 1;
+}
+
+/*
+=================
+G_WakeQueueUp
+=================
+*/
+static void G_WakeQueueUp( int slot )
+{
+  int num = level.wakeQueue[ slot ];
+  int wakeTime = g_entities[ num ].wakeTime;
+
+  while( slot > 0 )
+  {
+    int parent = ( slot - 1 ) / 2;
+
+    if( g_entities[ level.wakeQueue[ parent ] ].wakeTime <= wakeTime )
+      break;
+
+    G_WakeQueueSet( slot, level.wakeQueue[ parent ] );
+    slot = parent;
+  }
+
+  G_WakeQueueSet( slot, num );
+}
+
+/*
+=================
+G_WakeQueueDown
+=================
+*/
+static void G_WakeQueueDown( int slot )
+{
+  int num = level.wakeQueue[ slot ];
+  int wakeTime = g_entities[ num ].wakeTime;
+
+  for( ;; )
+  {
+    int child = slot * 2 + 1;
+
+    if( child >= level.numWakeQueue )
+      break;
+
+    if( child + 1 < level.numWakeQueue &&
+        g_entities[ level.wakeQueue[ child + 1 ] ].wakeTime <
+        g_entities[ level.wakeQueue[ child ] ].wakeTime )
+      child++;
+
+    if( wakeTime <= g_entities[ level.wakeQueue[ child ] ].wakeTime )
+      break;
+
+    G_WakeQueueSet( slot, level.wakeQueue[ child ] );
+    slot = child;
+  }
+
+  G_WakeQueueSet( slot, num );
+}
+
+/*
+=================
+G_WakeQueueRemove
+=================
+*/
+static void G_WakeQueueRemove( gentity_t *ent )
+{
+  int slot = ent->wakeSlot - 1;
+
+  if( slot < 0 )
+    return;
+
+  ent->wakeSlot = 0;
+
+  if( --level.numWakeQueue == slot )
+    return;
+
+  // fill the hole with the last entry and let it find its place
+  G_WakeQueueSet( slot, level.wakeQueue[ level.numWakeQueue ] );
+  G_WakeQueueUp( slot );
+  G_WakeQueueDown( g_entities[ level.wakeQueue[ slot ] ].wakeSlot - 1 );
+}
+
+/*
+=================
+G_WakeEntity
+
+Makes G_RunFrame walk ent again, from this frame if it hasn't got to it yet
+=================
+*/
+void G_WakeEntity( gentity_t *ent )
+{
+  int num = ent - g_entities;
+
+  G_WakeQueueRemove( ent );
+  level.awakeEntities[ num >> 5 ] |= ENTITY_BIT( num );
+}
+
+/*
+=================
+G_SleepEntity
+
+Stops G_RunFrame walking ent until its think or event expiry is due,
+or until something wakes it
+=================
+*/
+void G_SleepEntity( gentity_t *ent )
+{
+  int num = ent - g_entities;
+  int wakeTime = 0;
+
+  level.awakeEntities[ num >> 5 ] &= ~ENTITY_BIT( num );
+  G_WakeQueueRemove( ent );
+
+  if( ent->nextthink > 0 )
+    wakeTime = ent->nextthink;
+
+  if( ent->s.event || ent->freeAfterEvent || ent->unlinkAfterEvent )
+  {
+    int expireTime = ent->eventTime + EVENT_VALID_MSEC + 1;
+
+    if( !wakeTime || expireTime < wakeTime )
+      wakeTime = expireTime;
+  }
+
+  if( !wakeTime )
+    return;
+
+  ent->wakeTime = wakeTime;
+  level.wakeQueue[ level.numWakeQueue ] = num;
+  G_WakeQueueUp( level.numWakeQueue++ );
+}
+
+/*
+=================
+G_WakeDueEntities
+
+Wakes the sleeping entities whose time has come, before G_RunFrame walks
+=================
+*/
+void G_WakeDueEntities( void )
+{
+  while( level.numWakeQueue > 0 &&
+         g_entities[ level.wakeQueue[ 0 ] ].wakeTime <= level.time )
+    G_WakeEntity( &g_entities[ level.wakeQueue[ 0 ] ] );
+}
+
+/*
+=================
+G_EntityNeedsFrame
+
+Entities that G_RunFrame does more for than running their think
+=================
+*/
+qboolean G_EntityNeedsFrame( gentity_t *ent )
+{
+  if( ent - g_entities < MAX_CLIENTS )
+    return qtrue;
+
+  if( ent->physicsObject || ent->evaluateAcceleration )
+    return qtrue;
+
+  switch( ent->s.eType )
+  {
+    case ET_MISSILE:
+    case ET_WEAPON_DROP:
+    case ET_BUILDABLE:
+    case ET_CORPSE:
+    case ET_MOVER:
+      return qtrue;
+
+    default:
+      return qfalse;
+  }
+}
+
 void G_InitGentity( gentity_t *e )
 {
   e->inuse = qtrue;
   e->classname = "noclass";
   e->s.number = e - g_entities;
   e->r.ownerNum = ENTITYNUM_NONE;
+  G_WakeEntity( e );
 }
 
 /*
@@ -490,6 +693,14 @@ void G_FreeEntity( gentity_t *ent )
   if( ent->neverFree )
     return;
 
+  // take it out of the buildable registry and the power graph
+  G_UnregisterBuildable( ent );
+  G_ClearPowerLoad( ent );
+
+  // and out of the scheduler
+  level.awakeEntities[ ( ent - g_entities ) >> 5 ] &= ~ENTITY_BIT( ent - g_entities );
+  G_WakeQueueRemove( ent );
+
   memset( ent, 0, sizeof( *ent ) );
   ent->classname = "freent";
   ent->freetime = level.time;
@@ -811,6 +1022,7 @@ void G_AddEvent( gentity_t *ent, int event, int eventParm )
   }
 
   ent->eventTime = level.time;
+  G_WakeEntity( ent );
 }
 
 
@@ -1185,3 +1397,21 @@ qboolean G_AddressCompare( const addr_t *a, const addr_t *b )
   }
   return qtrue;
 }
+
+/*
+===============
+G_GuidHash
+
+Bucket for a guid in a table of buckets (a power of two) entries,
+case insensitive like the Q_stricmp the lookups confirm with
+===============
+*/
+int G_GuidHash( const char *guid, int buckets )
+{
+  unsigned hash = 0;
+
+  for( ; *guid; guid++ )
+    hash = hash * 31 + tolower( *guid );
+
+  return hash & ( buckets - 1 );
+}
@@ -135,10 +135,10 @@ static void G_WideTrace( trace_t *tr, gentity_t *ent, float range,
   if( !ent->client )
     return;
 
-  G_UnlaggedOn( ent, muzzle, range + width );
-
   VectorMA( muzzle, range, forward, end );
 
+  G_UnlaggedOnTrace( ent, muzzle, end, VectorLength( maxs ) );
+
   // Trace against entities
   trap_Trace( tr, muzzle, mins, maxs, end, ent->s.number, CONTENTS_BODY );
   if( tr->entityNum != ENTITYNUM_NONE )
@@ -317,7 +317,7 @@ void bulletFire( gentity_t *ent, float spread, int damage, int mod )
   // don't use unlagged if this is not a client (e.g. turret)
   if( ent->client )
   {
-    G_UnlaggedOn( ent, muzzle, 8192 * 16 );
+    G_UnlaggedOnTrace( ent, muzzle, end, 0.0f );
     trap_Trace( &tr, muzzle, NULL, NULL, end, ent->s.number, MASK_SHOT );
     G_UnlaggedOff( );
   }
@@ -432,7 +432,7 @@ void massDriverFire( gentity_t *ent )
 
   VectorMA( muzzle, 8192.0f * 16.0f, forward, end );
 
-  G_UnlaggedOn( ent, muzzle, 8192.0f * 16.0f );
+  G_UnlaggedOnTrace( ent, muzzle, end, 0.0f );
   trap_Trace( &tr, muzzle, NULL, NULL, end, ent->s.number, MASK_SHOT );
   G_UnlaggedOff( );
 
@@ -579,7 +579,7 @@ void lasGunFire( gentity_t *ent )
 
   VectorMA( muzzle, 8192 * 16, forward, end );
 
-  G_UnlaggedOn( ent, muzzle, 8192 * 16 );
+  G_UnlaggedOnTrace( ent, muzzle, end, 0.0f );
   trap_Trace( &tr, muzzle, NULL, NULL, end, ent->s.number, MASK_SHOT );
   G_UnlaggedOff( );
 
@@ -0,0 +1,833 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// lg_client.cpp -- one synthetic client: handshake, gamestate, usercmds
+
+#include "lg_local.h"
+
+/*
+The synthetic clients speak protocol 71 only and mirror what
+CL_CheckForResend, CL_ConnectionlessPacket, CL_ParseServerMessage and
+CL_WritePacket do on a real client.  Snapshots are acknowledged but not
+decoded; keeping PACKET_BACKUP frames of entities for hundreds of clients
+would cost more than the server being measured.
+*/
+
+static void LG_WritePacket(lgClient_t *cl, int now);
+
+/*
+==================
+LG_AddReliableCommand
+==================
+*/
+static void LG_AddReliableCommand(lgClient_t *cl, const char *cmd)
+{
+    if (cl->reliableSequence - cl->reliableAcknowledge >= MAX_RELIABLE_COMMANDS - 1)
+    {
+        Com_Printf("client %d: reliable command overflow, dropping \"%s\"\n", cl->num, cmd);
+        return;
+    }
+
+    cl->reliableSequence++;
+    Q_strncpyz(cl->reliableCommands[cl->reliableSequence & (MAX_RELIABLE_COMMANDS - 1)], cmd,
+        sizeof(cl->reliableCommands[0]));
+}
+
+/*
+==================
+LG_InitClient
+==================
+*/
+void LG_InitClient(lgClient_t *cl, int num, int startTime)
+{
+    ::memset(cl, 0, sizeof(*cl));
+
+    cl->num = num;
+    cl->sock = -1;
+    cl->state = LG_IDLE;
+    cl->startTime = startTime;
+    cl->seed = lg_options.seed + num * 7919;
+    cl->qport = (lg_options.seed + num) & 0xffff;
+    cl->clientChallenge = (Q_rand(&cl->seed) & 0x7fffffff) | 1;
+    cl->script = lg_scriptLength ? (num * 97) % lg_scriptLength : 0;
+}
+
+/*
+==================
+LG_ResetStats
+==================
+*/
+void LG_ResetStats(lgClient_t *cl)
+{
+    cl->bytesIn = cl->bytesOut = 0;
+    cl->packetsIn = cl->packetsOut = 0;
+    cl->snapshots = cl->snapshotsDropped = 0;
+}
+
+/*
+==================
+LG_DisconnectClient
+==================
+*/
+void LG_DisconnectClient(lgClient_t *cl)
+{
+    int i;
+
+    if (cl->state >= LG_CONNECTED && cl->state != LG_DROPPED)
+    {
+        // same as CL_Disconnect, send it a few times in case one is dropped
+        LG_AddReliableCommand(cl, "disconnect");
+        for (i = 0; i < 3; i++)
+        {
+            LG_WritePacket(cl, cl->lastPacketSentTime);
+        }
+    }
+
+    cl->state = LG_DROPPED;
+    LG_CloseSocket(cl->sock);
+    cl->sock = -1;
+}
+
+/*
+==================
+LG_SystemInfoChanged
+
+Pull the serverId out of CS_SYSTEMINFO like CL_SystemInfoChanged
+==================
+*/
+static void LG_SystemInfoChanged(lgClient_t *cl, const char *systemInfo)
+{
+    cl->serverId = atoi(Info_ValueForKey(systemInfo, "sv_serverid"));
+
+    if (atoi(Info_ValueForKey(systemInfo, "sv_pure")) && !cl->pure)
+    {
+        cl->pure = true;
+        Com_Printf("client %d: server is pure, synthetic clients cannot validate paks; "
+                   "run the server with sv_pure 0\n", cl->num);
+    }
+}
+
+/*
+==================
+LG_ServerCommand
+
+Executes the few server commands that matter for staying connected,
+everything else is only kept for the usercmd key
+==================
+*/
+static void LG_ServerCommand(lgClient_t *cl, const char *s)
+{
+    char *bigConfigString = cl->bigConfigString;
+    const char *value;
+    int index;
+
+    if (!Q_strncmp(s, "disconnect", 10))
+    {
+        Com_Printf("client %d: server disconnected: %s\n", cl->num, s + 10);
+        cl->state = LG_DROPPED;
+        return;
+    }
+
+    if (!Q_strncmp(s, "csm ", 4))
+    {
+        // a batch of "cs", only the systeminfo matters
+        const char *p = s + 4;
+
+        while (1)
+        {
+            char *token = COM_Parse((char **)&p);
+            if (!token[0])
+            {
+                break;
+            }
+
+            index = atoi(token);
+            token = COM_Parse((char **)&p);
+            if (index == CS_SYSTEMINFO)
+            {
+                LG_SystemInfoChanged(cl, token);
+            }
+        }
+        return;
+    }
+
+    if (Q_strncmp(s, "cs ", 3) && Q_strncmp(s, "bcs", 3))
+    {
+        return;
+    }
+
+    index = atoi(strchr(s, ' ') + 1);
+    if (index != CS_SYSTEMINFO)
+    {
+        return;
+    }
+
+    value = strchr(s, '"');
+    if (!value)
+    {
+        return;
+    }
+    value++;
+
+    if (!Q_strncmp(s, "bcs0", 4))
+    {
+        Q_strncpyz(bigConfigString, value, sizeof(cl->bigConfigString));
+    }
+    else if (!Q_strncmp(s, "bcs1", 4) || !Q_strncmp(s, "bcs2", 4))
+    {
+        Q_strcat(bigConfigString, sizeof(cl->bigConfigString), value);
+    }
+    else
+    {
+        Q_strncpyz(bigConfigString, value, sizeof(cl->bigConfigString));
+    }
+
+    // strip the closing quote
+    if (strrchr(bigConfigString, '"'))
+    {
+        *strrchr(bigConfigString, '"') = '\0';
+    }
+
+    if (!Q_strncmp(s, "bcs0", 4) || !Q_strncmp(s, "bcs1", 4))
+    {
+        return;
+    }
+
+    LG_SystemInfoChanged(cl, bigConfigString);
+}
+
+/*
+==================
+LG_ParseZConfigstrings
+
+Same as CL_ParseZConfigstrings, but only the systeminfo is kept
+==================
+*/
+static void LG_ParseZConfigstrings(lgClient_t *cl, msg_t *msg)
+{
+    static byte deflated[MAX_MSGLEN];
+    static byte raw[MAX_MSGLEN + 1];
+    uint32_t rawLength, length;
+    int pos;
+
+    rawLength = MSG_ReadLong(msg);
+    length = MSG_ReadLong(msg);
+    if (!rawLength || rawLength > MAX_MSGLEN || !length || length > sizeof(deflated))
+    {
+        Com_Error(ERR_DROP, "LG_ParseZConfigstrings: bad size");
+    }
+    MSG_ReadData(msg, deflated, length);
+
+    if (puff(raw, &rawLength, deflated, &length))
+    {
+        Com_Error(ERR_DROP, "LG_ParseZConfigstrings: corrupt configstrings");
+    }
+    raw[rawLength] = '\0';
+
+    for (pos = 0; pos + 2 < (int)rawLength; pos += strlen((char *)raw + pos) + 1)
+    {
+        int i = raw[pos] | (raw[pos + 1] << 8);
+
+        pos += 2;
+        if (i == CS_SYSTEMINFO)
+        {
+            LG_SystemInfoChanged(cl, (char *)raw + pos);
+        }
+    }
+}
+
+/*
+==================
+LG_ParseGamestate
+==================
+*/
+static void LG_ParseGamestate(lgClient_t *cl, msg_t *msg, int now)
+{
+    entityState_t nullstate, baseline;
+    int cmd, i;
+
+    cl->serverCommandSequence = MSG_ReadLong(msg);
+    cl->netFields = false;
+
+    while (1)
+    {
+        cmd = MSG_ReadByte(msg);
+
+        if (cmd == svc_EOF)
+        {
+            break;
+        }
+
+        if (cmd == svc_configstring)
+        {
+            const char *s;
+
+            i = MSG_ReadShort(msg);
+            if (i < 0 || i >= MAX_CONFIGSTRINGS)
+            {
+                Com_Error(ERR_DROP, "configstring > MAX_CONFIGSTRINGS");
+            }
+            s = MSG_ReadBigString(msg);
+            if (i == CS_SYSTEMINFO)
+            {
+                LG_SystemInfoChanged(cl, s);
+            }
+        }
+        else if (cmd == svc_zconfigstrings)
+        {
+            LG_ParseZConfigstrings(cl, msg);
+        }
+        else if (cmd == svc_netfields)
+        {
+            if (MSG_ReadLong(msg) != MSG_NetFieldsChecksum())
+            {
+                Com_Error(ERR_DROP, "LG_ParseGamestate: the server has different profiled field tables");
+            }
+            cl->netFields = true;
+        }
+        else if (cmd == svc_baseline)
+        {
+            i = MSG_ReadBits(msg, GENTITYNUM_BITS);
+            if (i < 0 || i >= MAX_GENTITIES)
+            {
+                Com_Error(ERR_DROP, "Baseline number out of range: %i", i);
+            }
+            ::memset(&nullstate, 0, sizeof(nullstate));
+            MSG_ReadDeltaEntity(
+                cl->netFields ? MSG_PROFILED_FIELDS : cl->netchan.alternateProtocol, msg, &nullstate, &baseline, i);
+        }
+        else
+        {
+            Com_Error(ERR_DROP, "LG_ParseGamestate: bad command byte");
+        }
+    }
+
+    cl->clientNum = MSG_ReadLong(msg);
+    cl->checksumFeed = MSG_ReadLong(msg);
+
+    if (cl->state == LG_CONNECTED)
+    {
+        cl->gamestateTime = now - cl->connectTime;
+        if (lg_options.verbose)
+        {
+            Com_Printf("client %d: gamestate as client %d after %d msec\n", cl->num, cl->clientNum,
+                cl->gamestateTime);
+        }
+    }
+
+    // a new gamestate (map change or restart) waits for the first
+    // snapshot again, exactly like a real client reloading the cgame
+    cl->state = LG_PRIMED;
+    cl->snapServerTime = 0;
+    cl->execSent = false;
+}
+
+/*
+==================
+LG_ParseSnapshot
+
+Only the header is read; whatever follows is delta compressed
+against frames this client does not keep
+==================
+*/
+static void LG_ParseSnapshot(lgClient_t *cl, msg_t *msg, int now)
+{
+    int serverTime = MSG_ReadLong(msg);
+
+    if (cl->state == LG_PRIMED)
+    {
+        cl->state = LG_ACTIVE;
+        cl->activeTime = now;
+    }
+
+    if (lg_measuring)
+    {
+        cl->snapshots++;
+        if (cl->lastSnapRealTime && lg_numSnapIntervals < LG_MAX_SAMPLES)
+        {
+            lg_snapIntervals[lg_numSnapIntervals++] = now - cl->lastSnapRealTime;
+        }
+    }
+
+    cl->lastSnapRealTime = now;
+    cl->snapServerTime = serverTime;
+    cl->snapRealTime = now;
+}
+
+/*
+==================
+LG_ParseServerMessage
+==================
+*/
+static void LG_ParseServerMessage(lgClient_t *cl, msg_t *msg, int now)
+{
+    int cmd;
+
+    MSG_Bitstream(msg);
+
+    cl->reliableAcknowledge = MSG_ReadLong(msg);
+    if (cl->reliableAcknowledge < cl->reliableSequence - MAX_RELIABLE_COMMANDS)
+    {
+        cl->reliableAcknowledge = cl->reliableSequence;
+    }
+
+    while (cl->state != LG_DROPPED)
+    {
+        if (msg->readcount > msg->cursize)
+        {
+            Com_Error(ERR_DROP, "LG_ParseServerMessage: read past end of server message");
+        }
+
+        cmd = MSG_ReadByte(msg);
+
+        if (cmd == svc_EOF)
+        {
+            break;
+        }
+
+        switch (cmd)
+        {
+            case svc_nop:
+                break;
+
+            case svc_serverCommand:
+            {
+                int seq = MSG_ReadLong(msg);
+                const char *s = MSG_ReadString(msg);
+
+                if (cl->serverCommandSequence >= seq)
+                {
+                    break;
+                }
+                cl->serverCommandSequence = seq;
+                Q_strncpyz(cl->serverCommands[seq & (MAX_RELIABLE_COMMANDS - 1)], s,
+                    sizeof(cl->serverCommands[0]));
+                LG_ServerCommand(cl, s);
+                break;
+            }
+
+            case svc_gamestate:
+                LG_ParseGamestate(cl, msg, now);
+                break;
+
+            case svc_snapshot:
+                // the rest of the message is the undecoded snapshot
+                LG_ParseSnapshot(cl, msg, now);
+                return;
+
+            default:
+                // downloads and voip are not simulated
+                return;
+        }
+    }
+}
+
+/*
+==================
+LG_ConnectionlessPacket
+==================
+*/
+static void LG_ConnectionlessPacket(lgClient_t *cl, msg_t *msg, int now)
+{
+    char *s, *token;
+
+    MSG_BeginReadingOOB(msg);
+    MSG_ReadLong(msg);  // skip the -1
+
+    s = MSG_ReadStringLine(msg);
+    token = COM_Parse(&s);
+
+    if (!Q_stricmp(token, "challengeResponse"))
+    {
+        int challenge;
+
+        if (cl->state != LG_CONNECTING)
+        {
+            return;
+        }
+
+        challenge = atoi(COM_Parse(&s));
+        if (atoi(COM_Parse(&s)) != cl->clientChallenge)
+        {
+            return;
+        }
+
+        cl->challenge = challenge;
+        cl->state = LG_CHALLENGING;
+        cl->connectTime = -99999;
+        return;
+    }
+
+    if (!Q_stricmp(token, "connectResponse"))
+    {
+        if (cl->state != LG_CHALLENGING || atoi(COM_Parse(&s)) != cl->challenge)
+        {
+            return;
+        }
+
+        Netchan_Setup(0, NS_CLIENT, &cl->netchan, lg_serverAddress, cl->qport, cl->challenge);
+        cl->state = LG_CONNECTED;
+        cl->lastPacketSentTime = -9999;
+        cl->connectTime = now;
+        return;
+    }
+
+    if (!Q_stricmp(token, "print") && cl->state == LG_CHALLENGING)
+    {
+        // connection refused, the reason follows on the next line
+        Com_Printf("client %d: %s", cl->num, MSG_ReadString(msg));
+        cl->state = LG_DROPPED;
+        return;
+    }
+}
+
+/*
+==================
+LG_ClientPacket
+==================
+*/
+void LG_ClientPacket(lgClient_t *cl, msg_t *msg, netadr_t from, int now)
+{
+    if (from.port != lg_serverAddress.port || ::memcmp(from.ip, lg_serverAddress.ip, sizeof(from.ip)))
+    {
+        return;
+    }
+
+    if (lg_measuring)
+    {
+        cl->bytesIn += msg->cursize;
+        cl->packetsIn++;
+    }
+
+    if (msg->cursize >= 4 && *(int *)msg->data == -1)
+    {
+        LG_ConnectionlessPacket(cl, msg, now);
+        return;
+    }
+
+    if (cl->state < LG_CONNECTED || cl->state == LG_DROPPED)
+    {
+        return;
+    }
+
+    if (msg->cursize < 4)
+    {
+        return;
+    }
+
+    if (!Netchan_Process(&cl->netchan, msg))
+    {
+        return;  // out of order, duplicated, or a fragment
+    }
+
+    if (lg_measuring && cl->netchan.dropped > 0)
+    {
+        cl->snapshotsDropped += cl->netchan.dropped;
+    }
+
+    cl->serverMessageSequence = LittleLong(*(int *)msg->data);
+
+    LG_ParseServerMessage(cl, msg, now);
+}
+
+/*
+==================
+LG_CommandMsec
+
+Interval until the next usercmd is due
+==================
+*/
+static int LG_CommandMsec(const lgClient_t *cl)
+{
+    if (lg_scriptLength)
+    {
+        return lg_script[cl->script].msec;
+    }
+
+    return lg_options.cmdMsec;
+}
+
+/*
+==================
+LG_NextCommand
+
+Fills the next usercmd from the recorded stream, or from a seeded
+random walk that strafes, turns, jumps and fires
+==================
+*/
+static void LG_NextCommand(lgClient_t *cl, usercmd_t *cmd, int msec)
+{
+    if (lg_scriptLength)
+    {
+        *cmd = lg_script[cl->script].cmd;
+        cl->script = (cl->script + 1) % lg_scriptLength;
+        return;
+    }
+
+    *cmd = cl->cmds[cl->cmdNumber & LG_CMD_MASK];
+
+    cl->scriptTime += msec;
+    if (cl->scriptTime >= 1500)
+    {
+        // pick a new heading and strafe direction every 1.5 seconds
+        cl->scriptTime = 0;
+        cl->script = Q_rand(&cl->seed) & 0x7fffffff;
+        cmd->rightmove = (signed char)((cl->script % 3 - 1) * 127);
+        cmd->buttons = (cl->script & 8) ? BUTTON_ATTACK : 0;
+    }
+
+    cmd->angles[YAW] += ANGLE2SHORT(((cl->script >> 4) % 61 - 30) * msec / 100.0f);
+    cmd->angles[PITCH] = 0;
+    cmd->forwardmove = 127;
+    cmd->upmove = ((Q_rand(&cl->seed) & 0x7fffffff) % 40) ? 0 : 127;
+}
+
+/*
+==================
+LG_CreateCommands
+==================
+*/
+static void LG_CreateCommands(lgClient_t *cl, int now)
+{
+    usercmd_t cmd;
+    int msec;
+
+    while (now - cl->lastCmdTime >= (msec = LG_CommandMsec(cl)))
+    {
+        LG_NextCommand(cl, &cmd, msec);
+
+        cl->lastCmdTime += msec;
+        if (now - cl->lastCmdTime > 1000)
+        {
+            // fell far behind (hitch or just went active), don't burst
+            cl->lastCmdTime = now;
+        }
+
+        if (cl->snapServerTime)
+        {
+            cmd.serverTime = cl->snapServerTime + (cl->lastCmdTime - cl->snapRealTime);
+        }
+        else
+        {
+            cmd.serverTime = 0;
+        }
+
+        cl->cmdNumber++;
+        cl->cmds[cl->cmdNumber & LG_CMD_MASK] = cmd;
+    }
+}
+
+/*
+==================
+LG_WritePacket
+==================
+*/
+static void LG_WritePacket(lgClient_t *cl, int now)
+{
+    msg_t buf;
+    byte data[MAX_MSGLEN];
+    usercmd_t nullcmd, *cmd, *oldcmd;
+    int i, count, key;
+
+    ::memset(&nullcmd, 0, sizeof(nullcmd));
+    oldcmd = &nullcmd;
+
+    MSG_Init(&buf, data, sizeof(data));
+    MSG_Bitstream(&buf);
+
+    MSG_WriteLong(&buf, cl->serverId);
+    MSG_WriteLong(&buf, cl->serverMessageSequence);
+    MSG_WriteLong(&buf, cl->serverCommandSequence);
+
+    for (i = cl->reliableAcknowledge + 1; i <= cl->reliableSequence; i++)
+    {
+        MSG_WriteByte(&buf, clc_clientCommand);
+        MSG_WriteLong(&buf, i);
+        MSG_WriteString(&buf, cl->reliableCommands[i & (MAX_RELIABLE_COMMANDS - 1)]);
+    }
+
+    // like cl_packetdup 1, repeat the commands of the previous packet
+    count = cl->state >= LG_PRIMED ? cl->cmdNumber - cl->packetCmdNumber[0] : 0;
+    if (count > MAX_PACKET_USERCMDS)
+    {
+        count = MAX_PACKET_USERCMDS;
+    }
+
+    if (count >= 1)
+    {
+        if (cl->state == LG_ACTIVE && cl->snapRealTime)
+        {
+            MSG_WriteByte(&buf, clc_move);
+        }
+        else
+        {
+            MSG_WriteByte(&buf, clc_moveNoDelta);
+        }
+
+        MSG_WriteByte(&buf, count);
+
+        key = cl->checksumFeed;
+        key ^= cl->serverMessageSequence;
+        key ^= MSG_HashKey(0, cl->serverCommands[cl->serverCommandSequence & (MAX_RELIABLE_COMMANDS - 1)], 32);
+
+        for (i = 0; i < count; i++)
+        {
+            cmd = &cl->cmds[(cl->cmdNumber - count + i + 1) & LG_CMD_MASK];
+            MSG_WriteDeltaUsercmdKey(&buf, key, oldcmd, cmd);
+            oldcmd = cmd;
+        }
+    }
+
+    cl->packetCmdNumber[0] = cl->packetCmdNumber[1];
+    cl->packetCmdNumber[1] = cl->cmdNumber;
+
+    MSG_WriteByte(&buf, clc_EOF);
+
+    LG_SetSocket(cl->sock, cl->qport);
+    Netchan_Transmit(&cl->netchan, buf.cursize, buf.data);
+    while (cl->netchan.unsentFragments)
+    {
+        Netchan_TransmitNextFragment(&cl->netchan);
+    }
+
+    cl->lastPacketSentTime = now;
+
+    if (lg_measuring)
+    {
+        cl->bytesOut += buf.cursize;
+        cl->packetsOut++;
+    }
+}
+
+/*
+==================
+LG_ClientFrame
+==================
+*/
+void LG_ClientFrame(lgClient_t *cl, int now)
+{
+    int i;
+
+    switch (cl->state)
+    {
+        case LG_IDLE:
+            if (now < cl->startTime)
+            {
+                return;
+            }
+            cl->sock = LG_OpenSocket();
+            if (cl->sock < 0)
+            {
+                cl->state = LG_DROPPED;
+                return;
+            }
+            cl->state = LG_CONNECTING;
+            cl->connectTime = -99999;
+            // fall through
+
+        case LG_CONNECTING:
+            if (now - cl->connectTime < LG_RETRANSMIT)
+            {
+                return;
+            }
+            cl->connectTime = now;
+            LG_SetSocket(cl->sock, cl->qport);
+            NET_OutOfBandPrint(NS_CLIENT, lg_serverAddress, "getchallenge %d %s", cl->clientChallenge,
+                GAMENAME_FOR_MASTER);
+            return;
+
+        case LG_CHALLENGING:
+        {
+            char info[MAX_INFO_STRING];
+            char guid[33];
+            char data[MAX_INFO_STRING + 16];
+            int seed = cl->num + 1;
+
+            if (now - cl->connectTime < LG_RETRANSMIT)
+            {
+                return;
+            }
+            cl->connectTime = now;
+
+            for (i = 0; i < (int)sizeof(guid) - 1; i++)
+            {
+                guid[i] = "0123456789ABCDEF"[Q_rand(&seed) & 15];
+            }
+            guid[sizeof(guid) - 1] = '\0';
+
+            info[0] = '\0';
+            Info_SetValueForKey(info, "name", va("%s%03d", lg_options.name, cl->num));
+            Info_SetValueForKey(info, "rate", va("%d", lg_options.rate));
+            Info_SetValueForKey(info, "snaps", va("%d", lg_options.snaps));
+            Info_SetValueForKey(info, "cl_guid", guid);
+            Info_SetValueForKey(info, "cl_csm", "1");
+            Info_SetValueForKey(info, "cl_zgamestate", "1");
+            if (lg_options.netFields)
+            {
+                Info_SetValueForKey(info, "cl_netFields", va("%08x", MSG_NetFieldsChecksum()));
+            }
+            if (lg_options.password[0])
+            {
+                Info_SetValueForKey(info, "password", lg_options.password);
+            }
+            Info_SetValueForKey(info, "protocol", va("%i", PROTOCOL_VERSION));
+            Info_SetValueForKey(info, "qport", va("%i", cl->qport));
+            Info_SetValueForKey(info, "challenge", va("%i", cl->challenge));
+
+            Com_sprintf(data, sizeof(data), "connect \"%s\"", info);
+            LG_SetSocket(cl->sock, cl->qport);
+            NET_OutOfBandData(NS_CLIENT, lg_serverAddress, (byte *)data, strlen(data));
+            return;
+        }
+
+        case LG_CONNECTED:
+            // nothing to say until the gamestate arrives, just keep the channel open
+            if (now - cl->lastPacketSentTime >= 1000)
+            {
+                LG_WritePacket(cl, now);
+            }
+            return;
+
+        case LG_PRIMED:
+        case LG_ACTIVE:
+            if (cl->state == LG_ACTIVE && !cl->execSent)
+            {
+                for (i = 0; i < lg_options.numExec; i++)
+                {
+                    LG_AddReliableCommand(cl, lg_options.exec[i]);
+                }
+                cl->execSent = true;
+            }
+
+            LG_CreateCommands(cl, now);
+
+            if (now - cl->lastPacketSentTime >= 1000 / lg_options.maxPackets)
+            {
+                LG_WritePacket(cl, now);
+            }
+            return;
+
+        case LG_DROPPED:
+            return;
+    }
+}
@@ -0,0 +1,453 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// lg_common.cpp -- the parts of common, cvar and net_ip that msg.cpp and
+// net_chan.cpp need, plus one UDP socket per synthetic client
+
+#include "lg_local.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <setjmp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+cvar_t *cl_shownet;
+cvar_t *cl_packetdelay;
+cvar_t *sv_packetdelay;
+cvar_t *com_timescale;
+cvar_t *com_replay;  // never set, net_chan.cpp only checks it
+
+jmp_buf lg_abortClient;
+bool lg_abortSet;
+
+static int lg_socket = -1;  // socket Sys_SendPacket writes to
+
+/*
+==============================================================
+
+COMMON
+
+==============================================================
+*/
+
+void QDECL Com_Printf(const char *fmt, ...)
+{
+    va_list argptr;
+
+    va_start(argptr, fmt);
+    vfprintf(stderr, fmt, argptr);
+    va_end(argptr);
+}
+
+void QDECL Com_DPrintf(const char *fmt, ...)
+{
+    va_list argptr;
+
+    if (!lg_options.verbose)
+    {
+        return;
+    }
+
+    va_start(argptr, fmt);
+    vfprintf(stderr, fmt, argptr);
+    va_end(argptr);
+}
+
+/*
+=============
+Com_Error
+
+A drop only takes down the client whose packet was being parsed
+=============
+*/
+void QDECL Com_Error(int code, const char *fmt, ...)
+{
+    va_list argptr;
+    char msg[MAXPRINTMSG];
+
+    va_start(argptr, fmt);
+    Q_vsnprintf(msg, sizeof(msg), fmt, argptr);
+    va_end(argptr);
+
+    fprintf(stderr, "ERROR: %s\n", msg);
+
+    if (code != ERR_FATAL && lg_abortSet)
+    {
+        longjmp(lg_abortClient, 1);
+    }
+
+    exit(1);
+}
+
+#ifdef ZONE_DEBUG
+void *S_MallocDebug(int size, const char *label, const char *file, int line) { return calloc(1, size); }
+#else
+void *S_Malloc(int size) { return calloc(1, size); }
+#endif
+
+void Z_Free(void *ptr) { free(ptr); }
+
+void Com_ReplayOutboundPacket(int length, const void *data, netadr_t to) {}
+int Com_NetMilliseconds(void) { return Sys_Milliseconds(); }
+
+/*
+==============================================================
+
+CVAR
+
+Only the handful of cvars read by msg.cpp and net_chan.cpp exist,
+they are created once and never changed by name
+
+==============================================================
+*/
+
+#define LG_MAX_CVARS 16
+
+static cvar_t lg_cvars[LG_MAX_CVARS];
+static int lg_numCvars;
+
+cvar_t *Cvar_Get(const char *var_name, const char *var_value, int flags)
+{
+    cvar_t *var;
+    int i;
+
+    for (i = 0; i < lg_numCvars; i++)
+    {
+        if (!strcmp(lg_cvars[i].name, var_name))
+        {
+            return &lg_cvars[i];
+        }
+    }
+
+    if (lg_numCvars == LG_MAX_CVARS)
+    {
+        Com_Error(ERR_FATAL, "Cvar_Get: too many cvars");
+    }
+
+    var = &lg_cvars[lg_numCvars++];
+    var->name = strdup(var_name);
+    var->string = strdup(var_value);
+    var->resetString = var->string;
+    var->flags = flags;
+    var->value = atof(var_value);
+    var->integer = atoi(var_value);
+    return var;
+}
+
+/*
+==============================================================
+
+SYSTEM
+
+==============================================================
+*/
+
+int Sys_Milliseconds(void)
+{
+    static time_t timeBase;
+    struct timeval tp;
+
+    gettimeofday(&tp, NULL);
+
+    if (!timeBase)
+    {
+        timeBase = tp.tv_sec;
+    }
+
+    return (tp.tv_sec - timeBase) * 1000 + tp.tv_usec / 1000;
+}
+
+/*
+==============================================================
+
+NET
+
+==============================================================
+*/
+
+bool Sys_StringToAdr(const char *s, netadr_t *a, netadrtype_t family)
+{
+    struct addrinfo hints, *res;
+
+    ::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(s, NULL, &hints, &res) || !res)
+    {
+        return false;
+    }
+
+    ::memset(a, 0, sizeof(*a));
+    a->type = NA_IP;
+    ::memcpy(a->ip, &((struct sockaddr_in *)res->ai_addr)->sin_addr, sizeof(a->ip));
+    freeaddrinfo(res);
+    return true;
+}
+
+const char *NET_AdrToString(netadr_t a)
+{
+    static char s[NET_ADDRSTRMAXLEN];
+
+    if (a.type == NA_IP)
+    {
+        Com_sprintf(s, sizeof(s), "%i.%i.%i.%i", a.ip[0], a.ip[1], a.ip[2], a.ip[3]);
+    }
+    else
+    {
+        Com_sprintf(s, sizeof(s), "unknown");
+    }
+
+    return s;
+}
+
+void Sys_SendPacket(int length, const void *data, netadr_t to)
+{
+    struct sockaddr_in addr;
+
+    if (lg_socket < 0 || to.type != NA_IP)
+    {
+        return;
+    }
+
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = to.port;
+    ::memcpy(&addr.sin_addr, to.ip, sizeof(to.ip));
+
+    if (sendto(lg_socket, data, length, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EAGAIN)
+    {
+        Com_DPrintf("Sys_SendPacket: %s\n", strerror(errno));
+    }
+}
+
+/*
+==================
+LG_OpenSocket
+
+Every synthetic client gets its own ephemeral port, so the server sees
+distinct addresses exactly as it would for separate machines behind NAT
+==================
+*/
+int LG_OpenSocket(void)
+{
+    struct sockaddr_in addr;
+    int sock, size = 256 * 1024;
+
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        Com_Printf("LG_OpenSocket: socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = 0;
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        Com_Printf("LG_OpenSocket: bind: %s\n", strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    return sock;
+}
+
+void LG_CloseSocket(int sock)
+{
+    if (sock >= 0)
+    {
+        close(sock);
+    }
+}
+
+/*
+==================
+LG_SetSocket
+
+net_chan.cpp writes the global net_qport into every client packet and
+hands the datagram to Sys_SendPacket without a socket, so both are
+switched to the client about to transmit
+==================
+*/
+extern cvar_t *qport;
+
+void LG_SetSocket(int sock, int port)
+{
+    lg_socket = sock;
+    qport->integer = port;
+}
+
+bool LG_GetPacket(int sock, netadr_t *from, msg_t *msg)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int ret;
+
+    ret = recvfrom(sock, msg->data, msg->maxsize, 0, (struct sockaddr *)&addr, &len);
+    if (ret <= 0)
+    {
+        return false;
+    }
+
+    ::memset(from, 0, sizeof(*from));
+    from->type = NA_IP;
+    from->port = addr.sin_port;
+    ::memcpy(from->ip, &addr.sin_addr, sizeof(from->ip));
+
+    if (ret >= msg->maxsize)
+    {
+        Com_Printf("Oversize packet from %s\n", NET_AdrToString(*from));
+        return false;
+    }
+
+    msg->cursize = ret;
+    msg->readcount = 0;
+    msg->bit = 0;
+    return true;
+}
+
+/*
+==================
+LG_WaitForPackets
+
+Sleeps until any client socket is readable or msec passes
+==================
+*/
+void LG_WaitForPackets(int msec)
+{
+    static struct pollfd fds[LG_MAX_CLIENTS];
+    int i, numFds = 0;
+
+    for (i = 0; i < lg_options.numClients; i++)
+    {
+        if (lg_clients[i].sock >= 0)
+        {
+            fds[numFds].fd = lg_clients[i].sock;
+            fds[numFds].events = POLLIN;
+            fds[numFds].revents = 0;
+            numFds++;
+        }
+    }
+
+    poll(fds, numFds, msec);
+}
+
+/*
+==================
+LG_LoadScript
+
+Recorded usercmd streams are text, one command per line:
+msec forwardmove rightmove upmove buttons weapon pitch yaw roll
+with the angles in degrees; '#' starts a comment
+==================
+*/
+bool LG_LoadScript(const char *path)
+{
+    FILE *f;
+    char line[MAX_STRING_CHARS];
+    int size = 0;
+
+    f = fopen(path, "r");
+    if (!f)
+    {
+        Com_Printf("Couldn't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        lgCmd_t *rec;
+        int forward, right, up, buttons, weapon;
+        float angles[3];
+
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        if (lg_scriptLength == size)
+        {
+            size = size ? size * 2 : 1024;
+            lg_script = (lgCmd_t *)realloc(lg_script, size * sizeof(lgCmd_t));
+        }
+
+        rec = &lg_script[lg_scriptLength];
+        ::memset(rec, 0, sizeof(*rec));
+
+        if (sscanf(line, "%d %d %d %d %d %d %f %f %f", &rec->msec, &forward, &right, &up, &buttons, &weapon,
+                &angles[PITCH], &angles[YAW], &angles[ROLL]) != 9)
+        {
+            Com_Printf("%s: skipping malformed line \"%s\"\n", path, line);
+            continue;
+        }
+
+        rec->msec = MAX(rec->msec, 1);
+        rec->cmd.forwardmove = (signed char)Com_Clamp(-127, 127, forward);
+        rec->cmd.rightmove = (signed char)Com_Clamp(-127, 127, right);
+        rec->cmd.upmove = (signed char)Com_Clamp(-127, 127, up);
+        rec->cmd.buttons = buttons;
+        rec->cmd.weapon = weapon;
+        rec->cmd.angles[PITCH] = ANGLE2SHORT(angles[PITCH]);
+        rec->cmd.angles[YAW] = ANGLE2SHORT(angles[YAW]);
+        rec->cmd.angles[ROLL] = ANGLE2SHORT(angles[ROLL]);
+        lg_scriptLength++;
+    }
+
+    fclose(f);
+
+    if (!lg_scriptLength)
+    {
+        Com_Printf("%s: no usercmds\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+==================
+LG_InitCommon
+==================
+*/
+void LG_InitCommon(void)
+{
+    cl_shownet = Cvar_Get("cl_shownet", "0", CVAR_TEMP);
+    cl_packetdelay = Cvar_Get("cl_packetdelay", "0", CVAR_CHEAT);
+    sv_packetdelay = Cvar_Get("sv_packetdelay", "0", CVAR_CHEAT);
+    com_timescale = Cvar_Get("timescale", "1", CVAR_CHEAT);
+
+    Netchan_Init(0);
+}
@@ -0,0 +1,170 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// lg_local.h -- headless synthetic client load generator
+
+#ifndef LG_LOCAL_H
+#define LG_LOCAL_H 1
+
+#include "qcommon/cvar.h"
+#include "qcommon/huffman.h"
+#include "qcommon/msg.h"
+#include "qcommon/net.h"
+#include "qcommon/puff.h"
+#include "qcommon/q_shared.h"
+#include "qcommon/qcommon.h"
+#include "sys/sys_shared.h"
+
+#define LG_MAX_CLIENTS      1024
+#define LG_MAX_EXEC         16
+#define LG_MAX_SAMPLES      65536  // snapshot interval samples kept for percentiles
+#define LG_CMD_BACKUP       64     // usercmds kept for packet duplication
+#define LG_CMD_MASK         (LG_CMD_BACKUP - 1)
+#define LG_RETRANSMIT       3000   // same as the client RETRANSMIT_TIMEOUT
+
+enum lgState_t {
+    LG_IDLE,         // waiting for its slot in the connect ramp
+    LG_CONNECTING,   // sending getchallenge
+    LG_CHALLENGING,  // sending connect
+    LG_CONNECTED,    // netchan is up, waiting for the gamestate
+    LG_PRIMED,       // gamestate parsed, sending usercmds until snapshots arrive
+    LG_ACTIVE,       // receiving snapshots
+    LG_DROPPED       // server sent a disconnect or refused the connection
+};
+
+// one recorded usercmd, time is relative to the previous entry
+struct lgCmd_t {
+    int msec;
+    usercmd_t cmd;
+};
+
+struct lgClient_t {
+    int num;
+    int sock;
+    lgState_t state;
+    int qport;
+    int clientChallenge;
+    int challenge;
+
+    int startTime;  // when the connect ramp releases this client
+    int connectTime;  // last getchallenge / connect transmission
+    int activeTime;  // first snapshot
+    int lastPacketSentTime;
+    int lastCmdTime;
+
+    netchan_t netchan;
+
+    // gamestate
+    int serverId;
+    int checksumFeed;
+    int clientNum;
+    bool pure;
+    bool netFields;  // svc_netfields, the baselines use the profiled field tables
+
+    // reliable commands in both directions, needed for the usercmd key
+    char serverCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+    int serverCommandSequence;
+    char bigConfigString[BIG_INFO_STRING];  // bcs0..bcs2 reassembly
+    char reliableCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+    int reliableSequence;
+    int reliableAcknowledge;
+    int serverMessageSequence;
+    bool execSent;
+
+    // snapshots are not decoded, only their timing is tracked
+    int snapServerTime;
+    int snapRealTime;
+    int lastSnapRealTime;
+
+    // usercmd stream
+    usercmd_t cmds[LG_CMD_BACKUP];
+    int cmdNumber;
+    int packetCmdNumber[2];  // cmdNumber at the last two packets, for duplication
+    int script;  // position in the recorded stream or the scripted walk
+    int scriptTime;
+    int seed;
+
+    // statistics, only accumulated while the measurement window is open
+    int bytesIn, bytesOut;
+    int packetsIn, packetsOut;
+    int snapshots;
+    int snapshotsDropped;
+    int gamestateTime;  // msec between connect and gamestate
+};
+
+struct lgOptions_t {
+    char server[MAX_OSPATH];
+    int numClients;
+    int connectRate;  // clients released per second
+    int duration;  // msec of measurement after all clients went active
+    int warmup;  // msec to wait after the last client went active
+    int timeout;  // msec to wait for all clients to go active
+    int cmdMsec;  // usercmd generation interval
+    int maxPackets;  // packets per second per client
+    int rate;
+    int snaps;
+    int seed;
+    char name[MAX_NAME_LENGTH];
+    char password[MAX_STRING_CHARS];
+    char rconPassword[MAX_STRING_CHARS];
+    char cmdFile[MAX_OSPATH];
+    char output[MAX_OSPATH];
+    char exec[LG_MAX_EXEC][MAX_STRING_CHARS];
+    int numExec;
+    bool netFields;  // ask for the profiled field tables
+    bool perClient;
+    bool verbose;
+};
+
+extern lgOptions_t lg_options;
+extern lgClient_t *lg_clients;  // [lg_options.numClients]
+extern netadr_t lg_serverAddress;
+extern lgCmd_t *lg_script;
+extern int lg_scriptLength;
+extern bool lg_measuring;
+
+// snapshot arrival interval samples in msec, over all clients
+extern int lg_snapIntervals[LG_MAX_SAMPLES];
+extern int lg_numSnapIntervals;
+
+//
+// lg_client.cpp
+//
+void LG_InitClient(lgClient_t *cl, int num, int startTime);
+void LG_ClientFrame(lgClient_t *cl, int now);
+void LG_ClientPacket(lgClient_t *cl, msg_t *msg, netadr_t from, int now);
+void LG_DisconnectClient(lgClient_t *cl);
+void LG_ResetStats(lgClient_t *cl);
+
+//
+// lg_common.cpp
+//
+int LG_OpenSocket(void);
+void LG_CloseSocket(int sock);
+void LG_SetSocket(int sock, int qport);
+bool LG_GetPacket(int sock, netadr_t *from, msg_t *msg);
+void LG_WaitForPackets(int msec);
+bool LG_LoadScript(const char *path);
+void LG_InitCommon(void);
+
+#endif
@@ -0,0 +1,531 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// lg_main.cpp -- tremloadgen: connects many synthetic clients to a
+// dedicated server, plays usercmd streams and reports JSON statistics
+//
+// typical use against a local server started with
+//   +set sv_pure 0 +set sv_protect 0 +set rconpassword secret +map atcs
+// is
+//   tremloadgen -clients 60 -duration 60 -rcon secret -exec "team humans" 127.0.0.1:30720
+
+#include "lg_local.h"
+
+#include <setjmp.h>
+#include <unistd.h>
+
+lgOptions_t lg_options;
+lgClient_t *lg_clients;
+netadr_t lg_serverAddress;
+lgCmd_t *lg_script;
+int lg_scriptLength;
+bool lg_measuring;
+
+int lg_snapIntervals[LG_MAX_SAMPLES];
+int lg_numSnapIntervals;
+
+extern jmp_buf lg_abortClient;
+extern bool lg_abortSet;
+
+struct lgFrameStats_t {
+    bool valid;
+    int frames, p50, p90, p99, max;
+};
+
+/*
+==================
+LG_Usage
+==================
+*/
+static void LG_Usage(void)
+{
+    fprintf(stderr,
+        "usage: tremloadgen [options] <server[:port]>\n"
+        "  -clients <n>      synthetic clients to connect (default 32, max %d)\n"
+        "  -connectrate <n>  clients released per second (default 8)\n"
+        "  -timeout <sec>    give up waiting for clients to go active (default 60)\n"
+        "  -warmup <sec>     settle time once every client is active (default 5)\n"
+        "  -duration <sec>   length of the measurement window (default 30)\n"
+        "  -cmdmsec <msec>   scripted usercmd interval (default 8)\n"
+        "  -maxpackets <n>   packets per second per client (default 30)\n"
+        "  -clrate <n>       userinfo rate (default 25000)\n"
+        "  -snaps <n>        userinfo snaps (default 40)\n"
+        "  -seed <n>         seed for the scripted walk and qports (default 1)\n"
+        "  -name <prefix>    player name prefix (default lg)\n"
+        "  -password <pw>    server password\n"
+        "  -rcon <pw>        rcon password, enables server frame time percentiles\n"
+        "  -cmds <file>      recorded usercmd stream instead of the scripted walk\n"
+        "  -exec <cmd>       client command sent once active, may be repeated\n"
+        "  -o <file>         write the JSON report here instead of stdout\n"
+        "  -netfields        ask for the profiled entity and playerstate field tables\n"
+        "  -perclient        include per-client statistics in the report\n"
+        "  -v                verbose\n",
+        LG_MAX_CLIENTS);
+    exit(1);
+}
+
+/*
+==================
+LG_ParseArgs
+==================
+*/
+static void LG_ParseArgs(int argc, char **argv)
+{
+    lgOptions_t *o = &lg_options;
+    int i;
+
+    ::memset(o, 0, sizeof(*o));
+    o->numClients = 32;
+    o->connectRate = 8;
+    o->timeout = 60000;
+    o->warmup = 5000;
+    o->duration = 30000;
+    o->cmdMsec = 8;
+    o->maxPackets = 30;
+    o->rate = 25000;
+    o->snaps = 40;
+    o->seed = 1;
+    Q_strncpyz(o->name, "lg", sizeof(o->name));
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (arg[0] != '-')
+        {
+            Q_strncpyz(o->server, arg, sizeof(o->server));
+            continue;
+        }
+
+        if (!Q_stricmp(arg, "-netfields"))
+        {
+            o->netFields = true;
+            continue;
+        }
+        if (!Q_stricmp(arg, "-perclient"))
+        {
+            o->perClient = true;
+            continue;
+        }
+        if (!Q_stricmp(arg, "-v"))
+        {
+            o->verbose = true;
+            continue;
+        }
+
+        if (!val)
+        {
+            LG_Usage();
+        }
+        i++;
+
+        if (!Q_stricmp(arg, "-clients"))
+            o->numClients = atoi(val);
+        else if (!Q_stricmp(arg, "-connectrate"))
+            o->connectRate = atoi(val);
+        else if (!Q_stricmp(arg, "-timeout"))
+            o->timeout = atoi(val) * 1000;
+        else if (!Q_stricmp(arg, "-warmup"))
+            o->warmup = atoi(val) * 1000;
+        else if (!Q_stricmp(arg, "-duration"))
+            o->duration = atoi(val) * 1000;
+        else if (!Q_stricmp(arg, "-cmdmsec"))
+            o->cmdMsec = atoi(val);
+        else if (!Q_stricmp(arg, "-maxpackets"))
+            o->maxPackets = atoi(val);
+        else if (!Q_stricmp(arg, "-clrate"))
+            o->rate = atoi(val);
+        else if (!Q_stricmp(arg, "-snaps"))
+            o->snaps = atoi(val);
+        else if (!Q_stricmp(arg, "-seed"))
+            o->seed = atoi(val);
+        else if (!Q_stricmp(arg, "-name"))
+            Q_strncpyz(o->name, val, sizeof(o->name));
+        else if (!Q_stricmp(arg, "-password"))
+            Q_strncpyz(o->password, val, sizeof(o->password));
+        else if (!Q_stricmp(arg, "-rcon"))
+            Q_strncpyz(o->rconPassword, val, sizeof(o->rconPassword));
+        else if (!Q_stricmp(arg, "-cmds"))
+            Q_strncpyz(o->cmdFile, val, sizeof(o->cmdFile));
+        else if (!Q_stricmp(arg, "-o"))
+            Q_strncpyz(o->output, val, sizeof(o->output));
+        else if (!Q_stricmp(arg, "-exec"))
+        {
+            if (o->numExec == LG_MAX_EXEC)
+            {
+                LG_Usage();
+            }
+            Q_strncpyz(o->exec[o->numExec++], val, sizeof(o->exec[0]));
+        }
+        else
+        {
+            LG_Usage();
+        }
+    }
+
+    if (!o->server[0] || o->numClients < 1 || o->numClients > LG_MAX_CLIENTS)
+    {
+        LG_Usage();
+    }
+
+    o->connectRate = MAX(o->connectRate, 1);
+    o->cmdMsec = MAX(o->cmdMsec, 1);
+    o->maxPackets = Com_Clamp(1, 125, o->maxPackets);
+}
+
+/*
+==================
+LG_Rcon
+
+Sends an rcon command from a throwaway socket and waits up to a second
+for the print response
+==================
+*/
+static bool LG_Rcon(const char *cmd, char *response, int size)
+{
+    byte data[MAX_MSGLEN];
+    msg_t msg;
+    netadr_t from;
+    int sock, start;
+
+    if (!lg_options.rconPassword[0])
+    {
+        return false;
+    }
+
+    sock = LG_OpenSocket();
+    if (sock < 0)
+    {
+        return false;
+    }
+
+    LG_SetSocket(sock, 0);
+    NET_OutOfBandPrint(NS_CLIENT, lg_serverAddress, "rcon %s %s", lg_options.rconPassword, cmd);
+
+    MSG_Init(&msg, data, sizeof(data));
+    start = Sys_Milliseconds();
+    while (Sys_Milliseconds() - start < 1000)
+    {
+        if (LG_GetPacket(sock, &from, &msg) && msg.cursize >= 4 && *(int *)msg.data == -1)
+        {
+            const char *s;
+
+            MSG_BeginReadingOOB(&msg);
+            MSG_ReadLong(&msg);
+            s = MSG_ReadStringLine(&msg);
+            if (!Q_stricmp(s, "print"))
+            {
+                Q_strncpyz(response, MSG_ReadString(&msg), size);
+                LG_CloseSocket(sock);
+                return true;
+            }
+        }
+        usleep(1000);
+    }
+
+    LG_CloseSocket(sock);
+    return false;
+}
+
+/*
+==================
+LG_ReadFrameStats
+==================
+*/
+static void LG_ReadFrameStats(lgFrameStats_t *stats)
+{
+    char response[MAX_STRING_CHARS];
+
+    ::memset(stats, 0, sizeof(*stats));
+
+    if (!LG_Rcon("framestats", response, sizeof(response)))
+    {
+        return;
+    }
+
+    stats->valid = sscanf(response, "frames=%d p50=%d p90=%d p99=%d max=%d", &stats->frames, &stats->p50,
+                       &stats->p90, &stats->p99, &stats->max) == 5;
+    if (!stats->valid)
+    {
+        Com_Printf("framestats: unexpected rcon response \"%s\"\n", response);
+    }
+}
+
+/*
+==================
+LG_RunClient
+
+Reads everything queued on the client socket and lets it think, a
+Com_Error while parsing drops just this client
+==================
+*/
+static void LG_RunClient(lgClient_t *cl, int now)
+{
+    static byte data[MAX_MSGLEN];
+    msg_t msg;
+    netadr_t from;
+
+    if (setjmp(lg_abortClient))
+    {
+        lg_abortSet = false;
+        LG_DisconnectClient(cl);
+        return;
+    }
+    lg_abortSet = true;
+
+    if (cl->sock >= 0)
+    {
+        MSG_Init(&msg, data, sizeof(data));
+        while (LG_GetPacket(cl->sock, &from, &msg))
+        {
+            LG_ClientPacket(cl, &msg, from, now);
+            MSG_Init(&msg, data, sizeof(data));
+        }
+    }
+
+    LG_ClientFrame(cl, now);
+
+    lg_abortSet = false;
+}
+
+static int LG_CompareInts(const void *a, const void *b) { return *(const int *)a - *(const int *)b; }
+
+/*
+==================
+LG_WriteDistribution
+
+Writes "name": {p50, p90, p99, max} for an unsorted sample array
+==================
+*/
+static void LG_WriteDistribution(FILE *f, const char *name, int *samples, int count, bool last)
+{
+    if (!count)
+    {
+        fprintf(f, "  \"%s\": null%s\n", name, last ? "" : ",");
+        return;
+    }
+
+    qsort(samples, count, sizeof(int), LG_CompareInts);
+    fprintf(f, "  \"%s\": { \"samples\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d }%s\n", name, count,
+        samples[count * 50 / 100], samples[count * 90 / 100], samples[count * 99 / 100], samples[count - 1],
+        last ? "" : ",");
+}
+
+/*
+==================
+LG_WriteReport
+==================
+*/
+static void LG_WriteReport(int connectTime, int measured, const lgFrameStats_t *frameStats)
+{
+    static int gamestateTimes[LG_MAX_CLIENTS], bytesIn[LG_MAX_CLIENTS], bytesOut[LG_MAX_CLIENTS];
+    int i, active = 0, dropped = 0, snapshots = 0, snapshotsDropped = 0;
+    FILE *f = stdout;
+
+    if (lg_options.output[0])
+    {
+        f = fopen(lg_options.output, "w");
+        if (!f)
+        {
+            Com_Error(ERR_FATAL, "Couldn't write %s", lg_options.output);
+        }
+    }
+
+    measured = MAX(measured, 1);
+
+    for (i = 0; i < lg_options.numClients; i++)
+    {
+        lgClient_t *cl = &lg_clients[i];
+
+        if (cl->state == LG_ACTIVE)
+        {
+            active++;
+        }
+        else if (cl->state == LG_DROPPED)
+        {
+            dropped++;
+        }
+
+        gamestateTimes[i] = cl->gamestateTime;
+        bytesIn[i] = (int)((int64_t)cl->bytesIn * 1000 / measured);
+        bytesOut[i] = (int)((int64_t)cl->bytesOut * 1000 / measured);
+        snapshots += cl->snapshots;
+        snapshotsDropped += cl->snapshotsDropped;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"server\": \"%s\",\n", lg_options.server);
+    fprintf(f, "  \"clients\": %d,\n", lg_options.numClients);
+    fprintf(f, "  \"active\": %d,\n", active);
+    fprintf(f, "  \"dropped\": %d,\n", dropped);
+    fprintf(f, "  \"connect_ms\": %d,\n", connectTime);
+    fprintf(f, "  \"duration_ms\": %d,\n", measured);
+
+    if (frameStats->valid)
+    {
+        fprintf(f, "  \"server_frame_usec\": { \"samples\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d },\n",
+            frameStats->frames, frameStats->p50, frameStats->p90, frameStats->p99, frameStats->max);
+    }
+    else
+    {
+        fprintf(f, "  \"server_frame_usec\": null,\n");
+    }
+
+    fprintf(f, "  \"snapshots\": { \"received\": %d, \"dropped\": %d, \"drop_rate\": %.5f },\n", snapshots,
+        snapshotsDropped, snapshots + snapshotsDropped ? (double)snapshotsDropped / (snapshots + snapshotsDropped) : 0.0);
+
+    LG_WriteDistribution(f, "snapshot_interval_ms", lg_snapIntervals, lg_numSnapIntervals, false);
+    LG_WriteDistribution(f, "gamestate_ms", gamestateTimes, lg_options.numClients, false);
+    LG_WriteDistribution(f, "bytes_in_per_sec_per_client", bytesIn, lg_options.numClients, false);
+    LG_WriteDistribution(f, "bytes_out_per_sec_per_client", bytesOut, lg_options.numClients, !lg_options.perClient);
+
+    if (lg_options.perClient)
+    {
+        fprintf(f, "  \"per_client\": [\n");
+        for (i = 0; i < lg_options.numClients; i++)
+        {
+            lgClient_t *cl = &lg_clients[i];
+
+            fprintf(f,
+                "    { \"num\": %d, \"client_num\": %d, \"active\": %s, \"bytes_in\": %d, \"bytes_out\": %d, "
+                "\"packets_in\": %d, \"packets_out\": %d, \"snapshots\": %d, \"snapshots_dropped\": %d }%s\n",
+                cl->num, cl->clientNum, cl->state == LG_ACTIVE ? "true" : "false", cl->bytesIn, cl->bytesOut,
+                cl->packetsIn, cl->packetsOut, cl->snapshots, cl->snapshotsDropped,
+                i == lg_options.numClients - 1 ? "" : ",");
+        }
+        fprintf(f, "  ]\n");
+    }
+
+    fprintf(f, "}\n");
+
+    if (f != stdout)
+    {
+        fclose(f);
+    }
+}
+
+/*
+==================
+main
+==================
+*/
+int main(int argc, char **argv)
+{
+    lgFrameStats_t frameStats;
+    char response[MAX_STRING_CHARS];
+    int i, start, now, allActiveTime = 0, measureStart = 0, connectTime = 0;
+
+    LG_ParseArgs(argc, argv);
+    LG_InitCommon();
+
+    if (!NET_StringToAdr(lg_options.server, &lg_serverAddress, NA_IP) || lg_serverAddress.type != NA_IP)
+    {
+        Com_Error(ERR_FATAL, "Bad server address %s", lg_options.server);
+    }
+
+    if (lg_options.cmdFile[0] && !LG_LoadScript(lg_options.cmdFile))
+    {
+        return 1;
+    }
+
+    lg_clients = (lgClient_t *)calloc(lg_options.numClients, sizeof(lgClient_t));
+    if (!lg_clients)
+    {
+        Com_Error(ERR_FATAL, "Couldn't allocate %d clients", lg_options.numClients);
+    }
+
+    start = Sys_Milliseconds();
+    for (i = 0; i < lg_options.numClients; i++)
+    {
+        LG_InitClient(&lg_clients[i], i, start + i * 1000 / lg_options.connectRate);
+    }
+
+    Com_Printf("connecting %d clients to %s\n", lg_options.numClients, lg_options.server);
+
+    while (1)
+    {
+        int active = 0, pending = 0;
+
+        now = Sys_Milliseconds();
+
+        for (i = 0; i < lg_options.numClients; i++)
+        {
+            LG_RunClient(&lg_clients[i], now);
+
+            if (lg_clients[i].state == LG_ACTIVE)
+            {
+                active++;
+            }
+            else if (lg_clients[i].state != LG_DROPPED)
+            {
+                pending++;
+            }
+        }
+
+        if (!active && !pending)
+        {
+            Com_Printf("every client was dropped\n");
+            break;
+        }
+
+        if (!allActiveTime && (!pending || now - start >= lg_options.timeout))
+        {
+            allActiveTime = now;
+            connectTime = now - start;
+            Com_Printf("%d of %d clients active after %d msec\n", active, lg_options.numClients, connectTime);
+        }
+
+        if (allActiveTime && !lg_measuring && now - allActiveTime >= lg_options.warmup)
+        {
+            for (i = 0; i < lg_options.numClients; i++)
+            {
+                LG_ResetStats(&lg_clients[i]);
+            }
+            lg_numSnapIntervals = 0;
+            LG_Rcon("framestats reset", response, sizeof(response));
+
+            Com_Printf("measuring for %d msec\n", lg_options.duration);
+            lg_measuring = true;
+            measureStart = Sys_Milliseconds();
+        }
+
+        if (lg_measuring && now - measureStart >= lg_options.duration)
+        {
+            break;
+        }
+
+        LG_WaitForPackets(1);
+    }
+
+    lg_measuring = false;
+    LG_ReadFrameStats(&frameStats);
+    LG_WriteReport(connectTime, measureStart ? Sys_Milliseconds() - measureStart : 0, &frameStats);
+
+    for (i = 0; i < lg_options.numClients; i++)
+    {
+        LG_DisconnectClient(&lg_clients[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,609 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// mb_common.cpp -- the parts of common, cvar and the filesystem that the
+// collision model needs, the syscalls bg_misc.c and bg_pmove.c make, and
+// the counting trace callbacks handed to Pmove
+
+#include "mb_local.h"
+
+#include <errno.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <elf.h>
+#include <link.h>
+#endif
+
+mbStats_t mb_stats;
+
+#if id386
+// common.cpp picks these by cpuid, the x87 versions run everywhere
+long (QDECL *Q_ftol)(float f) = qftolx87;
+void (QDECL *Q_SnapVector)(vec3_t vec) = qsnapvectorx87;
+#endif
+
+/*
+==============================================================
+
+COMMON
+
+==============================================================
+*/
+
+void QDECL Com_Printf(const char *fmt, ...)
+{
+    va_list argptr;
+
+    va_start(argptr, fmt);
+    vfprintf(stderr, fmt, argptr);
+    va_end(argptr);
+}
+
+void QDECL Com_DPrintf(const char *fmt, ...)
+{
+    va_list argptr;
+
+    if (!mb_options.verbose)
+    {
+        return;
+    }
+
+    va_start(argptr, fmt);
+    vfprintf(stderr, fmt, argptr);
+    va_end(argptr);
+}
+
+void QDECL Com_Error(int code, const char *fmt, ...)
+{
+    va_list argptr;
+    char msg[MAXPRINTMSG];
+
+    va_start(argptr, fmt);
+    Q_vsnprintf(msg, sizeof(msg), fmt, argptr);
+    va_end(argptr);
+
+    fprintf(stderr, "ERROR: %s\n", msg);
+    exit(1);
+}
+
+#ifdef HUNK_DEBUG
+void *Hunk_AllocDebug(int size, ha_pref preference, const char *label, const char *file, int line)
+#else
+void *Hunk_Alloc(int size, ha_pref preference)
+#endif
+{
+    void *buf = calloc(1, size);
+
+    if (!buf)
+    {
+        Com_Error(ERR_FATAL, "Hunk_Alloc failed on %i", size);
+    }
+
+    return buf;
+}
+
+#ifdef ZONE_DEBUG
+void *Z_MallocDebug(int size, const char *label, const char *file, int line) { return calloc(1, size); }
+#else
+void *Z_Malloc(int size) { return calloc(1, size); }
+#endif
+
+void Z_Free(void *ptr) { free(ptr); }
+
+/*
+==============================================================
+
+CVAR
+
+Only the few cvars the collision model reads exist, at their defaults
+
+==============================================================
+*/
+
+#define MB_MAX_CVARS 8
+
+static cvar_t mb_cvars[MB_MAX_CVARS];
+static int mb_numCvars;
+
+cvar_t *Cvar_Get(const char *var_name, const char *var_value, int flags)
+{
+    cvar_t *var;
+    int i;
+
+    for (i = 0; i < mb_numCvars; i++)
+    {
+        if (!strcmp(mb_cvars[i].name, var_name))
+        {
+            return &mb_cvars[i];
+        }
+    }
+
+    if (mb_numCvars == MB_MAX_CVARS)
+    {
+        Com_Error(ERR_FATAL, "Cvar_Get: too many cvars");
+    }
+
+    var = &mb_cvars[mb_numCvars++];
+    var->name = strdup(var_name);
+    var->string = strdup(var_value);
+    var->resetString = var->string;
+    var->flags = flags;
+    var->value = atof(var_value);
+    var->integer = atoi(var_value);
+    return var;
+}
+
+/*
+==============================================================
+
+FILESYSTEM
+
+Plain files looked up under each -base directory in turn, then as given
+
+==============================================================
+*/
+
+#define MB_MAX_FILES 16
+
+static FILE *mb_files[MB_MAX_FILES];
+
+static FILE *MB_OpenFile(const char *qpath)
+{
+    char path[MAX_OSPATH * 2];
+    FILE *f;
+    int i;
+
+    for (i = 0; i < mb_options.numBaseDirs; i++)
+    {
+        Com_sprintf(path, sizeof(path), "%s/%s", mb_options.baseDirs[i], qpath);
+        if ((f = fopen(path, "rb")))
+        {
+            return f;
+        }
+    }
+
+    return fopen(qpath, "rb");
+}
+
+static long MB_FileLength(FILE *f)
+{
+    long length;
+
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    return length;
+}
+
+long FS_ReadFile(const char *qpath, void **buffer)
+{
+    FILE *f;
+    byte *buf;
+    long length;
+
+    f = MB_OpenFile(qpath);
+    if (!f)
+    {
+        if (buffer)
+        {
+            *buffer = NULL;
+        }
+        return -1;
+    }
+
+    length = MB_FileLength(f);
+    if (!buffer)
+    {
+        fclose(f);
+        return length;
+    }
+
+    buf = (byte *)malloc(length + 1);
+    if (fread(buf, 1, length, f) != (size_t)length)
+    {
+        Com_Error(ERR_FATAL, "Couldn't read %s", qpath);
+    }
+    buf[length] = 0;
+    fclose(f);
+
+    *buffer = buf;
+    return length;
+}
+
+void FS_FreeFile(void *buffer) { free(buffer); }
+
+extern "C" {
+
+int trap_FS_FOpenFile(const char *qpath, fileHandle_t *f, enum FS_Mode mode)
+{
+    FILE *file;
+    int i;
+
+    if (mode != FS_READ)
+    {
+        return -1;
+    }
+
+    file = MB_OpenFile(qpath);
+    if (!file)
+    {
+        return -1;
+    }
+
+    if (!f)
+    {
+        long length = MB_FileLength(file);
+
+        fclose(file);
+        return length;
+    }
+
+    for (i = 1; i < MB_MAX_FILES; i++)
+    {
+        if (!mb_files[i])
+        {
+            mb_files[i] = file;
+            *f = i;
+            return MB_FileLength(file);
+        }
+    }
+
+    fclose(file);
+    return -1;
+}
+
+void trap_FS_Read(void *buffer, int len, fileHandle_t f)
+{
+    if (f > 0 && f < MB_MAX_FILES && mb_files[f] && fread(buffer, 1, len, mb_files[f]) != (size_t)len)
+    {
+        Com_Printf("trap_FS_Read: short read\n");
+    }
+}
+
+void trap_FS_Write(const void *buffer, int len, fileHandle_t f) {}
+
+void trap_FS_FCloseFile(fileHandle_t f)
+{
+    if (f > 0 && f < MB_MAX_FILES && mb_files[f])
+    {
+        fclose(mb_files[f]);
+        mb_files[f] = NULL;
+    }
+}
+
+void trap_FS_Seek(fileHandle_t f, long offset, enum FS_Origin origin) {}
+
+int trap_FS_GetFileList(const char *path, const char *extension, char *listbuf, int bufsize) { return 0; }
+
+void trap_Cvar_VariableStringBuffer(const char *var_name, char *buffer, int bufsize)
+{
+    if (bufsize > 0)
+    {
+        buffer[0] = '\0';
+    }
+}
+
+// the server's G_SNAPVECTOR
+void trap_SnapVector(float *v) { Q_SnapVector(v); }
+
+}
+
+/*
+==============================================================
+
+PMOVE CALLBACKS
+
+==============================================================
+*/
+
+int64_t MB_Nanoseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+==================
+MB_CountSite
+==================
+*/
+static void MB_CountSite(void *address, int64_t nsec)
+{
+    mbSite_t *site;
+    int i;
+
+    for (i = 0; i < mb_stats.numSites; i++)
+    {
+        if (mb_stats.sites[i].address == address)
+        {
+            break;
+        }
+    }
+
+    if (i == mb_stats.numSites)
+    {
+        if (mb_stats.numSites == MB_MAX_SITES)
+        {
+            return;
+        }
+        mb_stats.sites[mb_stats.numSites++].address = address;
+    }
+
+    site = &mb_stats.sites[i];
+    site->count++;
+    site->nsec += nsec;
+}
+
+/*
+==================
+MB_Trace
+
+The world half of SV_Trace, the benchmark has no entities to clip against
+==================
+*/
+void MB_Trace(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+    int passEntityNum, int contentMask)
+{
+    int64_t traceStart = 0;
+
+    mb_stats.traces++;
+
+    if (mb_options.profile)
+    {
+        traceStart = MB_Nanoseconds();
+    }
+
+    CM_BoxTrace(results, start, end, (float *)(mins ? mins : vec3_origin), (float *)(maxs ? maxs : vec3_origin), 0,
+        contentMask, TT_AABB);
+    results->entityNum = results->fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+
+    if (mb_options.profile)
+    {
+        int64_t nsec = MB_Nanoseconds() - traceStart;
+
+        mb_stats.traceNsec += nsec;
+        MB_CountSite(__builtin_return_address(0), nsec);
+    }
+}
+
+int MB_PointContents(const vec3_t point, int passEntityNum)
+{
+    mb_stats.pointContents++;
+    return CM_PointContents(point, 0);
+}
+
+/*
+==============================================================
+
+SYMBOLS
+
+Trace call sites are named from the executable's own symbol table, which
+also has the static functions of bg_pmove.c
+
+==============================================================
+*/
+
+#ifdef __linux__
+struct mbSymbol_t {
+    uintptr_t start;
+    uintptr_t end;
+    char *name;
+};
+
+static mbSymbol_t *mb_symbols;
+static int mb_numSymbols;
+static uintptr_t mb_loadBias;
+
+static int MB_ExecutableBias(struct dl_phdr_info *info, size_t size, void *data)
+{
+    // the executable is always listed first
+    *(uintptr_t *)data = info->dlpi_addr;
+    return 1;
+}
+
+/*
+==================
+MB_LoadSymbols
+==================
+*/
+static void MB_LoadSymbols(void)
+{
+    FILE *f;
+    byte *image;
+    long length;
+    ElfW(Ehdr) *header;
+    ElfW(Shdr) *sections;
+    int i;
+
+    dl_iterate_phdr(MB_ExecutableBias, &mb_loadBias);
+
+    f = fopen("/proc/self/exe", "rb");
+    if (!f)
+    {
+        return;
+    }
+
+    length = MB_FileLength(f);
+    image = (byte *)malloc(length);
+    if (fread(image, 1, length, f) != (size_t)length)
+    {
+        fclose(f);
+        free(image);
+        return;
+    }
+    fclose(f);
+
+    header = (ElfW(Ehdr) *)image;
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG))
+    {
+        free(image);
+        return;
+    }
+
+    sections = (ElfW(Shdr) *)(image + header->e_shoff);
+    for (i = 0; i < header->e_shnum; i++)
+    {
+        ElfW(Sym) *symbols;
+        const char *strings;
+        int j, count;
+
+        if (sections[i].sh_type != SHT_SYMTAB)
+        {
+            continue;
+        }
+
+        symbols = (ElfW(Sym) *)(image + sections[i].sh_offset);
+        strings = (const char *)(image + sections[sections[i].sh_link].sh_offset);
+        count = sections[i].sh_size / sizeof(ElfW(Sym));
+
+        mb_symbols = (mbSymbol_t *)realloc(mb_symbols, (mb_numSymbols + count) * sizeof(mbSymbol_t));
+        for (j = 0; j < count; j++)
+        {
+            if (ELF64_ST_TYPE(symbols[j].st_info) != STT_FUNC || !symbols[j].st_size)
+            {
+                continue;
+            }
+
+            mb_symbols[mb_numSymbols].start = mb_loadBias + symbols[j].st_value;
+            mb_symbols[mb_numSymbols].end = mb_symbols[mb_numSymbols].start + symbols[j].st_size;
+            mb_symbols[mb_numSymbols].name = strdup(strings + symbols[j].st_name);
+            mb_numSymbols++;
+        }
+    }
+
+    free(image);
+}
+#endif
+
+/*
+==================
+MB_SymbolForAddress
+
+function+offset when the executable isn't stripped, the bare address if it is
+==================
+*/
+const char *MB_SymbolForAddress(void *address, char *buffer, int size)
+{
+    uintptr_t addr = (uintptr_t)address;
+
+#ifdef __linux__
+    static bool loaded;
+    int i;
+
+    if (!loaded)
+    {
+        loaded = true;
+        MB_LoadSymbols();
+    }
+
+    for (i = 0; i < mb_numSymbols; i++)
+    {
+        if (addr >= mb_symbols[i].start && addr < mb_symbols[i].end)
+        {
+            Com_sprintf(buffer, size, "%s+0x%x", mb_symbols[i].name, (int)(addr - mb_symbols[i].start));
+            return buffer;
+        }
+    }
+
+    addr -= mb_loadBias;
+#endif
+
+    Com_sprintf(buffer, size, "0x%lx", (unsigned long)addr);
+    return buffer;
+}
+
+/*
+==================
+MB_LoadScript
+
+Same format as tremloadgen's -cmds, one usercmd per line:
+msec forwardmove rightmove upmove buttons weapon pitch yaw roll
+with the angles in degrees; '#' starts a comment
+==================
+*/
+bool MB_LoadScript(const char *path)
+{
+    FILE *f;
+    char line[MAX_STRING_CHARS];
+    int size = 0;
+
+    f = fopen(path, "r");
+    if (!f)
+    {
+        Com_Printf("Couldn't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        mbCmd_t *rec;
+        int forward, right, up, buttons, weapon;
+        float angles[3];
+
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        if (mb_scriptLength == size)
+        {
+            size = size ? size * 2 : 1024;
+            mb_script = (mbCmd_t *)realloc(mb_script, size * sizeof(mbCmd_t));
+        }
+
+        rec = &mb_script[mb_scriptLength];
+        ::memset(rec, 0, sizeof(*rec));
+
+        if (sscanf(line, "%d %d %d %d %d %d %f %f %f", &rec->msec, &forward, &right, &up, &buttons, &weapon,
+                &angles[PITCH], &angles[YAW], &angles[ROLL]) != 9)
+        {
+            Com_Printf("%s: skipping malformed line \"%s\"\n", path, line);
+            continue;
+        }
+
+        rec->msec = MAX(rec->msec, 1);
+        rec->cmd.forwardmove = (signed char)Com_Clamp(-127, 127, forward);
+        rec->cmd.rightmove = (signed char)Com_Clamp(-127, 127, right);
+        rec->cmd.upmove = (signed char)Com_Clamp(-127, 127, up);
+        rec->cmd.buttons = buttons;
+        rec->cmd.weapon = weapon;
+        rec->cmd.angles[PITCH] = ANGLE2SHORT(angles[PITCH]);
+        rec->cmd.angles[YAW] = ANGLE2SHORT(angles[YAW]);
+        rec->cmd.angles[ROLL] = ANGLE2SHORT(angles[ROLL]);
+        mb_scriptLength++;
+    }
+
+    fclose(f);
+
+    if (!mb_scriptLength)
+    {
+        Com_Printf("%s: no usercmds\n", path);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,96 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// mb_local.h -- standalone pmove replay benchmark
+
+#ifndef MB_LOCAL_H
+#define MB_LOCAL_H 1
+
+#include "qcommon/cm_public.h"
+#include "qcommon/cvar.h"
+#include "qcommon/files.h"
+#include "qcommon/q_shared.h"
+#include "qcommon/qcommon.h"
+
+extern "C" {
+#include "game/bg_public.h"
+}
+
+#define MB_MAX_BASEDIRS     8
+#define MB_MAX_SITES        256  // distinct trace call sites told apart by -profile
+
+// one recorded usercmd, time is relative to the previous entry
+struct mbCmd_t {
+    int msec;
+    usercmd_t cmd;
+};
+
+// traces issued from one place in the pmove code
+struct mbSite_t {
+    void *address;  // return address of the pm->trace call
+    int count;
+    int64_t nsec;
+};
+
+struct mbStats_t {
+    int traces;
+    int pointContents;
+    int64_t traceNsec;  // only measured with -profile
+
+    mbSite_t sites[MB_MAX_SITES];
+    int numSites;
+};
+
+struct mbOptions_t {
+    char map[MAX_OSPATH];
+    char baseDirs[MB_MAX_BASEDIRS][MAX_OSPATH];
+    int numBaseDirs;
+    int moves;  // per class
+    int cmdMsec;
+    int seed;
+    char classNames[PCL_NUM_CLASSES][MAX_QPATH];  // -class, none for every playable class
+    int numClassNames;
+    bool haveOrigin;
+    vec3_t origin;
+    char cmdFile[MAX_OSPATH];
+    char output[MAX_OSPATH];
+    bool profile;
+    bool verbose;
+};
+
+extern mbOptions_t mb_options;
+extern mbStats_t mb_stats;
+extern mbCmd_t *mb_script;
+extern int mb_scriptLength;
+
+//
+// mb_common.cpp
+//
+int64_t MB_Nanoseconds(void);
+void MB_Trace(trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+    int passEntityNum, int contentMask);
+int MB_PointContents(const vec3_t point, int passEntityNum);
+const char *MB_SymbolForAddress(void *address, char *buffer, int size);
+bool MB_LoadScript(const char *path);
+
+#endif
@@ -0,0 +1,608 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// mb_main.cpp -- tremmovebench: replays usercmd streams through the game's
+// Pmove against a real BSP for every class and reports JSON statistics
+//
+// typical use from the build directory is
+//   tremmovebench -base gpp -base ../../assets -moves 200000 atcs
+// and a second run with the same arguments must report the same checksums
+
+#include "mb_local.h"
+
+mbOptions_t mb_options;
+mbCmd_t *mb_script;
+int mb_scriptLength;
+
+// the seeded walk, a usercmd every -cmdmsec
+struct mbWalk_t {
+    int seed;
+    int script;
+    int scriptTime;
+    usercmd_t cmd;
+};
+
+struct mbClassResult_t {
+    class_t klass;
+    int moves;
+    int64_t nsec;
+    int traces;
+    int pointContents;
+    int64_t traceNsec;
+    int p50, p90, p99, max;  // nanoseconds per Pmove
+    int respawns;            // fell out of the world and started over
+    unsigned checksum;
+    vec3_t start, end;
+};
+
+/*
+==================
+MB_Usage
+==================
+*/
+static void MB_Usage(void)
+{
+    fprintf(stderr,
+        "usage: tremmovebench [options] <map>\n"
+        "  -base <dir>       directory holding maps/ and configs/, may be repeated (default .)\n"
+        "  -moves <n>        Pmove calls per class (default 100000)\n"
+        "  -cmdmsec <msec>   scripted usercmd interval (default 8)\n"
+        "  -seed <n>         seed for the scripted walk (default 1)\n"
+        "  -class <name>     only this class, may be repeated (default every class)\n"
+        "  -origin <x y z>   start here instead of at a spawn point\n"
+        "  -cmds <file>      recorded usercmd stream instead of the scripted walk\n"
+        "  -o <file>         write the JSON report here instead of stdout\n"
+        "  -profile          time every trace and break them down by call site\n"
+        "  -v                verbose\n");
+    exit(1);
+}
+
+/*
+==================
+MB_ParseArgs
+==================
+*/
+static void MB_ParseArgs(int argc, char **argv)
+{
+    mbOptions_t *o = &mb_options;
+    int i;
+
+    ::memset(o, 0, sizeof(*o));
+    o->moves = 100000;
+    o->cmdMsec = 8;
+    o->seed = 1;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (arg[0] != '-')
+        {
+            Q_strncpyz(o->map, arg, sizeof(o->map));
+            continue;
+        }
+
+        if (!Q_stricmp(arg, "-profile"))
+        {
+            o->profile = true;
+            continue;
+        }
+        if (!Q_stricmp(arg, "-v"))
+        {
+            o->verbose = true;
+            continue;
+        }
+
+        if (!val)
+        {
+            MB_Usage();
+        }
+        i++;
+
+        if (!Q_stricmp(arg, "-base"))
+        {
+            if (o->numBaseDirs == MB_MAX_BASEDIRS)
+            {
+                MB_Usage();
+            }
+            Q_strncpyz(o->baseDirs[o->numBaseDirs++], val, sizeof(o->baseDirs[0]));
+        }
+        else if (!Q_stricmp(arg, "-moves"))
+            o->moves = atoi(val);
+        else if (!Q_stricmp(arg, "-cmdmsec"))
+            o->cmdMsec = atoi(val);
+        else if (!Q_stricmp(arg, "-seed"))
+            o->seed = atoi(val);
+        else if (!Q_stricmp(arg, "-cmds"))
+            Q_strncpyz(o->cmdFile, val, sizeof(o->cmdFile));
+        else if (!Q_stricmp(arg, "-o"))
+            Q_strncpyz(o->output, val, sizeof(o->output));
+        else if (!Q_stricmp(arg, "-class"))
+        {
+            if (o->numClassNames == PCL_NUM_CLASSES)
+            {
+                MB_Usage();
+            }
+            Q_strncpyz(o->classNames[o->numClassNames++], val, sizeof(o->classNames[0]));
+        }
+        else if (!Q_stricmp(arg, "-origin"))
+        {
+            if (i + 2 >= argc)
+            {
+                MB_Usage();
+            }
+            o->origin[0] = atof(argv[i]);
+            o->origin[1] = atof(argv[++i]);
+            o->origin[2] = atof(argv[++i]);
+            o->haveOrigin = true;
+        }
+        else
+        {
+            MB_Usage();
+        }
+    }
+
+    if (!o->map[0] || o->moves < 1)
+    {
+        MB_Usage();
+    }
+
+    if (!o->numBaseDirs)
+    {
+        Q_strncpyz(o->baseDirs[o->numBaseDirs++], ".", sizeof(o->baseDirs[0]));
+    }
+
+    o->cmdMsec = MAX(o->cmdMsec, 1);
+}
+
+/*
+==================
+MB_FindSpawn
+
+Origin of the first entity of the given class in the map's entity string
+==================
+*/
+static bool MB_FindSpawn(const char *classname, vec3_t origin)
+{
+    char *p = CM_EntityString();
+    char key[MAX_TOKEN_CHARS];
+    char *token;
+    bool haveOrigin, match;
+
+    while (1)
+    {
+        token = COM_Parse(&p);
+        if (!p || token[0] != '{')
+        {
+            return false;
+        }
+
+        haveOrigin = match = false;
+        while (1)
+        {
+            token = COM_Parse(&p);
+            if (!p || token[0] == '}')
+            {
+                break;
+            }
+            Q_strncpyz(key, token, sizeof(key));
+
+            token = COM_Parse(&p);
+            if (!p)
+            {
+                return false;
+            }
+
+            if (!Q_stricmp(key, "classname"))
+            {
+                match = !Q_stricmp(token, classname);
+            }
+            else if (!Q_stricmp(key, "origin"))
+            {
+                haveOrigin = sscanf(token, "%f %f %f", &origin[0], &origin[1], &origin[2]) == 3;
+            }
+        }
+
+        if (match && haveOrigin)
+        {
+            return true;
+        }
+    }
+}
+
+/*
+==================
+MB_SpawnOrigin
+
+Entities are never linked in the benchmark, so a spawn buildable's origin
+is just a point above the floor the player drops onto
+==================
+*/
+static void MB_SpawnOrigin(class_t klass, vec3_t origin)
+{
+    const char *spawn = klass <= PCL_ALIEN_LEVEL4 ? "team_alien_spawn" : "team_human_spawn";
+    vec3_t mins;
+
+    if (mb_options.haveOrigin)
+    {
+        VectorCopy(mb_options.origin, origin);
+        return;
+    }
+
+    if (!MB_FindSpawn(spawn, origin) && !MB_FindSpawn("info_player_intermission", origin) &&
+        !MB_FindSpawn("info_player_deathmatch", origin))
+    {
+        VectorClear(origin);
+    }
+
+    BG_ClassBoundingBox(klass, mins, NULL, NULL, NULL, NULL);
+    origin[2] += 1.0f - mins[2];
+}
+
+/*
+==================
+MB_SpawnClass
+
+The parts of ClientSpawn that Pmove looks at
+==================
+*/
+static void MB_SpawnClass(class_t klass, playerState_t *ps, pmoveExt_t *pmext)
+{
+    const classAttributes_t *ca = BG_Class(klass);
+    weapon_t weapon;
+
+    ::memset(ps, 0, sizeof(*ps));
+    ::memset(pmext, 0, sizeof(*pmext));
+
+    ps->stats[STAT_CLASS] = klass;
+    ps->stats[STAT_TEAM] = klass <= PCL_ALIEN_LEVEL4 ? TEAM_ALIENS : TEAM_HUMANS;
+    ps->stats[STAT_HEALTH] = ps->stats[STAT_MAX_HEALTH] = ca->health;
+    ps->stats[STAT_STAMINA] = STAMINA_MAX;
+    ps->stats[STAT_BUILDABLE] = BA_NONE;
+    VectorSet(ps->grapplePoint, 0.0f, 0.0f, 1.0f);
+
+    if (ps->stats[STAT_TEAM] == TEAM_HUMANS)
+    {
+        BG_AddUpgradeToInventory(UP_MEDKIT, ps->stats);
+        if (klass == PCL_HUMAN_BSUIT)
+        {
+            BG_AddUpgradeToInventory(UP_BATTLESUIT, ps->stats);
+        }
+        weapon = WP_MACHINEGUN;
+    }
+    else
+    {
+        weapon = ca->startWeapon;
+    }
+
+    ps->stats[STAT_WEAPON] = ps->weapon = weapon;
+    ps->ammo = BG_Weapon(weapon)->maxAmmo;
+    ps->clips = BG_Weapon(weapon)->maxClips;
+
+    ps->pm_type = PM_NORMAL;
+    ps->gravity = 800;
+    ps->speed = 320 * ca->speed;
+    ps->torsoAnim = TORSO_STAND;
+    ps->legsAnim = LEGS_IDLE;
+
+    MB_SpawnOrigin(klass, ps->origin);
+}
+
+/*
+==================
+MB_NextCommand
+
+Fills the next usercmd from the recorded stream, or from the same seeded
+random walk tremloadgen plays
+==================
+*/
+static int MB_NextCommand(mbWalk_t *walk, int index, usercmd_t *cmd)
+{
+    int msec = mb_options.cmdMsec;
+
+    if (mb_scriptLength)
+    {
+        const mbCmd_t *rec = &mb_script[index % mb_scriptLength];
+
+        *cmd = rec->cmd;
+        return rec->msec;
+    }
+
+    walk->scriptTime += msec;
+    if (walk->scriptTime >= 1500)
+    {
+        // pick a new heading and strafe direction every 1.5 seconds
+        walk->scriptTime = 0;
+        walk->script = Q_rand(&walk->seed) & 0x7fffffff;
+        walk->cmd.rightmove = (signed char)((walk->script % 3 - 1) * 127);
+        walk->cmd.buttons = (walk->script & 8) ? BUTTON_ATTACK : 0;
+    }
+
+    walk->cmd.angles[YAW] += ANGLE2SHORT(((walk->script >> 4) % 61 - 30) * msec / 100.0f);
+    walk->cmd.angles[PITCH] = 0;
+    walk->cmd.forwardmove = 127;
+    walk->cmd.upmove = ((Q_rand(&walk->seed) & 0x7fffffff) % 40) ? 0 : 127;
+
+    *cmd = walk->cmd;
+    return msec;
+}
+
+/*
+==================
+MB_Checksum
+
+FNV-1a, folded over the whole player state after every move so any
+difference in collision or float handling shows up
+==================
+*/
+static unsigned MB_Checksum(unsigned hash, const void *data, int length)
+{
+    const byte *p = (const byte *)data;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static int MB_CompareInts(const void *a, const void *b) { return *(const int *)a - *(const int *)b; }
+
+/*
+==================
+MB_RunClass
+==================
+*/
+static void MB_RunClass(class_t klass, mbClassResult_t *result, int *samples)
+{
+    playerState_t ps;
+    pmoveExt_t pmext;
+    pmove_t pm;
+    mbWalk_t walk;
+    usercmd_t cmd;
+    vec3_t worldMins, worldMaxs;
+    int i, serverTime = 0;
+
+    CM_ModelBounds(CM_InlineModel(0), worldMins, worldMaxs);
+    MB_SpawnClass(klass, &ps, &pmext);
+
+    ::memset(result, 0, sizeof(*result));
+    ::memset(&walk, 0, sizeof(walk));
+    walk.seed = mb_options.seed;
+    result->klass = klass;
+    result->checksum = 2166136261u;
+    VectorCopy(ps.origin, result->start);
+
+    mb_stats.traces = mb_stats.pointContents = 0;
+    mb_stats.traceNsec = 0;
+
+    for (i = 0; i < mb_options.moves; i++)
+    {
+        int64_t start;
+
+        serverTime += MB_NextCommand(&walk, i, &cmd);
+        cmd.serverTime = serverTime;
+
+        // the same per-frame setup as ClientThink_real
+        pmext.fallVelocity = 0.0f;
+
+        ::memset(&pm, 0, sizeof(pm));
+        pm.ps = &ps;
+        pm.pmext = &pmext;
+        pm.cmd = cmd;
+        pm.tracemask = MASK_PLAYERSOLID;
+        pm.trace = MB_Trace;
+        pm.pointcontents = MB_PointContents;
+        pm.pmove_msec = 8;
+
+        start = MB_Nanoseconds();
+        Pmove(&pm);
+        samples[i] = (int)MIN(MB_Nanoseconds() - start, INT_MAX);
+        result->nsec += samples[i];
+
+        result->checksum = MB_Checksum(result->checksum, &ps, sizeof(ps));
+        result->checksum = MB_Checksum(result->checksum, &pmext, sizeof(pmext));
+
+        if (ps.origin[2] < worldMins[2])
+        {
+            // the walk found a hole, keep going from the spawn like a suicide would
+            MB_SpawnClass(klass, &ps, &pmext);
+            ps.commandTime = serverTime;
+            result->respawns++;
+        }
+    }
+
+    result->moves = mb_options.moves;
+    result->traces = mb_stats.traces;
+    result->pointContents = mb_stats.pointContents;
+    result->traceNsec = mb_stats.traceNsec;
+    VectorCopy(ps.origin, result->end);
+
+    qsort(samples, result->moves, sizeof(int), MB_CompareInts);
+    result->p50 = samples[result->moves * 50 / 100];
+    result->p90 = samples[result->moves * 90 / 100];
+    result->p99 = samples[result->moves * 99 / 100];
+    result->max = samples[result->moves - 1];
+}
+
+static int MB_CompareSites(const void *a, const void *b)
+{
+    const mbSite_t *sa = (const mbSite_t *)a;
+    const mbSite_t *sb = (const mbSite_t *)b;
+
+    if (sa->nsec != sb->nsec)
+    {
+        return sa->nsec < sb->nsec ? 1 : -1;
+    }
+
+    return sb->count - sa->count;
+}
+
+/*
+==================
+MB_WriteReport
+==================
+*/
+static void MB_WriteReport(const mbClassResult_t *results, int numResults)
+{
+    FILE *f = stdout;
+    int64_t nsec = 0;
+    int i, moves = 0, traces = 0;
+
+    if (mb_options.output[0])
+    {
+        f = fopen(mb_options.output, "w");
+        if (!f)
+        {
+            Com_Error(ERR_FATAL, "Couldn't write %s", mb_options.output);
+        }
+    }
+
+    for (i = 0; i < numResults; i++)
+    {
+        moves += results[i].moves;
+        traces += results[i].traces;
+        nsec += results[i].nsec;
+    }
+    nsec = MAX(nsec, 1);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"map\": \"%s\",\n", mb_options.map);
+    fprintf(f, "  \"commands\": \"%s\",\n", mb_scriptLength ? mb_options.cmdFile : "walk");
+    fprintf(f, "  \"seed\": %d,\n", mb_options.seed);
+    fprintf(f, "  \"moves\": %d,\n", moves);
+    fprintf(f, "  \"moves_per_sec\": %.0f,\n", moves * 1e9 / nsec);
+    fprintf(f, "  \"traces_per_move\": %.3f,\n", (double)traces / MAX(moves, 1));
+
+    fprintf(f, "  \"classes\": [\n");
+    for (i = 0; i < numResults; i++)
+    {
+        const mbClassResult_t *r = &results[i];
+
+        fprintf(f,
+            "    { \"class\": \"%s\", \"moves\": %d, \"moves_per_sec\": %.0f, \"traces_per_move\": %.3f, "
+            "\"pointcontents_per_move\": %.3f,",
+            BG_Class(r->klass)->name, r->moves, r->moves * 1e9 / MAX(r->nsec, 1), (double)r->traces / r->moves,
+            (double)r->pointContents / r->moves);
+        if (mb_options.profile)
+        {
+            fprintf(f, " \"trace_time_fraction\": %.3f,", (double)r->traceNsec / MAX(r->nsec, 1));
+        }
+        fprintf(f,
+            " \"move_nsec\": { \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d }, "
+            "\"start\": [ %.1f, %.1f, %.1f ], \"end\": [ %.1f, %.1f, %.1f ], \"respawns\": %d, \"checksum\": \"%08x\" }%s\n",
+            r->p50, r->p90, r->p99, r->max, r->start[0], r->start[1], r->start[2], r->end[0], r->end[1], r->end[2],
+            r->respawns, r->checksum, i + 1 < numResults ? "," : "");
+    }
+    fprintf(f, "  ]%s\n", mb_options.profile ? "," : "");
+
+    if (mb_options.profile)
+    {
+        char name[MAX_QPATH];
+
+        qsort(mb_stats.sites, mb_stats.numSites, sizeof(mbSite_t), MB_CompareSites);
+
+        fprintf(f, "  \"trace_sites\": [\n");
+        for (i = 0; i < mb_stats.numSites; i++)
+        {
+            const mbSite_t *site = &mb_stats.sites[i];
+
+            fprintf(f, "    { \"site\": \"%s\", \"traces\": %d, \"per_move\": %.3f, \"nsec\": %lld }%s\n",
+                MB_SymbolForAddress(site->address, name, sizeof(name)), site->count, (double)site->count / moves,
+                (long long)site->nsec, i + 1 < mb_stats.numSites ? "," : "");
+        }
+        fprintf(f, "  ]\n");
+    }
+
+    fprintf(f, "}\n");
+
+    if (f != stdout)
+    {
+        fclose(f);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static mbClassResult_t results[PCL_NUM_CLASSES];
+    char map[MAX_QPATH];
+    int *samples;
+    int i, checksum, classes = 0, numResults = 0;
+
+    MB_ParseArgs(argc, argv);
+
+    // class speeds and bounding boxes come from configs/classes/ in the base dirs
+    BG_InitMemory();
+    BG_InitClassConfigs();
+
+    for (i = 0; i < mb_options.numClassNames; i++)
+    {
+        class_t klass = BG_ClassByName(mb_options.classNames[i])->number;
+
+        if (klass == PCL_NONE)
+        {
+            Com_Printf("unknown class \"%s\"\n", mb_options.classNames[i]);
+            MB_Usage();
+        }
+        classes |= 1 << klass;
+    }
+
+    if (mb_options.cmdFile[0] && !MB_LoadScript(mb_options.cmdFile))
+    {
+        return 1;
+    }
+
+    if (strchr(mb_options.map, '/') || COM_CompareExtension(mb_options.map, ".bsp"))
+    {
+        Q_strncpyz(map, mb_options.map, sizeof(map));
+    }
+    else
+    {
+        Com_sprintf(map, sizeof(map), "maps/%s.bsp", mb_options.map);
+    }
+    CM_LoadMap(map, false, &checksum);
+
+    samples = (int *)malloc(mb_options.moves * sizeof(int));
+
+    for (i = PCL_ALIEN_BUILDER0; i < PCL_NUM_CLASSES; i++)
+    {
+        if (classes && !(classes & (1 << i)))
+        {
+            continue;
+        }
+
+        MB_RunClass((class_t)i, &results[numResults], samples);
+        Com_DPrintf("%s: %d moves, %08x\n", BG_Class((class_t)i)->name, results[numResults].moves,
+            results[numResults].checksum);
+        numResults++;
+    }
+
+    MB_WriteReport(results, numResults);
+
+    free(samples);
+    return 0;
+}
@@ -75,6 +75,7 @@ cvar_t *com_dedicated;
 cvar_t *com_timescale;
 cvar_t *com_fixedtime;
 cvar_t *com_journal;
+cvar_t *com_replay;
 cvar_t *com_maxfps;
 cvar_t *com_altivec;
 cvar_t *com_timedemo;
@@ -107,6 +108,7 @@ cvar_t *com_legacyprotocol;
 cvar_t *com_basegame;
 cvar_t *com_homepath;
 cvar_t *com_busyWait;
+cvar_t *com_fieldStats;
 
 #if id386
 void (QDECL *Q_SnapVector)(vec3_t vec);
@@ -464,6 +466,44 @@ void Com_Colors_f(void) {
 }
 
 
+/*
+==============
+Com_WriteNetFieldTables
+==============
+*/
+static void Com_WriteNetFieldTables(const char *name)
+{
+    static char buf[32768];
+    int len = MSG_NetFieldTables(buf, sizeof(buf));
+
+    FS_WriteFile(name, buf, len);
+    Com_Printf("wrote profiled field tables to %s\n", name);
+}
+
+/*
+==============
+Com_ChangeVectors_f
+
+"changeVectors <file>" also writes the profiled field tables for
+msg_netfields.h picked from the deltas so far
+==============
+*/
+static void Com_ChangeVectors_f(void)
+{
+    if (!msg_countFields)
+    {
+        Com_Printf("set com_fieldStats 1 to count the deltas\n");
+    }
+
+    MSG_ReportChangeVectors_f();
+
+    if (Cmd_Argc() > 1)
+    {
+        Com_WriteNetFieldTables(Cmd_Argv(1));
+    }
+}
+
+
 /*
 =============
 Com_Quit_f
@@ -2043,15 +2083,37 @@ static int com_pushedEventsHead = 0;
 static int com_pushedEventsTail = 0;
 static sysEvent_t com_pushedEvents[MAX_PUSHED_EVENTS];
 
+// sv_replay statistics
+static int          com_replayStartTime;  // real msec when the replay started
+static int          com_replayFirstEvent = -1;  // journaled msec of the first event
+static int          com_replayLastEvent;
+static int          com_replayPacketsIn;
+static int          com_replayPacketsOut;
+static uint64_t     com_replayHash = 14695981039346656037ULL;  // FNV-1a over all outbound packets
+
 /*
 =================
 Com_InitJournaling
+
+The journal starts with the seed for rand() so a replayed server hands out
+the same challenges and checksum feeds, server packets are journaled as
+SE_PACKET events in between the system events
 =================
 */
 void Com_InitJournaling( void )
 {
+    unsigned int seed;
+
     Com_StartupVariable( "journal" );
+    Com_StartupVariable( "sv_replay" );
     com_journal = Cvar_Get ("journal", "0", CVAR_INIT);
+    com_replay = Cvar_Get ("sv_replay", "0", CVAR_INIT);
+
+    // sv_replay is a journal replay that doesn't wait for real time
+    if ( com_replay->integer && com_journal->integer != 2 ) {
+        com_journal = Cvar_Set2( "journal", "2", true );
+    }
+
     if ( !com_journal->integer ) {
         return;
     }
@@ -2067,11 +2129,147 @@ void Com_InitJournaling( void )
     }
 
     if ( !com_journalFile || !com_journalDataFile ) {
-        Cvar_Set( "com_journal", "0" );
+        Cvar_Set2( "journal", "0", true );
+        Cvar_Set2( "sv_replay", "0", true );
         com_journalFile = 0;
         com_journalDataFile = 0;
         Com_Printf( "Couldn't open journal files\n" );
+        return;
     }
+
+    if ( com_journal->integer == 1 ) {
+        if ( !Sys_RandomBytes( (byte *)&seed, sizeof( seed ) ) )
+            seed = time( NULL );
+
+        if ( FS_Write( &seed, sizeof( seed ), com_journalFile ) != sizeof( seed ) )
+            Com_Error( ERR_FATAL, "Error writing to journal file" );
+    } else {
+        if ( FS_Read( &seed, sizeof( seed ), com_journalFile ) != sizeof( seed ) )
+            Com_Error( ERR_FATAL, "Error reading from journal file" );
+    }
+
+    srand( seed );
+    com_replayStartTime = Sys_Milliseconds();
+}
+
+/*
+=================
+Com_JournalPacket
+
+Records a packet from the network so sv_replay can feed it back through
+SV_PacketEvent at the same point of the event stream
+=================
+*/
+static void Com_JournalPacket( const netadr_t *from, const msg_t *msg )
+{
+    sysEvent_t ev;
+
+    ::memset( &ev, 0, sizeof( ev ) );
+    ev.evTime = Sys_Milliseconds();
+    ev.evType = SE_PACKET;
+    ev.evValue = msg->cursize;
+    ev.evPtrLength = sizeof( *from ) + msg->cursize;
+
+    if ( FS_Write( &ev, sizeof( ev ), com_journalFile ) != sizeof( ev ) ||
+         FS_Write( from, sizeof( *from ), com_journalFile ) != sizeof( *from ) ||
+         FS_Write( msg->data, msg->cursize, com_journalFile ) != msg->cursize )
+        Com_Error( ERR_FATAL, "Error writing to journal file" );
+}
+
+/*
+=================
+Com_NetMilliseconds
+
+Clock for rate control and flood protection. During sv_replay real time
+runs far ahead of the journal, so the journaled frame time is used
+instead, and while recording too so both runs see the same clock
+=================
+*/
+int Com_NetMilliseconds( void )
+{
+    if ( com_journal && com_journal->integer )
+        return com_frameTime;
+
+    return Sys_Milliseconds();
+}
+
+/*
+=================
+Com_JournalRandomBytes
+
+Cryptographic random bytes that a replay has to reproduce, written to the
+journal data file when journaling and read back from it on playback
+=================
+*/
+void Com_JournalRandomBytes( byte *buf, int len )
+{
+    int length;
+
+    if ( com_journal && com_journal->integer == 2 && com_journalDataFile )
+    {
+        if ( FS_Read( &length, sizeof( length ), com_journalDataFile ) != sizeof( length ) ||
+             length != len || FS_Read( buf, len, com_journalDataFile ) != len )
+            Com_Error( ERR_FATAL, "Error reading random bytes from journal file" );
+        return;
+    }
+
+    Sys_CryptoRandomBytes( buf, len );
+
+    if ( com_journal && com_journal->integer == 1 && com_journalDataFile )
+    {
+        if ( FS_Write( &len, sizeof( len ), com_journalDataFile ) != sizeof( len ) ||
+             FS_Write( buf, len, com_journalDataFile ) != len )
+            Com_Error( ERR_FATAL, "Error writing to journal file" );
+        FS_Flush( com_journalDataFile );
+    }
+}
+
+/*
+=================
+Com_ReplayOutboundPacket
+
+During sv_replay nothing goes out on the wire, every outbound packet is
+folded into a hash instead so two builds can be compared
+=================
+*/
+void Com_ReplayOutboundPacket( int length, const void *data, netadr_t to )
+{
+    const byte *p = (const byte *)data;
+    int i;
+
+    com_replayHash ^= (uint64_t)( to.port ^ ( to.ip[ 3 ] << 16 ) );
+    com_replayHash *= 1099511628211ULL;
+
+    for ( i = 0; i < length; i++ )
+    {
+        com_replayHash ^= p[ i ];
+        com_replayHash *= 1099511628211ULL;
+    }
+
+    com_replayPacketsOut++;
+}
+
+/*
+=================
+Com_ReplayReport
+=================
+*/
+static void Com_ReplayReport( void )
+{
+    int realMsec = Sys_Milliseconds() - com_replayStartTime;
+
+    // a recorded rcon quit would swallow the report
+    Com_EndRedirect();
+
+    Com_Printf( "replay: %d packets in, %d packets out, %d msec of game time in %d msec\n",
+        com_replayPacketsIn, com_replayPacketsOut,
+        com_replayFirstEvent < 0 ? 0 : com_replayLastEvent - com_replayFirstEvent, realMsec );
+    Com_Printf( "replay: outbound hash %08x%08x\n",
+        (unsigned int)( com_replayHash >> 32 ), (unsigned int)com_replayHash );
+
+    // the deltas of a recorded session make the profiled field tables
+    if ( Cvar_VariableString( "sv_replayFieldTables" )[ 0 ] )
+        Com_WriteNetFieldTables( Cvar_VariableString( "sv_replayFieldTables" ) );
 }
 
 /*
@@ -2202,7 +2400,17 @@ sysEvent_t Com_GetRealEvent( void )
     {
         int r = FS_Read( &ev, sizeof(ev), com_journalFile );
         if ( r != sizeof(ev) )
+        {
+            // the capture ended without a quit, Com_Shutdown prints the report
+            if ( com_replay->integer )
+                Engine_Exit( "" );
+
             Com_Error( ERR_FATAL, "Error reading from journal file" );
+        }
+
+        if ( com_replayFirstEvent < 0 )
+            com_replayFirstEvent = ev.evTime;
+        com_replayLastEvent = ev.evTime;
 
         if ( ev.evPtrLength )
         {
@@ -2309,6 +2517,10 @@ Com_RunAndTimeServerPacket
 void Com_RunAndTimeServerPacket( netadr_t *evFrom, msg_t *buf )
 {
     int t1 = 0;
+
+    if ( com_journal->integer == 1 && evFrom->type != NA_LOOPBACK )
+        Com_JournalPacket( evFrom, buf );
+
     if ( com_speeds->integer )
         t1 = Sys_Milliseconds();
 
@@ -2376,6 +2588,21 @@ int Com_EventLoop(void)
                 Cbuf_AddText( (char *)ev.evPtr );
                 Cbuf_AddText( "\n" );
                 break;
+            case SE_PACKET:
+                if ( ev.evValue < 0 || ev.evValue > buf.maxsize ||
+                     ev.evPtrLength != (int)sizeof( evFrom ) + ev.evValue )
+                    Com_Error( ERR_FATAL, "Com_EventLoop: bad journaled packet" );
+
+                ::memcpy( &evFrom, ev.evPtr, sizeof( evFrom ) );
+                ::memcpy( buf.data, (byte *)ev.evPtr + sizeof( evFrom ), ev.evValue );
+                buf.cursize = ev.evValue;
+                buf.readcount = 0;
+                buf.bit = 0;
+
+                com_replayPacketsIn++;
+                if ( com_sv_running->integer )
+                    Com_RunAndTimeServerPacket( &evFrom, &buf );
+                break;
             default:
                 Com_Error( ERR_FATAL, "Com_EventLoop: bad event type %i", ev.evType );
                 break;
@@ -2705,7 +2932,7 @@ void Com_Init( char *commandLine )
     }
     Cmd_AddCommand ("quit", Com_Quit_f);
     Cmd_AddCommand ("colors", Com_Colors_f);
-    Cmd_AddCommand ("changeVectors", MSG_ReportChangeVectors_f );
+    Cmd_AddCommand ("changeVectors", Com_ChangeVectors_f );
     Cmd_AddCommand ("writeconfig", Com_WriteConfig_f );
     Cmd_SetCommandCompletionFunc( "writeconfig", Cmd_CompleteCfgName );
     Cmd_AddCommand("game_restart", Com_GameRestart_f);
@@ -2759,6 +2986,12 @@ void Com_Init( char *commandLine )
     com_minimized = Cvar_Get( "com_minimized", "0", CVAR_ROM );
     com_maxfpsMinimized = Cvar_Get( "com_maxfpsMinimized", "0", CVAR_ARCHIVE );
     com_busyWait = Cvar_Get("com_busyWait", "0", CVAR_ARCHIVE);
+    com_fieldStats = Cvar_Get("com_fieldStats", "0", 0);
+    // replaying a journal for the profiled field tables needs the statistics
+    if (Cvar_VariableString("sv_replayFieldTables")[0])
+    {
+        Cvar_Set("com_fieldStats", "1");
+    }
     Cvar_Get("com_errorMessage", "", CVAR_ROM | CVAR_NORESTART);
     Cvar_Get("com_demoErrorMessage", "", CVAR_ROM | CVAR_NORESTART);
 
@@ -3044,6 +3277,8 @@ void Com_Frame( void )
     // write config file if anything changed
     Com_WriteConfiguration();
 
+    msg_countFields = com_fieldStats->integer != 0;
+
     //
     // main event loop
     //
@@ -3084,25 +3319,34 @@ void Com_Frame( void )
         minMsec = 1;
     }
 
-    do {
+    // a replay takes both its clock and its packets from the journal
+    if ( com_replay->integer )
+    {
         if ( com_sv_running->integer )
-        {
-            timeValSV = SV_SendQueuedPackets();
-            timeVal = Com_TimeVal(minMsec);
+            SV_SendQueuedPackets();
+    }
+    else
+    {
+        do {
+            if ( com_sv_running->integer )
+            {
+                timeValSV = SV_SendQueuedPackets();
+                timeVal = Com_TimeVal(minMsec);
 
-            if ( timeValSV < timeVal )
-                timeVal = timeValSV;
-        }
-        else
-        {
-            timeVal = Com_TimeVal(minMsec);
-        }
+                if ( timeValSV < timeVal )
+                    timeVal = timeValSV;
+            }
+            else
+            {
+                timeVal = Com_TimeVal(minMsec);
+            }
 
-        if ( com_busyWait->integer || timeVal < 1 )
-            NET_Sleep(0);
-        else
-            NET_Sleep(timeVal - 1);
-    } while( Com_TimeVal(minMsec) );
+            if ( com_busyWait->integer || timeVal < 1 )
+                NET_Sleep(0);
+            else
+                NET_Sleep(timeVal - 1);
+        } while( Com_TimeVal(minMsec) );
+    }
 
     IN_Frame();
 
@@ -3228,6 +3472,9 @@ Com_Shutdown
 */
 void Com_Shutdown(void)
 {
+    if ( com_replay && com_replay->integer )
+        Com_ReplayReport();
+
     if (logfile)
     {
         FS_FCloseFile (logfile);
@@ -0,0 +1,247 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// deflate.cpp -- small deflate encoder, the bundled zlib only has inflate
+//
+// Everything goes into a single block with the fixed Huffman codes and the
+// matches come from hash chains over the whole input, which is plenty for
+// the few kilobytes of text it is used on
+
+#include "deflate.h"
+
+#include "qcommon.h"
+
+#define DEFLATE_WINDOW      32768
+#define DEFLATE_MIN_MATCH   3
+#define DEFLATE_MAX_MATCH   258
+#define DEFLATE_MAX_CHAIN   64
+#define DEFLATE_HASH_BITS   13
+#define DEFLATE_HASH_SIZE   (1 << DEFLATE_HASH_BITS)
+
+static const short lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83,
+    99, 115, 131, 163, 195, 227, 258};
+static const byte lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const short distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const byte distExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+struct deflateState_t {
+    byte *out;
+    int outSize;
+    int pos;
+    uint32_t bits;
+    int numBits;
+    bool overflow;
+};
+
+/*
+==================
+Deflate_PutBits
+
+Deflate packs its bit fields starting at the least significant bit
+==================
+*/
+static void Deflate_PutBits(deflateState_t *s, uint32_t value, int numBits)
+{
+    s->bits |= value << s->numBits;
+    s->numBits += numBits;
+
+    while (s->numBits >= 8)
+    {
+        if (s->pos < s->outSize)
+        {
+            s->out[s->pos++] = s->bits & 0xff;
+        }
+        else
+        {
+            s->overflow = true;
+        }
+        s->bits >>= 8;
+        s->numBits -= 8;
+    }
+}
+
+/*
+==================
+Deflate_PutCode
+
+Huffman codes are the exception and go out most significant bit first
+==================
+*/
+static void Deflate_PutCode(deflateState_t *s, int code, int length)
+{
+    uint32_t reversed = 0;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+
+    Deflate_PutBits(s, reversed, length);
+}
+
+/*
+==================
+Deflate_PutSymbol
+
+One literal/length symbol with the fixed code of RFC 1951 3.2.6
+==================
+*/
+static void Deflate_PutSymbol(deflateState_t *s, int symbol)
+{
+    if (symbol < 144)
+    {
+        Deflate_PutCode(s, 0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        Deflate_PutCode(s, 0x190 + symbol - 144, 9);
+    }
+    else if (symbol < 280)
+    {
+        Deflate_PutCode(s, symbol - 256, 7);
+    }
+    else
+    {
+        Deflate_PutCode(s, 0xc0 + symbol - 280, 8);
+    }
+}
+
+/*
+==================
+Deflate_PutMatch
+==================
+*/
+static void Deflate_PutMatch(deflateState_t *s, int length, int distance)
+{
+    int code;
+
+    for (code = ARRAY_LEN(lengthBase) - 1; lengthBase[code] > length; code--)
+        ;
+    Deflate_PutSymbol(s, 257 + code);
+    Deflate_PutBits(s, length - lengthBase[code], lengthExtra[code]);
+
+    for (code = ARRAY_LEN(distBase) - 1; distBase[code] > distance; code--)
+        ;
+    Deflate_PutCode(s, code, 5);
+    Deflate_PutBits(s, distance - distBase[code], distExtra[code]);
+}
+
+static int Deflate_Hash(const byte *p) { return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (DEFLATE_HASH_SIZE - 1); }
+
+/*
+==================
+Com_Deflate
+==================
+*/
+int Com_Deflate(const byte *in, int inLength, byte *out, int outSize)
+{
+    deflateState_t s;
+    int *head, *prev;
+    int i, j;
+
+    ::memset(&s, 0, sizeof(s));
+    s.out = out;
+    s.outSize = outSize;
+
+    head = (int *)Z_Malloc(DEFLATE_HASH_SIZE * sizeof(int));
+    prev = (int *)Z_Malloc(MAX(inLength, 1) * sizeof(int));
+    for (i = 0; i < DEFLATE_HASH_SIZE; i++)
+    {
+        head[i] = -1;
+    }
+
+    // BFINAL, BTYPE 01 for the fixed codes
+    Deflate_PutBits(&s, 1, 1);
+    Deflate_PutBits(&s, 1, 2);
+
+    for (i = 0; i < inLength && !s.overflow;)
+    {
+        int bestLength = 0, bestDistance = 0;
+
+        if (i + DEFLATE_MIN_MATCH <= inLength)
+        {
+            int hash = Deflate_Hash(in + i);
+            int maxLength = MIN(DEFLATE_MAX_MATCH, inLength - i);
+            int chain = 0;
+
+            for (j = head[hash]; j >= 0 && i - j <= DEFLATE_WINDOW && chain < DEFLATE_MAX_CHAIN; j = prev[j], chain++)
+            {
+                int length = 0;
+
+                while (length < maxLength && in[j + length] == in[i + length])
+                {
+                    length++;
+                }
+
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestDistance = i - j;
+
+                    if (length == maxLength)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            prev[i] = head[hash];
+            head[hash] = i;
+        }
+
+        if (bestLength < DEFLATE_MIN_MATCH)
+        {
+            Deflate_PutSymbol(&s, in[i]);
+            i++;
+            continue;
+        }
+
+        Deflate_PutMatch(&s, bestLength, bestDistance);
+
+        // the skipped positions still have to be found by later matches
+        for (j = i + 1; j < i + bestLength; j++)
+        {
+            if (j + DEFLATE_MIN_MATCH <= inLength)
+            {
+                int hash = Deflate_Hash(in + j);
+
+                prev[j] = head[hash];
+                head[hash] = j;
+            }
+        }
+        i += bestLength;
+    }
+
+    // end of block, then pad out the last byte
+    Deflate_PutSymbol(&s, 256);
+    Deflate_PutBits(&s, 0, 7);
+
+    Z_Free(prev);
+    Z_Free(head);
+
+    return s.overflow ? -1 : s.pos;
+}
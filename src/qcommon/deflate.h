@@ -0,0 +1,35 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+
+#ifndef QCOMMON_DEFLATE_H
+#define QCOMMON_DEFLATE_H 1
+
+#include "q_shared.h"
+
+// Raw deflate (RFC 1951) stream of in, readable by zlib's inflate with
+// negative windowBits or by puff. Returns the compressed length, or -1 if
+// it doesn't fit in outSize bytes
+int Com_Deflate(const byte *in, int inLength, byte *out, int outSize);
+
+#endif
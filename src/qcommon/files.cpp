@@ -603,6 +603,40 @@ bool FS_FileExists(const char *file)
     return FS_FileInPathExists(FS_BuildOSPath(fs_homepath->string, fs_gamedir, file));
 }
 
+/*
+================
+FS_MapHomeFile
+
+Maps a file the engine wrote to the current gamedir in fs_homepath.
+Like FS_FileExists this DOES NOT search the paths, so it is not subject
+to sv_pure; only use it for caches of data that is already verified.
+A mapped file counts as just used for FS_PruneHomeDir.
+================
+*/
+void *FS_MapHomeFile(const char *qpath, int *length)
+{
+    char *ospath;
+    void *data;
+
+    if (!fs_searchpaths) Com_Error(ERR_FATAL, "Filesystem call made without initialization");
+
+    ospath = FS_BuildOSPath(fs_homepath->string, fs_gamedir, qpath);
+    data = Sys_MapFile(ospath, length);
+    if (data)
+    {
+        Sys_TouchFile(ospath);
+    }
+
+    return data;
+}
+
+/*
+================
+FS_UnmapHomeFile
+================
+*/
+void FS_UnmapHomeFile(void *data, int length) { Sys_UnmapFile(data, length); }
+
 /*
 ================
 FS_SV_FileExists
@@ -1692,6 +1726,65 @@ int FS_FileIsInPAK(const char *filename, int *pChecksum)
 {
     return FS_FileIsInPAK_A(false, filename, pChecksum);
 }
+
+/*
+================
+FS_PakFileChecksum
+
+Resolves filename the way FS_ReadFile would and, if it comes from a pk3,
+returns 1 with the content checksum of that pk3.  Unlike pure_checksum
+this does not change with the server's checksum feed, so it can key data
+cached across sessions.  The pk3 is referenced as if the file had been
+read, since the caller is going to use its cached copy instead.
+Returns -1 if the file is missing or would be loaded from a directory.
+================
+*/
+int FS_PakFileChecksum(const char *filename, int *pChecksum)
+{
+    if (!fs_searchpaths)
+        Com_Error(ERR_FATAL, "Filesystem call made without initialization");
+
+    if (!filename)
+        Com_Error(ERR_FATAL, "FS_PakFileChecksum: nullptr 'filename' parameter passed");
+
+    // qpaths are not supposed to have a leading slash
+    if (filename[0] == '/' || filename[0] == '\\')
+        filename++;
+
+    if (strstr(filename, "..") || strstr(filename, "::"))
+        return -1;
+
+    for (auto search = fs_searchpaths; search; search = search->next)
+    {
+        if (search->pack)
+        {
+            pack_t *pak = search->pack;
+
+            // FS_FOpenFileReadDir moves on past unpure pk3s as well
+            if (!pak->is_pure() || !pak->find(filename))
+                continue;
+
+            if (!strstr(filename, "levelshots"))
+                pak->referenced |= FS_GENERAL_REF;
+
+            if (pChecksum)
+                *pChecksum = pak->checksum;
+
+            return 1;
+        }
+        else if (search->dir)
+        {
+            // loose files are not loaded on pure servers
+            if (fs_numServerPaks)
+                continue;
+
+            if (FS_FileInPathExists(FS_BuildOSPath(search->dir->path, search->dir->gamedir, filename)))
+                return -1;
+        }
+    }
+
+    return -1;
+}
 /*
 ============
 FS_ReadFileDir
@@ -2319,6 +2412,95 @@ void FS_FreeFileList(char **list)
     Z_Free(list);
 }
 
+typedef struct {
+    const char *name;
+    int64_t size;
+    int64_t mtime;
+} homeDirFile_t;
+
+static int FS_CompareHomeDirFiles(const void *a, const void *b)
+{
+    const homeDirFile_t *fa = (const homeDirFile_t *)a;
+    const homeDirFile_t *fb = (const homeDirFile_t *)b;
+
+    if (fa->mtime != fb->mtime)
+    {
+        return fa->mtime < fb->mtime ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/*
+=================
+FS_PruneHomeDir
+
+Removes the least recently written or mapped files with extension from
+a directory of the current gamedir in fs_homepath, until the rest take
+no more than maxBytes.  A listing stops at MAX_FOUND_FILES, so a full
+one loses its oldest quarter as well, to keep the directory listable.
+=================
+*/
+void FS_PruneHomeDir(const char *path, const char *extension, int64_t maxBytes)
+{
+    char dir[MAX_OSPATH];
+    char **names;
+    homeDirFile_t *files;
+    int numNames, numFiles, numRemoved;
+    int64_t total = 0;
+    bool full;
+
+    if (!fs_searchpaths)
+    {
+        Com_Error(ERR_FATAL, "Filesystem call made without initialization");
+    }
+
+    Q_strncpyz(dir, FS_BuildOSPath(fs_homepath->string, fs_gamedir, path), sizeof(dir));
+    names = Sys_ListFiles(dir, extension, nullptr, &numNames, false);
+    if (!names)
+    {
+        return;
+    }
+
+    files = (homeDirFile_t *)Z_Malloc(numNames * sizeof(*files));
+    numFiles = 0;
+    for (int i = 0; i < numNames; i++)
+    {
+        homeDirFile_t *file = &files[numFiles];
+
+        if (!Sys_StatFile(va("%s%c%s", dir, PATH_SEP, names[i]), &file->size, &file->mtime))
+        {
+            continue;
+        }
+
+        file->name = names[i];
+        total += file->size;
+        numFiles++;
+    }
+
+    qsort(files, numFiles, sizeof(*files), FS_CompareHomeDirFiles);
+
+    full = numNames >= MAX_FOUND_FILES - 1;
+    for (numRemoved = 0; numRemoved < numFiles; numRemoved++)
+    {
+        if (total <= maxBytes && !(full && numRemoved < numFiles / 4))
+        {
+            break;
+        }
+
+        FS_HomeRemove(va("%s/%s", path, files[numRemoved].name));
+        total -= files[numRemoved].size;
+    }
+
+    if (numRemoved)
+    {
+        Com_DPrintf("FS_PruneHomeDir: removed %d files from %s, %d KB left\n", numRemoved, path, (int)(total >> 10));
+    }
+
+    Z_Free(files);
+    Sys_FreeFileList(names);
+}
+
 /*
 ================
 FS_GetFileList
@@ -229,8 +229,12 @@ void         FS_FreeFile (void* buffer);
 long         FS_ReadFile (const char* qpath, void** buffer);
 void         FS_Flush (fileHandle_t f);
 long         FS_ReadFileDir (const char* qpath, void* searchPath, bool unpure, void** buffer);
+void*        FS_MapHomeFile (const char* qpath, int* length);
+void         FS_UnmapHomeFile (void* data, int length);
+void         FS_PruneHomeDir (const char* path, const char* extension, int64_t maxBytes);
 int          FS_FileIsInPAK_A(bool alternate, const char *filename, int *pChecksum);
 int          FS_FileIsInPAK (const char* filename, int* pChecksum);
+int          FS_PakFileChecksum (const char* filename, int* pChecksum);
 int          FS_FTell (fileHandle_t f);
 int          FS_Seek (fileHandle_t f, long offset, enum FS_Origin origin);
 void QDECL   FS_Printf (fileHandle_t h, const char* fmt, ...);
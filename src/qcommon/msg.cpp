@@ -34,8 +34,6 @@ static huffman_t msgHuff;
 
 static bool msgInit = false;
 
-int pcount[256];
-
 /*
 ==============================================================================
 
@@ -394,6 +392,70 @@ static void MSG_WriteString2(msg_t *sb, const char *s, int maxsize)
 
 void MSG_WriteString(msg_t *sb, const char *s) { MSG_WriteString2(sb, s, MAX_STRING_CHARS); }
 void MSG_WriteBigString(msg_t *sb, const char *s) { MSG_WriteString2(sb, s, BIG_INFO_STRING); }
+
+// appends bits that were written to another msg_t, so data encoded once can
+// go into many messages. The Huffman code does not adapt, so the bits don't
+// depend on where they land
+void MSG_WriteHuffmanBits(msg_t *msg, const uint8_t *bits, int numBits)
+{
+    int bytes = (numBits + 7) >> 3;
+    int shift = msg->bit & 7;
+    uint8_t *out = msg->data + (msg->bit >> 3);
+
+    if (msg->overflowed)
+    {
+        return;
+    }
+
+    if (msg->oob)
+    {
+        Com_Error(ERR_DROP, "MSG_WriteHuffmanBits: out of band message");
+    }
+
+    // the shifted copy below touches one byte past the last bit
+    if (msg->bit + numBits + 8 > msg->maxsize << 3)
+    {
+        msg->overflowed = true;
+        return;
+    }
+
+    oldsize += numBits;
+
+    // bits past msg->bit are never set, as Huff_putBit clears each byte
+    // it starts
+    if (!shift)
+    {
+        ::memcpy(out, bits, bytes);
+    }
+    else
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            out[i] |= bits[i] << shift;
+            out[i + 1] = bits[i] >> (8 - shift);
+        }
+    }
+
+    msg->bit += numBits;
+    msg->cursize = (msg->bit >> 3) + 1;
+}
+
+// drops everything written to a Huffman message after bit, so it can be
+// written again differently
+void MSG_Rewind(msg_t *msg, int bit)
+{
+    if (msg->oob)
+    {
+        Com_Error(ERR_DROP, "MSG_Rewind: out of band message");
+    }
+
+    msg->bit = bit;
+    msg->cursize = (bit >> 3) + 1;
+    msg->overflowed = false;
+
+    // keep bits past msg->bit clear for MSG_WriteHuffmanBits
+    msg->data[bit >> 3] &= (1 << (bit & 7)) - 1;
+}
 void MSG_WriteAngle(msg_t *sb, float f) { MSG_WriteByte(sb, (int)(f * 256 / 360) & 255); }
 void MSG_WriteAngle16(msg_t *sb, float f) { MSG_WriteShort(sb, ANGLE2SHORT(f)); }
 //============================================================
@@ -796,29 +858,11 @@ entityState_t communication
 =============================================================================
 */
 
-/*
-=================
-MSG_ReportChangeVectors_f
-
-Prints out a table from the current statistics for copying to code
-=================
-*/
-void MSG_ReportChangeVectors_f(void)
-{
-    int i;
-    for (i = 0; i < 256; i++)
-    {
-        if (pcount[i])
-        {
-            Com_Printf("%d used %d\n", i, pcount[i]);
-        }
-    }
-}
-
 typedef struct {
     const char *name;
     size_t offset;
     int bits;  // 0 = float
+    int smallBits;  // profiled tables only, integers that fit go in this many bits behind a 0 bit
 } netField_t;
 
 // using the stringizing operator to save typing...
@@ -884,6 +928,249 @@ netField_t entityStateFields[] = {
 #define FLOAT_INT_BITS 13
 #define FLOAT_INT_BIAS (1 << (FLOAT_INT_BITS - 1))
 
+// using the stringizing operator to save typing...
+#define PSF(x) #x, (size_t) & ((playerState_t *) 0)->x
+
+// the fields of entityStateFields and playerStateFields in the order and
+// with the smallBits "changeVectors <file>" picked from a session, used
+// with MSG_PROFILED_FIELDS
+#include "msg_netfields.h"
+
+/*
+=============================================================================
+
+delta field statistics
+
+=============================================================================
+*/
+
+// how often each field changed in the deltas this process wrote or read,
+// indexed by the field's word in entityState_t or playerState_t
+typedef struct {
+    int changes;
+    int fullFloats;  // floats that needed all 32 bits
+    int valueBits[33];  // integers that went out, by the bits their value needs
+} netFieldStats_t;
+
+static netFieldStats_t entityFieldStats[sizeof(entityState_t) / 4];
+static netFieldStats_t playerFieldStats[sizeof(playerState_t) / 4];
+static int entityDeltas, playerDeltas;
+
+// only counted when asked for, the delta functions are hot on a busy server
+bool msg_countFields;
+
+/*
+=================
+MSG_ValueBits
+
+Bits an integer field value needs, counting the sign for signed fields
+=================
+*/
+static int MSG_ValueBits(const netField_t *field, int value)
+{
+    int bits = abs(field->bits);
+    unsigned int v;
+    int n;
+
+    if (field->bits < 0)
+    {
+        // what the receiver sees after sign extension from the field width
+        value = (int)((unsigned int)value << (32 - bits)) >> (32 - bits);
+        v = value < 0 ? ~value : value;
+        n = 1;
+    }
+    else
+    {
+        v = bits < 32 ? value & ((1u << bits) - 1) : value;
+        n = 0;
+    }
+
+    for (; v; v >>= 1)
+    {
+        n++;
+    }
+
+    return n;
+}
+
+static void MSG_CountField(netFieldStats_t *table, const netField_t *field, int value, bool zeroFlag)
+{
+    netFieldStats_t *stats = &table[field->offset / 4];
+
+    stats->changes++;
+
+    if (field->bits == 0)
+    {
+        float f = *(float *)&value;
+        int trunc = (int)f;
+
+        if (f != 0.0f && !(trunc == f && trunc + FLOAT_INT_BIAS >= 0 && trunc + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS)))
+        {
+            stats->fullFloats++;
+        }
+    }
+    else if (value || !zeroFlag)
+    {
+        stats->valueBits[MSG_ValueBits(field, value)]++;
+    }
+}
+
+/*
+=================
+MSG_WriteField / MSG_ReadField
+
+Integer field values, fields with smallBits send values that fit in
+those behind a 0 bit and the rest in full behind a 1 bit
+=================
+*/
+static void MSG_WriteField(msg_t *msg, const netField_t *field, int value)
+{
+    if (field->smallBits)
+    {
+        if (MSG_ValueBits(field, value) <= abs(field->smallBits))
+        {
+            MSG_WriteBits(msg, 0, 1);
+            MSG_WriteBits(msg, value, field->smallBits);
+            return;
+        }
+        MSG_WriteBits(msg, 1, 1);
+    }
+
+    MSG_WriteBits(msg, value, field->bits);
+}
+
+static int MSG_ReadField(msg_t *msg, const netField_t *field)
+{
+    if (field->smallBits && !MSG_ReadBits(msg, 1))
+    {
+        return MSG_ReadBits(msg, field->smallBits);
+    }
+
+    return MSG_ReadBits(msg, field->bits);
+}
+
+/*
+=================
+MSG_SmallBits
+
+Picks the smallBits that would have made the integers seen so far
+cheapest, 0 if sending them all in full is as good
+=================
+*/
+static int MSG_SmallBits(const netField_t *field, const netFieldStats_t *stats)
+{
+    int bits = abs(field->bits);
+    int64_t cost, bestCost, total;
+    int n, k, best;
+
+    total = 0;
+    for (k = 0; k <= 32; k++)
+    {
+        total += stats->valueBits[k];
+    }
+
+    if (field->bits == 0 || total < 16)
+    {
+        return 0;
+    }
+
+    best = 0;
+    bestCost = total * bits;
+    for (n = 1; n < bits; n++)
+    {
+        // MSG_ReadBits only sign extends whole bytes
+        if (field->bits < 0 && (n & 7))
+        {
+            continue;
+        }
+
+        cost = 0;
+        for (k = 0; k <= 32; k++)
+        {
+            cost += (int64_t)stats->valueBits[k] * (1 + (k <= n ? n : bits));
+        }
+
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            best = n;
+        }
+    }
+
+    return field->bits < 0 ? -best : best;
+}
+
+/*
+=================
+MSG_SortFields
+
+Field indexes of a table, most often changed first
+=================
+*/
+static void MSG_SortFields(const netField_t *fields, int numFields, const netFieldStats_t *table, int *order)
+{
+    int i, j, k;
+
+    for (i = 0; i < numFields; i++)
+    {
+        k = i;
+        for (j = i; j > 0 && table[fields[order[j - 1]].offset / 4].changes < table[fields[k].offset / 4].changes; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = k;
+    }
+}
+
+static void MSG_ReportFields(const char *title, const netField_t *fields, int numFields, const netFieldStats_t *table, int deltas)
+{
+    int order[MAX_GENTITIES];
+    const netFieldStats_t *stats;
+    int i;
+
+    MSG_SortFields(fields, numFields, table, order);
+
+    Com_Printf("%s, %d deltas:\n", title, deltas);
+    for (i = 0; i < numFields; i++)
+    {
+        stats = &table[fields[order[i]].offset / 4];
+        if (!stats->changes)
+        {
+            break;
+        }
+
+        Com_Printf("%6.2f%% %-20s %d changes", 100.0f * stats->changes / MAX(deltas, 1), fields[order[i]].name,
+            stats->changes);
+        if (stats->fullFloats)
+        {
+            Com_Printf(", %d full floats", stats->fullFloats);
+        }
+        Com_Printf("\n");
+    }
+}
+
+static int MSG_PrintFieldTable(char *buf, int size, const char *name, const char *macro, const netField_t *fields,
+    int numFields, const netFieldStats_t *table, int deltas)
+{
+    int order[MAX_GENTITIES];
+    const netFieldStats_t *stats;
+    int i, len;
+
+    MSG_SortFields(fields, numFields, table, order);
+
+    len = Com_sprintf(buf, size, "netField_t %s[] = {\n", name);
+    for (i = 0; i < numFields; i++)
+    {
+        stats = &table[fields[order[i]].offset / 4];
+        len += Com_sprintf(buf + len, size - len, "    {%s(%s), %d, %d},  // %.2f%%\n", macro, fields[order[i]].name,
+            fields[order[i]].bits, MSG_SmallBits(&fields[order[i]], stats), 100.0f * stats->changes / MAX(deltas, 1));
+    }
+    len += Com_sprintf(buf + len, size - len, "};\n");
+
+    return len;
+}
+
+
 /*
 ==================
 MSG_WriteDeltaEntity
@@ -899,12 +1186,13 @@ void MSG_WriteDeltaEntity(int alternateProtocol, msg_t *msg, struct entityState_
 {
     int i, lc;
     int numFields;
-    netField_t *field;
+    netField_t *fields, *field;
     int trunc;
     float fullFloat;
     int *fromF, *toF;
 
     numFields = ARRAY_LEN(entityStateFields);
+    fields = alternateProtocol == MSG_PROFILED_FIELDS ? profiledEntityStateFields : entityStateFields;
 
     // all fields should be 32 bits to avoid any compiler packing issues
     // the "number" field is not part of the field list
@@ -931,7 +1219,7 @@ void MSG_WriteDeltaEntity(int alternateProtocol, msg_t *msg, struct entityState_
 
     lc = 0;
     // build the change vector as bytes so it is endien independent
-    for (i = 0, field = entityStateFields; i < numFields; i++, field++)
+    for (i = 0, field = fields; i < numFields; i++, field++)
     {
         if (alternateProtocol == 2 && i == 13)
         {
@@ -973,8 +1261,12 @@ void MSG_WriteDeltaEntity(int alternateProtocol, msg_t *msg, struct entityState_
     }
 
     oldsize += numFields;
+    if (msg_countFields)
+    {
+        entityDeltas++;
+    }
 
-    for (i = 0, field = entityStateFields; i < lc; i++, field++)
+    for (i = 0, field = fields; i < lc; i++, field++)
     {
         if (alternateProtocol == 2 && i == 13)
         {
@@ -991,6 +1283,10 @@ void MSG_WriteDeltaEntity(int alternateProtocol, msg_t *msg, struct entityState_
         }
 
         MSG_WriteBits(msg, 1, 1);  // changed
+        if (msg_countFields)
+        {
+            MSG_CountField(entityFieldStats, field, *toF, true);
+        }
 
         if (field->bits == 0)
         {
@@ -1036,7 +1332,7 @@ void MSG_WriteDeltaEntity(int alternateProtocol, msg_t *msg, struct entityState_
                 }
                 else
                 {
-                    MSG_WriteBits(msg, *toF, field->bits);
+                    MSG_WriteField(msg, field, *toF);
                 }
             }
         }
@@ -1059,7 +1355,7 @@ void MSG_ReadDeltaEntity(int alternateProtocol, msg_t *msg, entityState_t *from,
 {
     int i, lc;
     int numFields;
-    netField_t *field;
+    netField_t *fields, *field;
     int *fromF, *toF;
     int print;
     int trunc;
@@ -1100,6 +1396,7 @@ void MSG_ReadDeltaEntity(int alternateProtocol, msg_t *msg, entityState_t *from,
     }
 
     numFields = ARRAY_LEN(entityStateFields);
+    fields = alternateProtocol == MSG_PROFILED_FIELDS ? profiledEntityStateFields : entityStateFields;
     lc = MSG_ReadByte(msg);
     if (alternateProtocol == 2 && lc - 1 >= 13)
     {
@@ -1124,8 +1421,12 @@ void MSG_ReadDeltaEntity(int alternateProtocol, msg_t *msg, entityState_t *from,
     }
 
     to->number = number;
+    if (msg_countFields)
+    {
+        entityDeltas++;
+    }
 
-    for (i = 0, field = entityStateFields; i < lc; i++, field++)
+    for (i = 0, field = fields; i < lc; i++, field++)
     {
         fromF = (int *)((uint8_t *)from + field->offset);
         toF = (int *)((uint8_t *)to + field->offset);
@@ -1189,7 +1490,7 @@ void MSG_ReadDeltaEntity(int alternateProtocol, msg_t *msg, entityState_t *from,
                     }
                     else
                     {
-                        *toF = MSG_ReadBits(msg, field->bits);
+                        *toF = MSG_ReadField(msg, field);
                     }
                     if (print)
                     {
@@ -1197,10 +1498,13 @@ void MSG_ReadDeltaEntity(int alternateProtocol, msg_t *msg, entityState_t *from,
                     }
                 }
             }
-            //			pcount[i]++;
+            if (msg_countFields)
+            {
+                MSG_CountField(entityFieldStats, field, *toF, true);
+            }
         }
     }
-    for (i = lc, field = &entityStateFields[lc]; i < numFields; i++, field++)
+    for (i = lc, field = &fields[lc]; i < numFields; i++, field++)
     {
         fromF = (int *)((uint8_t *)from + field->offset);
         toF = (int *)((uint8_t *)to + field->offset);
@@ -1230,9 +1534,6 @@ plyer_state_t communication
 ============================================================================
 */
 
-// using the stringizing operator to save typing...
-#define PSF(x) #x, (size_t) & ((playerState_t *) 0)->x
-
 netField_t playerStateFields[] = {
     {PSF(commandTime), 32},
     {PSF(origin[0]), 0},
@@ -1341,6 +1642,84 @@ netField_t alternatePlayerStateFields[] = {
     {APSF(loopSound), 16}
 };
 
+static_assert(ARRAY_LEN(profiledEntityStateFields) == ARRAY_LEN(entityStateFields), "profiled entity fields");
+static_assert(ARRAY_LEN(profiledPlayerStateFields) == ARRAY_LEN(playerStateFields), "profiled player fields");
+
+/*
+=================
+MSG_ReportChangeVectors_f
+
+Prints how often each field changed in the deltas so far
+=================
+*/
+void MSG_ReportChangeVectors_f(void)
+{
+    MSG_ReportFields("entityState_t", entityStateFields, ARRAY_LEN(entityStateFields), entityFieldStats, entityDeltas);
+    MSG_ReportFields("playerState_t", playerStateFields, ARRAY_LEN(playerStateFields), playerFieldStats, playerDeltas);
+}
+
+/*
+=================
+MSG_NetFieldTables
+
+Writes the profiled tables for the deltas so far as C source to buf,
+returns the length
+=================
+*/
+int MSG_NetFieldTables(char *buf, int size)
+{
+    int len;
+
+    len = Com_sprintf(buf, size,
+        "// generated by \"changeVectors <file>\" from %d entity and %d playerstate deltas\n\n", entityDeltas,
+        playerDeltas);
+    len += MSG_PrintFieldTable(buf + len, size - len, "profiledEntityStateFields", "NETF", entityStateFields,
+        ARRAY_LEN(entityStateFields), entityFieldStats, entityDeltas);
+    len += Com_sprintf(buf + len, size - len, "\n");
+    len += MSG_PrintFieldTable(buf + len, size - len, "profiledPlayerStateFields", "PSF", playerStateFields,
+        ARRAY_LEN(playerStateFields), playerFieldStats, playerDeltas);
+
+    return len;
+}
+
+/*
+=================
+MSG_NetFieldsChecksum
+
+Identifies the profiled tables, so both ends can tell they were built
+with the same ones
+=================
+*/
+int MSG_NetFieldsChecksum(void)
+{
+    static unsigned int checksum;
+    const netField_t *tables[2] = {profiledEntityStateFields, profiledPlayerStateFields};
+    const int sizes[2] = {ARRAY_LEN(profiledEntityStateFields), ARRAY_LEN(profiledPlayerStateFields)};
+    int t, i;
+
+    if (checksum)
+    {
+        return checksum;
+    }
+
+    // FNV-1a over the layout of every field
+    checksum = 2166136261u;
+    for (t = 0; t < 2; t++)
+    {
+        for (i = 0; i < sizes[t]; i++)
+        {
+            int words[3] = {(int)tables[t][i].offset, tables[t][i].bits, tables[t][i].smallBits};
+
+            for (int w = 0; w < 3; w++)
+            {
+                checksum = (checksum ^ (unsigned int)words[w]) * 16777619u;
+            }
+        }
+    }
+
+    return checksum;
+}
+
 /*
 =============
 MSG_WriteDeltaPlayerstate
@@ -1358,7 +1737,7 @@ void MSG_WriteDeltaPlayerstate(int alternateProtocol, msg_t *msg, struct playerS
     int ammobits;
     int miscbits;
     int numFields;
-    netField_t *field;
+    netField_t *fields, *field;
     int *fromF, *toF;
     float fullFloat;
     int trunc, lc;
@@ -1370,9 +1749,10 @@ void MSG_WriteDeltaPlayerstate(int alternateProtocol, msg_t *msg, struct playerS
     }
 
     numFields = ARRAY_LEN(playerStateFields);
+    fields = alternateProtocol == MSG_PROFILED_FIELDS ? profiledPlayerStateFields : playerStateFields;
 
     lc = 0;
-    for (i = 0, field = playerStateFields; i < numFields; i++, field++)
+    for (i = 0, field = fields; i < numFields; i++, field++)
     {
         if (alternateProtocol == 2 && (i == 15 || i == 34 || i == 35 || i == 41))
         {
@@ -1415,8 +1795,12 @@ void MSG_WriteDeltaPlayerstate(int alternateProtocol, msg_t *msg, struct playerS
     }
 
     oldsize += numFields - lc;
+    if (msg_countFields)
+    {
+        playerDeltas++;
+    }
 
-    for (i = 0, field = playerStateFields; i < lc; i++, field++)
+    for (i = 0, field = fields; i < lc; i++, field++)
     {
         if (alternateProtocol == 2 && (i == 15 || i == 34 || i == 35 || i == 41))
         {
@@ -1433,7 +1817,10 @@ void MSG_WriteDeltaPlayerstate(int alternateProtocol, msg_t *msg, struct playerS
         }
 
         MSG_WriteBits(msg, 1, 1);  // changed
-        //		pcount[i]++;
+        if (msg_countFields)
+        {
+            MSG_CountField(playerFieldStats, field, *toF, false);
+        }
 
         if (field->bits == 0)
         {
@@ -1474,7 +1861,7 @@ void MSG_WriteDeltaPlayerstate(int alternateProtocol, msg_t *msg, struct playerS
             }
             else
             {
-                MSG_WriteBits(msg, *toF, field->bits);
+                MSG_WriteField(msg, field, *toF);
             }
         }
     }
@@ -1593,11 +1980,11 @@ void MSG_WriteDeltaPlayerstate(int alternateProtocol, msg_t *msg, struct playerS
 MSG_ReadDeltaPlayerstate
 ===================
 */
-void MSG_ReadDeltaPlayerstate(msg_t *msg, playerState_t *from, playerState_t *to)
+void MSG_ReadDeltaPlayerstate(int alternateProtocol, msg_t *msg, playerState_t *from, playerState_t *to)
 {
     int i, lc;
     int bits;
-    netField_t *field;
+    netField_t *fields, *field;
     int numFields;
     int startBit, endBit;
     int print;
@@ -1634,6 +2021,7 @@ void MSG_ReadDeltaPlayerstate(msg_t *msg, playerState_t *from, playerState_t *to
     }
 
     numFields = ARRAY_LEN(playerStateFields);
+    fields = alternateProtocol == MSG_PROFILED_FIELDS ? profiledPlayerStateFields : playerStateFields;
     lc = MSG_ReadByte(msg);
 
     if (lc > numFields || lc < 0)
@@ -1641,7 +2029,12 @@ void MSG_ReadDeltaPlayerstate(msg_t *msg, playerState_t *from, playerState_t *to
         Com_Error(ERR_DROP, "invalid playerState field count");
     }
 
-    for (i = 0, field = playerStateFields; i < lc; i++, field++)
+    if (msg_countFields)
+    {
+        playerDeltas++;
+    }
+
+    for (i = 0, field = fields; i < lc; i++, field++)
     {
         fromF = (int *)((uint8_t *)from + field->offset);
         toF = (int *)((uint8_t *)to + field->offset);
@@ -1681,15 +2074,19 @@ void MSG_ReadDeltaPlayerstate(msg_t *msg, playerState_t *from, playerState_t *to
             else
             {
                 // integer
-                *toF = MSG_ReadBits(msg, field->bits);
+                *toF = MSG_ReadField(msg, field);
                 if (print)
                 {
                     Com_Printf("%s:%i ", field->name, *toF);
                 }
             }
+            if (msg_countFields)
+            {
+                MSG_CountField(playerFieldStats, field, *toF, false);
+            }
         }
     }
-    for (i = lc, field = &playerStateFields[lc]; i < numFields; i++, field++)
+    for (i = lc, field = &fields[lc]; i < numFields; i++, field++)
     {
         fromF = (int *)((uint8_t *)from + field->offset);
         toF = (int *)((uint8_t *)to + field->offset);
@@ -42,6 +42,8 @@ void MSG_WriteLong(struct msg_t *sb, int c);
 void MSG_WriteFloat(struct msg_t *sb, float f);
 void MSG_WriteString(struct msg_t *sb, const char *s);
 void MSG_WriteBigString(struct msg_t *sb, const char *s);
+void MSG_WriteHuffmanBits(struct msg_t *msg, const uint8_t *bits, int numBits);
+void MSG_Rewind(struct msg_t *msg, int bit);
 void MSG_WriteAngle16(struct msg_t *sb, float f);
 int MSG_HashKey(int alternateProtocol, const char *string, int maxlen);
 
@@ -65,15 +67,24 @@ int MSG_LookaheadByte(struct msg_t *msg);
 void MSG_WriteDeltaUsercmdKey(struct msg_t *msg, int key, usercmd_t *from, usercmd_t *to);
 void MSG_ReadDeltaUsercmdKey(struct msg_t *msg, int key, usercmd_t *from, usercmd_t *to);
 
+// alternateProtocol of the delta functions on a protocol 71 connection
+// that agreed on the profiled field tables with svc_netfields
+#define MSG_PROFILED_FIELDS 3
+
 void MSG_WriteDeltaEntity(int alternateProtocol, struct msg_t *msg, struct entityState_s *from, struct entityState_s *to, bool force);
 void MSG_ReadDeltaEntity(int alternateProtocol, struct msg_t *msg, entityState_t *from, entityState_t *to, int number);
 
 void MSG_WriteDeltaPlayerstate(int alternateProtocol, struct msg_t *msg, struct playerState_s *from, struct playerState_s *to);
-void MSG_ReadDeltaPlayerstate(struct msg_t *msg, struct playerState_s *from, struct playerState_s *to);
+void MSG_ReadDeltaPlayerstate(int alternateProtocol, struct msg_t *msg, struct playerState_s *from, struct playerState_s *to);
 
 struct alternatePlayerState_t;
 void MSG_ReadDeltaAlternatePlayerstate(struct msg_t *msg, struct alternatePlayerState_t *from, struct alternatePlayerState_t *to);
 
+// the field statistics are only counted while this is set
+extern bool msg_countFields;
+
 void MSG_ReportChangeVectors_f(void);
+int MSG_NetFieldTables(char *buf, int size);
+int MSG_NetFieldsChecksum(void);
 
 #endif
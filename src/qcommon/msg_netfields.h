@@ -0,0 +1,111 @@
+// generated by "changeVectors <file>" from 304 entity and 16659 playerstate deltas
+
+netField_t profiledEntityStateFields[] = {
+    {NETF(event), 10, 0},  // 84.21%
+    {NETF(pos.trBase[0]), 0, 0},  // 36.84%
+    {NETF(pos.trBase[2]), 0, 0},  // 36.84%
+    {NETF(eType), 8, 3},  // 36.84%
+    {NETF(modelindex), 8, 4},  // 36.84%
+    {NETF(torsoAnim), 8, 2},  // 21.05%
+    {NETF(groundEntityNum), 10, 0},  // 21.05%
+    {NETF(eFlags), 19, 5},  // 21.05%
+    {NETF(solid), 24, 0},  // 21.05%
+    {NETF(misc), 16, 10},  // 21.05%
+    {NETF(origin2[2]), 0, 0},  // 21.05%
+    {NETF(modelindex2), 8, 2},  // 21.05%
+    {NETF(time), 32, 8},  // 21.05%
+    {NETF(angles2[0]), 0, 0},  // 21.05%
+    {NETF(apos.trBase[1]), 0, 0},  // 10.53%
+    {NETF(angles2[1]), 0, 0},  // 10.53%
+    {NETF(pos.trTime), 32, 0},  // 0.00%
+    {NETF(pos.trBase[1]), 0, 0},  // 0.00%
+    {NETF(pos.trDelta[0]), 0, 0},  // 0.00%
+    {NETF(pos.trDelta[1]), 0, 0},  // 0.00%
+    {NETF(pos.trDelta[2]), 0, 0},  // 0.00%
+    {NETF(apos.trBase[0]), 0, 0},  // 0.00%
+    {NETF(weaponAnim), 8, 0},  // 0.00%
+    {NETF(eventParm), 8, 0},  // 0.00%
+    {NETF(legsAnim), 8, 0},  // 0.00%
+    {NETF(pos.trType), 8, 0},  // 0.00%
+    {NETF(otherEntityNum), 10, 0},  // 0.00%
+    {NETF(weapon), 8, 0},  // 0.00%
+    {NETF(clientNum), 8, 0},  // 0.00%
+    {NETF(angles[1]), 0, 0},  // 0.00%
+    {NETF(pos.trDuration), 32, 0},  // 0.00%
+    {NETF(apos.trType), 8, 0},  // 0.00%
+    {NETF(origin[0]), 0, 0},  // 0.00%
+    {NETF(origin[1]), 0, 0},  // 0.00%
+    {NETF(origin[2]), 0, 0},  // 0.00%
+    {NETF(otherEntityNum2), 10, 0},  // 0.00%
+    {NETF(loopSound), 8, 0},  // 0.00%
+    {NETF(generic1), 10, 0},  // 0.00%
+    {NETF(origin2[0]), 0, 0},  // 0.00%
+    {NETF(origin2[1]), 0, 0},  // 0.00%
+    {NETF(angles[0]), 0, 0},  // 0.00%
+    {NETF(apos.trTime), 32, 0},  // 0.00%
+    {NETF(apos.trDuration), 32, 0},  // 0.00%
+    {NETF(apos.trBase[2]), 0, 0},  // 0.00%
+    {NETF(apos.trDelta[0]), 0, 0},  // 0.00%
+    {NETF(apos.trDelta[1]), 0, 0},  // 0.00%
+    {NETF(apos.trDelta[2]), 0, 0},  // 0.00%
+    {NETF(time2), 32, 0},  // 0.00%
+    {NETF(angles[2]), 0, 0},  // 0.00%
+    {NETF(angles2[2]), 0, 0},  // 0.00%
+    {NETF(constantLight), 32, 0},  // 0.00%
+    {NETF(frame), 16, 0},  // 0.00%
+};
+
+netField_t profiledPlayerStateFields[] = {
+    {PSF(commandTime), 32, 21},  // 99.81%
+    {PSF(origin[0]), 0, 0},  // 99.80%
+    {PSF(origin[1]), 0, 0},  // 99.80%
+    {PSF(velocity[0]), 0, 0},  // 99.20%
+    {PSF(velocity[1]), 0, 0},  // 99.04%
+    {PSF(viewangles[1]), 0, 0},  // 98.66%
+    {PSF(velocity[2]), 0, 0},  // 83.35%
+    {PSF(origin[2]), 0, 0},  // 24.83%
+    {PSF(torsoAnim), 8, 4},  // 0.29%
+    {PSF(legsAnim), 8, 5},  // 0.29%
+    {PSF(eFlags), 16, 2},  // 0.29%
+    {PSF(speed), -16, 0},  // 0.29%
+    {PSF(delta_angles[1]), 16, 9},  // 0.29%
+    {PSF(pm_type), 8, 2},  // 0.29%
+    {PSF(grapplePoint[2]), 0, 0},  // 0.29%
+    {PSF(clientNum), 8, 4},  // 0.27%
+    {PSF(pm_time), -16, 0},  // 0.04%
+    {PSF(pm_flags), 24, 0},  // 0.04%
+    {PSF(bobCycle), 8, 0},  // 0.00%
+    {PSF(viewangles[0]), 0, 0},  // 0.00%
+    {PSF(weaponTime), -16, 0},  // 0.00%
+    {PSF(legsTimer), 8, 0},  // 0.00%
+    {PSF(eventSequence), 16, 0},  // 0.00%
+    {PSF(weaponAnim), 8, 0},  // 0.00%
+    {PSF(movementDir), 4, 0},  // 0.00%
+    {PSF(events[0]), 8, 0},  // 0.00%
+    {PSF(events[1]), 8, 0},  // 0.00%
+    {PSF(groundEntityNum), 10, 0},  // 0.00%
+    {PSF(weaponstate), 4, 0},  // 0.00%
+    {PSF(externalEvent), 10, 0},  // 0.00%
+    {PSF(gravity), -16, 0},  // 0.00%
+    {PSF(externalEventParm), 8, 0},  // 0.00%
+    {PSF(viewheight), -8, 0},  // 0.00%
+    {PSF(damageEvent), 8, 0},  // 0.00%
+    {PSF(damageYaw), 8, 0},  // 0.00%
+    {PSF(damagePitch), 8, 0},  // 0.00%
+    {PSF(damageCount), 8, 0},  // 0.00%
+    {PSF(ammo), 12, 0},  // 0.00%
+    {PSF(clips), 4, 0},  // 0.00%
+    {PSF(generic1), 10, 0},  // 0.00%
+    {PSF(delta_angles[0]), 16, 0},  // 0.00%
+    {PSF(delta_angles[2]), 16, 0},  // 0.00%
+    {PSF(torsoTimer), 12, 0},  // 0.00%
+    {PSF(tauntTimer), 12, 0},  // 0.00%
+    {PSF(eventParms[0]), 8, 0},  // 0.00%
+    {PSF(eventParms[1]), 8, 0},  // 0.00%
+    {PSF(weapon), 5, 0},  // 0.00%
+    {PSF(viewangles[2]), 0, 0},  // 0.00%
+    {PSF(grapplePoint[0]), 0, 0},  // 0.00%
+    {PSF(grapplePoint[1]), 0, 0},  // 0.00%
+    {PSF(otherEntityNum), 10, 0},  // 0.00%
+    {PSF(loopSound), 16, 0},  // 0.00%
+};
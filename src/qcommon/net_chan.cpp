@@ -146,7 +146,7 @@ void Netchan_TransmitNextFragment(netchan_t *chan)
     NET_SendPacket(chan->sock, send.cursize, send.data, chan->remoteAddress);
 
     // Store send time and size of this packet for rate control
-    chan->lastSentTime = Sys_Milliseconds();
+    chan->lastSentTime = Com_NetMilliseconds();
     chan->lastSentSize = send.cursize;
 
     if (showpackets->integer)
@@ -219,7 +219,7 @@ void Netchan_Transmit(netchan_t *chan, int length, const byte *data)
     NET_SendPacket(chan->sock, send.cursize, send.data, chan->remoteAddress);
 
     // Store send time and size of this packet for rate control
-    chan->lastSentTime = Sys_Milliseconds();
+    chan->lastSentTime = Com_NetMilliseconds();
     chan->lastSentSize = send.cursize;
 
     if (showpackets->integer)
@@ -551,6 +551,12 @@ void NET_SendPacket(netsrc_t sock, int length, const void *data, netadr_t to)
         return;
     }
 
+    if (com_replay && com_replay->integer)
+    {
+        Com_ReplayOutboundPacket(length, data, to);
+        return;
+    }
+
     if (sock == NS_CLIENT && cl_packetdelay->integer > 0)
     {
         NET_QueuePacket(length, data, to, cl_packetdelay->integer);
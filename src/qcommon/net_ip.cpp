@@ -30,6 +30,16 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 #include "q_shared.h"
 #include "qcommon.h"
 
+#include "sys/sys_shared.h"
+
+#ifndef DEDICATED
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -119,6 +129,10 @@ static cvar_t *net_mcast6iface;
 
 static cvar_t *net_dropsim;
 
+#ifndef DEDICATED
+static cvar_t *net_recvThread;
+#endif
+
 static struct sockaddr socksRelayAddr;
 
 static SOCKET ip_sockets[3] = {INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET};
@@ -155,6 +169,36 @@ typedef struct {
 static nip_localaddr_t localIP[MAX_IPS];
 static int numIP;
 
+#ifndef DEDICATED
+/*
+The optional client receive thread drains the sockets as soon as packets
+arrive and stamps each one with its arrival time, so a slow or hitching
+frame no longer skews the snapshot timing CL_AdjustTimeDelta relies on.
+The thread only ever advances recvHead and the main thread only ever
+advances recvTail, which keeps the ring itself lock free; the mutex is
+used solely to let NET_Sleep block until something arrives.
+*/
+#define NET_RECV_SLOTS 64  // must be a power of two
+
+typedef struct {
+    int time;  // Sys_Milliseconds when the packet came off the socket
+    int protocol;  // index into ip_sockets or ip6_sockets
+    bool ip6;
+    socklen_t fromlen;
+    struct sockaddr_storage from;
+    int length;
+    byte data[MAX_MSGLEN + 1];
+} netRecvSlot_t;
+
+static netRecvSlot_t recvSlots[NET_RECV_SLOTS];
+static std::atomic<unsigned> recvHead(0);  // written by the receive thread only
+static std::atomic<unsigned> recvTail(0);  // written by the main thread only
+static std::atomic<bool> recvQuit(false);
+static std::thread *recvThread;
+static std::mutex recvWakeLock;
+static std::condition_variable recvWake;
+#endif
+
 //=============================================================================
 
 /*
@@ -551,6 +595,54 @@ bool NET_CompareAdr(netadr_t a, netadr_t b)
 bool NET_IsLocalAddress(netadr_t adr) { return (bool)(adr.type == NA_LOOPBACK); }
 //=============================================================================
 
+/*
+==================
+NET_ParsePacket
+
+Fill in the sender and message for a datagram recvfrom() returned
+==================
+*/
+static bool NET_ParsePacket(int protocol, bool ip6, struct sockaddr_storage *from, socklen_t fromlen, int ret,
+    netadr_t *net_from, msg_t *net_message)
+{
+    if (!ip6)
+    {
+        memset(((struct sockaddr_in *)from)->sin_zero, 0, 8);
+    }
+
+    if (!ip6 && usingSocks && memcmp(from, &socksRelayAddr, fromlen) == 0)
+    {
+        if (ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 ||
+            net_message->data[3] != 1)
+        {
+            return false;
+        }
+        net_from->type = NA_IP;
+        net_from->ip[0] = net_message->data[4];
+        net_from->ip[1] = net_message->data[5];
+        net_from->ip[2] = net_message->data[6];
+        net_from->ip[3] = net_message->data[7];
+        net_from->port = *(short *)&net_message->data[8];
+        net_message->readcount = 10;
+    }
+    else
+    {
+        SockadrToNetadr((struct sockaddr *)from, net_from);
+        net_message->readcount = 0;
+    }
+
+    net_from->alternateProtocol = protocol;
+
+    if (ret >= net_message->maxsize)
+    {
+        Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
+        return false;
+    }
+
+    net_message->cursize = ret;
+    return true;
+}
+
 /*
 ==================
 NET_GetPacket
@@ -583,39 +675,7 @@ bool NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
             }
             else
             {
-                memset(((struct sockaddr_in *)&from)->sin_zero, 0, 8);
-
-                if (usingSocks && memcmp(&from, &socksRelayAddr, fromlen) == 0)
-                {
-                    if (ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 ||
-                        net_message->data[2] != 0 || net_message->data[3] != 1)
-                    {
-                        return false;
-                    }
-                    net_from->type = NA_IP;
-                    net_from->ip[0] = net_message->data[4];
-                    net_from->ip[1] = net_message->data[5];
-                    net_from->ip[2] = net_message->data[6];
-                    net_from->ip[3] = net_message->data[7];
-                    net_from->port = *(short *)&net_message->data[8];
-                    net_message->readcount = 10;
-                }
-                else
-                {
-                    SockadrToNetadr((struct sockaddr *)&from, net_from);
-                    net_message->readcount = 0;
-                }
-
-                net_from->alternateProtocol = a;
-
-                if (ret >= net_message->maxsize)
-                {
-                    Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
-                    return false;
-                }
-
-                net_message->cursize = ret;
-                return true;
+                return NET_ParsePacket(a, false, &from, fromlen, ret, net_from, net_message);
             }
         }
 
@@ -633,19 +693,7 @@ bool NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
             }
             else
             {
-                SockadrToNetadr((struct sockaddr *)&from, net_from);
-                net_message->readcount = 0;
-
-                net_from->alternateProtocol = a;
-
-                if (ret >= net_message->maxsize)
-                {
-                    Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
-                    return false;
-                }
-
-                net_message->cursize = ret;
-                return true;
+                return NET_ParsePacket(a, true, &from, fromlen, ret, net_from, net_message);
             }
         }
 
@@ -1593,9 +1641,176 @@ static bool NET_GetCvars(void)
 
     net_dropsim = Cvar_Get("net_dropsim", "", CVAR_TEMP);
 
+#ifndef DEDICATED
+    net_recvThread = Cvar_Get("net_recvThread", "0", CVAR_LATCH | CVAR_ARCHIVE);
+    Cvar_SetDescription(net_recvThread, "Receive packets on a separate thread with precise arrival times");
+    modified += net_recvThread->modified;
+    net_recvThread->modified = false;
+#endif
+
     return modified ? true : false;
 }
 
+#ifndef DEDICATED
+/*
+====================
+NET_RecvSocket
+
+Move every queued datagram on a socket into the receive ring, called from
+the receive thread. Errors are left to the next read rather than printed,
+as the console is not safe to use from here.
+====================
+*/
+static bool NET_RecvSocket(SOCKET s, int protocol, bool ip6)
+{
+    netRecvSlot_t *slot;
+    unsigned head;
+    int ret;
+    bool received = false;
+
+    while (1)
+    {
+        head = recvHead.load(std::memory_order_relaxed);
+
+        // when full, leave the rest in the kernel until the main thread catches up
+        if (head - recvTail.load(std::memory_order_acquire) >= NET_RECV_SLOTS)
+        {
+            break;
+        }
+
+        slot = &recvSlots[head & (NET_RECV_SLOTS - 1)];
+        slot->fromlen = sizeof(slot->from);
+        ret = recvfrom(s, (char *)slot->data, sizeof(slot->data), 0, (struct sockaddr *)&slot->from, &slot->fromlen);
+
+        if (ret == SOCKET_ERROR)
+        {
+            break;
+        }
+
+        slot->time = Sys_Milliseconds();
+        slot->protocol = protocol;
+        slot->ip6 = ip6;
+        slot->length = ret;
+        recvHead.store(head + 1, std::memory_order_release);
+        received = true;
+    }
+
+    return received;
+}
+
+/*
+====================
+NET_RecvThread
+====================
+*/
+static void NET_RecvThread(void)
+{
+    struct timeval timeout;
+    fd_set fdr;
+    SOCKET highestfd;
+    bool received;
+    int a;
+
+    while (!recvQuit.load(std::memory_order_relaxed))
+    {
+        FD_ZERO(&fdr);
+        highestfd = INVALID_SOCKET;
+
+        for (a = 0; a < 3; ++a)
+        {
+            if (ip_sockets[a] != INVALID_SOCKET)
+            {
+                FD_SET(ip_sockets[a], &fdr);
+
+                if (highestfd == INVALID_SOCKET || ip_sockets[a] > highestfd) highestfd = ip_sockets[a];
+            }
+            if (ip6_sockets[a] != INVALID_SOCKET)
+            {
+                FD_SET(ip6_sockets[a], &fdr);
+
+                if (highestfd == INVALID_SOCKET || ip6_sockets[a] > highestfd) highestfd = ip6_sockets[a];
+            }
+        }
+
+        // a full ring or no sockets: give the main thread a moment
+        if (highestfd == INVALID_SOCKET ||
+            recvHead.load(std::memory_order_relaxed) - recvTail.load(std::memory_order_acquire) >= NET_RECV_SLOTS)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // wake up regularly to notice NET_StopRecvThread
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 100 * 1000;
+
+        if (select(highestfd + 1, &fdr, NULL, NULL, &timeout) <= 0)
+        {
+            continue;
+        }
+
+        received = false;
+
+        for (a = 0; a < 3; ++a)
+        {
+            if (ip_sockets[a] != INVALID_SOCKET && FD_ISSET(ip_sockets[a], &fdr))
+                received |= NET_RecvSocket(ip_sockets[a], a, false);
+
+            if (ip6_sockets[a] != INVALID_SOCKET && FD_ISSET(ip6_sockets[a], &fdr))
+                received |= NET_RecvSocket(ip6_sockets[a], a, true);
+        }
+
+        if (received)
+        {
+            // taking the lock orders the notify after a NET_Sleep that just found the ring empty
+            {
+                std::lock_guard<std::mutex> lock(recvWakeLock);
+            }
+            recvWake.notify_one();
+        }
+    }
+}
+
+/*
+====================
+NET_StartRecvThread
+====================
+*/
+static void NET_StartRecvThread(void)
+{
+    if (recvThread || !net_recvThread->integer || com_dedicated->integer)
+    {
+        return;
+    }
+
+    recvHead.store(0);
+    recvTail.store(0);
+    recvQuit.store(false);
+    recvThread = new std::thread(NET_RecvThread);
+}
+
+/*
+====================
+NET_StopRecvThread
+
+Must run before the sockets are closed. Anything still in the ring is
+dropped, just as closing the socket drops what the kernel had queued.
+====================
+*/
+static void NET_StopRecvThread(void)
+{
+    if (!recvThread)
+    {
+        return;
+    }
+
+    recvQuit.store(true);
+    recvThread->join();
+    delete recvThread;
+    recvThread = NULL;
+}
+#endif
+
 /*
 ====================
 NET_Config
@@ -1652,6 +1867,10 @@ void NET_Config(bool enableNetworking)
 
     if (stop)
     {
+#ifndef DEDICATED
+        NET_StopRecvThread();
+#endif
+
         for (a = 0; a < 3; ++a)
         {
             if (ip_sockets[a] != INVALID_SOCKET)
@@ -1690,6 +1909,9 @@ void NET_Config(bool enableNetworking)
         {
             NET_OpenIP();
             NET_SetMulticast6();
+#ifndef DEDICATED
+            NET_StartRecvThread();
+#endif
         }
     }
 }
@@ -1740,6 +1962,29 @@ void NET_Shutdown(void)
 #endif
 }
 
+/*
+====================
+NET_DispatchPacket
+
+Hand a received packet to the server or the client. delay is how long
+the packet sat in the receive ring before reaching here.
+====================
+*/
+static void NET_DispatchPacket(netadr_t *from, msg_t *netmsg, int delay)
+{
+    if (net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
+    {
+        // com_dropsim->value percent of incoming packets get dropped.
+        if (rand() < (int)(((double)RAND_MAX) / 100.0 * (double)net_dropsim->value))
+            return;  // drop this packet
+    }
+
+    if (com_sv_running->integer)
+        Com_RunAndTimeServerPacket(from, netmsg);
+    else
+        CL_PacketEvent(*from, netmsg, delay);
+}
+
 /*
 ====================
 NET_Event
@@ -1761,23 +2006,67 @@ void NET_Event(fd_set *fdr)
         MSG_Init(&netmsg, bufData, sizeof(bufData));
 
         if (NET_GetPacket(&from, &netmsg, fdr))
+            NET_DispatchPacket(&from, &netmsg, 0);
+        else
+            break;
+    }
+}
+
+#ifndef DEDICATED
+/*
+====================
+NET_RecvThreadEvents
+
+Called from NET_Sleep in place of select() while the receive thread owns the sockets.
+====================
+*/
+static void NET_RecvThreadEvents(int msec)
+{
+    uint8_t bufData[MAX_MSGLEN + 1];
+    netRecvSlot_t *slot;
+    netadr_t from;
+    msg_t netmsg;
+    unsigned tail;
+    int delay;
+
+    if (msec > 0)
+    {
+        std::unique_lock<std::mutex> lock(recvWakeLock);
+
+        recvWake.wait_for(lock, std::chrono::milliseconds(msec), [] {
+            return recvHead.load(std::memory_order_acquire) != recvTail.load(std::memory_order_relaxed);
+        });
+    }
+
+    memset(&from, 0, sizeof(from));
+
+    while (1)
+    {
+        tail = recvTail.load(std::memory_order_relaxed);
+
+        if (tail == recvHead.load(std::memory_order_acquire))
         {
-            if (net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
-            {
-                // com_dropsim->value percent of incoming packets get dropped.
-                if (rand() < (int)(((double)RAND_MAX) / 100.0 * (double)net_dropsim->value))
-                    continue;  // drop this packet
-            }
+            break;
+        }
 
-            if (com_sv_running->integer)
-                Com_RunAndTimeServerPacket(&from, &netmsg);
-            else
-                CL_PacketEvent(from, &netmsg);
+        // copy out and release the slot first, the packet handlers may restart the network
+        slot = &recvSlots[tail & (NET_RECV_SLOTS - 1)];
+        MSG_Init(&netmsg, bufData, sizeof(bufData));
+        ::memcpy(bufData, slot->data, slot->length);
+
+        if (NET_ParsePacket(slot->protocol, slot->ip6, &slot->from, slot->fromlen, slot->length, &from, &netmsg))
+        {
+            delay = Sys_Milliseconds() - slot->time;
+            recvTail.store(tail + 1, std::memory_order_release);
+            NET_DispatchPacket(&from, &netmsg, delay);
         }
         else
-            break;
+        {
+            recvTail.store(tail + 1, std::memory_order_release);
+        }
     }
 }
+#endif
 
 /*
 ====================
@@ -1796,6 +2085,14 @@ void NET_Sleep(int msec)
 
     if (msec < 0) msec = 0;
 
+#ifndef DEDICATED
+    if (recvThread)
+    {
+        NET_RecvThreadEvents(msec);
+        return;
+    }
+#endif
+
     FD_ZERO(&fdr);
 
     for (a = 0; a < 3; ++a)
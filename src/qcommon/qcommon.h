@@ -87,6 +87,12 @@ enum svc_ops_e {
 // new commands, supported only by ioquake3 protocol but not legacy
 	svc_voipSpeex,     // not wrapped in USE_VOIP, so this value is reserved.
 	svc_voipOpus,      //
+
+// only sent to clients that set cl_zgamestate
+	svc_zconfigstrings,	// [long] raw size [long] size [size bytes] raw deflated configstrings, only in gamestate messages
+
+// only sent to clients whose cl_netFields matches the server's tables
+	svc_netfields,		// [long] checksum, deltas use the profiled field tables, only in gamestate messages
 };
 
 
@@ -153,7 +159,8 @@ typedef enum {
 	SE_CHAR,		// evValue is an ascii char
 	SE_MOUSE,		// evValue and evValue2 are relative signed x / y moves
 	SE_JOYSTICK_AXIS,	// evValue is an axis number and evValue2 is the current state (-127 to 127)
-	SE_CONSOLE		// evPtr is a char*
+	SE_CONSOLE,		// evPtr is a char*
+	SE_PACKET		// evPtr is a netadr_t followed by evValue bytes of packet, only read from a journal
 } sysEventType_t;
 
 typedef struct {
@@ -168,6 +175,9 @@ void  Com_rgb_to_hsl(vec4_t rgb, vec4_t hsl);
 void  Com_hsl_to_rgb(vec4_t hsl, vec4_t rgb);
 
 void		Com_QueueEvent( int time, sysEventType_t type, int value, int value2, int ptrLength, void *ptr );
+void		Com_ReplayOutboundPacket( int length, const void *data, netadr_t to );
+int			Com_NetMilliseconds( void );
+void		Com_JournalRandomBytes( byte *buf, int len );
 int			Com_EventLoop( void );
 sysEvent_t	Com_GetSystemEvent( void );
 
@@ -215,6 +225,7 @@ extern	cvar_t	*com_cl_running;
 extern	cvar_t	*com_version;
 extern	cvar_t	*com_buildScript;		// for building release pak files
 extern	cvar_t	*com_journal;
+extern	cvar_t	*com_replay;
 extern	cvar_t	*com_cameraMode;
 extern	cvar_t	*com_ansiColor;
 extern	cvar_t	*com_unfocused;
@@ -342,7 +353,7 @@ void CL_MouseEvent( int dx, int dy, int time );
 
 void CL_JoystickEvent( int axis, int value, int time );
 
-void CL_PacketEvent( struct netadr_t from, struct msg_t *msg );
+void CL_PacketEvent( struct netadr_t from, struct msg_t *msg, int delay = 0 );
 
 void CL_ConsolePrint( const char *text );
 
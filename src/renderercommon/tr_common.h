@@ -66,6 +66,8 @@ typedef struct image_s {
 	imgType_t   type;
 	int /*imgFlags_t*/  flags;
 
+	struct imageJob_s	*job;			// decode still in flight, see r_asyncImages
+
 	struct image_s*	next;
 } image_t;
 
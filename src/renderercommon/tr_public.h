@@ -26,7 +26,7 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 
 #include "renderercommon/tr_types.h"
 
-#define	REF_API_VERSION		8
+#define	REF_API_VERSION		9
 
 // AVI files have the start of pixel lines 4 byte-aligned
 #define AVI_LINE_PADDING 4
@@ -166,6 +166,14 @@ typedef struct {
 	void	(*FS_WriteFile)( const char *qpath, const void *buffer, int size );
 	bool (*FS_FileExists)( const char *file );
 
+	// content checksum of the pk3 a file loads from, -1 if it is not in one
+	int		(*FS_PakFileChecksum)( const char *name, int *pCheckSum );
+	// read only mapping of a file the renderer wrote to the homepath gamedir
+	void	*(*FS_MapHomeFile)( const char *qpath, int *length );
+	void	(*FS_UnmapHomeFile)( void *data, int length );
+	// drops the least recently used files in a homepath gamedir directory down to maxBytes
+	void	(*FS_PruneHomeDir)( const char *path, const char *extension, int64_t maxBytes );
+
 	// cinematic stuff
 	void	(*CIN_UploadCinematic)(int handle);
 	int		(*CIN_PlayCinematic)( const char *arg0, int xpos, int ypos, int width, int height, int bits);
@@ -47,6 +47,9 @@ void GL_Bind( image_t *image ) {
 		ri.Printf( PRINT_WARNING, "GL_Bind: NULL image\n" );
 		texnum = tr.defaultImage->texnum;
 	} else {
+		if ( image->job ) {
+			R_FinishImageJob( image );
+		}
 		texnum = image->texnum;
 	}
 
@@ -100,6 +103,13 @@ void GL_SelectTexture( int unit )
 void GL_BindMultitexture( image_t *image0, GLuint env0, image_t *image1, GLuint env1 ) {
 	int		texnum0, texnum1;
 
+	if ( image0->job ) {
+		R_FinishImageJob( image0 );
+	}
+	if ( image1->job ) {
+		R_FinishImageJob( image1 );
+	}
+
 	texnum0 = image0->texnum;
 	texnum1 = image1->texnum;
 
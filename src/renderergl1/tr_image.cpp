@@ -151,6 +151,8 @@ void R_ImageList_f( void ) {
 	int i;
 	int estTotalSize = 0;
 
+	R_FinishImageJobs();
+
 	ri.Printf(PRINT_ALL, "\n      -w-- -h-- type  -size- --name-------\n");
 
 	for ( i = 0 ; i < tr.numImages ; i++ )
@@ -548,6 +550,284 @@ byte	mipBlendColors[16][4] = {
 };
 
 
+/*
+===============
+R_TextureFilter
+
+Sets the filtering of the bound texture
+===============
+*/
+static void R_TextureFilter( bool mipmap )
+{
+	if (mipmap)
+	{
+		if ( glConfig.textureFilterAnisotropic )
+			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+					(GLint)Com_Clamp( 1, glConfig.maxAnisotropy, r_ext_max_anisotropy->integer ) );
+
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
+	}
+	else
+	{
+		if ( glConfig.textureFilterAnisotropic )
+			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1 );
+
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	}
+
+	GL_CheckErrors();
+}
+
+/*
+===============================================================================
+
+R_IMAGECACHE
+
+r_imageCache keeps the mip chain Upload32 produced for pk3 images in
+fs_homepath, so a later load with the same settings maps it back in
+instead of decoding, resampling, light scaling and mipmapping again.
+Each registration ends by dropping the least recently used files until
+the cache fits in r_imageCacheSize megabytes.
+
+===============================================================================
+*/
+
+#define IMAGE_CACHE_IDENT	(('C'<<24)+('G'<<16)+('M'<<8)+'I')
+#define IMAGE_CACHE_VERSION	1
+#define IMAGE_CACHE_DIR		"imagecache/v" XSTRING( IMAGE_CACHE_VERSION )
+
+typedef struct {
+	int		ident;
+	int		version;
+	char	key[MAX_IMAGE_CACHE_KEY];	// guards against hash collisions
+	int		width, height;				// the source image
+	int		uploadWidth, uploadHeight;
+	int		internalFormat;
+	int		numLevels;
+	// followed by numLevels of width, height and width * height * 4 bytes of RGBA
+} imageCacheHeader_t;
+
+typedef struct {
+	const imageCacheKey_t	*key;
+	int		width, height;
+	byte	*buffer;		// hunk temp memory, NULL if nothing is written
+	int		size;
+	int		used;
+} imageCacheFile_t;
+
+/*
+================
+R_ImageCacheKey
+
+Describes everything Upload32 output depends on for an image loaded
+from fileName.  Returns false if r_imageCache is off or the file is not
+in a pk3, as loose files have no checksum to notice them changing.
+================
+*/
+static bool R_ImageCacheKey( const char *name, const char *fileName, int flags, imageCacheKey_t *cacheKey )
+{
+	unsigned	tables, hash, hash2;
+	int			checksum;
+	int			i;
+
+	if ( !r_imageCache->integer ) {
+		return false;
+	}
+
+	if ( ri.FS_PakFileChecksum( fileName, &checksum ) != 1 ) {
+		return false;
+	}
+
+	tables = 2166136261u;
+	for ( i = 0; i < 256; i++ ) {
+		tables = ( tables ^ s_gammatable[i] ) * 16777619u;
+		tables = ( tables ^ s_intensitytable[i] ) * 16777619u;
+	}
+
+	Com_sprintf( cacheKey->key, sizeof( cacheKey->key ),
+		"%s %s %08x %d picmip %d round %d grey %g bits %d colormip %d simplemip %d max %d tc %d gamma %d/%08x",
+		name, fileName, checksum, flags,
+		( flags & IMGFLAG_PICMIP ) ? r_picmip->integer : 0,
+		r_roundImagesDown->integer, r_greyscale->value, r_texturebits->integer,
+		r_colorMipLevels->integer, r_simpleMipMaps->integer,
+		glConfig.maxTextureSize, glConfig.textureCompression,
+		glConfig.deviceSupportsGamma, tables );
+
+	hash = 2166136261u;
+	hash2 = 5381;
+	for ( i = 0; cacheKey->key[i]; i++ ) {
+		hash = ( hash ^ (byte)cacheKey->key[i] ) * 16777619u;
+		hash2 = hash2 * 33 + (byte)cacheKey->key[i];
+	}
+
+	Com_sprintf( cacheKey->path, sizeof( cacheKey->path ), IMAGE_CACHE_DIR "/%08x%08x.img", hash, hash2 );
+
+	return true;
+}
+
+/*
+================
+R_BeginCacheImage
+================
+*/
+static void R_BeginCacheImage( imageCacheFile_t *cache, const imageCacheKey_t *cacheKey, int width, int height )
+{
+	Com_Memset( cache, 0, sizeof( *cache ) );
+	cache->key = cacheKey;
+	cache->width = width;
+	cache->height = height;
+}
+
+/*
+================
+R_AllocCacheImage
+
+Makes room for the levels Upload32 is about to produce from a
+width by height first level
+================
+*/
+static void R_AllocCacheImage( imageCacheFile_t *cache, int width, int height, bool mipmap )
+{
+	int		size;
+
+	size = sizeof( imageCacheHeader_t );
+	while ( 1 ) {
+		size += 2 * sizeof( int ) + width * height * 4;
+
+		if ( !mipmap || ( width == 1 && height == 1 ) ) {
+			break;
+		}
+
+		width = MAX( width >> 1, 1 );
+		height = MAX( height >> 1, 1 );
+	}
+
+	cache->buffer = (byte *)ri.Hunk_AllocateTempMemory( size );
+	Com_Memset( cache->buffer, 0, sizeof( imageCacheHeader_t ) );
+	cache->size = size;
+	cache->used = sizeof( imageCacheHeader_t );
+}
+
+/*
+================
+R_CacheImageLevel
+================
+*/
+static void R_CacheImageLevel( imageCacheFile_t *cache, int width, int height, const void *pixels )
+{
+	int		*level;
+	int		size;
+
+	if ( !cache->buffer ) {
+		return;
+	}
+
+	size = width * height * 4;
+	if ( cache->used + 2 * (int)sizeof( int ) + size > cache->size ) {
+		ri.Error( ERR_DROP, "R_CacheImageLevel: overflow" );
+	}
+
+	level = (int *)( cache->buffer + cache->used );
+	level[0] = width;
+	level[1] = height;
+	Com_Memcpy( level + 2, pixels, size );
+
+	cache->used += 2 * sizeof( int ) + size;
+	( (imageCacheHeader_t *)cache->buffer )->numLevels++;
+}
+
+/*
+================
+R_WriteCacheImage
+================
+*/
+static void R_WriteCacheImage( imageCacheFile_t *cache, int uploadWidth, int uploadHeight, int internalFormat )
+{
+	imageCacheHeader_t	*header = (imageCacheHeader_t *)cache->buffer;
+
+	header->ident = IMAGE_CACHE_IDENT;
+	header->version = IMAGE_CACHE_VERSION;
+	Q_strncpyz( header->key, cache->key->key, sizeof( header->key ) );
+	header->width = cache->width;
+	header->height = cache->height;
+	header->uploadWidth = uploadWidth;
+	header->uploadHeight = uploadHeight;
+	header->internalFormat = internalFormat;
+
+	ri.FS_WriteFile( cache->key->path, cache->buffer, cache->used );
+
+	ri.Hunk_FreeTempMemory( cache->buffer );
+	cache->buffer = NULL;
+}
+
+/*
+================
+R_PruneImageCache
+================
+*/
+void R_PruneImageCache( void )
+{
+	if ( !r_imageCache->integer ) {
+		return;
+	}
+
+	ri.FS_PruneHomeDir( IMAGE_CACHE_DIR, ".img", (int64_t)r_imageCacheSize->integer << 20 );
+}
+
+/*
+================
+R_CheckCacheImage
+
+A file that does not match, from another key with the same hash
+or a write that was cut short, is rebuilt and overwritten
+================
+*/
+static bool R_CheckCacheImage( const imageCacheHeader_t *header, int length, const imageCacheKey_t *cacheKey )
+{
+	const int	*level;
+	int			offset;
+	int			i;
+
+	if ( length < (int)sizeof( *header ) ) {
+		return false;
+	}
+
+	if ( header->ident != IMAGE_CACHE_IDENT || header->version != IMAGE_CACHE_VERSION ) {
+		return false;
+	}
+
+	if ( strncmp( header->key, cacheKey->key, sizeof( header->key ) ) ) {
+		return false;
+	}
+
+	if ( header->width <= 0 || header->height <= 0 || header->numLevels < 1 || header->numLevels > 32 ) {
+		return false;
+	}
+
+	offset = sizeof( *header );
+	for ( i = 0; i < header->numLevels; i++ ) {
+		if ( length - offset < 2 * (int)sizeof( int ) ) {
+			return false;
+		}
+
+		level = (const int *)( (const byte *)header + offset );
+		if ( level[0] < 1 || level[0] > glConfig.maxTextureSize || level[1] < 1 || level[1] > glConfig.maxTextureSize ) {
+			return false;
+		}
+
+		offset += 2 * sizeof( int );
+		if ( length - offset < level[0] * level[1] * 4 ) {
+			return false;
+		}
+		offset += level[0] * level[1] * 4;
+	}
+
+	return offset == length;
+}
+
+
 /*
 ===============
 Upload32
@@ -561,17 +841,21 @@ static void Upload32( unsigned *data,
 							bool lightMap,
 						  bool allowCompression,
 						  int *format, 
-						  int *pUploadWidth, int *pUploadHeight )
+						  int *pUploadWidth, int *pUploadHeight,
+						  const imageCacheKey_t *cacheKey )
 {
 	int			samples;
 	unsigned	*scaledBuffer = NULL;
 	unsigned	*resampledBuffer = NULL;
+	imageCacheFile_t	cache;
 	int			scaled_width, scaled_height;
 	int			i, c;
 	byte		*scan;
 	GLenum		internalFormat = GL_RGB;
 	float		rMax = 0, gMax = 0, bMax = 0;
 
+	R_BeginCacheImage( &cache, cacheKey, width, height );
+
 	//
 	// convert to exact power of 2 sizes
 	//
@@ -623,6 +907,10 @@ static void Upload32( unsigned *data,
 
 	scaledBuffer = (unsigned*)ri.Hunk_AllocateTempMemory( sizeof( unsigned ) * scaled_width * scaled_height );
 
+	if ( cacheKey ) {
+		R_AllocCacheImage( &cache, scaled_width, scaled_height, mipmap );
+	}
+
 	//
 	// scan the texture for each channel's max values
 	// and verify if the alpha channel is being used or not
@@ -751,6 +1039,7 @@ static void Upload32( unsigned *data,
 		( scaled_height == height ) ) {
 		if (!mipmap)
 		{
+			R_CacheImageLevel( &cache, scaled_width, scaled_height, data );
 			qglTexImage2D (GL_TEXTURE_2D, 0, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 			*pUploadWidth = scaled_width;
 			*pUploadHeight = scaled_height;
@@ -783,6 +1072,7 @@ static void Upload32( unsigned *data,
 	*pUploadHeight = scaled_height;
 	*format = internalFormat;
 
+	R_CacheImageLevel( &cache, scaled_width, scaled_height, scaledBuffer );
 	qglTexImage2D (GL_TEXTURE_2D, 0, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledBuffer );
 
 	if (mipmap)
@@ -805,30 +1095,17 @@ static void Upload32( unsigned *data,
 				R_BlendOverTexture( (byte *)scaledBuffer, scaled_width * scaled_height, mipBlendColors[miplevel] );
 			}
 
+			R_CacheImageLevel( &cache, scaled_width, scaled_height, scaledBuffer );
 			qglTexImage2D (GL_TEXTURE_2D, miplevel, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledBuffer );
 		}
 	}
 done:
 
-	if (mipmap)
-	{
-		if ( glConfig.textureFilterAnisotropic )
-			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
-					(GLint)Com_Clamp( 1, glConfig.maxAnisotropy, r_ext_max_anisotropy->integer ) );
+	R_TextureFilter( mipmap );
 
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
+	if ( cache.buffer ) {
+		R_WriteCacheImage( &cache, *pUploadWidth, *pUploadHeight, *format );
 	}
-	else
-	{
-		if ( glConfig.textureFilterAnisotropic )
-			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1 );
-
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	}
-
-	GL_CheckErrors();
 
 	if ( scaledBuffer != 0 )
 		ri.Hunk_FreeTempMemory( scaledBuffer );
@@ -839,27 +1116,22 @@ done:
 
 /*
 ================
-R_CreateImage
+R_AllocImage
 
-This is the only way any image_t are created
+Allocates and hashes an image_t without uploading anything, so an
+r_asyncImages decode can hand out the image before its pixels exist
 ================
 */
-image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
-		imgType_t type, int flags, int internalFormat ) {
+image_t *R_AllocImage( const char *name, int width, int height, imgType_t type, int flags ) {
 	image_t		*image;
-	bool	isLightmap = false;
 	long		hash;
-	int         glWrapClampMode;
 
 	if (strlen(name) >= MAX_QPATH ) {
-		ri.Error (ERR_DROP, "R_CreateImage: \"%s\" is too long", name);
-	}
-	if ( !strncmp( name, "*lightmap", 9 ) ) {
-		isLightmap = true;
+		ri.Error (ERR_DROP, "R_AllocImage: \"%s\" is too long", name);
 	}
 
 	if ( tr.numImages == MAX_DRAWIMAGES ) {
-		ri.Error( ERR_DROP, "R_CreateImage: MAX_DRAWIMAGES hit");
+		ri.Error( ERR_DROP, "R_AllocImage: MAX_DRAWIMAGES hit");
 	}
 
 	image = tr.images[tr.numImages] = (image_t*)ri.Hunk_Alloc( sizeof( image_t ), h_low );
@@ -873,13 +1145,24 @@ image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
 
 	image->width = width;
 	image->height = height;
-	if (flags & IMGFLAG_CLAMPTOEDGE)
-		glWrapClampMode = GL_CLAMP_TO_EDGE;
-	else
-		glWrapClampMode = GL_REPEAT;
 
+	hash = generateHashValue(name);
+	image->next = hashTable[hash];
+	hashTable[hash] = image;
+
+	return image;
+}
+
+/*
+================
+R_BeginImageUpload
+
+Binds image on the TMU it will be used with
+================
+*/
+static void R_BeginImageUpload( image_t *image ) {
 	// lightmaps are always allocated on TMU 1
-	if ( qglActiveTextureARB && isLightmap ) {
+	if ( qglActiveTextureARB && !strncmp( image->imgName, "*lightmap", 9 ) ) {
 		image->TMU = 1;
 	} else {
 		image->TMU = 0;
@@ -890,15 +1173,20 @@ image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
 	}
 
 	GL_Bind(image);
+}
 
-	Upload32( (unsigned *)pic, image->width, image->height, 
-								(image->flags & IMGFLAG_MIPMAP) == IMGFLAG_MIPMAP,
-								(image->flags & IMGFLAG_PICMIP) == IMGFLAG_PICMIP,
-								isLightmap,
-								!(image->flags & IMGFLAG_NO_COMPRESSION),
-								&image->internalFormat,
-								&image->uploadWidth,
-								&image->uploadHeight );
+/*
+================
+R_EndImageUpload
+================
+*/
+static void R_EndImageUpload( image_t *image ) {
+	int         glWrapClampMode;
+
+	if (image->flags & IMGFLAG_CLAMPTOEDGE)
+		glWrapClampMode = GL_CLAMP_TO_EDGE;
+	else
+		glWrapClampMode = GL_REPEAT;
 
 	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, glWrapClampMode );
 	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, glWrapClampMode );
@@ -909,10 +1197,96 @@ image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
 	if ( image->TMU == 1 ) {
 		GL_SelectTexture( 0 );
 	}
+}
 
-	hash = generateHashValue(name);
-	image->next = hashTable[hash];
-	hashTable[hash] = image;
+/*
+================
+R_UploadImage
+
+pic is image->width by image->height, the uploaded
+levels are written to r_imageCache if cacheKey is set
+================
+*/
+void R_UploadImage( image_t *image, byte *pic, const imageCacheKey_t *cacheKey ) {
+	R_BeginImageUpload( image );
+
+	Upload32( (unsigned *)pic, image->width, image->height, 
+								(image->flags & IMGFLAG_MIPMAP) == IMGFLAG_MIPMAP,
+								(image->flags & IMGFLAG_PICMIP) == IMGFLAG_PICMIP,
+								!strncmp( image->imgName, "*lightmap", 9 ),
+								!(image->flags & IMGFLAG_NO_COMPRESSION),
+								&image->internalFormat,
+								&image->uploadWidth,
+								&image->uploadHeight,
+								cacheKey );
+
+	R_EndImageUpload( image );
+}
+
+/*
+================
+R_LoadCacheImage
+
+Creates the image from its r_imageCache file, returns NULL if
+there is none for cacheKey
+================
+*/
+static image_t *R_LoadCacheImage( const char *name, imgType_t type, int flags, const imageCacheKey_t *cacheKey ) {
+	imageCacheHeader_t	*header;
+	image_t		*image;
+	const int	*level;
+	byte		*data;
+	int			length;
+	int			offset;
+	int			i;
+
+	data = (byte *)ri.FS_MapHomeFile( cacheKey->path, &length );
+	if ( !data ) {
+		return NULL;
+	}
+
+	header = (imageCacheHeader_t *)data;
+	if ( !R_CheckCacheImage( header, length, cacheKey ) ) {
+		ri.Printf( PRINT_DEVELOPER, "WARNING: rebuilding %s for %s\n", cacheKey->path, name );
+		ri.FS_UnmapHomeFile( data, length );
+		return NULL;
+	}
+
+	image = R_AllocImage( name, header->width, header->height, type, flags );
+
+	R_BeginImageUpload( image );
+
+	offset = sizeof( *header );
+	for ( i = 0; i < header->numLevels; i++ ) {
+		level = (const int *)( data + offset );
+		qglTexImage2D( GL_TEXTURE_2D, i, header->internalFormat, level[0], level[1], 0, GL_RGBA, GL_UNSIGNED_BYTE, level + 2 );
+		offset += 2 * sizeof( int ) + level[0] * level[1] * 4;
+	}
+
+	image->uploadWidth = header->uploadWidth;
+	image->uploadHeight = header->uploadHeight;
+	image->internalFormat = header->internalFormat;
+
+	R_TextureFilter( ( flags & IMGFLAG_MIPMAP ) == IMGFLAG_MIPMAP );
+	R_EndImageUpload( image );
+
+	ri.FS_UnmapHomeFile( data, length );
+	return image;
+}
+
+/*
+================
+R_CreateImage
+
+Allocates and uploads an image_t in one step
+================
+*/
+image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
+		imgType_t type, int flags, int internalFormat ) {
+	image_t		*image;
+
+	image = R_AllocImage( name, width, height, type, flags );
+	R_UploadImage( image, pic, NULL );
 
 	return image;
 }
@@ -1022,6 +1396,69 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 }
 
 
+/*
+=================
+R_FindImageLoader
+
+Picks the file and loader R_LoadImage would use, going by which files
+exist rather than which decode. Returns false if there are none.
+=================
+*/
+static bool R_FindImageLoader( const char *name, char *fileName, imageLoader_t *loader )
+{
+	int orgLoader = -1;
+	int i;
+	char localName[ MAX_QPATH ];
+	const char *ext;
+
+	Q_strncpyz( localName, name, MAX_QPATH );
+
+	ext = COM_GetExtension( localName );
+
+	if( *ext )
+	{
+		for( i = 0; i < numImageLoaders; i++ )
+		{
+			if( !Q_stricmp( ext, imageLoaders[ i ].ext ) )
+			{
+				if( ri.FS_ReadFile( localName, NULL ) > 0 )
+				{
+					Q_strncpyz( fileName, localName, MAX_QPATH );
+					*loader = imageLoaders[ i ].ImageLoader;
+					return true;
+				}
+
+				orgLoader = i;
+				COM_StripExtension( name, localName, MAX_QPATH );
+				break;
+			}
+		}
+	}
+
+	for( i = 0; i < numImageLoaders; i++ )
+	{
+		if (i == orgLoader)
+			continue;
+
+		Com_sprintf( fileName, MAX_QPATH, "%s.%s", localName, imageLoaders[ i ].ext );
+
+		if( ri.FS_ReadFile( fileName, NULL ) > 0 )
+		{
+			if( orgLoader >= 0 )
+			{
+				ri.Printf( PRINT_DEVELOPER, "WARNING: %s not present, using %s instead\n",
+						name, fileName );
+			}
+
+			*loader = imageLoaders[ i ].ImageLoader;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 /*
 ===============
 R_FindImageFile
@@ -1058,6 +1495,48 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, int /*imgFlags_t*/ f
 		}
 	}
 
+	if ( r_imageCache->integer || r_asyncImages->integer ) {
+		char			fileName[MAX_QPATH];
+		imageLoader_t	loader;
+		imageCacheKey_t	key, *cacheKey = NULL;
+
+		if ( !R_FindImageLoader( name, fileName, &loader ) ) {
+			return NULL;
+		}
+
+		//
+		// skip the decode if r_imageCache has this image processed already
+		//
+		if ( R_ImageCacheKey( name, fileName, flags, &key ) ) {
+			cacheKey = &key;
+
+			image = R_LoadCacheImage( name, type, flags, cacheKey );
+			if ( image ) {
+				return image;
+			}
+		}
+
+		//
+		// hand the decode to the r_asyncImages workers, it is
+		// uploaded by R_FinishImageJobs or the first GL_Bind
+		//
+		if ( r_asyncImages->integer ) {
+			image = R_AllocImage( name, 0, 0, type, flags );
+			R_QueueImageJob( image, fileName, loader, cacheKey );
+			return image;
+		}
+
+		R_LoadImage( name, &pic, &width, &height );
+		if ( pic == NULL ) {
+			return NULL;
+		}
+
+		image = R_AllocImage( name, width, height, type, flags );
+		R_UploadImage( image, pic, cacheKey );
+		ri.Free( pic );
+		return image;
+	}
+
 	//
 	// load the pic from disk
 	//
@@ -1371,6 +1850,8 @@ R_DeleteTextures
 void R_DeleteTextures( void ) {
 	int		i;
 
+	R_CancelImageJobs();
+
 	for ( i=0; i<tr.numImages ; i++ ) {
 		qglDeleteTextures( 1, &tr.images[i]->texnum );
 	}
@@ -0,0 +1,688 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// tr_imagejobs.c
+
+#include "tr_local.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+=============================================================================
+
+IMAGE JOBS
+
+With r_asyncImages set, R_FindImageFile reads the file on the main thread,
+hands back an image_t straight away and queues the decode for a pool of
+worker threads.  The GL upload stays on the main thread: finished images are
+uploaded as the queue backs up, when something binds one, and all at once in
+RE_EndRegistration, so everything is resident before the first frame.
+
+The image loaders only know how to talk to the engine through ri, and the
+engine is not thread safe.  While a loader runs on a job, the ri calls it
+makes are redirected: the file comes from the job's buffer, memory comes
+from malloc and is tracked by the job, prints are kept for the main thread
+and ri.Error unwinds back to R_RunImageJob on the same thread, freeing
+whatever the loader had allocated, so the main thread can raise it again.
+Calls from the main thread go straight through.  The redirections are only
+in ri while jobs are outstanding, the real imports are back once
+RE_EndRegistration has uploaded everything.
+
+=============================================================================
+*/
+
+#define MAX_IMAGE_JOBS		64		// outstanding decodes before the main thread uploads some
+#define MAX_JOB_MESSAGE		1024
+
+// header in front of every block a loader allocates on a job
+typedef struct jobAlloc_s {
+	struct jobAlloc_s	*prev, *next;
+} jobAlloc_t;
+
+#define JOB_ALLOC_HEADER	( ( sizeof( jobAlloc_t ) + 15 ) & ~15 )
+
+typedef struct imageJob_s {
+	image_t			*image;
+	char			fileName[MAX_QPATH];
+	imageLoader_t	loader;
+
+	imageCacheKey_t	cacheKey;		// written to r_imageCache on upload if writeCache
+	bool			writeCache;
+
+	void			*buffer;		// file contents, malloc'd
+	long			length;
+
+	byte			*pic;			// decoded pixels, one of allocs
+	jobAlloc_t		allocs;			// everything the loader allocated and didn't free
+	int				width, height;
+
+	int				errorLevel;		// ri.Error raised by the loader, -1 if none
+	int				printLevel;
+	char			message[MAX_JOB_MESSAGE];
+
+	bool			done;
+	struct imageJob_s	*nextQueued;
+} imageJob_t;
+
+static imageJob_t	*outstandingJobs[MAX_IMAGE_JOBS];	// main thread only
+static int			numOutstandingJobs;
+
+static imageJob_t	*queueHead, *queueTail;				// under jobLock
+static bool			workersQuit;
+static std::mutex	jobLock;
+static std::condition_variable	jobQueued;
+static std::condition_variable	jobDone;
+static std::thread	*workers[8];
+static int			numWorkers;
+
+static thread_local imageJob_t	*currentJob;
+static thread_local jmp_buf		currentJobAbort;	// in R_RunImageJob on this thread
+
+// the real engine imports, while ri holds the redirections below
+static bool		importsRedirected;
+static void		(QDECL *realPrintf)( int printLevel, const char *fmt, ... ) __attribute__ ((format (printf, 2, 3)));
+static void		(QDECL *realError)( int errorLevel, const char *fmt, ... ) __attribute__ ((noreturn, format (printf, 2, 3)));
+static void		*(*realMalloc)( int bytes );
+static void		(*realFree)( void *buf );
+static long		(*realReadFile)( const char *name, void **buf );
+static void		(*realFreeFile)( void *buf );
+
+/*
+=============================================================================
+
+REDIRECTED IMPORTS
+
+=============================================================================
+*/
+
+static void QDECL R_JobError( int errorLevel, const char *fmt, ... ) __attribute__ ((noreturn, format (printf, 2, 3)));
+
+static void QDECL R_JobPrintf( int printLevel, const char *fmt, ... ) {
+	va_list		argptr;
+	char		text[MAX_JOB_MESSAGE];
+	imageJob_t	*job = currentJob;
+
+	va_start( argptr, fmt );
+	Q_vsnprintf( text, sizeof( text ), fmt, argptr );
+	va_end( argptr );
+
+	if ( !job ) {
+		realPrintf( printLevel, "%s", text );
+		return;
+	}
+
+	job->printLevel = printLevel;
+	Q_strcat( job->message, sizeof( job->message ), text );
+}
+
+static void QDECL R_JobError( int errorLevel, const char *fmt, ... ) {
+	va_list		argptr;
+	char		text[MAX_JOB_MESSAGE];
+	imageJob_t	*job = currentJob;
+
+	va_start( argptr, fmt );
+	Q_vsnprintf( text, sizeof( text ), fmt, argptr );
+	va_end( argptr );
+
+	if ( !job ) {
+		realError( errorLevel, "%s", text );
+	}
+
+	job->errorLevel = errorLevel;
+	Q_strncpyz( job->message, text, sizeof( job->message ) );
+	longjmp( currentJobAbort, 1 );
+}
+
+static void *R_JobMalloc( int bytes ) {
+	imageJob_t	*job = currentJob;
+	jobAlloc_t	*alloc;
+
+	if ( !job ) {
+		return realMalloc( bytes );
+	}
+
+	// Z_Malloc hands out cleared memory, the loaders may rely on it
+	alloc = (jobAlloc_t *)calloc( 1, JOB_ALLOC_HEADER + bytes );
+	if ( !alloc ) {
+		R_JobError( ERR_DROP, "R_JobMalloc: failed on allocation of %i bytes", bytes );
+	}
+
+	alloc->prev = &job->allocs;
+	alloc->next = job->allocs.next;
+	alloc->next->prev = alloc;
+	job->allocs.next = alloc;
+
+	return (byte *)alloc + JOB_ALLOC_HEADER;
+}
+
+static void R_FreeJobAlloc( void *buf ) {
+	jobAlloc_t	*alloc = (jobAlloc_t *)( (byte *)buf - JOB_ALLOC_HEADER );
+
+	alloc->prev->next = alloc->next;
+	alloc->next->prev = alloc->prev;
+	free( alloc );
+}
+
+static void R_FreeJobAllocs( imageJob_t *job ) {
+	while ( job->allocs.next != &job->allocs ) {
+		R_FreeJobAlloc( (byte *)job->allocs.next + JOB_ALLOC_HEADER );
+	}
+}
+
+static void R_JobFree( void *buf ) {
+	if ( !currentJob ) {
+		realFree( buf );
+		return;
+	}
+
+	R_FreeJobAlloc( buf );
+}
+
+static long R_JobReadFile( const char *name, void **buf ) {
+	imageJob_t	*job = currentJob;
+
+	if ( !job ) {
+		return realReadFile( name, buf );
+	}
+
+	if ( Q_stricmp( name, job->fileName ) ) {
+		if ( buf ) {
+			*buf = NULL;
+		}
+		return -1;
+	}
+
+	if ( buf ) {
+		*buf = job->buffer;
+	}
+	return job->length;
+}
+
+static void R_JobFreeFile( void *buf ) {
+	// the job's buffer is released by R_UploadImageJob
+	if ( !currentJob ) {
+		realFreeFile( buf );
+	}
+}
+
+/*
+===============
+R_RedirectImports
+
+Called before the first job is queued, no worker is running a loader
+===============
+*/
+static void R_RedirectImports( void ) {
+	if ( importsRedirected ) {
+		return;
+	}
+
+	realPrintf = ri.Printf;
+	realError = ri.Error;
+	realMalloc = ri.Malloc;
+	realFree = ri.Free;
+	realReadFile = ri.FS_ReadFile;
+	realFreeFile = ri.FS_FreeFile;
+
+	ri.Printf = R_JobPrintf;
+	ri.Error = R_JobError;
+	ri.Malloc = R_JobMalloc;
+	ri.Free = R_JobFree;
+	ri.FS_ReadFile = R_JobReadFile;
+	ri.FS_FreeFile = R_JobFreeFile;
+
+	importsRedirected = true;
+}
+
+/*
+===============
+R_RestoreImports
+
+Called once the last job is released, ri is the refimport GetRefAPI
+filled it with again outside of registration
+===============
+*/
+static void R_RestoreImports( void ) {
+	if ( !importsRedirected ) {
+		return;
+	}
+
+	ri.Printf = realPrintf;
+	ri.Error = realError;
+	ri.Malloc = realMalloc;
+	ri.Free = realFree;
+	ri.FS_ReadFile = realReadFile;
+	ri.FS_FreeFile = realFreeFile;
+
+	importsRedirected = false;
+}
+
+/*
+=============================================================================
+
+WORKERS
+
+=============================================================================
+*/
+
+/*
+===============
+R_RunImageJob
+
+Decodes on whichever thread gets to the job first
+===============
+*/
+static void R_RunImageJob( imageJob_t *job ) {
+	currentJob = job;
+
+	if ( !setjmp( currentJobAbort ) ) {
+		job->loader( job->fileName, &job->pic, &job->width, &job->height );
+	} else {
+		// the loader is gone, so is anything it had allocated,
+		// R_UploadImageJob raises the error on the main thread
+		R_FreeJobAllocs( job );
+		job->pic = NULL;
+	}
+
+	currentJob = NULL;
+}
+
+/*
+===============
+R_ImageJobWorker
+===============
+*/
+static void R_ImageJobWorker( void ) {
+	imageJob_t	*job;
+
+	std::unique_lock<std::mutex> lock( jobLock );
+
+	while ( 1 ) {
+		jobQueued.wait( lock, [] { return workersQuit || queueHead; } );
+
+		if ( workersQuit ) {
+			return;
+		}
+
+		job = queueHead;
+		queueHead = job->nextQueued;
+		if ( !queueHead ) {
+			queueTail = NULL;
+		}
+
+		lock.unlock();
+		R_RunImageJob( job );
+		lock.lock();
+
+		job->done = true;
+		jobDone.notify_all();
+	}
+}
+
+/*
+===============
+R_StartImageJobWorkers
+===============
+*/
+static void R_StartImageJobWorkers( void ) {
+	int		i;
+
+	if ( numWorkers ) {
+		return;
+	}
+
+	workersQuit = false;
+	numWorkers = r_asyncImages->integer;
+	if ( numWorkers > (int)ARRAY_LEN( workers ) ) {
+		numWorkers = ARRAY_LEN( workers );
+	}
+
+	for ( i = 0; i < numWorkers; i++ ) {
+		workers[i] = new std::thread( R_ImageJobWorker );
+	}
+}
+
+/*
+===============
+R_ShutdownImageJobs
+
+The workers have to be gone before the renderer library is unloaded
+===============
+*/
+void R_ShutdownImageJobs( void ) {
+	int		i;
+
+	R_CancelImageJobs();
+	R_RestoreImports();
+
+	if ( !numWorkers ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( jobLock );
+		workersQuit = true;
+	}
+	jobQueued.notify_all();
+
+	for ( i = 0; i < numWorkers; i++ ) {
+		workers[i]->join();
+		delete workers[i];
+		workers[i] = NULL;
+	}
+	numWorkers = 0;
+}
+
+/*
+=============================================================================
+
+MAIN THREAD
+
+=============================================================================
+*/
+
+/*
+===============
+R_UnqueueImageJob
+
+Takes a job back off the queue before any worker started it, jobLock held
+===============
+*/
+static bool R_UnqueueImageJob( imageJob_t *job ) {
+	imageJob_t	**link;
+	imageJob_t	*prev = NULL;
+
+	for ( link = &queueHead; *link; prev = *link, link = &(*link)->nextQueued ) {
+		if ( *link == job ) {
+			*link = job->nextQueued;
+			if ( queueTail == job ) {
+				queueTail = prev;
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+===============
+R_ReleaseImageJob
+===============
+*/
+static void R_ReleaseImageJob( int index ) {
+	imageJob_t	*job = outstandingJobs[index];
+
+	outstandingJobs[index] = outstandingJobs[--numOutstandingJobs];
+
+	job->image->job = NULL;
+	R_FreeJobAllocs( job );
+	free( job->buffer );
+	free( job );
+
+	// every job is done, nothing is in a loader
+	if ( !numOutstandingJobs ) {
+		R_RestoreImports();
+	}
+}
+
+/*
+===============
+R_UploadImageJob
+
+A failed decode leaves the image showing the default texture, as
+R_FindImageFile could no longer return NULL for it
+===============
+*/
+static void R_UploadImageJob( int index ) {
+	imageJob_t	*job = outstandingJobs[index];
+	image_t		*image = job->image;
+	char		message[MAX_JOB_MESSAGE];
+	int			errorLevel;
+
+	if ( job->errorLevel >= 0 ) {
+		errorLevel = job->errorLevel;
+		Q_strncpyz( message, job->message, sizeof( message ) );
+		R_ReleaseImageJob( index );
+		ri.Error( errorLevel, "%s", message );
+	}
+
+	if ( job->message[0] ) {
+		ri.Printf( job->printLevel, "%s", job->message );
+	}
+
+	// clear the job first, R_UploadImage binds the image
+	image->job = NULL;
+
+	if ( job->pic ) {
+		image->width = job->width;
+		image->height = job->height;
+		R_UploadImage( image, job->pic, job->writeCache ? &job->cacheKey : NULL );
+	} else {
+		ri.Printf( PRINT_WARNING, "WARNING: couldn't load image %s\n", job->fileName );
+
+		image->texnum = tr.defaultImage->texnum;
+		image->width = tr.defaultImage->width;
+		image->height = tr.defaultImage->height;
+		image->uploadWidth = tr.defaultImage->uploadWidth;
+		image->uploadHeight = tr.defaultImage->uploadHeight;
+		image->internalFormat = tr.defaultImage->internalFormat;
+	}
+
+	R_ReleaseImageJob( index );
+}
+
+/*
+===============
+R_DrainImageJobs
+
+Uploads finished jobs until no more than keep are outstanding, decoding
+still queued ones here rather than sitting idle waiting for the workers
+===============
+*/
+static void R_DrainImageJobs( int keep ) {
+	imageJob_t	*job;
+	int			i;
+
+	std::unique_lock<std::mutex> lock( jobLock );
+
+	while ( numOutstandingJobs > keep ) {
+		for ( i = 0; i < numOutstandingJobs; i++ ) {
+			if ( outstandingJobs[i]->done ) {
+				break;
+			}
+		}
+
+		if ( i < numOutstandingJobs ) {
+			lock.unlock();
+			R_UploadImageJob( i );
+			lock.lock();
+			continue;
+		}
+
+		if ( queueHead ) {
+			job = queueHead;
+			R_UnqueueImageJob( job );
+
+			lock.unlock();
+			R_RunImageJob( job );
+			lock.lock();
+
+			job->done = true;
+			continue;
+		}
+
+		jobDone.wait( lock );
+	}
+}
+
+/*
+===============
+R_QueueImageJob
+===============
+*/
+void R_QueueImageJob( image_t *image, const char *fileName, imageLoader_t loader, const imageCacheKey_t *cacheKey ) {
+	imageJob_t	*job;
+	void		*data;
+	long		length;
+
+	if ( numOutstandingJobs == MAX_IMAGE_JOBS ) {
+		R_DrainImageJobs( MAX_IMAGE_JOBS / 2 );
+	}
+
+	// copy the file out of the hunk's temp memory, the
+	// jobs finish in any order but it frees in stack order
+	length = ri.FS_ReadFile( fileName, &data );
+
+	job = (imageJob_t *)calloc( 1, sizeof( *job ) );
+	job->image = image;
+	job->allocs.prev = job->allocs.next = &job->allocs;
+	Q_strncpyz( job->fileName, fileName, sizeof( job->fileName ) );
+	job->loader = loader;
+	if ( cacheKey ) {
+		job->cacheKey = *cacheKey;
+		job->writeCache = true;
+	}
+	job->errorLevel = -1;
+	job->length = length;
+
+	if ( data ) {
+		job->buffer = malloc( length + 1 );
+		Com_Memcpy( job->buffer, data, length );
+		( (byte *)job->buffer )[length] = 0;
+		ri.FS_FreeFile( data );
+	} else {
+		job->length = -1;
+	}
+
+	image->job = job;
+	outstandingJobs[numOutstandingJobs++] = job;
+
+	R_RedirectImports();
+
+	R_StartImageJobWorkers();
+
+	{
+		std::lock_guard<std::mutex> lock( jobLock );
+
+		if ( queueTail ) {
+			queueTail->nextQueued = job;
+		} else {
+			queueHead = job;
+		}
+		queueTail = job;
+	}
+	jobQueued.notify_one();
+}
+
+/*
+===============
+R_FinishImageJob
+
+Something needs this image now
+===============
+*/
+void R_FinishImageJob( image_t *image ) {
+	imageJob_t	*job = image->job;
+	int			i;
+
+	{
+		std::unique_lock<std::mutex> lock( jobLock );
+
+		if ( R_UnqueueImageJob( job ) ) {
+			lock.unlock();
+			R_RunImageJob( job );
+			lock.lock();
+
+			job->done = true;
+		}
+
+		jobDone.wait( lock, [job] { return job->done; } );
+	}
+
+	for ( i = 0; i < numOutstandingJobs; i++ ) {
+		if ( outstandingJobs[i] == job ) {
+			R_UploadImageJob( i );
+			return;
+		}
+	}
+}
+
+/*
+===============
+R_FinishImageJobs
+
+Everything registered so far is uploaded on return
+===============
+*/
+void R_FinishImageJobs( void ) {
+	R_DrainImageJobs( 0 );
+}
+
+/*
+===============
+R_CancelImageJobs
+
+Drops every outstanding job without uploading it
+===============
+*/
+void R_CancelImageJobs( void ) {
+	imageJob_t	*job;
+	int			i;
+
+	if ( !numOutstandingJobs ) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock( jobLock );
+
+		for ( i = 0; i < numOutstandingJobs; i++ ) {
+			job = outstandingJobs[i];
+
+			if ( R_UnqueueImageJob( job ) ) {
+				job->done = true;
+			}
+		}
+
+		jobDone.wait( lock, [] {
+			int		j;
+
+			for ( j = 0; j < numOutstandingJobs; j++ ) {
+				if ( !outstandingJobs[j]->done ) {
+					return false;
+				}
+			}
+			return true;
+		} );
+	}
+
+	while ( numOutstandingJobs ) {
+		R_ReleaseImageJob( numOutstandingJobs - 1 );
+	}
+}
@@ -116,6 +116,9 @@ cvar_t	*r_singleShader;
 cvar_t	*r_roundImagesDown;
 cvar_t	*r_colorMipLevels;
 cvar_t	*r_picmip;
+cvar_t	*r_asyncImages;
+cvar_t	*r_imageCache;
+cvar_t	*r_imageCacheSize;
 cvar_t	*r_showtris;
 cvar_t	*r_showsky;
 cvar_t	*r_shownormals;
@@ -949,6 +952,11 @@ void R_Register( void )
 	r_ext_max_anisotropy = ri.Cvar_Get( "r_ext_max_anisotropy", "2", CVAR_ARCHIVE | CVAR_LATCH );
 
 	r_roundImagesDown = ri.Cvar_Get ("r_roundImagesDown", "1", CVAR_ARCHIVE | CVAR_LATCH );
+	r_asyncImages = ri.Cvar_Get( "r_asyncImages", "0", CVAR_ARCHIVE | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_asyncImages, 0, 8, true );
+	r_imageCache = ri.Cvar_Get( "r_imageCache", "0", CVAR_ARCHIVE | CVAR_LATCH );
+	r_imageCacheSize = ri.Cvar_Get( "r_imageCacheSize", "256", CVAR_ARCHIVE );
+	ri.Cvar_CheckRange( r_imageCacheSize, 0, 65536, true );
 	r_colorMipLevels = ri.Cvar_Get ("r_colorMipLevels", "0", CVAR_LATCH );
 	ri.Cvar_CheckRange( r_picmip, 0, 16, true );
 	r_detailTextures = ri.Cvar_Get( "r_detailtextures", "1", CVAR_ARCHIVE | CVAR_LATCH );
@@ -1201,6 +1209,8 @@ void RE_Shutdown( bool destroyWindow ) {
 		R_DeleteTextures();
 	}
 
+	R_ShutdownImageJobs();
+
 	R_DoneFreeType();
 
 	// shut down platform specific OpenGL stuff
@@ -1223,6 +1233,8 @@ Touch all images to make sure they are resident
 =============
 */
 void RE_EndRegistration( void ) {
+	R_FinishImageJobs();
+	R_PruneImageCache();
 	R_IssuePendingRenderCommands();
 	if (!ri.Sys_LowPhysicalMemory()) {
 		RB_ShowImages();
@@ -1026,6 +1026,9 @@ extern	cvar_t	*r_singleShader;				// make most world faces use default shader
 extern	cvar_t	*r_roundImagesDown;
 extern	cvar_t	*r_colorMipLevels;				// development aid to see texture mip usage
 extern	cvar_t	*r_picmip;						// controls picmip values
+extern	cvar_t	*r_asyncImages;					// worker threads decoding images during registration
+extern	cvar_t	*r_imageCache;					// keep processed pk3 images in fs_homepath
+extern	cvar_t	*r_imageCacheSize;				// megabytes r_imageCache may take, least recently used go first
 extern	cvar_t	*r_finish;
 extern	cvar_t	*r_textureMode;
 extern	cvar_t	*r_offsetFactor;
@@ -1183,6 +1186,17 @@ void	R_InitFogTable( void );
 float	R_FogFactor( float s, float t );
 void	R_InitImages( void );
 void	R_DeleteTextures( void );
+
+#define MAX_IMAGE_CACHE_KEY	512
+
+typedef struct {
+	char	path[MAX_QPATH];			// r_imageCache file, relative to the gamedir
+	char	key[MAX_IMAGE_CACHE_KEY];	// source and settings the cached levels depend on
+} imageCacheKey_t;
+
+image_t	*R_AllocImage( const char *name, int width, int height, imgType_t type, int flags );
+void	R_UploadImage( image_t *image, byte *pic, const imageCacheKey_t *cacheKey );
+void	R_PruneImageCache( void );
 int		R_SumOfUsedImages( void );
 void	R_InitSkins( void );
 skin_t	*R_GetSkinByHandle( qhandle_t hSkin );
@@ -1191,6 +1205,17 @@ int R_ComputeLOD( trRefEntity_t *ent );
 
 const void *RB_TakeVideoFrameCmd( const void *data );
 
+//
+// tr_imagejobs.c
+//
+typedef void (*imageLoader_t)( const char *name, byte **pic, int *width, int *height );
+
+void	R_ShutdownImageJobs( void );
+void	R_QueueImageJob( image_t *image, const char *fileName, imageLoader_t loader, const imageCacheKey_t *cacheKey );
+void	R_FinishImageJob( image_t *image );
+void	R_FinishImageJobs( void );
+void	R_CancelImageJobs( void );
+
 //
 // tr_shader.c
 //
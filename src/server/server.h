@@ -89,6 +89,15 @@ struct configString_t {
     clientList_t clientList;
 };
 
+// the gamestate configstrings for cl_zgamestate clients, deflated once per
+// configstring revision instead of once per connecting client
+struct svZConfigstrings_t {
+    byte *data;
+    int length;
+    int rawLength;
+    int revision;
+};
+
 struct server_t {
     serverState_t state;
     bool restarting;  // if true, send configstring changes during SS_LOADING
@@ -102,6 +111,9 @@ struct server_t {
     int timeResidual;  // <= 1000 / sv_frame->value
     int nextFrameTime;  // when time > nextFrameTime, process world
     configString_t configstrings[MAX_CONFIGSTRINGS];
+    bool configstringsPending;  // SV_FlushConfigstrings has work this frame
+    int configstringRevision;  // bumped on every configstring change
+    svZConfigstrings_t zConfigstrings;
     svEntity_t svEntities[MAX_GENTITIES];
 
     char *entityParsePoint;  // used during game VM init
@@ -142,6 +154,16 @@ enum clientState_t {
     CS_ACTIVE  // client is fully in game
 };
 
+// a reliable server command, shared by the command rings of every client
+// it was sent to. bits is the Huffman coding of text, made the first time
+// the command is written to a message
+struct svCommand_t {
+    int refCount;
+    int numBits;  // -1 if text has to be written out each time
+    byte *bits;
+    char text[1];
+};
+
 struct netchan_buffer_t {
     msg_t msg;
     byte msgBuffer[MAX_MSGLEN];
@@ -153,7 +175,7 @@ struct client_t {
     char userinfo[MAX_INFO_STRING];  // name, etc
     char userinfobuffer[MAX_INFO_STRING];  ///< used for buffering of user info
 
-    char reliableCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+    svCommand_t *reliableCommands[MAX_RELIABLE_COMMANDS];
     int reliableSequence;  // last added reliable message, not necesarily sent or acknowledged yet
     int reliableAcknowledge;  // last acknowledged reliable message
     int reliableSent;  // last sent reliable message, not necesarily acknowledged yet
@@ -188,7 +210,12 @@ struct client_t {
     int nextReliableUserTime;  // svs.time when another userinfo change will be allowed
     int lastPacketTime;  // svs.time when packet was last received
     int lastConnectTime;  // svs.time when connection started
-    int lastSnapshotTime;  // svs.time of last sent snapshot
+    int lastSnapshotTime;  // svs.time of last sent snapshot, 0 asks for one right away
+    int nextSnapshotTime;  // SV_SnapshotClock() of the next send slot when sv_snapshotStagger is on
+    int64_t lastSnapshotUsec;  // Sys_Microseconds() the last snapshot went out
+    int snapshotJitter;  // smoothed distance of the snapshot gaps from snapshotMsec, usec
+    int snapshotJitterMax;  // largest distance since the last "framestats reset", usec
+    byte entityDeferrals[MAX_GENTITIES];  // snapshots in a row each entity's update was held back
     bool rateDelayed;  // true if nextSnapshotTime was set based on rate instead of snapshotMsec
     int timeoutCount;  // must timeout a few frames in a row so debugging doesn't break
     clientSnapshot_t frames[PACKET_BACKUP];  // updates can be delta'd from here
@@ -218,6 +245,10 @@ struct client_t {
 
     int oldServerTime;
     bool csUpdated[MAX_CONFIGSTRINGS];
+    bool csPending;  // csUpdated has changes this active client wasn't sent yet
+    bool csm;  // cl_csm, configstring updates can be batched into "csm" commands
+    bool zgamestate;  // cl_zgamestate, understands svc_zconfigstrings
+    bool netFields;  // cl_netFields matched, deltas use the profiled field tables
 };
 
 //=============================================================================
@@ -293,6 +324,51 @@ struct tempBan_t {
 #define SERVER_PERFORMANCECOUNTER_FRAMES    600
 #define SERVER_PERFORMANCECOUNTER_SAMPLES   6
 
+#define SERVER_FRAMESTATS_SAMPLES           4096  // must be a power of two
+
+// timed scopes, every one is kept per frame for the last SERVER_FRAMESTATS_SAMPLES frames
+enum svProfPhase_t {
+    PROF_FRAME,  // SV_Frame, only frames that ran the game are recorded
+    PROF_PACKETS,  // SV_PacketEvent, including the client messages below
+    PROF_CLIENTMSG,  // SV_ExecuteClientMessage
+    PROF_GAME,  // GAME_RUN_FRAME
+    PROF_GAME_PHASES,  // GAMEPHASE_NUM_PHASES sub-phases reported by the game
+    PROF_SNAPSHOT_BUILD = PROF_GAME_PHASES + GAMEPHASE_NUM_PHASES,
+    PROF_SNAPSHOT_ENCODE,
+    PROF_SNAPSHOT_SEND,
+    PROF_NUM_PHASES
+};
+
+// per frame counts, kept alongside the phases
+enum svProfCounter_t {
+    PROFC_PACKETS,  // packets received
+    PROFC_TRACES,  // SV_Trace calls
+    PROFC_LINKS,  // SV_LinkEntity calls
+    PROFC_SNAPSHOTS,  // snapshots sent
+    PROFC_BYTES_SENT,  // snapshot and gamestate bytes handed to the netchan
+    PROFC_DEFERRED,  // entity updates held back to fit a snapshot budget
+    PROF_NUM_COUNTERS
+};
+
+struct svProfile_t {
+    // the frame being measured, packet events in front of an SV_Frame are charged to it
+    int frame[PROF_NUM_PHASES];
+    int frameCounters[PROF_NUM_COUNTERS];
+
+    int gamePhase;  // gamePhase_t open in GAME_RUN_FRAME
+    int64_t gamePhaseStart;  // 0 when no phase is open
+
+    // history, written only by SV_Frame on the main thread so readers never see a torn frame
+    int phases[PROF_NUM_PHASES][SERVER_FRAMESTATS_SAMPLES];
+    int counters[PROF_NUM_COUNTERS][SERVER_FRAMESTATS_SAMPLES];
+    int numFrames;  // frames recorded since the last reset
+
+    int64_t totals[PROF_NUM_COUNTERS];  // monotonic, exported as counters
+    int64_t totalFrames;
+
+    int nextMetricsTime;  // svs.time of the next sv_metricsFile write
+};
+
 // this structure will be cleared only when the game dll changes
 struct serverStatic_t {
     bool initialized;  // sv_init has completed
@@ -318,6 +394,10 @@ struct serverStatic_t {
     int currentFrameIndex;
     int serverLoad;
     svstats_t stats;
+
+    svProfile_t prof;  // sv_profile scopes and counters
+
+    int snapshotWakeTime;  // SV_SnapshotClock() of the next staggered send slot, 0 if none
 };
 
 //=============================================================================
@@ -350,6 +430,7 @@ extern cvar_t *sv_minPing;
 extern cvar_t *sv_maxPing;
 extern cvar_t *sv_pure;
 extern cvar_t *sv_lanForceRate;
+extern cvar_t *sv_profiledFields;
 extern cvar_t *sv_banFile;
 
 extern	cvar_t *sv_protect;
@@ -362,6 +443,13 @@ extern cvar_t *sv_voipProtocol;
 
 extern cvar_t *sv_rsaAuth;
 
+extern cvar_t *sv_profile;
+extern cvar_t *sv_metricsFile;
+extern cvar_t *sv_metricsInterval;
+
+extern cvar_t *sv_snapshotStagger;
+extern cvar_t *sv_snapshotPriority;
+
 //===========================================================
 
 //
@@ -395,6 +483,7 @@ void SV_AddOperatorCommands(void);
 void SV_RemoveOperatorCommands(void);
 
 void SV_MasterShutdown(void);
+int SV_ClientRate(client_t *client);
 int SV_RateMsec(client_t *client);
 
 //
@@ -404,6 +493,8 @@ void SV_SetConfigstring(int index, const char *val);
 void SV_GetConfigstring(int index, char *buffer, int bufferSize);
 void SV_SetConfigstringRestrictions(int index, const clientList_t *clientList);
 void SV_UpdateConfigstrings(client_t *client);
+void SV_FlushConfigstrings(void);
+const char *SV_AlternateInfo(int index, int alternateProtocol);
 
 void SV_SetUserinfo(int index, const char *val);
 void SV_GetUserinfo(int index, char *buffer, int bufferSize);
@@ -429,6 +520,7 @@ void SV_ExecuteClientMessage(client_t *cl, msg_t *msg);
 void SV_UserinfoChanged(client_t *cl);
 
 void SV_ClientEnterWorld(client_t *client, usercmd_t *cmd);
+int SV_DeltaProtocol(client_t *client);
 void SV_FreeClient(client_t *client);
 void SV_DropClient(client_t *drop, const char *reason);
 
@@ -448,11 +540,15 @@ void SV_Heartbeat_f(void);
 // sv_snapshot.c
 //
 void SV_AddServerCommand(client_t *client, const char *cmd);
+const char *SV_ReliableCommand(client_t *client, int sequence);
+void SV_WriteServerCommand(msg_t *msg, svCommand_t *command);
+void SV_ClearReliableCommands(client_t *client);
 void SV_UpdateServerCommandsToClient(client_t *client, msg_t *msg);
 void SV_WriteFrameToClient(client_t *client, msg_t *msg);
 void SV_SendMessageToClient(msg_t *msg, client_t *client);
 void SV_SendClientMessages(void);
 void SV_SendClientSnapshot(client_t *client);
+int SV_SnapshotClock(void);
 
 //
 // sv_game.c
@@ -498,6 +594,10 @@ int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int m
 // returns the number of pointers filled in
 // The world entity is never returned in this list.
 
+int SV_EntitiesInRadius(const vec3_t origin, float radius, int contentmask, int *entityList, int maxcount);
+// the entities with bounding boxes closer than radius to origin, sorted
+// nearest first. A contentmask of 0 accepts any contents
+
 int SV_PointContents(const vec3_t p, int passEntityNum);
 // returns the CONTENTS_* value from the world and all entities at the given point.
 
@@ -517,6 +617,18 @@ void SV_ClipToEntity(trace_t *trace, const vec3_t start, const vec3_t mins, cons
     int entityNum, int contentmask, traceType_t type);
 // clip to a specific entity
 
+//
+// sv_profile.c
+//
+int64_t SV_ProfileStart(void);
+void SV_ProfileEnd(svProfPhase_t phase, int64_t start);
+void SV_ProfileGamePhase(int phase);
+void SV_ProfileEndFrame(int64_t frameStart);
+void SV_ProfileReset(void);
+void SV_ProfileMetrics_f(void);
+void SV_ProfileCount(svProfCounter_t counter, int amount);
+void SV_ProfileFrameStats_f(void);
+
 //
 // sv_net_chan.c
 //
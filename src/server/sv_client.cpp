@@ -26,6 +26,8 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 
 #include "server.h"
 
+#include "qcommon/deflate.h"
+
 static void SV_CloseDownload( client_t *cl );
 
 /*
@@ -206,7 +208,8 @@ void SV_GetChallenge(netadr_t from)
 		challenge->connected = false;
 
 		if ( sv_rsaAuth->integer ) {
-			Sys_CryptoRandomBytes( buf, sizeof(buf) );
+			// journaled, a replayed client answers the nonce it was sent
+			Com_JournalRandomBytes( buf, sizeof(buf) );
 			nettle_mpz_init_set_str_256_u( n, sizeof(buf), buf );
 			mpz_get_str( challenge->challenge2, 16, n );
 			mpz_clear( n );
@@ -460,6 +463,7 @@ gotnewcl:
 	// build a new connection
 	// accept the new client
 	// this is the only place a client_t is ever initialized
+	SV_ClearReliableCommands( newcl );
 	*newcl = temp;
 	clientNum = newcl - svs.clients;
 	ent = SV_GentityNum( clientNum );
@@ -607,7 +611,60 @@ void SV_DropClient( client_t *drop, const char *reason ) {
 	}
 }
 
-extern char alternateInfos[2][2][BIG_INFO_STRING];
+/*
+================
+SV_ZConfigstrings
+
+The configstrings of the gamestate as one deflated blob of little endian
+short index and zero terminated string pairs, rebuilt only when a
+configstring changed since. Returns NULL if it doesn't fit a message
+================
+*/
+static const svZConfigstrings_t *SV_ZConfigstrings( void ) {
+	static byte	raw[MAX_MSGLEN];
+	static byte	deflated[MAX_MSGLEN];
+	svZConfigstrings_t *z = &sv.zConfigstrings;
+	int			i, len, rawLength = 0;
+
+	if ( z->data && z->revision == sv.configstringRevision ) {
+		return z;
+	}
+
+	if ( z->data ) {
+		Z_Free( z->data );
+		z->data = NULL;
+	}
+
+	for ( i = 0 ; i < MAX_CONFIGSTRINGS ; i++ ) {
+		if ( !sv.configstrings[i].s[0] ) {
+			continue;
+		}
+
+		len = strlen( sv.configstrings[i].s ) + 1;
+		if ( rawLength + 2 + len > (int)sizeof( raw ) ) {
+			return NULL;
+		}
+
+		raw[rawLength++] = i & 0xff;
+		raw[rawLength++] = i >> 8;
+		::memcpy( raw + rawLength, sv.configstrings[i].s, len );
+		rawLength += len;
+	}
+
+	len = Com_Deflate( raw, rawLength, deflated, sizeof( deflated ) );
+	if ( len < 0 ) {
+		return NULL;
+	}
+
+	z->data = (byte *)Z_Malloc( len );
+	::memcpy( z->data, deflated, len );
+	z->length = len;
+	z->rawLength = rawLength;
+	z->revision = sv.configstringRevision;
+
+	Com_DPrintf( "SV_ZConfigstrings: %i bytes deflated to %i\n", rawLength, len );
+	return z;
+}
 
 /*
 ================
@@ -626,6 +683,7 @@ static void SV_SendClientGameState( client_t *client ) {
 	msg_t		msg;
 	byte		msgBuffer[MAX_MSGLEN];
 	const char	*configstring;
+	const svZConfigstrings_t *z;
 
  	Com_DPrintf ("SV_SendClientGameState() for %s\n", client->name);
 	Com_DPrintf( "Going from CS_CONNECTED to CS_PRIMED for %s\n", client->name );
@@ -654,10 +712,33 @@ static void SV_SendClientGameState( client_t *client ) {
 	MSG_WriteByte( &msg, svc_gamestate );
 	MSG_WriteLong( &msg, client->reliableSequence );
 
+	// the baselines and every snapshot after this use the profiled
+	// field tables if the client has the same ones
+	client->netFields = client->netchan.alternateProtocol == 0 && sv_profiledFields->integer &&
+		Info_ValueForKey( client->userinfo, "cl_netFields" )[0] &&
+		(int)strtoul( Info_ValueForKey( client->userinfo, "cl_netFields" ), NULL, 16 ) == MSG_NetFieldsChecksum();
+
+	if ( client->netFields ) {
+		MSG_WriteByte( &msg, svc_netfields );
+		MSG_WriteLong( &msg, MSG_NetFieldsChecksum() );
+	}
+
 	// write the configstrings
-	for ( start = 0 ; start < MAX_CONFIGSTRINGS ; start++ ) {
+	z = NULL;
+	if ( client->zgamestate && client->netchan.alternateProtocol == 0 ) {
+		z = SV_ZConfigstrings();
+	}
+
+	if ( z ) {
+		MSG_WriteByte( &msg, svc_zconfigstrings );
+		MSG_WriteLong( &msg, z->rawLength );
+		MSG_WriteLong( &msg, z->length );
+		MSG_WriteData( &msg, z->data, z->length );
+	}
+
+	for ( start = 0 ; start < MAX_CONFIGSTRINGS && !z ; start++ ) {
 		if ( start <= CS_SYSTEMINFO && client->netchan.alternateProtocol != 0 ) {
-			configstring = alternateInfos[start][ client->netchan.alternateProtocol - 1 ];
+			configstring = SV_AlternateInfo( start, client->netchan.alternateProtocol );
 		} else {
 			configstring = sv.configstrings[start].s;
 		}
@@ -669,6 +750,10 @@ static void SV_SendClientGameState( client_t *client ) {
 		}
 	}
 
+	// the gamestate has them all, drop updates queued before it
+	::memset( client->csUpdated, 0, sizeof( client->csUpdated ) );
+	client->csPending = false;
+
 	// write the baselines
 	::memset( &nullstate, 0, sizeof( nullstate ) );
 	for ( start = 0 ; start < MAX_GENTITIES; start++ ) {
@@ -677,7 +762,7 @@ static void SV_SendClientGameState( client_t *client ) {
 			continue;
 		}
 		MSG_WriteByte( &msg, svc_baseline );
-		MSG_WriteDeltaEntity( client->netchan.alternateProtocol, &msg, &nullstate, base, true );
+		MSG_WriteDeltaEntity( SV_DeltaProtocol( client ), &msg, &nullstate, base, true );
 	}
 
 	MSG_WriteByte( &msg, svc_EOF );
@@ -692,6 +777,21 @@ static void SV_SendClientGameState( client_t *client ) {
 }
 
 
+/*
+==================
+SV_DeltaProtocol
+
+The alternateProtocol for the entity and playerstate deltas of a client
+==================
+*/
+int SV_DeltaProtocol( client_t *client ) {
+	if ( client->netFields ) {
+		return MSG_PROFILED_FIELDS;
+	}
+
+	return client->netchan.alternateProtocol;
+}
+
 /*
 ==================
 SV_ClientEnterWorld
@@ -716,6 +816,7 @@ void SV_ClientEnterWorld( client_t *client, usercmd_t *cmd ) {
 
 	client->deltaMessage = -1;
 	client->lastSnapshotTime = 0;	// generate a snapshot immediately
+	Com_Memset( client->entityDeferrals, 0, sizeof( client->entityDeferrals ) );
 
 	if(cmd)
 		memcpy(&client->lastUsercmd, cmd, sizeof(client->lastUsercmd));
@@ -1349,6 +1450,10 @@ void SV_UserinfoChanged( client_t *cl ) {
 		cl->snapshotMsec = i;		
 	}
 	
+	// understands batched configstring updates
+	cl->csm = atoi( Info_ValueForKey( cl->userinfo, "cl_csm" ) ) > 0;
+	cl->zgamestate = atoi( Info_ValueForKey( cl->userinfo, "cl_zgamestate" ) ) > 0;
+
 #ifdef USE_VOIP
 	val = Info_ValueForKey(cl->userinfo, "cl_voipProtocol");
 	cl->hasVoip = !Q_stricmp( val, "opus" );
@@ -1606,7 +1711,7 @@ static void SV_UserMove( client_t *cl, msg_t *msg, bool delta ) {
 	// also use the message acknowledge
 	key ^= cl->messageAcknowledge;
 	// also use the last acknowledged server command in the key
-	key ^= MSG_HashKey(cl->netchan.alternateProtocol, cl->reliableCommands[ cl->reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ], 32);
+	key ^= MSG_HashKey(cl->netchan.alternateProtocol, SV_ReliableCommand( cl, cl->reliableAcknowledge ), 32);
 
 	::memset( &nullcmd, 0, sizeof(nullcmd) );
 	oldcmd = &nullcmd;
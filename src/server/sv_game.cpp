@@ -167,6 +167,26 @@ bool SV_inPVS (const vec3_t p1, const vec3_t p2)
 }
 
 
+/*
+=================
+SV_PointCluster
+
+Returns the PVS cluster of a point and stores its portal area, the two
+values SV_inPVS tests a viewpoint by
+=================
+*/
+static int SV_PointCluster (const vec3_t p, int *area)
+{
+	int		leafnum;
+
+	leafnum = CM_PointLeafnum (p);
+	if ( area )
+		*area = CM_LeafArea (leafnum);
+
+	return CM_LeafCluster (leafnum);
+}
+
+
 /*
 =================
 SV_inPVSIgnorePortals
@@ -300,7 +320,7 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
             Com_Error( ERR_DROP, "%s", (const char*)VMA(1) );
             return 0;
         case G_MILLISECONDS:
-            return Sys_Milliseconds();
+            return Com_NetMilliseconds();
         case G_CVAR_REGISTER:
             Cvar_Register( (vmCvar_t*)VMA(1), (const char*)VMA(2), (const char*)VMA(3), args[4] ); 
             return 0;
@@ -358,6 +378,10 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
             return 0;
         case G_ENTITIES_IN_BOX:
             return SV_AreaEntities( (const vec_t*)VMA(1), (const vec_t*)VMA(2), (int*)VMA(3), args[4] );
+        case G_ENTITIES_IN_RADIUS:
+            return SV_EntitiesInRadius( (const vec_t*)VMA(1), VMF(2), args[3], (int*)VMA(4), args[5] );
+        case G_POINT_CLUSTER:
+            return SV_PointCluster( (const vec_t*)VMA(1), (int*)VMA(2) );
         case G_ENTITY_CONTACT:
             return SV_EntityContact( (vec_t*)VMA(1), (vec_t*)VMA(2), (const sharedEntity_t*)VMA(3), TT_AABB );
         case G_ENTITY_CONTACTCAPSULE:
@@ -447,6 +471,10 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
             Cmd_RemoveCommand( (const char*)VMA(1) );
             return 0;
 
+        case G_PROFILE_PHASE:
+            SV_ProfileGamePhase( args[1] );
+            return 0;
+
         case TRAP_MEMSET:
             ::memset( VMA(1), args[2], args[3] );
             return 0;
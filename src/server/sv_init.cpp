@@ -33,37 +33,47 @@ int attHandle = 0; // server attack log file handle
 
 char alternateInfos[2][2][BIG_INFO_STRING];
 
+// the alternate protocol serverinfo and systeminfo are only rebuilt when a
+// client of that protocol needs them
+static bool alternateInfosDirty[2][2];
+
 /*
 ===============
-SV_SendConfigstring
-
-Creates and sends the server command necessary to update the CS index for the
-given client
+SV_ConfigstringForClient
 ===============
 */
-static void SV_SendConfigstring(client_t *client, int i)
+static const char *SV_ConfigstringForClient(client_t *client, int i)
 {
-    const char *configstring;
-    int maxChunkSize = MAX_STRING_CHARS - 24;
-    int len;
-
     if (sv.configstrings[i].restricted &&
         Com_ClientListContains(&sv.configstrings[i].clientList, client - svs.clients))
     {
         // Send a blank config string for this client if it's listed
-        SV_SendServerCommand(client, "cs %i \"\"\n", i);
-        return;
+        return "";
     }
 
     if (i <= CS_SYSTEMINFO && client->netchan.alternateProtocol != 0)
     {
-        configstring = alternateInfos[i][client->netchan.alternateProtocol - 1];
-    }
-    else
-    {
-        configstring = sv.configstrings[i].s;
+        return SV_AlternateInfo(i, client->netchan.alternateProtocol);
     }
 
+    return sv.configstrings[i].s;
+}
+
+/*
+===============
+SV_SendConfigstring
+
+Creates and sends the server command necessary to update the CS index for the
+given client
+===============
+*/
+static void SV_SendConfigstring(client_t *client, int i)
+{
+    const char *configstring;
+    int maxChunkSize = MAX_STRING_CHARS - 24;
+    int len;
+
+    configstring = SV_ConfigstringForClient(client, i);
     len = strlen(configstring);
 
     if (len >= maxChunkSize)
@@ -106,137 +116,267 @@ static void SV_SendConfigstring(client_t *client, int i)
 ===============
 SV_UpdateConfigstrings
 
-Called when a client goes from CS_PRIMED to CS_ACTIVE.  Updates all
-Configstring indexes that have changed while the client was in CS_PRIMED
+Sends every configstring index that changed since the client last heard
+about it. Called when a client goes from CS_PRIMED to CS_ACTIVE, once a
+frame for active clients and before any other reliable command so the
+client sees them in order.
+
+Clients that set cl_csm get all the short strings packed into as few
+"csm <index> <string> <index> <string> ..." commands as possible
 ===============
 */
 void SV_UpdateConfigstrings(client_t *client)
 {
+    static bool updating;
+    char batch[MAX_STRING_CHARS];
+    int batchLength = 0, batchCount = 0, batchFirst = 0;
+
+    // the commands below come back through SV_AddServerCommand
+    if (updating)
+    {
+        return;
+    }
+    updating = true;
+    client->csPending = false;
+
     for (int i = 0; i < MAX_CONFIGSTRINGS; i++)
     {
         // if the CS hasn't changed since we went to CS_PRIMED, ignore
         if (!client->csUpdated[i]) continue;
 
+        // may rebuild an alternate infostring, which marks it again
+        const char *configstring = SV_ConfigstringForClient(client, i);
+        client->csUpdated[i] = false;
+
         // do not always send server info to all clients
         if (i == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO))
         {
             continue;
         }
 
-        SV_SendConfigstring(client, i);
-        client->csUpdated[i] = false;
+        if (!client->csm)
+        {
+            SV_SendConfigstring(client, i);
+            continue;
+        }
+
+        char entry[MAX_STRING_CHARS];
+        int len = Com_sprintf(entry, sizeof(entry), " %i \"%s\"", i, configstring);
+
+        // 5 for "csm" and the newline
+        if (len >= (int)sizeof(entry) - 1 || len + 5 >= (int)sizeof(batch))
+        {
+            SV_SendConfigstring(client, i);
+            continue;
+        }
+
+        if (batchLength + len + 5 >= (int)sizeof(batch))
+        {
+            if (batchCount == 1)
+                SV_SendConfigstring(client, batchFirst);
+            else
+                SV_SendServerCommand(client, "csm%s\n", batch);
+            batchLength = batchCount = 0;
+        }
+
+        if (!batchCount)
+            batchFirst = i;
+
+        ::memcpy(batch + batchLength, entry, len + 1);
+        batchLength += len;
+        batchCount++;
     }
+
+    if (batchCount == 1)
+        SV_SendConfigstring(client, batchFirst);
+    else if (batchCount)
+        SV_SendServerCommand(client, "csm%s\n", batch);
+
+    updating = false;
 }
 
 /*
 ===============
-SV_SetConfigstring
+SV_MarkConfigstring
 
+Queues a configstring index for the clients that have a gamestate, an
+alternateProtocol of -1 matches every client
 ===============
 */
-void SV_SetConfigstring(int idx, const char *val)
+static void SV_MarkConfigstring(int idx, int alternateProtocol)
 {
-    bool modified[3] = {false, false, false};
-    int i;
     client_t *client;
+    int i;
 
-    if (idx < 0 || idx >= MAX_CONFIGSTRINGS)
-    {
-        Com_Error(ERR_DROP, "SV_SetConfigstring: bad idx %i", idx);
-    }
-
-    if (!val)
+    // the gamestate carries everything while a new server is spawning
+    if (sv.state != SS_GAME && !sv.restarting)
     {
-        val = "";
+        return;
     }
 
-    if (idx <= CS_SYSTEMINFO)
+    for (i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++)
     {
-        for (i = 1; i < 3; ++i)
+        if (client->state < CS_PRIMED)
         {
-            char info[BIG_INFO_STRING];
-
-            Q_strncpyz(info, val, sizeof(info));
-            if (idx == CS_SERVERINFO)
-            {
-                Info_SetValueForKey_Big(info, "protocol", (i == 1 ? "70" : "69"));
-            }
-            else if (i == 2)
-            {
-                Info_SetValueForKey_Big(info, "sv_paks", Cvar_VariableString("sv_alternatePaks"));
-                Info_SetValueForKey_Big(info, "sv_pakNames", Cvar_VariableString("sv_alternatePakNames"));
-                Info_SetValueForKey_Big(info, "sv_referencedPaks", Cvar_VariableString("sv_referencedAlternatePaks"));
-                Info_SetValueForKey_Big(
-                    info, "sv_referencedPakNames", Cvar_VariableString("sv_referencedAlternatePakNames"));
-                Info_SetValueForKey_Big(info, "cl_allowDownload", "1, you should set it yourself");
-                if (!(sv_allowDownload->integer & DLF_NO_REDIRECT))
-                {
-                    Info_SetValueForKey_Big(info, "sv_wwwBaseURL", Cvar_VariableString("sv_dlUrl"));
-                    Info_SetValueForKey_Big(
-                        info, "sv_wwwDownload", Cvar_VariableString("1, you should set it yourself"));
-                }
-            }
-
-            if (strcmp(info, alternateInfos[idx][i - 1]))
-            {
-                modified[i] = true;
-                strcpy(alternateInfos[idx][i - 1], info);
-            }
+            continue;
         }
 
-        if (strcmp(val, sv.configstrings[idx].s))
+        if (alternateProtocol >= 0 && client->netchan.alternateProtocol != alternateProtocol)
         {
-            modified[0] = true;
-            Z_Free(sv.configstrings[idx].s);
-            sv.configstrings[idx].s = CopyString(val);
+            continue;
         }
 
-        if (!modified[0] && !modified[1] && !modified[2])
+        client->csUpdated[idx] = true;
+
+        // primed clients get everything when they enter the world
+        if (client->state == CS_ACTIVE)
         {
-            return;
+            client->csPending = true;
+            sv.configstringsPending = true;
         }
     }
-    else
+}
+
+/*
+===============
+SV_AlternateInfo
+
+Returns the serverinfo or systeminfo as seen by clients of an alternate
+protocol, rebuilding it if the real one changed since
+===============
+*/
+const char *SV_AlternateInfo(int idx, int alternateProtocol)
+{
+    char info[BIG_INFO_STRING];
+    char *cached = alternateInfos[idx][alternateProtocol - 1];
+
+    if (!alternateInfosDirty[idx][alternateProtocol - 1])
+    {
+        return cached;
+    }
+
+    alternateInfosDirty[idx][alternateProtocol - 1] = false;
+
+    Q_strncpyz(info, sv.configstrings[idx].s, sizeof(info));
+    if (idx == CS_SERVERINFO)
     {
-        // don't bother broadcasting an update if no change
-        if (!strcmp(val, sv.configstrings[idx].s))
+        Info_SetValueForKey_Big(info, "protocol", (alternateProtocol == 1 ? "70" : "69"));
+    }
+    else if (alternateProtocol == 2)
+    {
+        Info_SetValueForKey_Big(info, "sv_paks", Cvar_VariableString("sv_alternatePaks"));
+        Info_SetValueForKey_Big(info, "sv_pakNames", Cvar_VariableString("sv_alternatePakNames"));
+        Info_SetValueForKey_Big(info, "sv_referencedPaks", Cvar_VariableString("sv_referencedAlternatePaks"));
+        Info_SetValueForKey_Big(
+            info, "sv_referencedPakNames", Cvar_VariableString("sv_referencedAlternatePakNames"));
+        Info_SetValueForKey_Big(info, "cl_allowDownload", "1, you should set it yourself");
+        if (!(sv_allowDownload->integer & DLF_NO_REDIRECT))
         {
-            return;
+            Info_SetValueForKey_Big(info, "sv_wwwBaseURL", Cvar_VariableString("sv_dlUrl"));
+            Info_SetValueForKey_Big(
+                info, "sv_wwwDownload", Cvar_VariableString("1, you should set it yourself"));
         }
+    }
+
+    if (strcmp(info, cached))
+    {
+        strcpy(cached, info);
+        SV_MarkConfigstring(idx, alternateProtocol);
+    }
+
+    return cached;
+}
+
+/*
+===============
+SV_FlushConfigstrings
+
+Sends the configstring changes of this frame, called once per server frame
+before the snapshots go out
+===============
+*/
+void SV_FlushConfigstrings(void)
+{
+    client_t *client;
+    int i, idx, protocol;
 
-        // change the string in sv
-        Z_Free(sv.configstrings[idx].s);
-        sv.configstrings[idx].s = CopyString(val);
+    if (!sv.configstringsPending)
+    {
+        return;
     }
+    sv.configstringsPending = false;
 
-    // send it to all the clients if we aren't
-    // spawning a new server
-    if (sv.state == SS_GAME || sv.restarting)
+    // rebuild the alternate infostrings first, that may queue more updates
+    for (idx = 0; idx <= CS_SYSTEMINFO; idx++)
     {
-        // send the data to all relevent clients
-        for (i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++)
+        for (protocol = 1; protocol <= 2; protocol++)
         {
-            if (idx <= CS_SYSTEMINFO && !modified[client->netchan.alternateProtocol])
+            if (!alternateInfosDirty[idx][protocol - 1])
             {
                 continue;
             }
 
-            if (client->state < CS_ACTIVE)
-            {
-                if (client->state == CS_PRIMED) client->csUpdated[idx] = true;
-                continue;
-            }
-            // do not always send server info to all clients
-            if (idx == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO))
+            for (i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++)
             {
-                continue;
+                if (client->state >= CS_PRIMED && client->netchan.alternateProtocol == protocol)
+                {
+                    SV_AlternateInfo(idx, protocol);
+                    break;
+                }
             }
+        }
+    }
 
-            SV_SendConfigstring(client, idx);
+    for (i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++)
+    {
+        if (client->state == CS_ACTIVE && client->csPending)
+        {
+            SV_UpdateConfigstrings(client);
         }
     }
 }
 
+/*
+===============
+SV_SetConfigstring
+
+Only stores the string, the clients hear about it in SV_FlushConfigstrings
+===============
+*/
+void SV_SetConfigstring(int idx, const char *val)
+{
+    if (idx < 0 || idx >= MAX_CONFIGSTRINGS)
+    {
+        Com_Error(ERR_DROP, "SV_SetConfigstring: bad idx %i", idx);
+    }
+
+    if (!val)
+    {
+        val = "";
+    }
+
+    if (idx <= CS_SYSTEMINFO)
+    {
+        // the alternate strings also depend on cvars, so they are
+        // compared again even if the string itself didn't change
+        alternateInfosDirty[idx][0] = alternateInfosDirty[idx][1] = true;
+        sv.configstringsPending = true;
+    }
+
+    // don't bother broadcasting an update if no change
+    if (!strcmp(val, sv.configstrings[idx].s))
+    {
+        return;
+    }
+
+    // change the string in sv
+    Z_Free(sv.configstrings[idx].s);
+    sv.configstrings[idx].s = CopyString(val);
+    sv.configstringRevision++;
+
+    SV_MarkConfigstring(idx, idx <= CS_SYSTEMINFO ? 0 : -1);
+}
+
 /*
 ===============
 SV_GetConfigstring
@@ -475,7 +615,12 @@ void SV_ChangeMaxClients(void)
         }
     }
 
-    // free old clients arrays
+    // free old clients arrays, along with the commands of the ones left behind
+    for (i = 0; i < oldMaxClients; i++)
+    {
+        if (i >= count || oldClients[i].state < CS_CONNECTED)
+            SV_ClearReliableCommands(&svs.clients[i]);
+    }
     Z_Free(svs.clients);
 
     // allocate new clients
@@ -520,12 +665,17 @@ static void SV_ClearServer(void)
         if (i <= CS_SYSTEMINFO)
         {
             alternateInfos[i][0][0] = alternateInfos[i][1][0] = '\0';
+            alternateInfosDirty[i][0] = alternateInfosDirty[i][1] = true;
         }
         if (sv.configstrings[i].s)
         {
             Z_Free(sv.configstrings[i].s);
         }
     }
+    if (sv.zConfigstrings.data)
+    {
+        Z_Free(sv.zConfigstrings.data);
+    }
     ::memset(&sv, 0, sizeof(sv));
 }
 
@@ -625,6 +775,7 @@ void SV_SpawnServer(char *server)
         if (i <= CS_SYSTEMINFO)
         {
             alternateInfos[i][0][0] = alternateInfos[i][1][0] = '\0';
+            alternateInfosDirty[i][0] = alternateInfosDirty[i][1] = true;
         }
         sv.configstrings[i].s = CopyString("");
         sv.configstrings[i].restricted = false;
@@ -916,7 +1067,15 @@ void SV_Init(void)
     sv_killserver = Cvar_Get("sv_killserver", "0", 0);
     sv_mapChecksum = Cvar_Get("sv_mapChecksum", "", CVAR_ROM);
     sv_lanForceRate = Cvar_Get("sv_lanForceRate", "1", CVAR_ARCHIVE);
+    sv_profiledFields = Cvar_Get("sv_profiledFields", "1", CVAR_ARCHIVE);
     sv_rsaAuth = Cvar_Get("sv_rsaAuth", "1", CVAR_INIT | CVAR_PROTECTED);
+
+    sv_profile = Cvar_Get("sv_profile", "0", 0);
+    sv_metricsFile = Cvar_Get("sv_metricsFile", "", CVAR_ARCHIVE);
+    sv_metricsInterval = Cvar_Get("sv_metricsInterval", "10", CVAR_ARCHIVE);
+
+    sv_snapshotStagger = Cvar_Get("sv_snapshotStagger", "1", CVAR_ARCHIVE);
+    sv_snapshotPriority = Cvar_Get("sv_snapshotPriority", "1", CVAR_ARCHIVE);
 }
 
 /*
@@ -993,7 +1152,10 @@ void SV_Shutdown(const char *finalmsg)
     if (svs.clients)
     {
         for (int i = 0; i < sv_maxclients->integer; i++)
+        {
             SV_FreeClient(&svs.clients[i]);
+            SV_ClearReliableCommands(&svs.clients[i]);
+        }
 
         Z_Free(svs.clients);
     }
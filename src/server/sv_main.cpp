@@ -61,6 +61,7 @@ cvar_t	*sv_maxPing;
 cvar_t	*sv_pure;
 cvar_t	*sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
 cvar_t	*sv_banFile;
+cvar_t	*sv_profiledFields;	// clients with the same profiled field tables may use them
 
 cvar_t  *sv_rsaAuth;
 
@@ -137,25 +138,96 @@ static bool SV_ReplacePendingServerCommands( client_t *client, const char *cmd )
 
 /*
 ======================
-SV_AddServerCommand
+SV_NewServerCommand
+
+The caller holds the first reference
+======================
+*/
+static svCommand_t *SV_NewServerCommand( const char *cmd ) {
+	svCommand_t	*command;
+	int			len;
+
+	len = strlen( cmd );
+	if ( len > MAX_STRING_CHARS - 1 ) {
+		len = MAX_STRING_CHARS - 1;
+	}
+
+	command = (svCommand_t *)Z_Malloc( sizeof( *command ) + len );
+	command->refCount = 1;
+	command->numBits = 0;
+	command->bits = NULL;
+	::memcpy( command->text, cmd, len );
+	command->text[len] = '\0';
+	return command;
+}
+
+/*
+======================
+SV_ReleaseServerCommand
+======================
+*/
+static void SV_ReleaseServerCommand( svCommand_t *command ) {
+	if ( --command->refCount > 0 ) {
+		return;
+	}
+
+	if ( command->bits ) {
+		Z_Free( command->bits );
+	}
+	Z_Free( command );
+}
+
+/*
+======================
+SV_ReliableCommand
+
+The text of a command in the client's ring, "" for slots never used
+======================
+*/
+const char *SV_ReliableCommand( client_t *client, int sequence ) {
+	svCommand_t *command = client->reliableCommands[ sequence & ( MAX_RELIABLE_COMMANDS - 1 ) ];
+
+	return command ? command->text : "";
+}
+
+/*
+======================
+SV_ClearReliableCommands
+
+Drops the client's references to its commands, before the slot is reused
+or freed
+======================
+*/
+void SV_ClearReliableCommands( client_t *client ) {
+	int		i;
+
+	for ( i = 0 ; i < MAX_RELIABLE_COMMANDS ; i++ ) {
+		if ( client->reliableCommands[i] ) {
+			SV_ReleaseServerCommand( client->reliableCommands[i] );
+			client->reliableCommands[i] = NULL;
+		}
+	}
+}
+
+/*
+======================
+SV_AddSharedServerCommand
 
 The given command will be transmitted to the client, and is guaranteed to
 not have future snapshot_t executed before it is executed
 ======================
 */
-void SV_AddServerCommand( client_t *client, const char *cmd ) {
+static void SV_AddSharedServerCommand( client_t *client, svCommand_t *command ) {
 	int		index, i;
 
-	// this is very ugly but it's also a waste to for instance send multiple config string updates
-	// for the same config string index in one snapshot
-//	if ( SV_ReplacePendingServerCommands( client, cmd ) ) {
-//		return;
-//	}
-
 	// do not send commands until the gamestate has been sent
 	if( client->state < CS_PRIMED )
 		return;
 
+	// configstring changes queued earlier this frame go out first
+	if ( client->csPending && client->state == CS_ACTIVE )
+		SV_UpdateConfigstrings( client );
+
 	client->reliableSequence++;
 	// if we would be losing an old command that hasn't been acknowledged,
 	// we must drop the connection
@@ -164,14 +236,70 @@ void SV_AddServerCommand( client_t *client, const char *cmd ) {
 	if ( client->reliableSequence - client->reliableAcknowledge == MAX_RELIABLE_COMMANDS + 1 ) {
 		Com_Printf( "===== pending server commands =====\n" );
 		for ( i = client->reliableAcknowledge + 1 ; i <= client->reliableSequence ; i++ ) {
-			Com_Printf( "cmd %5d: %s\n", i, client->reliableCommands[ i & (MAX_RELIABLE_COMMANDS-1) ] );
+			Com_Printf( "cmd %5d: %s\n", i, SV_ReliableCommand( client, i ) );
 		}
-		Com_Printf( "cmd %5d: %s\n", i, cmd );
+		Com_Printf( "cmd %5d: %s\n", i, command->text );
 		SV_DropClient( client, "Server command overflow" );
 		return;
 	}
 	index = client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 );
-	Q_strncpyz( client->reliableCommands[ index ], cmd, sizeof( client->reliableCommands[ index ] ) );
+	if ( client->reliableCommands[ index ] ) {
+		SV_ReleaseServerCommand( client->reliableCommands[ index ] );
+	}
+	command->refCount++;
+	client->reliableCommands[ index ] = command;
+}
+
+/*
+======================
+SV_AddServerCommand
+======================
+*/
+void SV_AddServerCommand( client_t *client, const char *cmd ) {
+	svCommand_t	*command;
+
+	if( client->state < CS_PRIMED )
+		return;
+
+	command = SV_NewServerCommand( cmd );
+	SV_AddSharedServerCommand( client, command );
+	SV_ReleaseServerCommand( command );
+}
+
+/*
+======================
+SV_WriteServerCommand
+
+Writes the command as Huffman coded bits made once per command, instead
+of coding the text again for every client and every retransmission
+======================
+*/
+void SV_WriteServerCommand( msg_t *msg, svCommand_t *command ) {
+	static byte	buf[ MAX_STRING_CHARS * 4 ];
+	msg_t		coded;
+
+	if ( !command ) {
+		MSG_WriteString( msg, "" );
+		return;
+	}
+
+	if ( !command->numBits ) {
+		MSG_Init( &coded, buf, sizeof( buf ) );
+		MSG_WriteString( &coded, command->text );
+		if ( coded.overflowed ) {
+			command->numBits = -1;
+		} else {
+			command->numBits = coded.bit;
+			command->bits = (byte *)Z_Malloc( ( coded.bit + 7 ) >> 3 );
+			::memcpy( command->bits, buf, ( coded.bit + 7 ) >> 3 );
+		}
+	}
+
+	if ( command->numBits < 0 || msg->oob ) {
+		MSG_WriteString( msg, command->text );
+		return;
+	}
+	MSG_WriteHuffmanBits( msg, command->bits, command->numBits );
 }
 
 /*
@@ -187,6 +315,7 @@ void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) {
 	va_list		argptr;
 	byte		message[MAX_MSGLEN];
 	client_t	*client;
+	svCommand_t	*command;
 	int			j;
 	
 	va_start(argptr, fmt);
@@ -220,10 +349,12 @@ void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) {
 		Com_Printf ("broadcast: %s\n", SV_ExpandNewlines((char *)message) );
 	}
 
-	// send the data to all relevent clients
+	// send the data to all relevent clients, sharing one copy
+	command = SV_NewServerCommand( (char *)message );
 	for (j = 0, client = svs.clients; j < sv_maxclients->integer ; j++, client++) {
-		SV_AddServerCommand( client, (char *)message );
+		SV_AddSharedServerCommand( client, command );
 	}
+	SV_ReleaseServerCommand( command );
 }
 
 
@@ -425,7 +556,7 @@ Find or allocate a bucket for an address
 static leakyBucket_t *SVC_BucketForAddress( netadr_t address, int burst, int period ) {
 	leakyBucket_t *bucket = NULL;
 	long hash = SVC_HashForAddress( address );
-	int now = Sys_Milliseconds();
+	int now = Com_NetMilliseconds();
 
 	for ( bucket = bucketHashes[ hash ]; bucket; bucket = bucket->next )
     {
@@ -517,7 +648,7 @@ bool SVC_RateLimit( leakyBucket_t *bucket, int burst, int period )
 {
 	if ( bucket != NULL )
 	{
-		int now = Sys_Milliseconds();
+		int now = Com_NetMilliseconds();
 		int interval = now - bucket->lastTime;
 		int expired = interval / period;
 		int expiredRemainder = interval % period;
@@ -965,13 +1096,14 @@ static void SV_ConnectionlessPacket( netadr_t from, msg_t *msg ) {
 
 /*
 =================
-SV_PacketEvent
+SV_DispatchPacket
 =================
 */
-void SV_PacketEvent( netadr_t from, msg_t *msg ) {
+static void SV_DispatchPacket( netadr_t from, msg_t *msg ) {
 	int			i;
 	client_t	*cl;
 	int			qport;
+	int64_t		start;
 
 	// check for connectionless packet (0xffffffff) first
 	if ( msg->cursize >= 4 && *(int *)msg->data == -1) {
@@ -1014,13 +1146,29 @@ void SV_PacketEvent( netadr_t from, msg_t *msg ) {
 			// reliable message, but they don't do any other processing
 			if (cl->state != CS_ZOMBIE) {
 				cl->lastPacketTime = svs.time;	// don't timeout
+				start = SV_ProfileStart();
 				SV_ExecuteClientMessage( cl, msg );
+				SV_ProfileEnd( PROF_CLIENTMSG, start );
 			}
 		}
 		return;
 	}
 }
 
+/*
+=================
+SV_PacketEvent
+=================
+*/
+void SV_PacketEvent( netadr_t from, msg_t *msg ) {
+	int64_t start = SV_ProfileStart();
+
+	SV_DispatchPacket( from, msg );
+
+	SV_ProfileEnd( PROF_PACKETS, start );
+	SV_ProfileCount( PROFC_PACKETS, 1 );
+}
+
 
 /*
 ===================
@@ -1105,6 +1253,7 @@ static void SV_CheckTimeouts( void ) {
 			// using the client id cause the cl->name is empty at this point
 			Com_DPrintf( "Going from CS_ZOMBIE to CS_FREE for client %d\n", i );
 			cl->state = CS_FREE;	// can now be reused
+			SV_ClearReliableCommands( cl );
 			continue;
 		}
 		if ( cl->state >= CS_CONNECTED && cl->lastPacketTime < droppoint) {
@@ -1113,6 +1262,7 @@ static void SV_CheckTimeouts( void ) {
 			if ( ++cl->timeoutCount > 5 ) {
 				SV_DropClient (cl, "timed out"); 
 				cl->state = CS_FREE;	// don't bother with zombie state
+				SV_ClearReliableCommands( cl );
 			}
 		} else {
 			cl->timeoutCount = 0;
@@ -1158,21 +1308,32 @@ static bool SV_CheckPaused( void ) {
 /*
 ==================
 SV_FrameMsec
-Return time in millseconds until processing of the next server frame.
+Return time in millseconds until processing of the next server frame,
+or of the next staggered snapshot slot if that comes first.
 ==================
 */
 int SV_FrameMsec()
 {
 	if(sv_fps)
 	{
-		int frameMsec;
+		int frameMsec, wakeMsec;
 		
 		frameMsec = 1000.0f / sv_fps->value;
 		
 		if(frameMsec < sv.timeResidual)
 			return 0;
-		else
-			return frameMsec - sv.timeResidual;
+
+		frameMsec -= sv.timeResidual;
+
+		// wake up for snapshot slots that fall inside the frame
+		if(sv_snapshotStagger && sv_snapshotStagger->integer > 1 && svs.snapshotWakeTime)
+		{
+			wakeMsec = svs.snapshotWakeTime - SV_SnapshotClock();
+			if(wakeMsec < frameMsec)
+				return MAX(wakeMsec, 0);
+		}
+
+		return frameMsec;
 	}
 	else
 		return 1;
@@ -1193,6 +1354,8 @@ void SV_Frame( int msec ) {
 	int		frameMsec;
 	int		startTime;
 	int   frameStartTime = 0;
+	int64_t frameStartUsec, gameStart;
+	bool  ranGameFrame = false;
 	static int start, end;
 
 	start           = Sys_Milliseconds();
@@ -1221,6 +1384,8 @@ void SV_Frame( int msec ) {
 		return;
 	}
 
+	frameStartUsec = Sys_Microseconds();
+
 	if (com_dedicated->integer)
 	{
 		frameStartTime = Sys_Milliseconds();
@@ -1289,7 +1454,10 @@ void SV_Frame( int msec ) {
 		sv.time += frameMsec;
 
 		// let everything in the world think and move
+		gameStart = SV_ProfileStart();
 		VM_Call (sv.gvm, GAME_RUN_FRAME, sv.time);
+		SV_ProfileEnd( PROF_GAME, gameStart );
+		ranGameFrame = true;
 	}
 
 	if ( com_speeds->integer ) {
@@ -1299,12 +1467,17 @@ void SV_Frame( int msec ) {
 	// check timeouts
 	SV_CheckTimeouts();
 
-	// send messages back to the clients
+	// send this frame's configstring changes, then the snapshots
+	SV_FlushConfigstrings();
 	SV_SendClientMessages();
 
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat(HEARTBEAT_FOR_MASTER);
 
+	if ( ranGameFrame ) {
+		SV_ProfileEndFrame( frameStartUsec );
+	}
+
 	if (com_dedicated->integer)
 	{
 		int frameEndTime = Sys_Milliseconds();
@@ -1395,22 +1568,16 @@ void SV_Frame( int msec ) {
 
 /*
 ====================
-SV_RateMsec
+SV_ClientRate
 
-Return the number of msec until another message can be sent to
-a client based on its rate settings
+Return the bytes per second a client is allowed, after sv_minRate,
+sv_maxRate and timescale
 ====================
 */
-
-#define UDPIP_HEADER_SIZE 28
-#define UDPIP6_HEADER_SIZE 48
-
-int SV_RateMsec(client_t *client)
+int SV_ClientRate(client_t *client)
 {
-	int rate, rateMsec;
-	int messageSize;
-	
-	messageSize = client->netchan.lastSentSize;
+	int rate;
+
 	rate = client->rate;
 
 	if(sv_maxRate->integer)
@@ -1429,16 +1596,40 @@ int SV_RateMsec(client_t *client)
 			rate = sv_minRate->integer;
 	}
 
+	rate = (int)(rate * com_timescale->value);
+	if(rate < 1)
+		rate = 1;
+
+	return rate;
+}
+
+/*
+====================
+SV_RateMsec
+
+Return the number of msec until another message can be sent to
+a client based on its rate settings
+====================
+*/
+
+#define UDPIP_HEADER_SIZE 28
+#define UDPIP6_HEADER_SIZE 48
+
+int SV_RateMsec(client_t *client)
+{
+	int rate, rateMsec;
+	int messageSize;
+	
+	messageSize = client->netchan.lastSentSize;
+	rate = SV_ClientRate(client);
+
 	if(client->netchan.remoteAddress.type == NA_IP6)
 		messageSize += UDPIP6_HEADER_SIZE;
 	else
 		messageSize += UDPIP_HEADER_SIZE;
 		
-	rate = (int)(rate * com_timescale->value);
-	if(rate < 1)
-		rate = 1;
 	rateMsec = messageSize * 1000 / rate;
-	rate = Sys_Milliseconds() - client->netchan.lastSentTime;
+	rate = Com_NetMilliseconds() - client->netchan.lastSentTime;
 	
 	if(rate > rateMsec)
 		return 0;
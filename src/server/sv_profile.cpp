@@ -0,0 +1,424 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2000-2013 Darklegion Development
+Copyright (C) 2015-2019 GrangerHub
+
+This file is part of Tremulous.
+
+Tremulous is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 3 of the License,
+or (at your option) any later version.
+
+Tremulous is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Tremulous; if not, see <https://www.gnu.org/licenses/>
+
+===========================================================================
+*/
+// sv_profile.cpp -- per frame phase timings and counters, exported in the
+// Prometheus text format by the "metrics" command and sv_metricsFile
+
+#include "server.h"
+
+cvar_t *sv_profile;  // time the frame phases, the whole frame is always timed
+cvar_t *sv_metricsFile;  // file under fs_homepath rewritten with the metrics
+cvar_t *sv_metricsInterval;  // seconds between sv_metricsFile writes
+
+static const char *profPhaseNames[PROF_NUM_PHASES] = {
+    "frame",
+    "packets",
+    "clientmsg",
+    "game",
+    "game_entities",
+    "game_missiles",
+    "game_buildables",
+    "game_clients",
+    "game_buildpoints",
+    "game_other",
+    "snapshot_build",
+    "snapshot_encode",
+    "snapshot_send"
+};
+
+static const char *profCounterNames[PROF_NUM_COUNTERS] = {
+    "packets",
+    "traces",
+    "entity_links",
+    "snapshots",
+    "bytes_sent",
+    "deferred_entities"
+};
+
+/*
+==================
+SV_ProfileStart
+
+Returns 0 when sv_profile is off so the matching SV_ProfileEnd is free
+==================
+*/
+int64_t SV_ProfileStart(void)
+{
+    if (!sv_profile->integer)
+    {
+        return 0;
+    }
+
+    return Sys_Microseconds();
+}
+
+/*
+==================
+SV_ProfileEnd
+==================
+*/
+void SV_ProfileEnd(svProfPhase_t phase, int64_t start)
+{
+    if (!start)
+    {
+        return;
+    }
+
+    svs.prof.frame[phase] += (int)(Sys_Microseconds() - start);
+}
+
+/*
+==================
+SV_ProfileCount
+==================
+*/
+void SV_ProfileCount(svProfCounter_t counter, int amount)
+{
+    svs.prof.frameCounters[counter] += amount;
+}
+
+/*
+==================
+SV_ProfileGamePhase
+
+G_PROFILE_PHASE, charges the time since the last call to the phase it opened
+==================
+*/
+void SV_ProfileGamePhase(int phase)
+{
+    svProfile_t *p = &svs.prof;
+    int64_t now;
+
+    if (!sv_profile->integer)
+    {
+        p->gamePhaseStart = 0;
+        return;
+    }
+
+    now = Sys_Microseconds();
+
+    if (p->gamePhaseStart && p->gamePhase > GAMEPHASE_NONE && p->gamePhase < GAMEPHASE_NUM_PHASES)
+    {
+        p->frame[PROF_GAME_PHASES + p->gamePhase] += (int)(now - p->gamePhaseStart);
+    }
+
+    p->gamePhase = phase;
+    p->gamePhaseStart = phase == GAMEPHASE_NONE ? 0 : now;
+}
+
+/*
+==================
+SV_ProfileReset
+==================
+*/
+void SV_ProfileReset(void)
+{
+    int i;
+
+    svs.prof.numFrames = 0;
+
+    for (i = 0; svs.clients && i < sv_maxclients->integer; i++)
+    {
+        svs.clients[i].snapshotJitterMax = 0;
+    }
+}
+
+/*
+==============================================================================
+
+EXPORT
+
+==============================================================================
+*/
+
+static char profText[32768];
+static int profTextLength;
+
+static void QDECL SV_MetricsPrintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void QDECL SV_MetricsPrintf(const char *fmt, ...)
+{
+    va_list argptr;
+    int len;
+
+    va_start(argptr, fmt);
+    len = Q_vsnprintf(profText + profTextLength, sizeof(profText) - profTextLength, fmt, argptr);
+    va_end(argptr);
+
+    if (len > 0)
+    {
+        profTextLength = MIN(profTextLength + len, (int)sizeof(profText) - 1);
+    }
+}
+
+static int QDECL SV_CompareSamples(const void *a, const void *b) { return *(const int *)a - *(const int *)b; }
+
+/*
+==================
+SV_ProfileSummary
+
+Writes one Prometheus summary for a sample ring
+==================
+*/
+static void SV_ProfileSummary(const char *metric, const char *label, const char *value, const int *ring)
+{
+    static int sorted[SERVER_FRAMESTATS_SAMPLES];
+    static const int quantiles[] = {50, 90, 99};
+    int64_t sum = 0;
+    int count, i;
+
+    count = MIN(svs.prof.numFrames, SERVER_FRAMESTATS_SAMPLES);
+    if (!count)
+    {
+        return;
+    }
+
+    ::memcpy(sorted, ring, count * sizeof(int));
+    qsort(sorted, count, sizeof(int), SV_CompareSamples);
+
+    for (i = 0; i < count; i++)
+    {
+        sum += sorted[i];
+    }
+
+    for (i = 0; i < (int)ARRAY_LEN(quantiles); i++)
+    {
+        SV_MetricsPrintf("%s{%s=\"%s\",quantile=\"0.%d\"} %d\n", metric, label, value, quantiles[i],
+            sorted[count * quantiles[i] / 100]);
+    }
+    SV_MetricsPrintf("%s{%s=\"%s\",quantile=\"1\"} %d\n", metric, label, value, sorted[count - 1]);
+    SV_MetricsPrintf("%s_sum{%s=\"%s\"} %lld\n", metric, label, value, (long long)sum);
+    SV_MetricsPrintf("%s_count{%s=\"%s\"} %d\n", metric, label, value, count);
+}
+
+/*
+==================
+SV_ProfileBuildMetrics
+==================
+*/
+static void SV_ProfileBuildMetrics(void)
+{
+    client_t *cl;
+    int i, clients = 0;
+
+    profTextLength = 0;
+    profText[0] = '\0';
+
+    SV_MetricsPrintf("# HELP tremded_phase_usec Wall time spent in each server frame phase, over recent frames.\n");
+    SV_MetricsPrintf("# TYPE tremded_phase_usec summary\n");
+    for (i = 0; i < PROF_NUM_PHASES; i++)
+    {
+        // everything but the frame itself needs sv_profile
+        if (i != PROF_FRAME && !sv_profile->integer)
+        {
+            break;
+        }
+        SV_ProfileSummary("tremded_phase_usec", "phase", profPhaseNames[i], svs.prof.phases[i]);
+    }
+
+    SV_MetricsPrintf("# HELP tremded_frame_count Work done per server frame, over recent frames.\n");
+    SV_MetricsPrintf("# TYPE tremded_frame_count summary\n");
+    for (i = 0; i < PROF_NUM_COUNTERS; i++)
+    {
+        SV_ProfileSummary("tremded_frame_count", "counter", profCounterNames[i], svs.prof.counters[i]);
+    }
+
+    SV_MetricsPrintf("# HELP tremded_frames_total Server frames that ran the game.\n");
+    SV_MetricsPrintf("# TYPE tremded_frames_total counter\n");
+    SV_MetricsPrintf("tremded_frames_total %lld\n", (long long)svs.prof.totalFrames);
+
+    for (i = 0; i < PROF_NUM_COUNTERS; i++)
+    {
+        SV_MetricsPrintf("# TYPE tremded_%s_total counter\n", profCounterNames[i]);
+        SV_MetricsPrintf("tremded_%s_total %lld\n", profCounterNames[i], (long long)svs.prof.totals[i]);
+    }
+
+    if (svs.clients)
+    {
+        for (i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++)
+        {
+            if (cl->state >= CS_CONNECTED)
+            {
+                clients++;
+            }
+        }
+    }
+
+    SV_MetricsPrintf("# TYPE tremded_clients gauge\n");
+    SV_MetricsPrintf("tremded_clients %d\n", clients);
+
+    if (clients)
+    {
+        SV_MetricsPrintf("# HELP tremded_snapshot_jitter_usec Smoothed distance of each client's snapshot gaps from its snapshot interval.\n");
+        SV_MetricsPrintf("# TYPE tremded_snapshot_jitter_usec gauge\n");
+        for (i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++)
+        {
+            if (cl->state == CS_ACTIVE)
+            {
+                SV_MetricsPrintf("tremded_snapshot_jitter_usec{client=\"%d\"} %d\n", i, cl->snapshotJitter);
+            }
+        }
+
+        SV_MetricsPrintf("# HELP tremded_snapshot_jitter_max_usec Largest snapshot gap distance since the last framestats reset.\n");
+        SV_MetricsPrintf("# TYPE tremded_snapshot_jitter_max_usec gauge\n");
+        for (i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++)
+        {
+            if (cl->state == CS_ACTIVE)
+            {
+                SV_MetricsPrintf("tremded_snapshot_jitter_max_usec{client=\"%d\"} %d\n", i, cl->snapshotJitterMax);
+            }
+        }
+    }
+    SV_MetricsPrintf("# TYPE tremded_entities gauge\n");
+    SV_MetricsPrintf("tremded_entities %d\n", sv.num_entities);
+}
+
+/*
+==================
+SV_ProfileWriteMetricsFile
+
+Written to a temporary name and renamed so a scraper never reads half a file
+==================
+*/
+static void SV_ProfileWriteMetricsFile(void)
+{
+    char tmpName[MAX_QPATH];
+    fileHandle_t f;
+
+    Com_sprintf(tmpName, sizeof(tmpName), "%s.tmp", sv_metricsFile->string);
+
+    f = FS_SV_FOpenFileWrite(tmpName);
+    if (!f)
+    {
+        Com_Printf("SV_ProfileWriteMetricsFile: couldn't write %s\n", tmpName);
+        Cvar_Set("sv_metricsFile", "");
+        return;
+    }
+
+    SV_ProfileBuildMetrics();
+    FS_Write(profText, profTextLength, f);
+    FS_FCloseFile(f);
+
+    FS_SV_Rename(tmpName, sv_metricsFile->string, true);
+}
+
+/*
+==================
+SV_ProfileEndFrame
+
+Moves the frame being measured into the history, called at the end of an
+SV_Frame that ran the game
+==================
+*/
+void SV_ProfileEndFrame(int64_t frameStart)
+{
+    svProfile_t *p = &svs.prof;
+    int slot = p->numFrames & (SERVER_FRAMESTATS_SAMPLES - 1);
+    int i;
+
+    p->frame[PROF_FRAME] = (int)(Sys_Microseconds() - frameStart);
+
+    for (i = 0; i < PROF_NUM_PHASES; i++)
+    {
+        p->phases[i][slot] = p->frame[i];
+    }
+    for (i = 0; i < PROF_NUM_COUNTERS; i++)
+    {
+        p->counters[i][slot] = p->frameCounters[i];
+        p->totals[i] += p->frameCounters[i];
+    }
+
+    p->numFrames++;
+    p->totalFrames++;
+
+    ::memset(p->frame, 0, sizeof(p->frame));
+    ::memset(p->frameCounters, 0, sizeof(p->frameCounters));
+
+    if (sv_metricsFile->string[0] && svs.time >= p->nextMetricsTime)
+    {
+        p->nextMetricsTime = svs.time + MAX(sv_metricsInterval->integer, 1) * 1000;
+        SV_ProfileWriteMetricsFile();
+    }
+}
+
+/*
+==================
+SV_ProfileMetrics_f
+
+Prints the Prometheus text exposition, one line at a time so rcon
+redirection never truncates it
+==================
+*/
+void SV_ProfileMetrics_f(void)
+{
+    char *line, *next;
+
+    SV_ProfileBuildMetrics();
+
+    for (line = profText; *line; line = next)
+    {
+        next = strchr(line, '\n');
+        if (!next)
+        {
+            Com_Printf("%s\n", line);
+            break;
+        }
+
+        *next++ = '\0';
+        Com_Printf("%s\n", line);
+    }
+}
+
+/*
+==================
+SV_ProfileFrameStats_f
+
+Prints percentiles of the recent game frame durations in microseconds
+as a single key=value line, "framestats reset" starts a new window
+==================
+*/
+void SV_ProfileFrameStats_f(void)
+{
+    static int sorted[SERVER_FRAMESTATS_SAMPLES];
+    int count;
+
+    if (!Q_stricmp(Cmd_Argv(1), "reset"))
+    {
+        SV_ProfileReset();
+        return;
+    }
+
+    count = MIN(svs.prof.numFrames, SERVER_FRAMESTATS_SAMPLES);
+    if (!count)
+    {
+        Com_Printf("frames=0\n");
+        return;
+    }
+
+    ::memcpy(sorted, svs.prof.phases[PROF_FRAME], count * sizeof(int));
+    qsort(sorted, count, sizeof(int), SV_CompareSamples);
+
+    // only the last SERVER_FRAMESTATS_SAMPLES frames are behind the percentiles
+    Com_Printf("frames=%d p50=%d p90=%d p99=%d max=%d\n", count, sorted[count * 50 / 100],
+        sorted[count * 90 / 100], sorted[count * 99 / 100], sorted[count - 1]);
+}
@@ -24,6 +24,13 @@ along with Tremulous; if not, see <https://www.gnu.org/licenses/>
 
 #include "server.h"
 
+cvar_t *sv_snapshotStagger;  // 0 sends every due snapshot at once, 1 spreads them over frames, 2 also inside frames
+cvar_t *sv_snapshotPriority;  // hold back the least important entity updates when a snapshot won't fit
+
+#define MAX_ENTITY_DEFERRALS 3  // snapshots an update may be held back before it has to go
+#define SNAPSHOT_TAIL_BYTES 32  // kept free after the entities for the end marker and padding
+#define SNAPSHOT_MIN_ENTITY_BYTES 128  // entity budget floor so a tiny rate still makes progress
+
 /*
 =============================================================================
 
@@ -51,14 +58,18 @@ A normal server packet will look like:
 SV_EmitPacketEntities
 
 Writes a delta update of an entityState_t list to the message.
+If bits is given, it gets the size of each update in to, and updates
+flagged in defer are left out.
 =============
 */
-static void SV_EmitPacketEntities(int alternateProtocol, clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg)
+static void SV_EmitPacketEntities(int alternateProtocol, clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg,
+    int *bits = nullptr, const bool *defer = nullptr)
 {
     entityState_t *oldent, *newent;
     int oldindex, newindex;
     int oldnum, newnum;
     int from_num_entities;
+    int start;
 
     // generate the delta update
     if (!from)
@@ -101,7 +112,15 @@ static void SV_EmitPacketEntities(int alternateProtocol, clientSnapshot_t *from,
             // delta update from old position
             // because the force parm is false, this will not result
             // in any bytes being emited if the entity has not changed at all
-            MSG_WriteDeltaEntity(alternateProtocol, msg, oldent, newent, false);
+            start = msg->bit;
+            if (!defer || !defer[newindex])
+            {
+                MSG_WriteDeltaEntity(alternateProtocol, msg, oldent, newent, false);
+            }
+            if (bits)
+            {
+                bits[newindex] = msg->bit - start;
+            }
             oldindex++;
             newindex++;
             continue;
@@ -110,7 +129,15 @@ static void SV_EmitPacketEntities(int alternateProtocol, clientSnapshot_t *from,
         if (newnum < oldnum)
         {
             // this is a new entity, send it from the baseline
-            MSG_WriteDeltaEntity(alternateProtocol, msg, &sv.svEntities[newnum].baseline, newent, true);
+            start = msg->bit;
+            if (!defer || !defer[newindex])
+            {
+                MSG_WriteDeltaEntity(alternateProtocol, msg, &sv.svEntities[newnum].baseline, newent, true);
+            }
+            if (bits)
+            {
+                bits[newindex] = msg->bit - start;
+            }
             newindex++;
             continue;
         }
@@ -127,6 +154,266 @@ static void SV_EmitPacketEntities(int alternateProtocol, clientSnapshot_t *from,
     MSG_WriteBits(msg, (MAX_GENTITIES - 1), GENTITYNUM_BITS);  // end of packetentities
 }
 
+/*
+=============
+SV_RateLimited
+
+Clients that aren't local or on a LAN with sv_lanForceRate are held to
+their rate
+=============
+*/
+static bool SV_RateLimited(client_t *client)
+{
+    return !(client->netchan.remoteAddress.type == NA_LOOPBACK ||
+             (sv_lanForceRate->integer && Sys_IsLANAddress(client->netchan.remoteAddress)));
+}
+
+/*
+=============
+SV_PacketEntitiesBudget
+
+Bits the entity updates may take in this snapshot. The message has to
+fit MAX_MSGLEN, and a rate limited client's whole snapshot should get
+through in one snapshot interval or the next one is delayed
+=============
+*/
+static int SV_PacketEntitiesBudget(client_t *client, msg_t *msg)
+{
+    int bytes, rateBytes;
+
+    bytes = msg->maxsize - msg->cursize - SNAPSHOT_TAIL_BYTES;
+
+    if (SV_RateLimited(client))
+    {
+        rateBytes = SV_ClientRate(client) * client->snapshotMsec / 1000 - msg->cursize;
+        bytes = MIN(bytes, MAX(rateBytes, SNAPSHOT_MIN_ENTITY_BYTES));
+    }
+
+    return MAX(bytes, 0) * 8;
+}
+
+/*
+=============
+SV_EntityPriority
+
+How much an entity update matters to a client: other players first,
+then anything moving, nearer ones first, rising every snapshot the
+update is held back
+=============
+*/
+static float SV_EntityPriority(client_t *client, clientSnapshot_t *frame, entityState_t *ent)
+{
+    float weight;
+
+    if (ent->number < sv_maxclients->integer)
+    {
+        weight = 4.0f;
+    }
+    else if (ent->pos.trType != TR_STATIONARY)
+    {
+        weight = 2.0f;
+    }
+    else
+    {
+        weight = 1.0f;
+    }
+
+    return weight * (1 + client->entityDeferrals[ent->number]) / (Distance(frame->ps.origin, ent->pos.trBase) + 256.0f);
+}
+
+/*
+=============
+SV_ForgetEntityDeferrals
+
+Clears the count of every entity that is not in the frame, so an entity
+number reused after it left the client's view starts over
+=============
+*/
+static void SV_ForgetEntityDeferrals(client_t *client, clientSnapshot_t *frame)
+{
+    entityState_t *ent;
+    int number, i;
+
+    number = 0;
+    for (i = 0; i < frame->num_entities; i++)
+    {
+        ent = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
+        if (ent->number > number)
+        {
+            Com_Memset(&client->entityDeferrals[number], 0, ent->number - number);
+        }
+        number = ent->number + 1;
+    }
+
+    if (number < MAX_GENTITIES)
+    {
+        Com_Memset(&client->entityDeferrals[number], 0, MAX_GENTITIES - number);
+    }
+}
+
+typedef struct {
+    int index;
+    float priority;
+} entityPriority_t;
+
+static int QDECL SV_QsortEntityPriorities(const void *a, const void *b)
+{
+    float pa = ((const entityPriority_t *)a)->priority;
+    float pb = ((const entityPriority_t *)b)->priority;
+
+    return pa < pb ? -1 : pa > pb;
+}
+
+/*
+=============
+SV_EmitClientPacketEntities
+
+Writes the entity updates of a snapshot and, if they come out over the
+client's budget, writes them again without the least important ones.
+
+A held back update must leave the frame looking like what the client
+ends up with, or later deltas from it would be wrong, so a changed entity
+keeps the state it had in the frame the client deltas from. Entities new
+to the client, temp event entities among them, removals, events and type
+changes, broadcast entities and updates already held back
+MAX_ENTITY_DEFERRALS times always go
+=============
+*/
+static void SV_EmitClientPacketEntities(client_t *client, clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg)
+{
+    static int bits[MAX_SNAPSHOT_ENTITIES];
+    static bool defer[MAX_SNAPSHOT_ENTITIES];
+    static entityPriority_t candidates[MAX_SNAPSHOT_ENTITIES];
+    entityState_t *oldent, *newent;
+    int alternateProtocol = SV_DeltaProtocol(client);
+    int budget, start, excess;
+    int oldindex, newindex, numCandidates, numDeferred;
+    bool countFields;
+    int i;
+
+    if (!sv_snapshotPriority->integer || to->num_entities > MAX_SNAPSHOT_ENTITIES)
+    {
+        SV_EmitPacketEntities(alternateProtocol, from, to, msg);
+        return;
+    }
+
+    SV_ForgetEntityDeferrals(client, to);
+
+    budget = SV_PacketEntitiesBudget(client, msg);
+    start = msg->bit;
+
+    // the field statistics only count the pass that is kept
+    countFields = msg_countFields;
+    msg_countFields = false;
+    SV_EmitPacketEntities(alternateProtocol, from, to, msg, bits);
+    msg_countFields = countFields;
+
+    if (!msg->overflowed && msg->bit - start <= budget)
+    {
+        for (i = 0; i < to->num_entities; i++)
+        {
+            newent = &svs.snapshotEntities[(to->first_entity + i) % svs.numSnapshotEntities];
+            client->entityDeferrals[newent->number] = 0;
+        }
+
+        // the measuring pass is kept, write it again to count it
+        if (countFields)
+        {
+            MSG_Rewind(msg, start);
+            SV_EmitPacketEntities(alternateProtocol, from, to, msg);
+        }
+        return;
+    }
+
+    // find the updates that may wait, pairing the frames up the same way
+    // SV_EmitPacketEntities does
+    numCandidates = 0;
+    oldindex = 0;
+    for (newindex = 0; newindex < to->num_entities; newindex++)
+    {
+        newent = &svs.snapshotEntities[(to->first_entity + newindex) % svs.numSnapshotEntities];
+        oldent = NULL;
+        defer[newindex] = false;
+
+        for (; from && oldindex < from->num_entities; oldindex++)
+        {
+            oldent = &svs.snapshotEntities[(from->first_entity + oldindex) % svs.numSnapshotEntities];
+            if (oldent->number >= newent->number)
+            {
+                break;
+            }
+        }
+        if (oldent && oldent->number != newent->number)
+        {
+            oldent = NULL;
+        }
+
+        if (!bits[newindex] || client->entityDeferrals[newent->number] >= MAX_ENTITY_DEFERRALS ||
+            (SV_GentityNum(newent->number)->r.svFlags & SVF_BROADCAST))
+        {
+            continue;
+        }
+
+        // temp entities are always new and only live for a moment,
+        // holding one back could lose its event
+        if (!oldent || newent->event)
+        {
+            continue;
+        }
+
+        if (oldent->event != newent->event || oldent->eType != newent->eType)
+        {
+            continue;
+        }
+
+        candidates[numCandidates].index = newindex;
+        candidates[numCandidates].priority = SV_EntityPriority(client, to, newent);
+        numCandidates++;
+    }
+
+    qsort(candidates, numCandidates, sizeof(candidates[0]), SV_QsortEntityPriorities);
+
+    excess = msg->bit - start - budget;
+    for (i = 0; i < numCandidates && excess > 0; i++)
+    {
+        defer[candidates[i].index] = true;
+        excess -= bits[candidates[i].index];
+    }
+
+    MSG_Rewind(msg, start);
+    SV_EmitPacketEntities(alternateProtocol, from, to, msg, nullptr, defer);
+
+    // make the frame match what the client will have
+    numDeferred = 0;
+    oldindex = 0;
+    for (i = 0; i < to->num_entities; i++)
+    {
+        newent = &svs.snapshotEntities[(to->first_entity + i) % svs.numSnapshotEntities];
+
+        if (!defer[i])
+        {
+            client->entityDeferrals[newent->number] = 0;
+            continue;
+        }
+
+        numDeferred++;
+        client->entityDeferrals[newent->number]++;
+
+        // only entities the client already has are held back
+        for (; oldindex < from->num_entities; oldindex++)
+        {
+            oldent = &svs.snapshotEntities[(from->first_entity + oldindex) % svs.numSnapshotEntities];
+            if (oldent->number >= newent->number)
+            {
+                break;
+            }
+        }
+        *newent = *oldent;
+    }
+
+    SV_ProfileCount(PROFC_DEFERRED, numDeferred);
+}
+
 /*
 ==================
 SV_WriteSnapshotToClient
@@ -216,15 +503,15 @@ static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg)
     // delta encode the playerstate
     if (oldframe)
     {
-        MSG_WriteDeltaPlayerstate(client->netchan.alternateProtocol, msg, &oldframe->ps, &frame->ps);
+        MSG_WriteDeltaPlayerstate(SV_DeltaProtocol(client), msg, &oldframe->ps, &frame->ps);
     }
     else
     {
-        MSG_WriteDeltaPlayerstate(client->netchan.alternateProtocol, msg, NULL, &frame->ps);
+        MSG_WriteDeltaPlayerstate(SV_DeltaProtocol(client), msg, NULL, &frame->ps);
     }
 
     // delta encode the entities
-    SV_EmitPacketEntities(client->netchan.alternateProtocol, oldframe, frame, msg);
+    SV_EmitClientPacketEntities(client, oldframe, frame, msg);
 
     // padding for rate debugging
     if (sv_padPackets->integer)
@@ -252,7 +539,7 @@ void SV_UpdateServerCommandsToClient(client_t *client, msg_t *msg)
     {
         MSG_WriteByte(msg, svc_serverCommand);
         MSG_WriteLong(msg, i);
-        MSG_WriteString(msg, client->reliableCommands[i & (MAX_RELIABLE_COMMANDS - 1)]);
+        SV_WriteServerCommand(msg, client->reliableCommands[i & (MAX_RELIABLE_COMMANDS - 1)]);
     }
     client->reliableSent = client->reliableSequence;
 }
@@ -662,6 +949,8 @@ void SV_SendMessageToClient(msg_t *msg, client_t *client)
     client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
     client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
+    SV_ProfileCount(PROFC_BYTES_SENT, msg->cursize);
+
     // send the datagram
     SV_Netchan_Transmit(client, msg);
 }
@@ -678,10 +967,14 @@ void SV_SendClientSnapshot(client_t *client)
 {
     byte msg_buf[MAX_MSGLEN];
     msg_t msg;
+    int64_t start;
 
     // build the snapshot
+    start = SV_ProfileStart();
     SV_BuildClientSnapshot(client);
+    SV_ProfileEnd(PROF_SNAPSHOT_BUILD, start);
 
+    start = SV_ProfileStart();
     MSG_Init(&msg, msg_buf, sizeof(msg_buf));
     msg.allowoverflow = true;
 
@@ -706,8 +999,82 @@ void SV_SendClientSnapshot(client_t *client)
         Com_Printf("WARNING: msg overflowed for %s\n", client->name);
         MSG_Clear(&msg);
     }
+    SV_ProfileEnd(PROF_SNAPSHOT_ENCODE, start);
 
+    start = SV_ProfileStart();
     SV_SendMessageToClient(&msg, client);
+    SV_ProfileEnd(PROF_SNAPSHOT_SEND, start);
+    SV_ProfileCount(PROFC_SNAPSHOTS, 1);
+}
+
+/*
+=======================
+SV_SnapshotClock
+
+svs.time carried on through the time banked towards the next game frame,
+so snapshot slots can fall between frames
+=======================
+*/
+int SV_SnapshotClock(void) { return svs.time + sv.timeResidual; }
+
+/*
+=======================
+SV_SnapshotPhase
+
+Where in its snapshot interval a client's slot sits. The client number is
+bit reversed so however many of the low slots are taken, the clients land
+spread evenly over the interval. With sv_snapshotStagger 1 the phase is
+rounded down to a game frame so no snapshot waits for its data
+=======================
+*/
+static int SV_SnapshotPhase(client_t *client, int interval)
+{
+    int num = client - svs.clients;
+    int reversed = 0;
+    int bit, mirror, phase, frameMsec;
+
+    for (bit = 1, mirror = MAX_CLIENTS >> 1; mirror; bit <<= 1, mirror >>= 1)
+    {
+        if (num & bit)
+        {
+            reversed |= mirror;
+        }
+    }
+
+    phase = reversed * interval / MAX_CLIENTS;
+
+    if (sv_snapshotStagger->integer < 2)
+    {
+        frameMsec = MAX((int)(1000 / MAX(sv_fps->integer, 1) * com_timescale->value), 1);
+        phase -= phase % frameMsec;
+    }
+
+    return phase;
+}
+
+/*
+=======================
+SV_SnapshotJitter
+
+Tracks how far the gaps between a client's snapshots stray from
+snapshotMsec, smoothed the way RFC 3550 smooths packet jitter. Called
+before lastSnapshotTime is updated, so a snapshot asked for out of turn
+doesn't count as a gap
+=======================
+*/
+static void SV_SnapshotJitter(client_t *client)
+{
+    int64_t now = Sys_Microseconds();
+    int distance;
+
+    if (client->lastSnapshotUsec && client->lastSnapshotTime)
+    {
+        distance = abs((int)(now - client->lastSnapshotUsec) - client->snapshotMsec * 1000);
+        client->snapshotJitter += (distance - client->snapshotJitter) / 16;
+        client->snapshotJitterMax = MAX(client->snapshotJitterMax, distance);
+    }
+
+    client->lastSnapshotUsec = now;
 }
 
 /*
@@ -719,6 +1086,10 @@ void SV_SendClientMessages(void)
 {
     int i;
     client_t *c;
+    int now = SV_SnapshotClock();
+    int interval, phase;
+
+    svs.snapshotWakeTime = 0;
 
     // send a message to each connected client
     for (i = 0; i < sv_maxclients->integer; i++)
@@ -727,7 +1098,19 @@ void SV_SendClientMessages(void)
 
         if (!c->state) continue;  // not connected
 
-        if (svs.time - c->lastSnapshotTime < c->snapshotMsec * com_timescale->value) continue; // It's not time yet
+        interval = MAX((int)(c->snapshotMsec * com_timescale->value), 1);
+
+        if (!sv_snapshotStagger->integer)
+        {
+            if (svs.time - c->lastSnapshotTime < interval) continue; // It's not time yet
+        }
+        else if (c->lastSnapshotTime && now < c->nextSnapshotTime)
+        {
+            // It's not time yet, remember when to wake up for it
+            if (!svs.snapshotWakeTime || c->nextSnapshotTime < svs.snapshotWakeTime)
+                svs.snapshotWakeTime = c->nextSnapshotTime;
+            continue;
+        }
 
         if (*c->downloadName) continue;  // Client is downloading, don't send snapshots
 
@@ -737,8 +1120,7 @@ void SV_SendClientMessages(void)
             continue;  // Drop this snapshot if the packet queue is still full or delta compression will break
         }
 
-        if (!(c->netchan.remoteAddress.type == NA_LOOPBACK ||
-                (sv_lanForceRate->integer && Sys_IsLANAddress(c->netchan.remoteAddress))))
+        if (SV_RateLimited(c))
         {
             // rate control for clients not on LAN
 
@@ -752,7 +1134,12 @@ void SV_SendClientMessages(void)
 
         // generate and send a new message
         SV_SendClientSnapshot(c);
+        SV_SnapshotJitter(c);
         c->lastSnapshotTime = svs.time;
         c->rateDelayed = false;
+
+        // the next slot on this client's grid, late sends don't shift the grid
+        phase = SV_SnapshotPhase(c, interval);
+        c->nextSnapshotTime = now - (((now - phase) % interval) + interval) % interval + interval;
     }
 }
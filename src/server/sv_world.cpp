@@ -229,6 +229,8 @@ void SV_LinkEntity(sharedEntity_t *gEnt)
     float *origin, *angles;
     svEntity_t *ent;
 
+    SV_ProfileCount(PROFC_LINKS, 1);
+
     ent = SV_SvEntityForGentity(gEnt);
 
     if (ent->worldSector)
@@ -472,6 +474,94 @@ int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int m
     return ap.count;
 }
 
+struct radiusEntity_t {
+    int num;
+    float distSquared;
+};
+
+static int QDECL SV_CompareRadiusEntities(const void *a, const void *b)
+{
+    const radiusEntity_t *ra = (const radiusEntity_t *)a;
+    const radiusEntity_t *rb = (const radiusEntity_t *)b;
+
+    if (ra->distSquared != rb->distSquared)
+    {
+        return ra->distSquared < rb->distSquared ? -1 : 1;
+    }
+
+    return ra->num - rb->num;
+}
+
+/*
+================
+SV_EntitiesInRadius
+
+The area entities whose bounds come closer than radius to origin, measured
+to the nearest point of the box, nearest first
+================
+*/
+int SV_EntitiesInRadius(const vec3_t origin, float radius, int contentmask, int *entityList, int maxcount)
+{
+    static int touch[MAX_GENTITIES];
+    static radiusEntity_t found[MAX_GENTITIES];
+    vec3_t mins, maxs;
+    int i, j, num, count = 0;
+
+    for (i = 0; i < 3; i++)
+    {
+        mins[i] = origin[i] - radius;
+        maxs[i] = origin[i] + radius;
+    }
+
+    num = SV_AreaEntities(mins, maxs, touch, MAX_GENTITIES);
+
+    for (i = 0; i < num; i++)
+    {
+        sharedEntity_t *check = SV_GentityNum(touch[i]);
+        float distSquared = 0.0f;
+
+        if (contentmask && !(check->r.contents & contentmask))
+        {
+            continue;
+        }
+
+        for (j = 0; j < 3; j++)
+        {
+            float d = 0.0f;
+
+            if (origin[j] < check->r.absmin[j])
+            {
+                d = check->r.absmin[j] - origin[j];
+            }
+            else if (origin[j] > check->r.absmax[j])
+            {
+                d = origin[j] - check->r.absmax[j];
+            }
+
+            distSquared += d * d;
+        }
+
+        if (distSquared >= radius * radius)
+        {
+            continue;
+        }
+
+        found[count].num = touch[i];
+        found[count].distSquared = distSquared;
+        count++;
+    }
+
+    qsort(found, count, sizeof(found[0]), SV_CompareRadiusEntities);
+
+    count = MIN(count, maxcount);
+    for (i = 0; i < count; i++)
+    {
+        entityList[i] = found[i].num;
+    }
+
+    return count;
+}
+
 //===========================================================================
 
 struct moveclip_t {
@@ -648,6 +738,8 @@ void SV_Trace(trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, co
     moveclip_t clip;
     int i;
 
+    SV_ProfileCount(PROFC_TRACES, 1);
+
     if (!mins)
     {
         mins = vec3_origin;
@@ -57,6 +57,9 @@ void Sys_Print(const char *msg);
 // any game related timing information should come from event timestamps
 int Sys_Milliseconds(void);
 
+// monotonic microsecond clock with an arbitrary origin, for profiling only
+int64_t Sys_Microseconds(void);
+
 bool Sys_RandomBytes(byte *string, int len);
 
 void Sys_CryptoRandomBytes(byte *string, int len);
@@ -69,6 +72,10 @@ cpuFeatures_t Sys_GetProcessorFeatures(void);
 void Sys_SetErrorText(const char *text);
 
 FILE *Sys_FOpen(const char *ospath, const char *mode);
+void *Sys_MapFile(const char *ospath, int *length);
+void Sys_UnmapFile(void *data, int length);
+bool Sys_StatFile(const char *ospath, int64_t *size, int64_t *mtime);
+void Sys_TouchFile(const char *ospath);
 bool Sys_Mkdir(const char *path);
 FILE *Sys_Mkfifo(const char *ospath);
 bool Sys_OpenWithDefault( const char *path );
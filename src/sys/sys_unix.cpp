@@ -115,6 +115,20 @@ int Sys_Milliseconds (void)
 	return curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+int64_t Sys_Microseconds (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /*
 ==================
 Sys_RandomBytes
@@ -215,6 +229,79 @@ FILE *Sys_FOpen( const char *ospath, const char *mode ) {
 	return fopen( ospath, mode );
 }
 
+/*
+==============
+Sys_MapFile
+
+Maps a whole file read only, returns NULL if it does not exist or is empty
+==============
+*/
+void *Sys_MapFile( const char *ospath, int *length ) {
+	struct stat buf;
+	void *data;
+	int fd;
+
+	*length = 0;
+
+	fd = open( ospath, O_RDONLY );
+	if ( fd == -1 )
+		return NULL;
+
+	if ( fstat( fd, &buf ) || !S_ISREG( buf.st_mode ) || buf.st_size <= 0 || buf.st_size > INT_MAX ) {
+		close( fd );
+		return NULL;
+	}
+
+	data = mmap( NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	*length = buf.st_size;
+	return data;
+}
+
+/*
+==============
+Sys_UnmapFile
+==============
+*/
+void Sys_UnmapFile( void *data, int length ) {
+	if ( data )
+		munmap( data, length );
+}
+
+/*
+==============
+Sys_StatFile
+
+Size and modification time of a regular file, the time is only good
+for comparing with other files
+==============
+*/
+bool Sys_StatFile( const char *ospath, int64_t *size, int64_t *mtime ) {
+	struct stat buf;
+
+	if ( stat( ospath, &buf ) || !S_ISREG( buf.st_mode ) )
+		return false;
+
+	*size = buf.st_size;
+	*mtime = buf.st_mtime;
+	return true;
+}
+
+/*
+==============
+Sys_TouchFile
+
+Sets the modification time of a file to now
+==============
+*/
+void Sys_TouchFile( const char *ospath ) {
+	utimes( ospath, NULL );
+}
+
 /*
 ==================
 Sys_Mkdir
@@ -101,6 +101,25 @@ int Sys_Milliseconds (void)
 	return sys_curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+int64_t Sys_Microseconds (void)
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (!frequency.QuadPart) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+
+	return (int64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+		(int64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
 /*
 ================
 Sys_RandomBytes
@@ -230,6 +249,94 @@ FILE *Sys_FOpen( const char *ospath, const char *mode ) {
 	return fopen( ospath, mode );
 }
 
+/*
+==============
+Sys_MapFile
+
+Maps a whole file read only, returns NULL if it does not exist or is empty
+==============
+*/
+void *Sys_MapFile( const char *ospath, int *length ) {
+	HANDLE file, mapping;
+	LARGE_INTEGER size;
+	void *data;
+
+	*length = 0;
+
+	file = CreateFile( ospath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	if ( !GetFileSizeEx( file, &size ) || size.QuadPart <= 0 || size.QuadPart > INT_MAX ) {
+		CloseHandle( file );
+		return NULL;
+	}
+
+	mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( !mapping )
+		return NULL;
+
+	data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+
+	if ( !data )
+		return NULL;
+
+	*length = (int)size.QuadPart;
+	return data;
+}
+
+/*
+==============
+Sys_UnmapFile
+==============
+*/
+void Sys_UnmapFile( void *data, int length ) {
+	if ( data )
+		UnmapViewOfFile( data );
+}
+
+/*
+==============
+Sys_StatFile
+
+Size and modification time of a regular file, the time is only good
+for comparing with other files
+==============
+*/
+bool Sys_StatFile( const char *ospath, int64_t *size, int64_t *mtime ) {
+	WIN32_FILE_ATTRIBUTE_DATA data;
+
+	if ( !GetFileAttributesEx( ospath, GetFileExInfoStandard, &data ) ||
+		( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+		return false;
+
+	*size = ( (int64_t)data.nFileSizeHigh << 32 ) | data.nFileSizeLow;
+	*mtime = ( (int64_t)data.ftLastWriteTime.dwHighDateTime << 32 ) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+/*
+==============
+Sys_TouchFile
+
+Sets the modification time of a file to now
+==============
+*/
+void Sys_TouchFile( const char *ospath ) {
+	HANDLE file;
+	FILETIME now;
+
+	file = CreateFile( ospath, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return;
+
+	GetSystemTimeAsFileTime( &now );
+	SetFileTime( file, NULL, NULL, &now );
+	CloseHandle( file );
+}
+
 /*
 ==============
 Sys_Mkdir